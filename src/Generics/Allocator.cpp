@@ -435,6 +435,416 @@ namespace Generics
     }
 
 
+    //
+    // class ThreadMagazines::FreeList
+    //
+
+    ThreadMagazines::FreeList::FreeList() throw ()
+      : head(0), count(0)
+    {
+    }
+
+    inline
+    void
+    ThreadMagazines::FreeList::push(Pointer ptr) throw ()
+    {
+      *static_cast<Pointer*>(ptr) = head;
+      head = ptr;
+      // Other threads read the counters for statistics only
+      __atomic_store_n(&count, count + 1, __ATOMIC_RELAXED);
+    }
+
+    inline
+    Base::Pointer
+    ThreadMagazines::FreeList::pop() throw ()
+    {
+      Pointer ptr = head;
+      head = *static_cast<Pointer*>(ptr);
+      __atomic_store_n(&count, count - 1, __ATOMIC_RELAXED);
+      return ptr;
+    }
+
+    void
+    ThreadMagazines::FreeList::split(FreeList& list, size_t number) throw ()
+    {
+      Pointer tail = head;
+      for (size_t i = 1; i < number; i++)
+      {
+        tail = *static_cast<Pointer*>(tail);
+      }
+      list.head = head;
+      list.count = number;
+      head = *static_cast<Pointer*>(tail);
+      *static_cast<Pointer*>(tail) = 0;
+      __atomic_store_n(&count, count - number, __ATOMIC_RELAXED);
+    }
+
+    void
+    ThreadMagazines::FreeList::release() throw ()
+    {
+      while (head)
+      {
+        Pointer next = *static_cast<Pointer*>(head);
+        delete [] static_cast<unsigned char*>(head);
+        head = next;
+      }
+      __atomic_store_n(&count, 0, __ATOMIC_RELAXED);
+    }
+
+
+    //
+    // class ThreadMagazines::Stats
+    //
+
+    ThreadMagazines::Stats::Stats() throw ()
+      : hits(0), misses(0)
+    {
+    }
+
+    inline
+    void
+    ThreadMagazines::Stats::hit() throw ()
+    {
+      __atomic_store_n(&hits, hits + 1, __ATOMIC_RELAXED);
+    }
+
+    inline
+    void
+    ThreadMagazines::Stats::miss() throw ()
+    {
+      __atomic_store_n(&misses, misses + 1, __ATOMIC_RELAXED);
+    }
+
+    void
+    ThreadMagazines::Stats::add(const Stats& stats) throw ()
+    {
+      hits += __atomic_load_n(&stats.hits, __ATOMIC_RELAXED);
+      misses += __atomic_load_n(&stats.misses, __ATOMIC_RELAXED);
+    }
+
+
+    //
+    // class ThreadMagazines::ThreadCache
+    //
+
+    ThreadMagazines::ThreadCache::ThreadCache(ThreadMagazines* owner_val,
+      size_t index_val) throw (eh::Exception)
+      : owner(owner_val), index(index_val), lists(owner_val->CLASSES_)
+    {
+    }
+
+
+    //
+    // class ThreadMagazines
+    //
+
+    const size_t ThreadMagazines::DEF_MIN_CODE;
+    const size_t ThreadMagazines::DEF_MAX_CODE;
+    const size_t ThreadMagazines::DEF_MAGAZINE_BLOCKS;
+    const size_t ThreadMagazines::DEF_MAGAZINE_BYTES;
+    const size_t ThreadMagazines::DEF_POOL_MAGAZINES;
+
+    ThreadMagazines::ThreadMagazines(size_t min_code, size_t max_code,
+      size_t magazine_blocks, size_t magazine_bytes, size_t pool_magazines)
+      throw (Exception, eh::Exception)
+      : MIN_CODE_(min_code), MAX_SIZE_(static_cast<size_t>(1) << max_code),
+        POOL_MAGAZINES_(pool_magazines),
+        CLASSES_((max_code - min_code) * 4 + 1),
+        threads_(0)
+    {
+      if ((static_cast<size_t>(1) << min_code) < sizeof(Pointer) ||
+        min_code < 2 || max_code < min_code ||
+        max_code >= sizeof(size_t) * 8 - 1)
+      {
+        Stream::Error ostr;
+        ostr << FNS << "invalid size classes range " << min_code <<
+          " - " << max_code;
+        throw Exception(ostr);
+      }
+
+      classes_.reset(CLASSES_);
+      for (size_t i = 0; i < CLASSES_; i++)
+      {
+        SizeClass& size_class = classes_[i];
+        if (i)
+        {
+          const size_t SHIFT = (i - 1) / 4 + MIN_CODE_ - 2;
+          size_class.size = (4 + (i - 1) % 4 + 1) << SHIFT;
+        }
+        else
+        {
+          size_class.size = static_cast<size_t>(1) << MIN_CODE_;
+        }
+        size_class.magazine = std::max<size_t>(1,
+          std::min(magazine_blocks, magazine_bytes / size_class.size));
+        // No allocations under the lock later
+        size_class.magazines.reserve(POOL_MAGAZINES_);
+      }
+
+      if (const int RES = pthread_key_create(&key_, thread_exit_))
+      {
+        eh::throw_errno_exception<Exception>(RES, FNE,
+          "Failed to create thread key");
+      }
+    }
+
+    ThreadMagazines::~ThreadMagazines() throw ()
+    {
+      // Exiting threads do not access the object after this
+      pthread_key_delete(key_);
+
+      for (ThreadCaches::iterator it = caches_.begin(); it != caches_.end();
+        ++it)
+      {
+        for (size_t i = 0; i < CLASSES_; i++)
+        {
+          (*it)->lists[i].release();
+        }
+        delete *it;
+      }
+
+      for (size_t i = 0; i < CLASSES_; i++)
+      {
+        std::vector<FreeList>& magazines = classes_[i].magazines;
+        for (std::vector<FreeList>::iterator it = magazines.begin();
+          it != magazines.end(); ++it)
+        {
+          it->release();
+        }
+      }
+    }
+
+    inline
+    size_t
+    ThreadMagazines::class_(size_t size) const throw ()
+    {
+      if (size <= (static_cast<size_t>(1) << MIN_CODE_))
+      {
+        return 0;
+      }
+      const size_t VALUE = size - 1;
+      const size_t CODE = BitAlgs::highest_bit_64(VALUE);
+      return (CODE - MIN_CODE_) * 4 + ((VALUE >> (CODE - 2)) & 3) + 1;
+    }
+
+    inline
+    ThreadMagazines::ThreadCache*
+    ThreadMagazines::thread_cache_() throw (eh::Exception)
+    {
+      ThreadCache* cache =
+        static_cast<ThreadCache*>(pthread_getspecific(key_));
+      if (cache)
+      {
+        return cache;
+      }
+
+      {
+        Sync::PosixGuard guard(mutex_);
+        caches_.push_back(0);
+        try
+        {
+          caches_.back() = cache = new ThreadCache(this, threads_++);
+        }
+        catch (...)
+        {
+          caches_.pop_back();
+          throw;
+        }
+      }
+
+      if (const int RES = pthread_setspecific(key_, cache))
+      {
+        release_cache_(cache);
+        eh::throw_errno_exception<Exception>(RES, FNE,
+          "Failed to set thread cache");
+      }
+      return cache;
+    }
+
+    void
+    ThreadMagazines::thread_exit_(void* cache) throw ()
+    {
+      ThreadCache* thread_cache = static_cast<ThreadCache*>(cache);
+      thread_cache->owner->release_cache_(thread_cache);
+    }
+
+    void
+    ThreadMagazines::release_cache_(ThreadCache* cache) throw ()
+    {
+      for (size_t i = 0; i < CLASSES_; i++)
+      {
+        FreeList& list = cache->lists[i];
+        while (list.count)
+        {
+          FreeList magazine;
+          list.split(magazine,
+            std::min(list.count, classes_[i].magazine));
+          put_magazine_(i, magazine);
+        }
+      }
+
+      Sync::PosixGuard guard(mutex_);
+      finished_.add(cache->stats);
+      caches_.remove(cache);
+      delete cache;
+    }
+
+    bool
+    ThreadMagazines::get_magazine_(size_t size_class, FreeList& list)
+      throw ()
+    {
+      SizeClass& cls = classes_[size_class];
+
+      Sync::PosixGuard guard(mutex_);
+      if (cls.magazines.empty())
+      {
+        cls.stats.miss();
+        return false;
+      }
+      cls.stats.hit();
+      list.head = cls.magazines.back().head;
+      __atomic_store_n(&list.count, cls.magazines.back().count,
+        __ATOMIC_RELAXED);
+      cls.magazines.pop_back();
+      return true;
+    }
+
+    void
+    ThreadMagazines::put_magazine_(size_t size_class, FreeList& list)
+      throw ()
+    {
+      SizeClass& cls = classes_[size_class];
+
+      {
+        Sync::PosixGuard guard(mutex_);
+        if (cls.magazines.size() < POOL_MAGAZINES_)
+        {
+          cls.magazines.push_back(list);
+          list = FreeList();
+          return;
+        }
+      }
+      list.release();
+    }
+
+    Base::Pointer
+    ThreadMagazines::allocate(size_t& size)
+      throw (eh::Exception, OutOfMemory)
+    {
+      if (size > MAX_SIZE_)
+      {
+        return new unsigned char[size];
+      }
+
+      const size_t SIZE_CLASS = class_(size);
+      size = classes_[SIZE_CLASS].size;
+
+      ThreadCache* cache = thread_cache_();
+      FreeList& list = cache->lists[SIZE_CLASS];
+      if (!list.count && !get_magazine_(SIZE_CLASS, list))
+      {
+        cache->stats.miss();
+        return new unsigned char[size];
+      }
+      cache->stats.hit();
+      return list.pop();
+    }
+
+    void
+    ThreadMagazines::deallocate(Pointer ptr, size_t size) throw ()
+    {
+      if (size <= MAX_SIZE_)
+      {
+        try
+        {
+          const size_t SIZE_CLASS = class_(size);
+          assert(classes_[SIZE_CLASS].size == size);
+
+          FreeList& list = thread_cache_()->lists[SIZE_CLASS];
+          list.push(ptr);
+
+          const size_t MAGAZINE = classes_[SIZE_CLASS].magazine;
+          if (list.count >= 2 * MAGAZINE)
+          {
+            FreeList magazine;
+            list.split(magazine, MAGAZINE);
+            put_magazine_(SIZE_CLASS, magazine);
+          }
+          return;
+        }
+        catch (const eh::Exception&)
+        {
+        }
+      }
+      delete [] static_cast<unsigned char*>(ptr);
+    }
+
+    size_t
+    ThreadMagazines::cached() const throw (eh::Exception)
+    {
+      size_t cached = 0;
+
+      Sync::PosixGuard guard(mutex_);
+      for (size_t i = 0; i < CLASSES_; i++)
+      {
+        const SizeClass& cls = classes_[i];
+        for (std::vector<FreeList>::const_iterator it =
+          cls.magazines.begin(); it != cls.magazines.end(); ++it)
+        {
+          cached += it->count * cls.size;
+        }
+        for (ThreadCaches::const_iterator it = caches_.begin();
+          it != caches_.end(); ++it)
+        {
+          cached += __atomic_load_n(&(*it)->lists[i].count,
+            __ATOMIC_RELAXED) * cls.size;
+        }
+      }
+      return cached;
+    }
+
+    void
+    ThreadMagazines::print_cached(std::ostream& ostr) const
+      throw (eh::Exception)
+    {
+      ostr << cached() << " G:";
+
+      Sync::PosixGuard guard(mutex_);
+      for (size_t i = 0; i < CLASSES_; i++)
+      {
+        const SizeClass& cls = classes_[i];
+        if (cls.stats.hits || cls.stats.misses)
+        {
+          size_t blocks = 0;
+          for (std::vector<FreeList>::const_iterator it =
+            cls.magazines.begin(); it != cls.magazines.end(); ++it)
+          {
+            blocks += it->count;
+          }
+          ostr << ' ' << cls.size << ':' << blocks << '(' <<
+            cls.stats.hits << '+' << cls.stats.misses << ')';
+        }
+      }
+
+      ostr << " T:";
+      for (ThreadCaches::const_iterator it = caches_.begin();
+        it != caches_.end(); ++it)
+      {
+        size_t blocks = 0;
+        for (size_t i = 0; i < CLASSES_; i++)
+        {
+          blocks += __atomic_load_n(&(*it)->lists[i].count,
+            __ATOMIC_RELAXED);
+        }
+        Stats stats;
+        stats.add((*it)->stats);
+        ostr << " [" << (*it)->index << "] " << blocks << '(' <<
+          stats.hits << '+' << stats.misses << ')';
+      }
+      ostr << " F:(" << finished_.hits << '+' << finished_.misses << ')';
+    }
+
+
     //
     // class Align
     //
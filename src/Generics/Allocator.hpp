@@ -26,8 +26,10 @@
 
 #include <iostream>
 #include <list>
+#include <vector>
 
 #include <signal.h>
+#include <pthread.h>
 
 
 #include <ReferenceCounting/ReferenceCounting.hpp>
@@ -389,6 +391,183 @@ namespace Generics
       get_allocator_(size_t size) throw ();
     };
 
+    /**
+     * Allocator with per-thread magazines of free blocks.
+     * Requested sizes are rounded up to size classes (four classes per
+     * power of two, from 2^min_code to 2^max_code bytes), bigger blocks
+     * are allocated and released directly.
+     * Each thread keeps a bounded free list for every size class and takes
+     * nothing but its own list in the fast path. The list exchanges
+     * magazines (batches of free blocks) with the global pool: an empty
+     * list takes one, an overflowed list gives one away. So the global
+     * lock is taken once per magazine, not once per block.
+     */
+    class ThreadMagazines :
+      public Base,
+      public ReferenceCounting::AtomicImpl
+    {
+    public:
+      DECLARE_EXCEPTION(Exception, eh::DescriptiveException);
+
+      static const size_t DEF_MIN_CODE = 5;
+      static const size_t DEF_MAX_CODE = 20;
+      static const size_t DEF_MAGAZINE_BLOCKS = 32;
+      static const size_t DEF_MAGAZINE_BYTES = 64 * 1024;
+      static const size_t DEF_POOL_MAGAZINES = 16;
+
+      /**
+       * @param min_code 2^min_code is the smallest size class, not less
+       * than pointer size
+       * @param max_code 2^max_code is the biggest size class
+       * @param magazine_blocks maximum number of blocks in a magazine
+       * @param magazine_bytes maximum size of blocks in a magazine,
+       * magazines of big blocks are shorter, one block at least
+       * @param pool_magazines number of magazines of each size class kept
+       * in the global pool, the rest is released
+       */
+      explicit
+      ThreadMagazines(
+        size_t min_code = DEF_MIN_CODE,
+        size_t max_code = DEF_MAX_CODE,
+        size_t magazine_blocks = DEF_MAGAZINE_BLOCKS,
+        size_t magazine_bytes = DEF_MAGAZINE_BYTES,
+        size_t pool_magazines = DEF_POOL_MAGAZINES)
+        throw (Exception, eh::Exception);
+
+      virtual
+      Pointer
+      allocate(size_t& size) throw (eh::Exception, OutOfMemory);
+
+      virtual
+      void
+      deallocate(Pointer ptr, size_t size) throw ();
+
+      virtual
+      size_t
+      cached() const throw (eh::Exception);
+
+      /**
+       * Prints total cached size, then for the global pool
+       * class_size:blocks(hits+misses) of the size classes in use, where
+       * hits are magazines taken by the threads and misses are system
+       * allocations, then for every thread
+       * [index] blocks(hits+misses) of its free lists.
+       */
+      virtual
+      void
+      print_cached(std::ostream& ostr) const throw (eh::Exception);
+
+    protected:
+      virtual
+      ~ThreadMagazines() throw ();
+
+    private:
+      /**
+       * Free blocks are linked through their first word
+       */
+      struct FreeList
+      {
+        FreeList() throw ();
+
+        void
+        push(Pointer ptr) throw ();
+
+        Pointer
+        pop() throw ();
+
+        /**
+         * Moves count first blocks into the list
+         */
+        void
+        split(FreeList& list, size_t count) throw ();
+
+        void
+        release() throw ();
+
+        Pointer head;
+        size_t count;
+      };
+
+      struct Stats
+      {
+        Stats() throw ();
+
+        void
+        hit() throw ();
+
+        void
+        miss() throw ();
+
+        void
+        add(const Stats& stats) throw ();
+
+        uint64_t hits;
+        uint64_t misses;
+      };
+
+      struct ThreadCache
+      {
+        ThreadCache(ThreadMagazines* owner, size_t index)
+          throw (eh::Exception);
+
+        ThreadMagazines* owner;
+        size_t index;
+        ArrayAutoPtr<FreeList> lists;
+        Stats stats;
+      };
+      typedef std::list<ThreadCache*> ThreadCaches;
+
+      struct SizeClass
+      {
+        size_t size;
+        size_t magazine;
+        std::vector<FreeList> magazines;
+        Stats stats;
+      };
+
+      size_t
+      class_(size_t size) const throw ();
+
+      ThreadCache*
+      thread_cache_() throw (eh::Exception);
+
+      void
+      release_cache_(ThreadCache* cache) throw ();
+
+      static
+      void
+      thread_exit_(void* cache) throw ();
+
+      /**
+       * Gets a magazine of free blocks from the global pool
+       * @return false if the pool is empty
+       */
+      bool
+      get_magazine_(size_t size_class, FreeList& list) throw ();
+
+      /**
+       * Puts the magazine into the global pool, releases it if the pool
+       * is full
+       */
+      void
+      put_magazine_(size_t size_class, FreeList& list) throw ();
+
+    private:
+      const size_t MIN_CODE_;
+      const size_t MAX_SIZE_;
+      const size_t POOL_MAGAZINES_;
+      const size_t CLASSES_;
+
+      pthread_key_t key_;
+
+      mutable Sync::PosixMutex mutex_;
+      ArrayAutoPtr<SizeClass> classes_;
+      ThreadCaches caches_;
+      size_t threads_;
+      Stats finished_;
+    };
+
+
     /**
      * Returns aligned pointer
      */
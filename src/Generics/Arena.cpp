@@ -0,0 +1,197 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <algorithm>
+
+#include <Generics/Arena.hpp>
+
+
+namespace Generics
+{
+  const size_t Arena::ALIGN;
+  const size_t Arena::MIN_CLASS_CODE;
+  const size_t Arena::MAX_CLASS_CODE;
+  const size_t Arena::MAX_CLASS_SIZE;
+  const size_t Arena::CLASSES;
+  const size_t Arena::DEF_CHUNK_SIZE;
+  const size_t Arena::CHUNK_HEADER_;
+  const size_t Arena::BIG_HEADER_;
+
+  Arena::Arena(size_t chunk_size) throw (eh::Exception)
+    : CHUNK_SIZE_(std::max(chunk_size, MAX_CLASS_SIZE + CHUNK_HEADER_)),
+      first_(0), current_(0), cur_(0), end_(0), chunks_(0),
+      big_(0), big_count_(0), allocated_(0)
+  {
+    std::fill(free_, free_ + CLASSES, static_cast<Pointer>(0));
+  }
+
+  Arena::~Arena() throw ()
+  {
+    release_big_blocks_();
+    while (first_)
+    {
+      Chunk* next = first_->next;
+      delete [] reinterpret_cast<char*>(first_);
+      first_ = next;
+    }
+  }
+
+  Arena::Pointer
+  Arena::cut_(size_t size) throw (eh::Exception)
+  {
+    // The rest of the current chunk is lost till reset()
+    if (current_ && current_->next)
+    {
+      current_ = current_->next;
+    }
+    else
+    {
+      Chunk* chunk = reinterpret_cast<Chunk*>(new char[CHUNK_SIZE_]);
+      chunk->next = 0;
+      chunk->size = CHUNK_SIZE_;
+      if (current_)
+      {
+        current_->next = chunk;
+      }
+      else
+      {
+        first_ = chunk;
+      }
+      current_ = chunk;
+      ++chunks_;
+    }
+
+    cur_ = reinterpret_cast<char*>(current_) + CHUNK_HEADER_;
+    end_ = reinterpret_cast<char*>(current_) + current_->size;
+
+    Pointer ptr = cur_;
+    cur_ += size;
+    return ptr;
+  }
+
+  Arena::Pointer
+  Arena::allocate(size_t& size) throw (eh::Exception, OutOfMemory)
+  {
+    if (size <= MAX_CLASS_SIZE)
+    {
+      size = class_size_(class_(size));
+      return allocate_block(size);
+    }
+
+    size = (size + ALIGN - 1) & ~(ALIGN - 1);
+    BigBlock* block =
+      reinterpret_cast<BigBlock*>(new char[size + BIG_HEADER_]);
+    block->prev = 0;
+    block->next = big_;
+    if (big_)
+    {
+      big_->prev = block;
+    }
+    big_ = block;
+    ++big_count_;
+    allocated_ += size;
+    return reinterpret_cast<char*>(block) + BIG_HEADER_;
+  }
+
+  void
+  Arena::deallocate(Pointer ptr, size_t size) throw ()
+  {
+    if (size <= MAX_CLASS_SIZE)
+    {
+      deallocate_block(ptr, size);
+      return;
+    }
+
+    BigBlock* block = reinterpret_cast<BigBlock*>(
+      static_cast<char*>(ptr) - BIG_HEADER_);
+    if (block->prev)
+    {
+      block->prev->next = block->next;
+    }
+    else
+    {
+      big_ = block->next;
+    }
+    if (block->next)
+    {
+      block->next->prev = block->prev;
+    }
+    --big_count_;
+    allocated_ -= (size + ALIGN - 1) & ~(ALIGN - 1);
+    delete [] reinterpret_cast<char*>(block);
+  }
+
+  void
+  Arena::release_big_blocks_() throw ()
+  {
+    while (big_)
+    {
+      BigBlock* next = big_->next;
+      delete [] reinterpret_cast<char*>(big_);
+      big_ = next;
+    }
+    big_count_ = 0;
+  }
+
+  void
+  Arena::reset() throw ()
+  {
+    release_big_blocks_();
+    std::fill(free_, free_ + CLASSES, static_cast<Pointer>(0));
+    allocated_ = 0;
+
+    current_ = first_;
+    if (first_)
+    {
+      cur_ = reinterpret_cast<char*>(first_) + CHUNK_HEADER_;
+      end_ = reinterpret_cast<char*>(first_) + first_->size;
+    }
+  }
+
+  void
+  Arena::release() throw ()
+  {
+    reset();
+    if (first_)
+    {
+      while (first_->next)
+      {
+        Chunk* next = first_->next->next;
+        delete [] reinterpret_cast<char*>(first_->next);
+        first_->next = next;
+        --chunks_;
+      }
+    }
+  }
+
+  size_t
+  Arena::cached() const throw (eh::Exception)
+  {
+    return chunks_ * CHUNK_SIZE_;
+  }
+
+  void
+  Arena::print_cached(std::ostream& ostr) const throw (eh::Exception)
+  {
+    ostr << cached() << " C:" << chunks_ << " B:" << big_count_ <<
+      " A:" << allocated_;
+  }
+}
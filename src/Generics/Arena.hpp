@@ -0,0 +1,378 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef GENERICS_ARENA_HPP
+#define GENERICS_ARENA_HPP
+
+#include <memory>
+
+#include <Generics/Allocator.hpp>
+
+
+namespace Generics
+{
+  /**
+   * Memory arena for request scoped work.
+   * Small blocks are cut from big chunks and are rounded up to size
+   * classes (ALIGN step up to 64 bytes, then four classes per power of
+   * two up to MAX_CLASS_SIZE), deallocated blocks are kept in the size class free
+   * lists for the following allocations. Bigger blocks are allocated
+   * separately.
+   * reset() releases all the allocations at once: chunks are rewound and
+   * kept for the next use, free lists are dropped, so the cost does not
+   * depend on the number of allocations. Only separately allocated big
+   * blocks still alive are released one by one.
+   * Memory must not be used after reset() or the arena destruction.
+   * Not thread safe: an arena belongs to a single request (thread).
+   * Usable as Allocator::Base (MemBuf) and through ArenaAllocator
+   * (STL containers, OutputMemoryStream).
+   */
+  class Arena :
+    public Allocator::Base,
+    public ReferenceCounting::AtomicImpl
+  {
+  public:
+    static const size_t ALIGN = 16;
+    static const size_t MIN_CLASS_CODE = 6;
+    static const size_t MAX_CLASS_CODE = 14;
+    static const size_t MAX_CLASS_SIZE = 1 << MAX_CLASS_CODE;
+    static const size_t CLASSES = (MAX_CLASS_CODE - MIN_CLASS_CODE + 1) * 4;
+    static const size_t DEF_CHUNK_SIZE = 64 * 1024;
+
+    /**
+     * @param chunk_size size of chunks to cut small blocks from,
+     * not less than MAX_CLASS_SIZE is used
+     */
+    explicit
+    Arena(size_t chunk_size = DEF_CHUNK_SIZE) throw (eh::Exception);
+
+    virtual
+    Pointer
+    allocate(size_t& size) throw (eh::Exception, OutOfMemory);
+
+    virtual
+    void
+    deallocate(Pointer ptr, size_t size) throw ();
+
+    /**
+     * Allocates memory for STL allocators
+     * @param size requested size
+     * @return allocated block, aligned by ALIGN
+     */
+    Pointer
+    allocate_block(size_t size) throw (eh::Exception);
+
+    /**
+     * Deallocates memory allocated by allocate_block()
+     * @param ptr released block
+     * @param size requested size passed to allocate_block()
+     */
+    void
+    deallocate_block(Pointer ptr, size_t size) throw ();
+
+    /**
+     * Releases all the allocated memory at once, keeps the chunks
+     */
+    void
+    reset() throw ();
+
+    /**
+     * Releases all the allocated memory and the chunks except the first one
+     */
+    void
+    release() throw ();
+
+    /**
+     * @return size of blocks allocated since the last reset()
+     */
+    size_t
+    allocated() const throw ();
+
+    /**
+     * @return size of chunks kept
+     */
+    virtual
+    size_t
+    cached() const throw (eh::Exception);
+
+    /**
+     * Prints chunks size, then C:chunks count, B:big blocks count and
+     * A:allocated size
+     */
+    virtual
+    void
+    print_cached(std::ostream& ostr) const throw (eh::Exception);
+
+  protected:
+    virtual
+    ~Arena() throw ();
+
+  private:
+    struct Chunk
+    {
+      Chunk* next;
+      size_t size;
+    };
+
+    struct BigBlock
+    {
+      BigBlock* prev;
+      BigBlock* next;
+    };
+
+    static const size_t CHUNK_HEADER_ = (sizeof(Chunk) + ALIGN - 1) &
+      ~(ALIGN - 1);
+    static const size_t BIG_HEADER_ = (sizeof(BigBlock) + ALIGN - 1) &
+      ~(ALIGN - 1);
+
+    static
+    size_t
+    class_(size_t size) throw ();
+
+    static
+    size_t
+    class_size_(size_t size_class) throw ();
+
+    Pointer
+    cut_(size_t size) throw (eh::Exception);
+
+    void
+    release_big_blocks_() throw ();
+
+  private:
+    const size_t CHUNK_SIZE_;
+
+    Chunk* first_;
+    Chunk* current_;
+    char* cur_;
+    char* end_;
+    size_t chunks_;
+
+    BigBlock* big_;
+    size_t big_count_;
+
+    size_t allocated_;
+
+    Pointer free_[CLASSES];
+  };
+  typedef ReferenceCounting::QualPtr<Arena> Arena_var;
+
+  /**
+   * STL allocator on Arena. Deallocated elements go to the arena free
+   * lists, all the memory is released by Arena::reset().
+   * The container must not outlive the arena and its reset.
+   * Usable for OutputMemoryStream with Arena* as the initializer.
+   */
+  template <typename Type>
+  class ArenaAllocator : public std::allocator<Type>
+  {
+  public:
+    typedef typename std::allocator<Type>::pointer pointer;
+    typedef typename std::allocator<Type>::size_type size_type;
+
+    template <typename Other>
+    struct rebind
+    {
+      typedef ArenaAllocator<Other> other;
+    };
+
+    ArenaAllocator(Arena* arena) throw ();
+    ArenaAllocator(const ArenaAllocator& allocator) throw ();
+    template <typename Other>
+    ArenaAllocator(const ArenaAllocator<Other>& allocator) throw ();
+
+    pointer
+    allocate(size_type n, const void* = 0) throw (eh::Exception);
+
+    void
+    deallocate(pointer ptr, size_type n) throw ();
+
+    Arena*
+    arena() const throw ();
+
+  private:
+    Arena* arena_;
+  };
+
+  template <typename Type, typename Other>
+  bool
+  operator ==(const ArenaAllocator<Type>& left,
+    const ArenaAllocator<Other>& right) throw ();
+
+  template <typename Type, typename Other>
+  bool
+  operator !=(const ArenaAllocator<Type>& left,
+    const ArenaAllocator<Other>& right) throw ();
+}
+
+//
+// INLINES
+//
+
+namespace Generics
+{
+  //
+  // Arena class
+  //
+
+  inline
+  size_t
+  Arena::class_(size_t size) throw ()
+  {
+    const size_t VALUE = size ? size - 1 : 0;
+    if (VALUE < (static_cast<size_t>(1) << MIN_CLASS_CODE))
+    {
+      // ALIGN step for the smallest blocks
+      return VALUE / ALIGN;
+    }
+    const size_t CODE = 63 - __builtin_clzll(VALUE);
+    return (CODE - MIN_CLASS_CODE + 1) * 4 + ((VALUE >> (CODE - 2)) & 3);
+  }
+
+  inline
+  size_t
+  Arena::class_size_(size_t size_class) throw ()
+  {
+    if (size_class < 4)
+    {
+      return (size_class + 1) * ALIGN;
+    }
+    return (4 + size_class % 4 + 1) <<
+      (size_class / 4 + MIN_CLASS_CODE - 3);
+  }
+
+  inline
+  Arena::Pointer
+  Arena::allocate_block(size_t size) throw (eh::Exception)
+  {
+    if (size > MAX_CLASS_SIZE)
+    {
+      return allocate(size);
+    }
+
+    const size_t SIZE_CLASS = class_(size);
+    const size_t SIZE = class_size_(SIZE_CLASS);
+    allocated_ += SIZE;
+
+    if (Pointer ptr = free_[SIZE_CLASS])
+    {
+      free_[SIZE_CLASS] = *static_cast<Pointer*>(ptr);
+      return ptr;
+    }
+
+    if (static_cast<size_t>(end_ - cur_) >= SIZE)
+    {
+      Pointer ptr = cur_;
+      cur_ += SIZE;
+      return ptr;
+    }
+    return cut_(SIZE);
+  }
+
+  inline
+  void
+  Arena::deallocate_block(Pointer ptr, size_t size) throw ()
+  {
+    if (size > MAX_CLASS_SIZE)
+    {
+      deallocate(ptr, size);
+      return;
+    }
+
+    const size_t SIZE_CLASS = class_(size);
+    allocated_ -= class_size_(SIZE_CLASS);
+    *static_cast<Pointer*>(ptr) = free_[SIZE_CLASS];
+    free_[SIZE_CLASS] = ptr;
+  }
+
+  inline
+  size_t
+  Arena::allocated() const throw ()
+  {
+    return allocated_;
+  }
+
+
+  //
+  // ArenaAllocator class
+  //
+
+  template <typename Type>
+  ArenaAllocator<Type>::ArenaAllocator(Arena* arena) throw ()
+    : arena_(arena)
+  {
+  }
+
+  template <typename Type>
+  ArenaAllocator<Type>::ArenaAllocator(const ArenaAllocator& allocator)
+    throw ()
+    : std::allocator<Type>(), arena_(allocator.arena())
+  {
+  }
+
+  template <typename Type>
+  template <typename Other>
+  ArenaAllocator<Type>::ArenaAllocator(
+    const ArenaAllocator<Other>& allocator) throw ()
+    : arena_(allocator.arena())
+  {
+  }
+
+  template <typename Type>
+  typename ArenaAllocator<Type>::pointer
+  ArenaAllocator<Type>::allocate(size_type n, const void*)
+    throw (eh::Exception)
+  {
+    return static_cast<pointer>(arena_->allocate_block(n * sizeof(Type)));
+  }
+
+  template <typename Type>
+  void
+  ArenaAllocator<Type>::deallocate(pointer ptr, size_type n) throw ()
+  {
+    arena_->deallocate_block(ptr, n * sizeof(Type));
+  }
+
+  template <typename Type>
+  Arena*
+  ArenaAllocator<Type>::arena() const throw ()
+  {
+    return arena_;
+  }
+
+  template <typename Type, typename Other>
+  bool
+  operator ==(const ArenaAllocator<Type>& left,
+    const ArenaAllocator<Other>& right) throw ()
+  {
+    return left.arena() == right.arena();
+  }
+
+  template <typename Type, typename Other>
+  bool
+  operator !=(const ArenaAllocator<Type>& left,
+    const ArenaAllocator<Other>& right) throw ()
+  {
+    return left.arena() != right.arena();
+  }
+}
+
+#endif
@@ -21,6 +21,15 @@
 
 
 
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define GENERICS_CRC_PCLMUL
+#endif
+
 #include <Generics/CRC.hpp>
 
 
@@ -165,3 +174,394 @@ namespace Generics
     };
   }
 }
+
+namespace
+{
+  using Generics::CRC::CRC_QUICK_TABLE;
+  using Generics::CRC::CRC_REVERSED_TABLE;
+
+  const unsigned SLICES = 16;
+
+  /// Slice tables, the first slice is the original table
+  uint32_t quick_slices[SLICES][256];
+  uint32_t reversed_slices[SLICES][256];
+
+  typedef uint32_t (*Function)(uint32_t crc, const uint8_t* data,
+    size_t size);
+
+  pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+  bool pclmul_supported = false;
+
+  inline
+  uint32_t
+  load32(const uint8_t* data) throw ()
+  {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+  }
+
+  /*
+   * quick() is MSB first CRC, reversed() is LSB first CRC working
+   * with the inverted value. Functions below take and return the
+   * internal state, reversed ones do not invert it.
+   */
+
+  uint32_t
+  quick_byte(uint32_t crc, const uint8_t* data, size_t size) throw ()
+  {
+    while (size-- > 0)
+    {
+      crc = (crc << 8) ^
+        CRC_QUICK_TABLE[static_cast<uint8_t>(crc >> 24) ^ *data++];
+    }
+    return crc;
+  }
+
+  uint32_t
+  reversed_byte(uint32_t crc, const uint8_t* data, size_t size) throw ()
+  {
+    while (size-- > 0)
+    {
+      crc = (crc >> 8) ^
+        CRC_REVERSED_TABLE[static_cast<uint8_t>(crc) ^ *data++];
+    }
+    return crc;
+  }
+
+  /**
+   * Word of data taken as big endian for MSB first CRC
+   */
+  inline
+  uint32_t
+  quick_word(uint32_t word, unsigned slice) throw ()
+  {
+    return quick_slices[slice + 3][word >> 24] ^
+      quick_slices[slice + 2][(word >> 16) & 0xFF] ^
+      quick_slices[slice + 1][(word >> 8) & 0xFF] ^
+      quick_slices[slice][word & 0xFF];
+  }
+
+  uint32_t
+  quick_slice8(uint32_t crc, const uint8_t* data, size_t size) throw ()
+  {
+    for (; size >= 8; data += 8, size -= 8)
+    {
+      crc = quick_word(__builtin_bswap32(load32(data)) ^ crc, 4) ^
+        quick_word(__builtin_bswap32(load32(data + 4)), 0);
+    }
+    return quick_byte(crc, data, size);
+  }
+
+  uint32_t
+  quick_slice16(uint32_t crc, const uint8_t* data, size_t size) throw ()
+  {
+    for (; size >= 16; data += 16, size -= 16)
+    {
+      crc = quick_word(__builtin_bswap32(load32(data)) ^ crc, 12) ^
+        quick_word(__builtin_bswap32(load32(data + 4)), 8) ^
+        quick_word(__builtin_bswap32(load32(data + 8)), 4) ^
+        quick_word(__builtin_bswap32(load32(data + 12)), 0);
+    }
+    return quick_slice8(crc, data, size);
+  }
+
+  /*
+   * Slices are indexed by the byte distance to the end of the block,
+   * the word is taken as little endian for LSB first CRC
+   */
+
+  inline
+  uint32_t
+  reversed_word(uint32_t word, unsigned slice) throw ()
+  {
+    return reversed_slices[slice + 3][word & 0xFF] ^
+      reversed_slices[slice + 2][(word >> 8) & 0xFF] ^
+      reversed_slices[slice + 1][(word >> 16) & 0xFF] ^
+      reversed_slices[slice][word >> 24];
+  }
+
+  uint32_t
+  reversed_slice8(uint32_t crc, const uint8_t* data, size_t size) throw ()
+  {
+    for (; size >= 8; data += 8, size -= 8)
+    {
+      crc = reversed_word(load32(data) ^ crc, 4) ^
+        reversed_word(load32(data + 4), 0);
+    }
+    return reversed_byte(crc, data, size);
+  }
+
+  uint32_t
+  reversed_slice16(uint32_t crc, const uint8_t* data, size_t size) throw ()
+  {
+    for (; size >= 16; data += 16, size -= 16)
+    {
+      crc = reversed_word(load32(data) ^ crc, 12) ^
+        reversed_word(load32(data + 4), 8) ^
+        reversed_word(load32(data + 8), 4) ^
+        reversed_word(load32(data + 12), 0);
+    }
+    return reversed_slice8(crc, data, size);
+  }
+
+#ifdef GENERICS_CRC_PCLMUL
+  /*
+   * Folding constants of the LSB first CRC32 polynomial: x^(4*128+32),
+   * x^(4*128-32), x^(128+32), x^(128-32), x^64 modulo P and
+   * the Barrett reduction constants, all bit reflected
+   * ("Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+   * Instruction", Intel).
+   */
+  const uint64_t K1K2[2] __attribute__((aligned(16))) =
+    { 0x0154442bd4ULL, 0x01c6e41596ULL };
+  const uint64_t K3K4[2] __attribute__((aligned(16))) =
+    { 0x01751997d0ULL, 0x00ccaa009eULL };
+  const uint64_t K5K0[2] __attribute__((aligned(16))) =
+    { 0x0163cd6124ULL, 0 };
+  const uint64_t POLY[2] __attribute__((aligned(16))) =
+    { 0x01db710641ULL, 0x01f7011641ULL };
+
+  /**
+   * Folds the blocks of 64 bytes and reduces to 32 bits
+   * @param crc internal state
+   * @param data data
+   * @param size at least 64, multiple of 16
+   */
+  __attribute__((target("pclmul,sse4.1")))
+  uint32_t
+  reversed_fold(uint32_t crc, const uint8_t* data, size_t size) throw ()
+  {
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i x2 =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+    __m128i x3 =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32));
+    __m128i x4 =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+    __m128i x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(K1K2));
+    data += 64;
+    size -= 64;
+
+    // Four folds in parallel
+    for (; size >= 64; data += 64, size -= 64)
+    {
+      const __m128i x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      const __m128i x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+      const __m128i x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+      const __m128i x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+      x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+      x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+      x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)));
+      x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)));
+      x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)));
+    }
+
+    // Fold into 128 bits
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(K3K4));
+
+    __m128i x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    for (; size >= 16; data += 16, size -= 16)
+    {
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x1 = _mm_xor_si128(_mm_xor_si128(x1,
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data))), x5);
+    }
+
+    // Fold 128 bits to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(K5K0));
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(POLY));
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return _mm_extract_epi32(x1, 1);
+  }
+
+  uint32_t
+  reversed_pclmul(uint32_t crc, const uint8_t* data, size_t size) throw ()
+  {
+    if (size >= 64)
+    {
+      const size_t FOLDED = size & ~static_cast<size_t>(15);
+      crc = reversed_fold(crc, data, FOLDED);
+      data += FOLDED;
+      size -= FOLDED;
+    }
+    return reversed_slice8(crc, data, size);
+  }
+#endif
+
+  void
+  init_tables() throw ()
+  {
+    for (unsigned i = 0; i < 256; i++)
+    {
+      quick_slices[0][i] = CRC_QUICK_TABLE[i];
+      reversed_slices[0][i] = CRC_REVERSED_TABLE[i];
+    }
+    for (unsigned slice = 1; slice < SLICES; slice++)
+    {
+      for (unsigned i = 0; i < 256; i++)
+      {
+        const uint32_t QUICK = quick_slices[slice - 1][i];
+        quick_slices[slice][i] = (QUICK << 8) ^ CRC_QUICK_TABLE[QUICK >> 24];
+        const uint32_t REVERSED = reversed_slices[slice - 1][i];
+        reversed_slices[slice][i] = (REVERSED >> 8) ^
+          CRC_REVERSED_TABLE[REVERSED & 0xFF];
+      }
+    }
+
+#ifdef GENERICS_CRC_PCLMUL
+    unsigned eax, ebx, ecx, edx;
+    pclmul_supported = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+      (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+#endif
+  }
+
+  Function
+  quick_function(Generics::CRC::Kernel kernel) throw ()
+  {
+    pthread_once(&tables_once, init_tables);
+
+    switch (kernel)
+    {
+    case Generics::CRC::K_BYTE:
+      return quick_byte;
+    case Generics::CRC::K_SLICE8:
+      return quick_slice8;
+    default:
+      return quick_slice16;
+    }
+  }
+
+  Function
+  reversed_function(Generics::CRC::Kernel kernel) throw ()
+  {
+    pthread_once(&tables_once, init_tables);
+
+    switch (kernel)
+    {
+    case Generics::CRC::K_BYTE:
+      return reversed_byte;
+    case Generics::CRC::K_SLICE8:
+      return reversed_slice8;
+#ifdef GENERICS_CRC_PCLMUL
+    case Generics::CRC::K_PCLMUL:
+      if (pclmul_supported)
+      {
+        return reversed_pclmul;
+      }
+      return reversed_slice16;
+#endif
+    default:
+      return reversed_slice16;
+    }
+  }
+
+  uint32_t
+  quick_dispatch(uint32_t crc, const uint8_t* data, size_t size) throw ();
+  uint32_t
+  reversed_dispatch(uint32_t crc, const uint8_t* data, size_t size) throw ();
+
+  /// Selected kernels, resolved on the first call
+  Function quick_selected = quick_dispatch;
+  Function reversed_selected = reversed_dispatch;
+
+  uint32_t
+  quick_dispatch(uint32_t crc, const uint8_t* data, size_t size) throw ()
+  {
+    const Function FUNCTION = quick_function(Generics::CRC::K_SLICE16);
+    __atomic_store_n(&quick_selected, FUNCTION, __ATOMIC_RELEASE);
+    return FUNCTION(crc, data, size);
+  }
+
+  uint32_t
+  reversed_dispatch(uint32_t crc, const uint8_t* data, size_t size) throw ()
+  {
+    const Function FUNCTION = reversed_function(Generics::CRC::K_PCLMUL);
+    __atomic_store_n(&reversed_selected, FUNCTION, __ATOMIC_RELEASE);
+    return FUNCTION(crc, data, size);
+  }
+}
+
+namespace Generics
+{
+  namespace CRC
+  {
+    uint32_t
+    quick_block(uint32_t crc, const void* data, size_t size) throw ()
+    {
+      return __atomic_load_n(&quick_selected, __ATOMIC_ACQUIRE)(crc,
+        static_cast<const uint8_t*>(data), size);
+    }
+
+    uint32_t
+    reversed_block(uint32_t crc, const void* data, size_t size) throw ()
+    {
+      return ~__atomic_load_n(&reversed_selected, __ATOMIC_ACQUIRE)(~crc,
+        static_cast<const uint8_t*>(data), size);
+    }
+
+    bool
+    supported(Kernel kernel) throw ()
+    {
+      pthread_once(&tables_once, init_tables);
+      return kernel != K_PCLMUL || pclmul_supported;
+    }
+
+    uint32_t
+    quick(Kernel kernel, uint32_t crc, const void* data, size_t size)
+      throw ()
+    {
+      return quick_function(kernel)(crc,
+        static_cast<const uint8_t*>(data), size);
+    }
+
+    uint32_t
+    reversed(Kernel kernel, uint32_t crc, const void* data, size_t size)
+      throw ()
+    {
+      return ~reversed_function(kernel)(~crc,
+        static_cast<const uint8_t*>(data), size);
+    }
+  }
+}
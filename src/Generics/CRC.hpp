@@ -49,6 +49,50 @@ namespace Generics
      */
     uint32_t
     reversed(uint32_t crc, const void* data, size_t size) throw ();
+
+    /**
+     * Implementations of the calculation. All of them give the same
+     * results, quick() and reversed() choose the fastest one supported
+     * by CPU for large blocks.
+     */
+    enum Kernel
+    {
+      K_BYTE, ///< one table lookup per byte
+      K_SLICE8, ///< eight tables, eight bytes per iteration
+      K_SLICE16, ///< sixteen tables, sixteen bytes per iteration
+      K_PCLMUL ///< carry-less multiplication folding, reversed() only
+    };
+
+    /**
+     * Checks if the kernel can be used on this CPU
+     * @param kernel kernel to check
+     * @return whether or not the kernel is supported
+     */
+    bool
+    supported(Kernel kernel) throw ();
+
+    /**
+     * Calculates CRC32 with the specified kernel.
+     * K_PCLMUL is calculated as K_SLICE16.
+     * @param kernel supported kernel to use
+     * @param crc initial value of CRC
+     * @param data data block
+     * @param size its size
+     */
+    uint32_t
+    quick(Kernel kernel, uint32_t crc, const void* data, size_t size)
+      throw ();
+
+    /**
+     * Calculates reversed CRC32 with the specified kernel
+     * @param kernel supported kernel to use
+     * @param crc initial value of CRC
+     * @param data data block
+     * @param size its size
+     */
+    uint32_t
+    reversed(Kernel kernel, uint32_t crc, const void* data, size_t size)
+      throw ();
   }
 }
 
@@ -57,13 +101,24 @@ namespace Generics
 {
   namespace CRC
   {
+    /// Smaller blocks are calculated inline byte by byte
+    const size_t INLINE_SIZE = 16;
+
     extern const uint32_t CRC_QUICK_TABLE[];
 
+    uint32_t
+    quick_block(uint32_t crc, const void* data, size_t size) throw ();
+
     inline
     uint32_t
     quick(uint32_t crc, const void* data, size_t size)
       throw ()
     {
+      if (size >= INLINE_SIZE)
+      {
+        return quick_block(crc, data, size);
+      }
+
       register const uint8_t* udata = static_cast<const uint8_t*>(data);
       while (size-- > 0)
       {
@@ -75,11 +130,19 @@ namespace Generics
 
     extern const uint32_t CRC_REVERSED_TABLE[];
 
+    uint32_t
+    reversed_block(uint32_t crc, const void* data, size_t size) throw ();
+
     inline
     uint32_t
     reversed(uint32_t crc, const void* data, size_t size)
       throw ()
     {
+      if (size >= INLINE_SIZE)
+      {
+        return reversed_block(crc, data, size);
+      }
+
       register const uint8_t* udata = static_cast<const uint8_t*>(data);
       crc = ~crc;
       while (size-- > 0)
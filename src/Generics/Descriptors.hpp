@@ -22,8 +22,10 @@
 #ifndef GENERICS_DESCRIPTORS_HPP
 #define GENERICS_DESCRIPTORS_HPP
 
+#include <stdint.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/eventfd.h>
 
 #include <eh/Errno.hpp>
 
@@ -160,6 +162,39 @@ namespace Generics
     int fd_;
   };
 
+  /**
+   * Non-blocking eventfd(2) counter. Unlike the pipe any number of
+   * signals is consumed by a single read and signalling never blocks.
+   */
+  class EventDescriptor : private Uncopyable
+  {
+  public:
+    DECLARE_EXCEPTION(Exception, eh::DescriptiveException);
+
+    EventDescriptor() throw (eh::Exception, Exception);
+    ~EventDescriptor() throw ();
+
+    int
+    fd() const throw ();
+
+    /**
+     * Increments the counter ignoring EINTRs
+     * @return see write(2)
+     */
+    ssize_t
+    signal() throw ();
+
+    /**
+     * Resets the counter
+     * @return the counter value, zero if it was not signalled
+     */
+    uint64_t
+    reset() throw ();
+
+  private:
+    int fd_;
+  };
+
   /**
    * Sets FD_CLOEXEC on the specified descriptor
    * @param fd descriptor to tune
@@ -327,6 +362,59 @@ namespace Generics
   }
 
 
+  //
+  // EventDescriptor class
+  //
+
+  inline
+  EventDescriptor::EventDescriptor() throw (eh::Exception, Exception)
+  {
+    fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd_ < 0)
+    {
+      eh::throw_errno_exception<Exception>(FNE, "failed to create eventfd");
+    }
+  }
+
+  inline
+  EventDescriptor::~EventDescriptor() throw ()
+  {
+    close(fd_);
+  }
+
+  inline
+  int
+  EventDescriptor::fd() const throw ()
+  {
+    return fd_;
+  }
+
+  inline
+  ssize_t
+  EventDescriptor::signal() throw ()
+  {
+    const uint64_t ONE = 1;
+    ssize_t result;
+    while ((result = ::write(fd_, &ONE, sizeof(ONE))) < 0 && errno == EINTR)
+    {
+    }
+    return result;
+  }
+
+  inline
+  uint64_t
+  EventDescriptor::reset() throw ()
+  {
+    uint64_t value;
+    ssize_t result;
+    while ((result = ::read(fd_, &value, sizeof(value))) < 0 &&
+      errno == EINTR)
+    {
+    }
+    return result == sizeof(value) ? value : 0;
+  }
+
+
   //
 
   inline
@@ -33,6 +33,7 @@
 #include <eh/Errno.hpp>
 
 #include <Sync/Condition.hpp>
+#include <Sync/PosixLock.hpp>
 
 #include <ReferenceCounting/ReferenceCounting.hpp>
 #include <ReferenceCounting/Map.hpp>
@@ -40,6 +41,7 @@
 #include <String/StringManip.hpp>
 
 #include <Generics/BoundedMap.hpp>
+#include <Generics/MMap.hpp>
 
 
 /**X Generics library namespace. */
@@ -213,6 +215,45 @@ namespace Generics
   };
 
 
+  /**
+   * Memory mapped file update strategy
+   * Maps the file with the specified file name into memory, the content
+   * is not copied and pages are shared with the page cache.
+   * The file must be replaced (rename(2)) rather than rewritten in place,
+   * truncation of the mapped file leads to SIGBUS on access.
+   */
+  class MMapFileUpdateStrategy
+  {
+  public:
+    typedef const String::SubString Buffer;
+
+    /**
+     * Constructor
+     * @param file_name name of the file to map
+     */
+    MMapFileUpdateStrategy(const char* file_name)
+      throw (eh::Exception);
+
+    /**
+     * Content of the mapped file
+     * @return SubString referencing the mapped data
+     */
+    Buffer&
+    get() throw ();
+
+    /**
+     * Maps the file anew, unmaps the previous mapping
+     */
+    void
+    update() throw (CacheExceptions::CacheException, eh::Exception);
+
+  private:
+    const std::string FILE_NAME_;
+    std::unique_ptr<MMapFile> mapping_;
+    String::SubString content_;
+  };
+
+
   /**
    * Cache provides means to update system state (via UpdateStrategy)
    * in case CheckStrategy says the controlling object is updated.
@@ -354,6 +395,121 @@ namespace Generics
     BufferHolder_var unreferenced_buffer_;
   };
 
+  /**
+   * SwappingCache is a double buffered variant of Cache.
+   * Every loaded state is a separate version owning its own UpdateStrategy
+   * object. When CheckStrategy says the object is changed a new version is
+   * loaded aside and published by the pointer swap, so get() never waits
+   * for release of the previous state: holders of it keep using it and
+   * the last of them destroys it (unmaps the file for
+   * MMapFileUpdateStrategy).
+   * Only one thread checks and loads at a time, others return the current
+   * version without waiting for it. Only the very first get() waits for
+   * the initial load.
+   * UpdateStrategy must be constructible from the name.
+   */
+  template <typename CheckStrategy, typename UpdateStrategy>
+  class SwappingCache : public ReferenceCounting::AtomicImpl
+  {
+  public:
+    typedef typename UpdateStrategy::Buffer Buffer;
+    typedef ReferenceCounting::QualPtr<SwappingCache> Cache_var;
+
+    /**
+     * One loaded version of the content
+     */
+    class BufferHolder : public ReferenceCounting::AtomicImpl
+    {
+    public:
+      /**
+       * Implements dereferencing poiner semantics.
+       * @return reference to the version's buffer
+       */
+      Buffer&
+      operator *() const throw (eh::Exception);
+
+      /**
+       * Implements dereferencing pointer semantics.
+       * @return pointer to the version's buffer
+       */
+      Buffer*
+      operator ->() const throw (eh::Exception);
+
+    protected:
+      /**
+       * Constructor
+       * @param name name to pass into UpdateStrategy
+       */
+      explicit
+      BufferHolder(const char* name) throw (eh::Exception);
+
+      /**
+       * Destructor
+       */
+      virtual
+      ~BufferHolder() throw ();
+
+    protected:
+      mutable UpdateStrategy updater_;
+
+      friend class SwappingCache;
+    };
+    typedef ReferenceCounting::QualPtr<BufferHolder> BufferHolder_var;
+
+  public:
+    /**
+     * Constructor
+     * @param name some name meaningful for both CheckStrategy and
+     * UpdateStrategy
+     */
+    explicit
+    SwappingCache(const char* name) throw (eh::Exception);
+
+    /**
+     * Constructor
+     * @param checker CheckStrategy to own and free on destruction
+     * @param name name to construct UpdateStrategy objects with
+     */
+    SwappingCache(CheckStrategy* checker, const char* name)
+      throw (eh::Exception);
+
+    /**
+     * If the CHECKER_ says it's modified loads and publishes the new
+     * version. Never waits for holders of the previous versions.
+     * @return smart pointer holding the current version
+     */
+    BufferHolder_var
+    get() throw (CacheExceptions::ImplementationException, eh::Exception);
+
+  protected:
+    /**
+     * Destructor
+     */
+    virtual
+    ~SwappingCache() throw ();
+
+    /**
+     * @return the current version (can be null before the first load)
+     */
+    BufferHolder_var
+    current_version_() throw ();
+
+    /**
+     * Loads and publishes a new version, update_mutex_ must be locked
+     * @return the new version
+     */
+    BufferHolder_var
+    load_() throw (eh::Exception);
+
+  private:
+    const std::string NAME_;
+    const std::unique_ptr<CheckStrategy> CHECKER_;
+
+    Sync::PosixMutex update_mutex_;
+    Sync::PosixSpinLock current_lock_;
+    BufferHolder_var current_;
+  };
+
   /**
    * CacheManager is a set of 'Cache's. It allows to keep many
    * caches in one place and access them by corresponding names.
@@ -778,6 +934,74 @@ namespace Generics
     content_.swap(content);
   }
 
+  //////////////////////////////////////////////////////////////
+  // MMapFileUpdateStrategy
+  //////////////////////////////////////////////////////////////
+
+  inline
+  MMapFileUpdateStrategy::MMapFileUpdateStrategy(const char* file_name)
+    throw (eh::Exception)
+    : FILE_NAME_(file_name ? file_name : "")
+  {
+  }
+
+  inline
+  MMapFileUpdateStrategy::Buffer&
+  MMapFileUpdateStrategy::get() throw ()
+  {
+    return content_;
+  }
+
+  inline
+  void
+  MMapFileUpdateStrategy::update()
+    throw (CacheExceptions::CacheException, eh::Exception)
+  {
+    int fildes = open(FILE_NAME_.c_str(), O_RDONLY);
+    if (fildes == -1)
+    {
+      eh::throw_errno_exception<CacheExceptions::CacheException>(
+        FNE, "failed to open file '", FILE_NAME_.c_str(), "'");
+    }
+
+    struct stat st;
+    if (fstat(fildes, &st) == -1)
+    {
+      int error = errno;
+      close(fildes);
+      eh::throw_errno_exception<CacheExceptions::CacheException>(
+        error, FNE, "failed to stat file '", FILE_NAME_.c_str(), "'");
+    }
+
+    // Empty file can not be mapped
+    std::unique_ptr<MMapFile> mapping;
+    if (st.st_size)
+    {
+      try
+      {
+        // Takes ownership over the descriptor
+        mapping.reset(new MMapFile(fildes));
+      }
+      catch (const MMap::Exception& ex)
+      {
+        Stream::Error ostr;
+        ostr << FNS << "failed to map file '" << FILE_NAME_ << "': " <<
+          ex.what();
+        throw CacheExceptions::CacheException(ostr);
+      }
+    }
+    else
+    {
+      close(fildes);
+    }
+
+    mapping_.swap(mapping);
+    content_ = mapping_.get() ?
+      String::SubString(static_cast<const char*>(mapping_->memory()),
+        mapping_->length()) :
+      String::SubString();
+  }
+
   /////////////////////////////////////////////////////////
   // Cache<CheckStrategy, UpdateStrategy>::BufferHolder
   /////////////////////////////////////////////////////////
@@ -940,6 +1164,117 @@ namespace Generics
     return return_buffer;
   }
 
+  /////////////////////////////////////////////////////////
+  // SwappingCache<CheckStrategy, UpdateStrategy>::BufferHolder
+  /////////////////////////////////////////////////////////
+
+  template <typename CheckStrategy, typename UpdateStrategy>
+  SwappingCache<CheckStrategy, UpdateStrategy>::BufferHolder::BufferHolder(
+    const char* name) throw (eh::Exception)
+    : updater_(name)
+  {
+  }
+
+  template <typename CheckStrategy, typename UpdateStrategy>
+  SwappingCache<CheckStrategy, UpdateStrategy>::BufferHolder::
+    ~BufferHolder() throw ()
+  {
+  }
+
+  template <typename CheckStrategy, typename UpdateStrategy>
+  typename SwappingCache<CheckStrategy, UpdateStrategy>::Buffer&
+  SwappingCache<CheckStrategy, UpdateStrategy>::BufferHolder::
+    operator *() const throw (eh::Exception)
+  {
+    return updater_.get();
+  }
+
+  template <typename CheckStrategy, typename UpdateStrategy>
+  typename SwappingCache<CheckStrategy, UpdateStrategy>::Buffer*
+  SwappingCache<CheckStrategy, UpdateStrategy>::BufferHolder::
+    operator ->() const throw (eh::Exception)
+  {
+    return &updater_.get();
+  }
+
+  //////////////////////////////////////////////////////////////
+  // SwappingCache
+  //////////////////////////////////////////////////////////////
+
+  template <typename CheckStrategy, typename UpdateStrategy>
+  SwappingCache<CheckStrategy, UpdateStrategy>::SwappingCache(
+    const char* name) throw (eh::Exception)
+    : NAME_(name ? name : ""), CHECKER_(new CheckStrategy(name))
+  {
+  }
+
+  template <typename CheckStrategy, typename UpdateStrategy>
+  SwappingCache<CheckStrategy, UpdateStrategy>::SwappingCache(
+    CheckStrategy* checker, const char* name) throw (eh::Exception)
+    : NAME_(name ? name : ""), CHECKER_(checker)
+  {
+  }
+
+  template <typename CheckStrategy, typename UpdateStrategy>
+  SwappingCache<CheckStrategy, UpdateStrategy>::~SwappingCache() throw ()
+  {
+  }
+
+  template <typename CheckStrategy, typename UpdateStrategy>
+  typename SwappingCache<CheckStrategy, UpdateStrategy>::BufferHolder_var
+  SwappingCache<CheckStrategy, UpdateStrategy>::current_version_() throw ()
+  {
+    Sync::PosixSpinGuard guard(current_lock_);
+    return current_;
+  }
+
+  template <typename CheckStrategy, typename UpdateStrategy>
+  typename SwappingCache<CheckStrategy, UpdateStrategy>::BufferHolder_var
+  SwappingCache<CheckStrategy, UpdateStrategy>::load_()
+    throw (eh::Exception)
+  {
+    BufferHolder_var version(new BufferHolder(NAME_.c_str()));
+    version->updater_.update();
+
+    BufferHolder_var old(version);
+    {
+      Sync::PosixSpinGuard guard(current_lock_);
+      current_.swap(old);
+    }
+    // The previous version is released (possibly destroyed) unlocked
+    return version;
+  }
+
+  template <typename CheckStrategy, typename UpdateStrategy>
+  typename SwappingCache<CheckStrategy, UpdateStrategy>::BufferHolder_var
+  SwappingCache<CheckStrategy, UpdateStrategy>::get()
+    throw (CacheExceptions::ImplementationException, eh::Exception)
+  {
+    BufferHolder_var version(current_version_());
+
+    if (!version)
+    {
+      // Nothing to return yet, waiting for the first load
+      Sync::PosixGuard guard(update_mutex_);
+      version = current_version_();
+      if (!version)
+      {
+        CHECKER_->object_is_changed();
+        version = load_();
+      }
+      return version;
+    }
+
+    Sync::PosixTryGuard guard(update_mutex_);
+    // Someone else is checking or loading, the current version is fine
+    if (guard && CHECKER_->object_is_changed())
+    {
+      version = load_();
+    }
+
+    return version;
+  }
+
   //////////////////////////////////////////////////////////////
   // CacheManager
   //////////////////////////////////////////////////////////////
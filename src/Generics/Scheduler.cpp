@@ -39,12 +39,14 @@ namespace Generics
     throw (eh::Exception)
     : SingleJob(callback),
       have_new_events_(false),
+      order_(0),
       delivery_time_adjustment_(delivery_time_adjustment)
   {
   }
 
   Planner::PlannerJob::~PlannerJob() throw ()
   {
+    clear();
   }
 
   void
@@ -55,6 +57,86 @@ namespace Generics
   }
 
   void
+  Planner::PlannerJob::place_(size_t index, GoalHandle_var& handle)
+    throw ()
+  {
+    handle->index_ = index;
+    messages_[index] = std::move(handle);
+  }
+
+  void
+  Planner::PlannerJob::sift_up_(size_t index) throw ()
+  {
+    GoalHandle_var handle(std::move(messages_[index]));
+    while (index)
+    {
+      const size_t PARENT = (index - 1) / 2;
+      if (!handle->is_before(*messages_[PARENT]))
+      {
+        break;
+      }
+      place_(index, messages_[PARENT]);
+      index = PARENT;
+    }
+    place_(index, handle);
+  }
+
+  void
+  Planner::PlannerJob::sift_down_(size_t index) throw ()
+  {
+    const size_t SIZE = messages_.size();
+    GoalHandle_var handle(std::move(messages_[index]));
+    for (;;)
+    {
+      size_t child = 2 * index + 1;
+      if (child >= SIZE)
+      {
+        break;
+      }
+      if (child + 1 < SIZE &&
+        messages_[child + 1]->is_before(*messages_[child]))
+      {
+        child++;
+      }
+      if (!messages_[child]->is_before(*handle))
+      {
+        break;
+      }
+      place_(index, messages_[child]);
+      index = child;
+    }
+    place_(index, handle);
+  }
+
+  Planner::GoalHandle_var
+  Planner::PlannerJob::remove_(size_t index) throw ()
+  {
+    GoalHandle_var removed(std::move(messages_[index]));
+    removed->index_ = GoalHandle::NOT_SCHEDULED;
+
+    const size_t LAST = messages_.size() - 1;
+    if (index != LAST)
+    {
+      place_(index, messages_[LAST]);
+      messages_.pop_back();
+      if (index && messages_[index]->is_before(*messages_[(index - 1) / 2]))
+      {
+        sift_up_(index);
+      }
+      else
+      {
+        sift_down_(index);
+      }
+    }
+    else
+    {
+      messages_.pop_back();
+    }
+
+    return removed;
+  }
+
+  Planner::GoalHandle_var
   Planner::PlannerJob::schedule(Goal* goal, const Time& time)
     throw (InvalidArgument, Exception, eh::Exception)
   {
@@ -83,27 +165,17 @@ namespace Generics
     }
 #endif
 
+    GoalHandle_var handle;
     bool signal;
     {
-      /** sch 1: add message into list */
+      /** sch 1: add message into heap */
       Sync::PosixGuard guard(mutex());
 
-      TimedList::iterator itor(messages_.end());
-
-      while (itor != messages_.begin())
-      {
-        --itor;
-        if (itor->time() < tm)
-        {
-          ++itor;
-          break;
-        }
-      }
-
-      signal = (itor == messages_.begin());
+      handle = new GoalHandle(tm, goal, order_++);
+      messages_.emplace_back(ReferenceCounting::add_ref(handle));
+      sift_up_(messages_.size() - 1);
 
-      TimedMessage m(tm, goal);
-      messages_.insert(itor, m);
+      signal = !handle->index_;
       if (signal)
       {
         have_new_events_ = true;
@@ -117,33 +189,62 @@ namespace Generics
       trace_message(FNB, "signaled");
     }
     trace_message(FNB, "leaving");
+    return handle;
   }
 
   unsigned
   Planner::PlannerJob::unschedule(const Goal* goal)
     throw (eh::Exception)
   {
-    unsigned removed = 0;
+    Heap removed;
 
     {
       Sync::PosixGuard guard(mutex());
 
-      for (TimedList::iterator itor(messages_.begin());
-        itor != messages_.end();)
+      for (Heap::iterator itor(messages_.begin()); itor != messages_.end();
+        ++itor)
       {
-        if (itor->is_goal(goal))
+        if ((*itor)->is_goal(goal))
         {
-          itor = messages_.erase(itor);
-          removed++;
-        }
-        else
-        {
-          ++itor;
+          removed.emplace_back(ReferenceCounting::add_ref(*itor));
         }
       }
+
+      for (Heap::iterator itor(removed.begin()); itor != removed.end();
+        ++itor)
+      {
+        remove_((*itor)->index_);
+      }
     }
 
-    return removed;
+    for (Heap::iterator itor(removed.begin()); itor != removed.end();
+      ++itor)
+    {
+      (*itor)->release();
+    }
+
+    return removed.size();
+  }
+
+  bool
+  Planner::PlannerJob::unschedule(GoalHandle* handle)
+    throw (eh::Exception)
+  {
+    GoalHandle_var removed;
+
+    {
+      Sync::PosixGuard guard(mutex());
+
+      const size_t INDEX = handle->index_;
+      if (INDEX >= messages_.size() || messages_[INDEX] != handle)
+      {
+        return false;
+      }
+      removed = remove_(INDEX);
+    }
+
+    removed->release();
+    return true;
   }
 
   void
@@ -153,7 +254,7 @@ namespace Generics
 
     try
     {
-      TimedList pending;
+      Heap pending;
       Time abs_time;
       Time cur_time;
 
@@ -176,7 +277,7 @@ namespace Generics
 
           while (!messages_.empty())  // pump messages to pending.
           {
-            abs_time = messages_.front().time();
+            abs_time = messages_.front()->time();
 
             if (delivery_time_adjustment_)
             {
@@ -189,8 +290,7 @@ namespace Generics
             //  They will call immediately
             if (abs_time <= cur_time)
             {
-              pending.splice(pending.end(), std::move(messages_),
-                messages_.begin());
+              pending.push_back(remove_(0));
             }
             else
             {
@@ -270,20 +370,22 @@ namespace Generics
         } // if (pending.empty())
 
         /** svc 3: deliver pending tasks */
-        while (!pending.empty())
+        for (Heap::iterator itor(pending.begin()); itor != pending.end();
+          ++itor)
         {
           trace_message(FNB, "deliver message");
           try
           {
-            pending.front().deliver();
+            (*itor)->deliver();
           }
           catch (const eh::Exception& ex)
           {
             callback()->error(String::SubString(ex.what()));
           }
           trace_message(FNB, "message delivered");
-          pending.pop_front();
+          *itor = GoalHandle_var();
         }
+        pending.clear();
       }
     }
     catch (const eh::Exception& e)
@@ -300,8 +402,23 @@ namespace Generics
   void
   Planner::PlannerJob::clear() throw ()
   {
-    Sync::PosixGuard guard(mutex());
-    messages_.clear();
+    Heap removed;
+
+    {
+      Sync::PosixGuard guard(mutex());
+      for (Heap::iterator itor(messages_.begin()); itor != messages_.end();
+        ++itor)
+      {
+        (*itor)->index_ = GoalHandle::NOT_SCHEDULED;
+      }
+      removed.swap(messages_);
+    }
+
+    for (Heap::iterator itor(removed.begin()); itor != removed.end();
+      ++itor)
+    {
+      (*itor)->release();
+    }
   }
 
 
@@ -24,7 +24,7 @@
 #ifndef GENERICS_SCHEDULER_HPP
 #define GENERICS_SCHEDULER_HPP
 
-#include <ReferenceCounting/List.hpp>
+#include <ReferenceCounting/Vector.hpp>
 
 #include <Generics/ActiveObject.hpp>
 
@@ -45,9 +45,84 @@ namespace Generics
 
   class Planner : public ActiveObjectCommonImpl
   {
+  private:
+    class PlannerJob;
+
   public:
     DECLARE_EXCEPTION(Exception, ActiveObject::Exception);
 
+    /**
+     * Scheduled goal. Is returned by schedule() and can be used for
+     * the fast unscheduling.
+     * The handle owns the goal only while it is scheduled: the goal is
+     * released when it is delivered, unscheduled or cleared, so holding
+     * the handle does not prolong the goal's lifetime.
+     */
+    class GoalHandle : public ReferenceCounting::AtomicImpl
+    {
+    public:
+      /**
+       * Holding time
+       * @return Associated time
+       */
+      const Time&
+      time() const throw ();
+
+    protected:
+      virtual
+      ~GoalHandle() throw ();
+
+    private:
+      friend class PlannerJob;
+
+      /**
+       * Constructor
+       * @param time Associated time
+       * @param goal Shared ownership on goal
+       * @param order sequence number, of the goals with the same time
+       * the later scheduled one is delivered first
+       */
+      GoalHandle(const Time& time, Goal* goal, unsigned long long order)
+        throw ();
+
+      /**
+       * Calls deliver() on owned goal and releases it
+       */
+      void
+      deliver() throw (eh::Exception);
+
+      /**
+       * Releases the goal of the removed handle
+       */
+      void
+      release() throw ();
+
+      /**
+       * Checks if it holds the goal
+       * @param goal goal to check against
+       * @return true if they coincide
+       */
+      bool
+      is_goal(const Goal* goal) const throw ();
+
+      /**
+       * Delivery order
+       * @param handle handle to compare with
+       * @return true if this goal is to be delivered before the other
+       */
+      bool
+      is_before(const GoalHandle& handle) const throw ();
+
+      static const size_t NOT_SCHEDULED = static_cast<size_t>(-1);
+
+      Time time_;
+      unsigned long long order_;
+      Goal_var goal_;
+      // Position in the heap of the planner
+      size_t index_;
+    };
+    typedef ReferenceCounting::QualPtr<GoalHandle> GoalHandle_var;
+
     /**
      * Constructor
      * @param callback Reference countable callback object to be called
@@ -63,15 +138,20 @@ namespace Generics
     /**
      * Adds goal to the queue. Goal's reference counter is incremented.
      * On error it is unchanged (and object will be freed in the caller).
+     * Goals with the same time are delivered in the reverse order
+     * of scheduling. Complexity is O(log n).
      * @param goal Object to enqueue
      * @param time Timestamp to match
+     * @return handle for unscheduling, it keeps the goal until
+     * the goal is delivered or removed
      */
-    void
+    GoalHandle_var
     schedule(Goal* goal, const Time& time)
       throw (InvalidArgument, Exception, eh::Exception);
 
     /**
      * Tries to remove goal from the queue.
+     * Checks all of the queued goals, use handle if possible.
      * @param goal Object to remove
      * @return number of entries removed
      */
@@ -79,6 +159,17 @@ namespace Generics
     unschedule(const Goal* goal)
       throw (eh::Exception);
 
+    /**
+     * Tries to remove scheduled goal from the queue.
+     * Complexity is O(log n).
+     * @param handle handle returned by schedule() of this Planner
+     * @return true if the goal has been removed, false if it has been
+     * delivered or removed already.
+     */
+    bool
+    unschedule(GoalHandle* handle)
+      throw (eh::Exception);
+
     /**
      * Clearance of messages' queue
      */
@@ -109,7 +200,7 @@ namespace Generics
       void
       terminate() throw ();
 
-      void
+      GoalHandle_var
       schedule(Goal* goal, const Time& time)
         throw (InvalidArgument, Exception, eh::Exception);
 
@@ -117,6 +208,10 @@ namespace Generics
       unschedule(const Goal* goal)
         throw (eh::Exception);
 
+      bool
+      unschedule(GoalHandle* handle)
+        throw (eh::Exception);
+
       void
       clear() throw ();
 
@@ -124,55 +219,34 @@ namespace Generics
       virtual
       ~PlannerJob() throw ();
 
+    private:
       /**
-       * Element of messages' queue. Composition of Message and
-       * associated Time.
+       * Binary min-heap of the goals, every goal knows its position
        */
-      class TimedMessage
-      {
-      public:
-        TimedMessage() throw ();
-
-        TimedMessage(TimedMessage&) = default;
-
-        /**
-         * Constructor
-         * @param time Associated time
-         * @param goal Shared ownership on goal
-         */
-        TimedMessage(const Time& time, Goal* goal) throw ();
-
-        /**
-         * Holding time
-         * @return Associated time
-         */
-        const Time&
-        time() const throw ();
-
-        /**
-         * Calls deliver() on owned goal
-         */
-        void
-        deliver() throw (eh::Exception);
-
-        /**
-         * Checks if it holds the goal
-         * @param goal goal to check against
-         * @return true if they coincide
-         */
-        bool
-        is_goal(const Goal* goal) const throw ();
-
-      private:
-        Time time_;
-        Goal_var goal_;
-      };
-      typedef ReferenceCounting::List<TimedMessage> TimedList;
+      typedef ReferenceCounting::Vector<GoalHandle_var> Heap;
+
+      void
+      sift_up_(size_t index) throw ();
+
+      void
+      sift_down_(size_t index) throw ();
+
+      void
+      place_(size_t index, GoalHandle_var& handle) throw ();
+
+      /**
+       * Removes the goal from the heap
+       * @param index position of the goal
+       * @return removed goal
+       */
+      GoalHandle_var
+      remove_(size_t index) throw ();
 
       mutable Sync::Conditional new_event_in_schedule_;
       bool have_new_events_;  // Predicate for condition!
 
-      TimedList messages_;
+      Heap messages_;
+      unsigned long long order_;
       bool delivery_time_adjustment_;
       Time delivery_time_shift_;
     };
@@ -190,54 +264,70 @@ namespace Generics
 namespace Generics
 {
   //
-  // Planner::TimedMessage class
+  // Planner::GoalHandle class
   //
 
   inline
-  Planner::PlannerJob::TimedMessage::TimedMessage() throw ()
+  Planner::GoalHandle::GoalHandle(const Time& time, Goal* goal,
+    unsigned long long order) throw ()
+    : time_(time), order_(order), goal_(ReferenceCounting::add_ref(goal)),
+      index_(NOT_SCHEDULED)
   {
   }
 
   inline
-  Planner::PlannerJob::TimedMessage::TimedMessage(
-    const Time& time, Goal* goal) throw ()
-    : time_(time), goal_(ReferenceCounting::add_ref(goal))
+  Planner::GoalHandle::~GoalHandle() throw ()
   {
   }
 
   inline
   const Time&
-  Planner::PlannerJob::TimedMessage::time() const throw ()
+  Planner::GoalHandle::time() const throw ()
   {
     return time_;
   }
 
   inline
   void
-  Planner::PlannerJob::TimedMessage::deliver() throw (eh::Exception)
+  Planner::GoalHandle::deliver() throw (eh::Exception)
   {
-    goal_->deliver();
+    Goal_var goal(goal_.retn());
+    goal->deliver();
+  }
+
+  inline
+  void
+  Planner::GoalHandle::release() throw ()
+  {
+    goal_.reset();
   }
 
   inline
   bool
-  Planner::PlannerJob::TimedMessage::is_goal(const Goal* goal) const
-    throw ()
+  Planner::GoalHandle::is_goal(const Goal* goal) const throw ()
   {
     return goal == goal_;
   }
 
+  inline
+  bool
+  Planner::GoalHandle::is_before(const GoalHandle& handle) const throw ()
+  {
+    return time_ < handle.time_ ||
+      (time_ == handle.time_ && order_ > handle.order_);
+  }
+
 
   //
   // Planner class
   //
 
   inline
-  void
+  Planner::GoalHandle_var
   Planner::schedule(Goal* goal, const Time& time)
     throw (InvalidArgument, Exception, eh::Exception)
   {
-    job_.schedule(goal, time);
+    return job_.schedule(goal, time);
   }
 
   inline
@@ -248,6 +338,14 @@ namespace Generics
     return job_.unschedule(goal);
   }
 
+  inline
+  bool
+  Planner::unschedule(GoalHandle* handle)
+    throw (eh::Exception)
+  {
+    return job_.unschedule(handle);
+  }
+
   inline
   void
   Planner::clear() throw (eh::Exception)
@@ -0,0 +1,1062 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+// ShardedBoundedMap.hpp
+#ifndef GENERICS_SHARDED_BOUNDED_MAP_HPP
+#define GENERICS_SHARDED_BOUNDED_MAP_HPP
+
+#include <vector>
+#include <cassert>
+
+#include <Generics/BoundedMap.hpp>
+#include <Generics/ArrayAutoPtr.hpp>
+#include <Generics/Uncopyable.hpp>
+
+
+namespace Generics
+{
+  /**
+   * Helper class for Container specification of ShardedBoundedMap class
+   */
+  template <typename Key, typename Data>
+  struct ShardedBoundedMapTypes
+  {
+    /**
+     * Item is stored in the hash of the segment. Recency information is
+     * kept inside of it and can be changed under the read lock.
+     */
+    struct Item
+    {
+      Data data;
+      size_t size;
+      size_t slot;              // position in the segment's clock ring
+      unsigned char referenced; // clock reference bit
+      long long last_used;      // microseconds, refreshed coarsely
+
+      Item(Data& data, size_t size, size_t slot, long long now)
+        throw (eh::Exception);
+      Item(Data&& data, size_t size, size_t slot, long long now)
+        throw (eh::Exception);
+      Item(Item&& i) throw ();
+      Item(Item&) throw () = delete;
+      Item(const Item&) throw () = delete;
+    };
+  };
+
+
+  /**
+   * Lock striped variant of BoundedMap.
+   * Items are distributed between independently locked segments by the
+   * key's hash, each segment has its own share of the bound.
+   * The least recent item is determined approximately with CLOCK algorithm
+   * instead of the ordered list: find() only sets the reference bit and
+   * refreshes the last usage time (once per timeout / RECENCY_DIVIDER)
+   * so it takes the read lock of the segment and writes nothing
+   * for frequently used items.
+   * When there is not enough space for an item the clock hand goes
+   * through the segment clearing reference bits and removing outdated
+   * not referenced items. Insertion fails if EVICTION_SCAN_LIMIT
+   * consequent items (or two full rounds) can not be removed.
+   *
+   * Iterators and statistics are the same as those of BoundedMap.
+   * Key must provide hash() member function (hash adapters do).
+   */
+  template <typename Key, typename Data,
+    typename SizePolicy = DefaultSizePolicy<Key, Data>,
+    typename SyncPolicy = Sync::Policy::PosixThreadRW,
+    typename Container =
+      ReferenceCounting::HashTable<Key,
+        typename ShardedBoundedMapTypes<Key, Data>::Item> >
+  class ShardedBoundedMap : private Uncopyable
+  {
+  private:
+    typedef BoundedMap<Key, Data, SizePolicy, SyncPolicy> Plain;
+
+  public:
+    typedef typename Plain::key_type key_type;
+    typedef typename Plain::data_type data_type;
+    typedef typename Plain::mapped_type mapped_type;
+    typedef typename Plain::value_type value_type;
+
+    typedef typename Container::size_type size_type;
+    typedef typename Plain::pointer pointer;
+    typedef typename Plain::const_pointer const_pointer;
+    typedef typename Plain::reference reference;
+    typedef typename Plain::const_reference const_reference;
+
+    typedef typename Plain::IteratorBase IteratorBase;
+    typedef typename Plain::const_iterator const_iterator;
+    typedef typename Plain::iterator iterator;
+
+    class Inserter
+    {
+    public:
+      void
+      operator =(Data& data) throw (eh::Exception);
+      void
+      operator =(Data&& data) throw (eh::Exception);
+
+    private:
+      Inserter(ShardedBoundedMap& map, const Key& key) throw ();
+      Inserter(Inserter&& inserter) throw ();
+
+      ShardedBoundedMap& map_;
+      const Key& key_;
+
+      friend class ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy,
+        Container>;
+    };
+
+    static const size_type DEFAULT_SEGMENTS = 16;
+    static const size_t EVICTION_SCAN_LIMIT = 64;
+    static const long long RECENCY_DIVIDER = 16;
+
+
+    /**
+     * Constructor
+     * @param bound upper limit of the total size of elements
+     * (positive), it is divided between segments
+     * @param timeout time interval allowing to name an element outdated
+     * @param size_policy size policy object
+     * @param segments number of independently locked segments (positive)
+     */
+    ShardedBoundedMap(size_type bound, const Time& timeout,
+      SizePolicy size_policy = SizePolicy(),
+      size_type segments = DEFAULT_SEGMENTS)
+      throw (eh::Exception);
+
+    /**
+     * Finds element by the key.
+     * Marks the found item as recently used, takes the read lock only.
+     * @param key key to search for
+     * @return iterator with the value of found element or
+     * iterator equal to end() if not found
+     */
+    iterator
+    find(const key_type& key) throw (eh::Exception);
+
+    /**
+     * Finds element by the key (const version).
+     * Marks the found item as recently used, takes the read lock only.
+     * @param key key to search for
+     * @return const iterator with the value of found element or
+     * const iterator equal to end() if not found
+     */
+    const_iterator
+    find(const key_type& key) const throw (eh::Exception);
+
+    /**
+     * Tries to inserts another item into the container.
+     * If an item with the equal key exists no insertion occur.
+     * If the segment's bound is reached outdated items of the segment
+     * are removed.
+     * This function also updates usage statistics.
+     * @param value value to insert
+     * @return pair<end(), false> if insert is impossible or
+     * pair<iterator to the existing/inserted item,
+     * whether or not insertion occured>
+     */
+    std::pair<iterator, bool>
+    insert(value_type& value) throw (eh::Exception);
+
+    /**
+     * Tries to inserts another item into the container.
+     * Move semantics version of insert().
+     * @param value value to insert (move semantic is used)
+     * @return pair<end(), false> if insert is impossible or
+     * pair<iterator to the existing/inserted item,
+     * whether or not insertion occured>
+     */
+    std::pair<iterator, bool>
+    insert(value_type&& value) throw (eh::Exception);
+
+    /**
+     * Updates the size of the specified item.
+     * Semantics are the same as those of BoundedMap::update()
+     * within the item's segment.
+     * @param key key describing changing element
+     */
+    void
+    update(const Key& key) throw ();
+
+    /**
+     * Updates the size of the specified item.
+     * @param iterator iterator describing changing element
+     */
+    void
+    update(const IteratorBase& iterator) throw ();
+
+    /**
+     * Either replaces the existing item or tries to insert it if it's
+     * absent.
+     * It also calls update() allowing to erase the item if it's too big.
+     */
+    void
+    insert_or_update(const Key& key, Data& data) throw (eh::Exception);
+
+    /**
+     * Either replaces the existing item or tries to insert it if it's
+     * absent.
+     * Move semantics is used.
+     */
+    void
+    insert_or_update(const Key& key, Data&& data) throw (eh::Exception);
+
+    /**
+     * Calls insert_or_update in std::map-compatible way.
+     * @param key key of the item
+     * @return proxy object allowing assignment of Data
+     */
+    Inserter
+    operator [](const Key& key) throw ();
+
+    /**
+     * Removes the item from the container by the key.
+     * @param key item key
+     */
+    void
+    erase(const Key& key) throw ();
+
+    /**
+     * Removes the item from the container by the key.
+     * @param itor item descriptor
+     */
+    void
+    erase(const IteratorBase& itor) throw ();
+
+    /**
+     * Clears the container
+     */
+    void
+    clear() throw ();
+
+    /**
+     * Beyond-the-last iterator is required for success test of
+     * find() and insert()
+     * @return iterator referencing to nothing
+     */
+    const const_iterator&
+    end() const throw ();
+
+    /**
+     * Actual number of elements stored (segments are locked one by one)
+     * @return number of elements in the map
+     */
+    size_type
+    size() const throw ();
+
+    /**
+     * Copies all of value pairs to insert iterator
+     * @param insert insert iterator to copy data to
+     * @result value of insert iterator after copying
+     */
+    template <typename InsertIterator>
+    InsertIterator
+    copy_to(InsertIterator insert) throw (eh::Exception);
+
+    /**
+     * Container usage statistics summed over segments
+     * @param reset whether or not reset usage statistics
+     * @return gathered statistics
+     */
+    BoundedMapStat
+    statistics(bool reset = false) throw ();
+
+    /**
+     * Current bound limit
+     * @return current bound limit
+     */
+    size_type
+    bound() const throw ();
+
+    /**
+     * Sets new bound limit. No removal of extra elements is made
+     * @param new_bound new bound limit
+     */
+    void
+    bound(size_type new_bound) throw ();
+
+    /**
+     * Current expiration timeout
+     * @return expiration timeout
+     */
+    Time
+    timeout() const throw ();
+
+    /**
+     * Sets new expiration timeout. No removal of expired elements is made
+     */
+    void
+    timeout(Time new_timeout) throw ();
+
+    /**
+     * Number of segments
+     * @return number of segments
+     */
+    size_type
+    segments() const throw ();
+
+  private:
+    typedef typename ShardedBoundedMapTypes<Key, Data>::Item Item;
+    typedef std::vector<Key> Ring;
+
+    struct Segment
+    {
+      Segment() throw (eh::Exception);
+
+      void
+      set_timeout(const Time& new_timeout) throw ();
+
+      mutable typename SyncPolicy::Mutex mutex;
+
+      Container container;
+      Ring ring;
+      size_t hand;
+      size_t size;
+      size_type bound;
+      Time timeout;
+      long long timeout_usec;
+      long long granularity;
+      BoundedMapStat stat;
+
+      char padding[64];
+    };
+
+    Segment&
+    segment_(const Key& key) const throw ();
+
+    static
+    void
+    touch_(Item& item, long long now, long long granularity) throw ();
+
+    static
+    long long
+    now_() throw ();
+
+    void
+    bound_(size_type new_bound) throw ();
+
+    bool
+    evict_(Segment& segment, size_t extra, const Item* keep,
+      long long now) throw ();
+
+    void
+    remove_(Segment& segment, typename Container::iterator itor)
+      throw ();
+
+    template <typename DataType>
+    std::pair<iterator, bool>
+    insert_(Segment& segment, const Key& key, DataType&& data,
+      long long now)
+      throw (eh::Exception);
+
+    template <typename ValueType>
+    std::pair<iterator, bool>
+    insert_(ValueType&& value) throw (eh::Exception);
+
+    bool
+    update_(Segment& segment, typename Container::iterator itor,
+      long long now) throw ();
+
+    template <typename DataType>
+    void
+    insert_or_update_(const Key& key, DataType&& data)
+      throw (eh::Exception);
+
+
+    const size_type SEGMENTS_;
+    SizePolicy size_policy_;
+    mutable ArrayAutoPtr<Segment> segments_;
+
+    const const_iterator END_CONST_ITERATOR;
+  };
+}
+
+/*
+ * INLINES
+ */
+namespace Generics
+{
+  //
+  // ShardedBoundedMapTypes::Item
+  //
+
+  template <typename Key, typename Data>
+  ShardedBoundedMapTypes<Key, Data>::Item::Item(Data& data, size_t size,
+    size_t slot, long long now) throw (eh::Exception)
+    : data(data), size(size), slot(slot), referenced(0), last_used(now)
+  {
+  }
+
+  template <typename Key, typename Data>
+  ShardedBoundedMapTypes<Key, Data>::Item::Item(Data&& data, size_t size,
+    size_t slot, long long now) throw (eh::Exception)
+    : data(std::move(data)), size(size), slot(slot), referenced(0),
+      last_used(now)
+  {
+  }
+
+  template <typename Key, typename Data>
+  ShardedBoundedMapTypes<Key, Data>::Item::Item(Item&& i) throw ()
+    : data(std::move(i.data)), size(i.size), slot(i.slot),
+      referenced(i.referenced), last_used(i.last_used)
+  {
+  }
+
+
+  //
+  // ShardedBoundedMap::Inserter class
+  //
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    Inserter::Inserter(ShardedBoundedMap& map, const Key& key) throw ()
+    : map_(map), key_(key)
+  {
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    Inserter::Inserter(Inserter&& inserter) throw ()
+    : map_(inserter.map_), key_(inserter.key_)
+  {
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    Inserter::operator =(Data& data) throw (eh::Exception)
+  {
+    map_.insert_or_update_(key_, data);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    Inserter::operator =(Data&& data) throw (eh::Exception)
+  {
+    map_.insert_or_update_(key_, std::move(data));
+  }
+
+
+  //
+  // ShardedBoundedMap::Segment class
+  //
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    Segment::Segment() throw (eh::Exception)
+    : hand(0), size(0), bound(0), timeout_usec(0), granularity(0)
+  {
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    Segment::set_timeout(const Time& new_timeout) throw ()
+  {
+    timeout = new_timeout;
+    timeout_usec = new_timeout.microseconds();
+    granularity = timeout_usec / RECENCY_DIVIDER;
+  }
+
+
+  //
+  // ShardedBoundedMap class
+  //
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    ShardedBoundedMap(size_type bound, const Time& timeout,
+      SizePolicy size_policy, size_type segments) throw (eh::Exception)
+    : SEGMENTS_(segments ? segments : 1), size_policy_(size_policy),
+      segments_(SEGMENTS_), END_CONST_ITERATOR()
+  {
+    bound_(bound);
+    for (size_type i = 0; i < SEGMENTS_; i++)
+    {
+      segments_[i].set_timeout(timeout);
+    }
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    Segment&
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    segment_(const Key& key) const throw ()
+  {
+    size_t hash = key.hash();
+    // Containers use the low bits, mix the high ones for the segment
+    hash ^= hash >> 16;
+    return segments_[hash % SEGMENTS_];
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    touch_(Item& item, long long now, long long granularity) throw ()
+  {
+    // Loads first, hot items must not make their cache lines dirty
+    if (!__atomic_load_n(&item.referenced, __ATOMIC_RELAXED))
+    {
+      __atomic_store_n(&item.referenced, 1, __ATOMIC_RELAXED);
+    }
+    if (__atomic_load_n(&item.last_used, __ATOMIC_RELAXED) + granularity <
+      now)
+    {
+      __atomic_store_n(&item.last_used, now, __ATOMIC_RELAXED);
+    }
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  long long
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    now_() throw ()
+  {
+    return Time::get_time_of_day().microseconds();
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    bound_(size_type new_bound) throw ()
+  {
+    const size_type SHARE = new_bound / SEGMENTS_;
+    const size_type REST = new_bound % SEGMENTS_;
+    for (size_type i = 0; i < SEGMENTS_; i++)
+    {
+      typename SyncPolicy::WriteGuard guard(segments_[i].mutex);
+      segments_[i].bound = SHARE + (i < REST);
+    }
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  bool
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    evict_(Segment& segment, size_t extra, const Item* keep, long long now)
+    throw ()
+  {
+    size_t idle = 0;
+    while (segment.size + extra > segment.bound)
+    {
+      if (idle >= EVICTION_SCAN_LIMIT || idle >= 2 * segment.ring.size())
+      {
+        return false;
+      }
+      if (segment.hand >= segment.ring.size())
+      {
+        segment.hand = 0;
+      }
+
+      typename Container::iterator itor(
+        segment.container.find(segment.ring[segment.hand]));
+      assert(itor != segment.container.end());
+      Item& item = itor->second;
+
+      if (&item == keep ||
+        item.last_used + segment.timeout_usec > now)
+      {
+        idle++;
+        segment.hand++;
+        continue;
+      }
+      if (item.referenced)
+      {
+        // Second chance
+        item.referenced = 0;
+        idle++;
+        segment.hand++;
+        continue;
+      }
+
+      segment.stat.removed_outdated++;
+      // The last item takes the slot, the hand stays
+      remove_(segment, itor);
+      idle = 0;
+    }
+
+    return true;
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    remove_(Segment& segment, typename Container::iterator itor) throw ()
+  {
+    const size_t SLOT = itor->second.slot;
+    segment.size -= itor->second.size;
+    segment.container.erase(itor);
+
+    if (SLOT + 1 != segment.ring.size())
+    {
+      segment.ring[SLOT] = std::move(segment.ring.back());
+      typename Container::iterator moved(
+        segment.container.find(segment.ring[SLOT]));
+      assert(moved != segment.container.end());
+      moved->second.slot = SLOT;
+    }
+    segment.ring.pop_back();
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    iterator
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    find(const key_type& key) throw (eh::Exception)
+  {
+    const long long NOW = now_();
+    Segment& segment = segment_(key);
+
+    typename SyncPolicy::ReadGuard guard(segment.mutex);
+
+    typename Container::iterator itor(segment.container.find(key));
+    if (itor == segment.container.end())
+    {
+      return iterator();
+    }
+    touch_(itor->second, NOW, segment.granularity);
+    return iterator(key, itor->second.data);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    const_iterator
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    find(const key_type& key) const throw (eh::Exception)
+  {
+    const long long NOW = now_();
+    Segment& segment = segment_(key);
+
+    typename SyncPolicy::ReadGuard guard(segment.mutex);
+
+    typename Container::iterator itor(segment.container.find(key));
+    if (itor == segment.container.end())
+    {
+      return end();
+    }
+    touch_(itor->second, NOW, segment.granularity);
+    return const_iterator(key, itor->second.data);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  template <typename DataType>
+  std::pair<
+    typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy,
+      Container>::iterator, bool>
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    insert_(Segment& segment, const Key& key, DataType&& data,
+      long long now)
+      throw (eh::Exception)
+  {
+    size_t size = size_policy_(key, data);
+    if (size > segment.bound || !evict_(segment, size, 0, now))
+    {
+      segment.stat.not_inserted++;
+      return std::pair<iterator, bool>(iterator(), false);
+    }
+
+    segment.ring.push_back(key);
+
+    std::pair<typename Container::iterator, bool> result;
+    try
+    {
+      Item item(std::forward<DataType>(data), size,
+        segment.ring.size() - 1, now);
+      result = segment.container.insert(
+        typename Container::value_type(key, std::move(item)));
+      assert(result.second);
+    }
+    catch (...)
+    {
+      segment.ring.pop_back();
+      throw;
+    }
+    segment.stat.inserted_new++;
+    segment.size += size;
+
+    return std::pair<iterator, bool>(
+      iterator(result.first->first, result.first->second.data), true);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  template <typename ValueType>
+  std::pair<
+    typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy,
+      Container>::iterator, bool>
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    insert_(ValueType&& value) throw (eh::Exception)
+  {
+    const long long NOW = now_();
+    Segment& segment = segment_(value.first);
+
+    typename SyncPolicy::WriteGuard guard(segment.mutex);
+
+    {
+      typename Container::iterator itor(
+        segment.container.find(value.first));
+      if (itor != segment.container.end())
+      {
+        touch_(itor->second, NOW, segment.granularity);
+        segment.stat.insert_existing++;
+        return std::pair<iterator, bool>(
+          iterator(itor->first, itor->second.data), false);
+      }
+    }
+
+    return insert_(segment, value.first,
+      std::forward<ValueType>(value).second, NOW);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  std::pair<
+    typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy,
+      Container>::iterator, bool>
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    insert(value_type& value) throw (eh::Exception)
+  {
+    return insert_(value);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  std::pair<
+    typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy,
+      Container>::iterator, bool>
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    insert(value_type&& value) throw (eh::Exception)
+  {
+    return insert_(std::move(value));
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  bool
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    update_(Segment& segment, typename Container::iterator itor,
+      long long now) throw ()
+  {
+    Item& item = itor->second;
+    size_t size = size_policy_(itor->first, item.data);
+    if (segment.size + size - item.size <= segment.bound)
+    {
+      segment.size = segment.size + size - item.size;
+      item.size = size;
+      return true;
+    }
+
+    if (size > segment.bound ||
+      !evict_(segment, size - item.size, &item, now))
+    {
+      segment.stat.removed_updated++;
+      remove_(segment, itor);
+      return false;
+    }
+
+    segment.size = segment.size + size - item.size;
+    item.size = size;
+    return true;
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    update(const Key& key) throw ()
+  {
+    const long long NOW = now_();
+    Segment& segment = segment_(key);
+
+    typename SyncPolicy::WriteGuard guard(segment.mutex);
+
+    typename Container::iterator itor(segment.container.find(key));
+    if (itor != segment.container.end())
+    {
+      update_(segment, itor, NOW);
+    }
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    update(const IteratorBase& iterator) throw ()
+  {
+    update(iterator->first);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  template <typename DataType>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    insert_or_update_(const Key& key, DataType&& data) throw (eh::Exception)
+  {
+    const long long NOW = now_();
+    Segment& segment = segment_(key);
+
+    typename SyncPolicy::WriteGuard guard(segment.mutex);
+
+    {
+      typename Container::iterator itor(segment.container.find(key));
+      if (itor != segment.container.end())
+      {
+        touch_(itor->second, NOW, segment.granularity);
+        itor->second.data = std::forward<DataType>(data);
+        if (update_(segment, itor, NOW))
+        {
+          segment.stat.replaced++;
+        }
+        return;
+      }
+    }
+
+    insert_(segment, key, std::forward<DataType>(data), NOW);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    insert_or_update(const Key& key, Data& data) throw (eh::Exception)
+  {
+    insert_or_update_(key, data);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    insert_or_update(const Key& key, Data&& data) throw (eh::Exception)
+  {
+    insert_or_update_(key, std::move(data));
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    Inserter
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    operator [](const Key& key) throw ()
+  {
+    return Inserter(*this, key);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    erase(const Key& key) throw ()
+  {
+    Segment& segment = segment_(key);
+
+    typename SyncPolicy::WriteGuard guard(segment.mutex);
+
+    typename Container::iterator itor(segment.container.find(key));
+    if (itor != segment.container.end())
+    {
+      remove_(segment, itor);
+    }
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    erase(const IteratorBase& it) throw ()
+  {
+    erase(it->first);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    clear() throw ()
+  {
+    for (size_type i = 0; i < SEGMENTS_; i++)
+    {
+      Segment& segment = segments_[i];
+
+      typename SyncPolicy::WriteGuard guard(segment.mutex);
+
+      segment.size = 0;
+      segment.hand = 0;
+      segment.container.clear();
+      segment.ring.clear();
+    }
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    const_iterator const &
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    end() const throw ()
+  {
+    return END_CONST_ITERATOR;
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  template <typename InsertIterator>
+  InsertIterator
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    copy_to(InsertIterator insert) throw (eh::Exception)
+  {
+    for (size_type i = 0; i < SEGMENTS_; i++)
+    {
+      Segment& segment = segments_[i];
+
+      typename SyncPolicy::ReadGuard guard(segment.mutex);
+
+      for (typename Container::iterator itor(segment.container.begin());
+        itor != segment.container.end(); ++itor)
+      {
+        *insert = value_type(itor->first, itor->second.data);
+        ++insert;
+      }
+    }
+
+    return insert;
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    size_type
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    size() const throw ()
+  {
+    size_type size = 0;
+    for (size_type i = 0; i < SEGMENTS_; i++)
+    {
+      typename SyncPolicy::ReadGuard guard(segments_[i].mutex);
+      size += segments_[i].container.size();
+    }
+    return size;
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  BoundedMapStat
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    statistics(bool reset) throw ()
+  {
+    BoundedMapStat stat;
+    for (size_type i = 0; i < SEGMENTS_; i++)
+    {
+      Segment& segment = segments_[i];
+
+      typename SyncPolicy::WriteGuard guard(segment.mutex);
+
+      stat.inserted_new += segment.stat.inserted_new;
+      stat.insert_existing += segment.stat.insert_existing;
+      stat.removed_outdated += segment.stat.removed_outdated;
+      stat.removed_updated += segment.stat.removed_updated;
+      stat.not_inserted += segment.stat.not_inserted;
+      stat.replaced += segment.stat.replaced;
+      if (reset)
+      {
+        segment.stat = BoundedMapStat();
+      }
+    }
+    return stat;
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    size_type
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    bound() const throw ()
+  {
+    size_type bound = 0;
+    for (size_type i = 0; i < SEGMENTS_; i++)
+    {
+      typename SyncPolicy::ReadGuard guard(segments_[i].mutex);
+      bound += segments_[i].bound;
+    }
+    return bound;
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    bound(size_type new_bound) throw ()
+  {
+    bound_(new_bound);
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  Time
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    timeout() const throw ()
+  {
+    typename SyncPolicy::ReadGuard guard(segments_[0].mutex);
+
+    return segments_[0].timeout;
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  void
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    timeout(Time new_timeout) throw ()
+  {
+    for (size_type i = 0; i < SEGMENTS_; i++)
+    {
+      typename SyncPolicy::WriteGuard guard(segments_[i].mutex);
+      segments_[i].set_timeout(new_timeout);
+    }
+  }
+
+  template <typename Key, typename Data, typename SizePolicy,
+    typename SyncPolicy, typename Container>
+  typename ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    size_type
+  ShardedBoundedMap<Key, Data, SizePolicy, SyncPolicy, Container>::
+    segments() const throw ()
+  {
+    return SEGMENTS_;
+  }
+}
+
+#endif
@@ -21,6 +21,10 @@
 
 
 
+#include <stdint.h>
+
+#include <Sync/Key.hpp>
+
 #include <Generics/Statistics.hpp>
 
 
@@ -161,5 +165,281 @@ namespace Generics
       return Time::get_time_of_day().get_local_time().format(
         "%a %d %b %Y %H:%M:%S");
     }
+
+
+    unsigned
+    thread_index() throw (eh::Exception)
+    {
+      // Index + 1 is stored as the key value, zero means not assigned
+      static Sync::Key<void> key;
+      static unsigned threads = 0;
+
+      void* index = key.get_data();
+      if (!index)
+      {
+        const unsigned NEW_INDEX =
+          __atomic_fetch_add(&threads, 1, __ATOMIC_RELAXED);
+        key.set_data(reinterpret_cast<void*>(
+          static_cast<uintptr_t>(NEW_INDEX) + 1));
+        return NEW_INDEX;
+      }
+      return reinterpret_cast<uintptr_t>(index) - 1;
+    }
+
+
+    //
+    // ShardedTimedStatSink class
+    //
+
+    ShardedTimedStatSink::ShardedTimedStatSink(unsigned shards)
+      throw (InvalidArgument, eh::Exception)
+    {
+      if (!shards)
+      {
+        Stream::Error ostr;
+        ostr << FNS << "shards == 0";
+        throw InvalidArgument(ostr);
+      }
+
+      shards_.resize(shards);
+    }
+
+    ShardedTimedStatSink::~ShardedTimedStatSink() throw ()
+    {
+    }
+
+    void
+    ShardedTimedStatSink::reset() throw (eh::Exception)
+    {
+      for (ShardArray::iterator it = shards_.begin(); it != shards_.end();
+        ++it)
+      {
+        it->reset();
+      }
+    }
+
+    StatSink*
+    ShardedTimedStatSink::clone() throw (eh::Exception)
+    {
+      ShardedTimedStatSink_var sink(
+        new ShardedTimedStatSink(shards_.size()));
+      for (unsigned i = 0; i < shards_.size(); i++)
+      {
+        shards_[i].merge(sink->shards_[i]);
+      }
+      return sink.retn();
+    }
+
+    ShardedTimedStatSink::Shard
+    ShardedTimedStatSink::merge_() const throw ()
+    {
+      Shard total;
+      for (ShardArray::const_iterator it = shards_.begin();
+        it != shards_.end(); ++it)
+      {
+        it->merge(total);
+      }
+      return total;
+    }
+
+    Time
+    ShardedTimedStatSink::time_(long long usec) throw ()
+    {
+      return usec >= 0 ? Time(usec / Time::USEC_MAX, usec % Time::USEC_MAX) :
+        -Time(-usec / Time::USEC_MAX, -usec % Time::USEC_MAX);
+    }
+
+    TimedStatData::Data
+    ShardedTimedStatSink::data() const throw (eh::Exception)
+    {
+      const Shard TOTAL = merge_();
+
+      TimedStatData::Data data;
+      data.count = TOTAL.count;
+      if (TOTAL.count)
+      {
+        data.max_time = time_(TOTAL.max);
+        data.min_time = time_(TOTAL.min);
+        data.total_time = time_(TOTAL.total);
+      }
+      return data;
+    }
+
+    Time
+    ShardedTimedStatSink::max_time() const throw (eh::Exception)
+    {
+      return data().max_time;
+    }
+
+    Time
+    ShardedTimedStatSink::min_time() const throw (eh::Exception)
+    {
+      return data().min_time;
+    }
+
+    Time
+    ShardedTimedStatSink::total_time() const throw (eh::Exception)
+    {
+      return data().total_time;
+    }
+
+    Time
+    ShardedTimedStatSink::average_time() const throw (eh::Exception)
+    {
+      const Shard TOTAL = merge_();
+      return TOTAL.count ?
+        time_(TOTAL.total / static_cast<long long>(TOTAL.count)) : Time();
+    }
+
+    void
+    ShardedTimedStatSink::dump_(std::ostream& ostr, const Shard& total)
+      throw (eh::Exception)
+    {
+      ostr << "Total time meterings: " << total.count << std::endl;
+      if (total.count)
+      {
+        ostr << "Ttl time: " << time_(total.total) << std::endl <<
+          "Max time: " << time_(total.max) << std::endl <<
+          "Min time: " << time_(total.min) << std::endl <<
+          "Avg time: " <<
+            time_(total.total / static_cast<long long>(total.count)) <<
+            std::endl;
+      }
+      else
+      {
+        ostr << "Ttl time: " << Time::ZERO << std::endl <<
+          "Max time: " << Time::ZERO << std::endl <<
+          "Min time: " << Time::ZERO << std::endl <<
+          "Avg time: " << Time::ZERO << std::endl;
+      }
+    }
+
+    void
+    ShardedTimedStatSink::dump(std::ostream& ostr) throw (eh::Exception)
+    {
+      dump_(ostr, merge_());
+    }
+
+
+    //
+    // HistogramStatSink class
+    //
+
+    HistogramStatSink::HistogramStatSink(unsigned shards)
+      throw (InvalidArgument, eh::Exception)
+      : ShardedTimedStatSink(shards),
+        counters_(static_cast<size_t>(shards) * SHARD_STRIDE, 0)
+    {
+    }
+
+    HistogramStatSink::~HistogramStatSink() throw ()
+    {
+    }
+
+    void
+    HistogramStatSink::reset() throw (eh::Exception)
+    {
+      ShardedTimedStatSink::reset();
+      for (Counters::iterator it = counters_.begin(); it != counters_.end();
+        ++it)
+      {
+        __atomic_store_n(&*it, 0, __ATOMIC_RELAXED);
+      }
+    }
+
+    StatSink*
+    HistogramStatSink::clone() throw (eh::Exception)
+    {
+      HistogramStatSink_var sink(new HistogramStatSink(shards_.size()));
+      for (unsigned i = 0; i < shards_.size(); i++)
+      {
+        shards_[i].merge(sink->shards_[i]);
+      }
+      for (size_t i = 0; i < counters_.size(); i++)
+      {
+        sink->counters_[i] = __atomic_load_n(&counters_[i], __ATOMIC_RELAXED);
+      }
+      return sink.retn();
+    }
+
+    void
+    HistogramStatSink::merge_counters_(Counters& counters) const
+      throw (eh::Exception)
+    {
+      counters.assign(BUCKETS, 0);
+      for (size_t shard = 0; shard < counters_.size();
+        shard += SHARD_STRIDE)
+      {
+        for (unsigned i = 0; i < BUCKETS; i++)
+        {
+          counters[i] +=
+            __atomic_load_n(&counters_[shard + i], __ATOMIC_RELAXED);
+        }
+      }
+    }
+
+    Time
+    HistogramStatSink::percentile_(const Counters& counters,
+      const Shard& total, double fraction) throw ()
+    {
+      unsigned long long count = 0;
+      for (Counters::const_iterator it = counters.begin();
+        it != counters.end(); ++it)
+      {
+        count += *it;
+      }
+      if (!count)
+      {
+        return Time::ZERO;
+      }
+
+      // Rank of the metering, counting from 1
+      unsigned long long rank =
+        static_cast<unsigned long long>(fraction * count + 0.5);
+      rank = std::max(rank, 1ULL);
+
+      unsigned long long seen = 0;
+      unsigned index = 0;
+      for (; index < BUCKETS - 1; index++)
+      {
+        seen += counters[index];
+        if (seen >= rank)
+        {
+          break;
+        }
+      }
+
+      // The bucket limit is an estimation, the exact extremes are known
+      long long result = bucket_limit(index);
+      if (total.count)
+      {
+        result = std::max(std::min(result, total.max), total.min);
+      }
+      return time_(result);
+    }
+
+    Time
+    HistogramStatSink::percentile(double fraction) const
+      throw (eh::Exception)
+    {
+      Counters counters;
+      merge_counters_(counters);
+      return percentile_(counters, merge_(), fraction);
+    }
+
+    void
+    HistogramStatSink::dump(std::ostream& ostr) throw (eh::Exception)
+    {
+      Counters counters;
+      merge_counters_(counters);
+      const Shard TOTAL = merge_();
+
+      dump_(ostr, TOTAL);
+      ostr << "p50 time: " << percentile_(counters, TOTAL, 0.5) <<
+        std::endl <<
+        "p90 time: " << percentile_(counters, TOTAL, 0.9) << std::endl <<
+        "p99 time: " << percentile_(counters, TOTAL, 0.99) << std::endl <<
+        "p999 time: " << percentile_(counters, TOTAL, 0.999) << std::endl;
+    }
   }
 }
@@ -26,6 +26,7 @@
 
 #include <iostream>
 #include <list>
+#include <vector>
 
 #include <Sync/SyncPolicy.hpp>
 
@@ -73,6 +74,14 @@ namespace Generics
       virtual
       void
       dump(std::ostream& ostr) throw (eh::Exception) = 0;
+
+      /**
+       * @return true if consider() may be called concurrently without
+       * serialization by Collection
+       */
+      virtual
+      bool
+      concurrent() const throw ();
     };
     typedef ReferenceCounting::QualPtr<StatSink> StatSink_var;
 
@@ -83,6 +92,12 @@ namespace Generics
     class DumpPolicy : public virtual ReferenceCounting::Interface
     {
     public:
+      /**
+       * Called after each consider(), Collection serializes the calls
+       * for the same policy object with its lock
+       * @param stat the sink considered
+       * @return true if the sink should be dumped
+       */
       virtual
       bool
       need_dump(StatSink* stat) throw (eh::Exception) = 0;
@@ -149,6 +164,11 @@ namespace Generics
       CountBasedDumpPolicy(std::ostream& ostr, unsigned long long dump_freq)
         throw (eh::Exception);
 
+      /**
+       * Dumps once for each multiple of dump_freq reached since the
+       * previous call. Several considers made concurrently between
+       * the calls can not hide or repeat a multiple then.
+       */
       virtual
       bool
       need_dump(StatSink* stat) throw (eh::Exception);
@@ -163,6 +183,7 @@ namespace Generics
 
     protected:
       unsigned long long dump_freq_;
+      unsigned long long last_count_;
     };
 
     //
@@ -672,6 +693,219 @@ namespace Generics
     protected:
       DataProvider provider_;
     };
+
+
+    //
+    // Sharded statistics implementation classes
+    //
+
+    /**
+     * Sequential number of the calling thread assigned on the first call.
+     * Sharded sinks use it to choose the shard to update.
+     * @return index of the calling thread
+     */
+    unsigned
+    thread_index() throw (eh::Exception);
+
+    /**
+     * TimedStatSink analogue for the heavily concurrent consider() calls.
+     * Every thread accumulates TimedSubject times in its own shard
+     * (thread_index() % shards) with relaxed atomic operations, no locks
+     * are taken; shards are merged only when data is read or dumped.
+     * Readers running concurrently with consider() get an approximate
+     * (not atomic) snapshot.
+     */
+    class ShardedTimedStatSink :
+      public virtual StatSink,
+      public virtual ReferenceCounting::AtomicImpl
+    {
+    public:
+      DECLARE_EXCEPTION(Exception, ActiveObject::Exception);
+      DECLARE_EXCEPTION(InvalidArgument, Exception);
+
+      static const unsigned DEFAULT_SHARDS = 16;
+
+      /**
+       * Constructor
+       * @param shards number of the shards, usually not less than the
+       * number of threads calling consider()
+       */
+      explicit
+      ShardedTimedStatSink(unsigned shards = DEFAULT_SHARDS)
+        throw (InvalidArgument, eh::Exception);
+
+      virtual
+      void
+      consider(const Subject& subject) throw (InvalidArgument, eh::Exception);
+
+      virtual
+      unsigned
+      considered_count() const throw (eh::Exception);
+
+      virtual
+      void
+      reset() throw (eh::Exception);
+
+      virtual
+      StatSink*
+      clone() throw (eh::Exception);
+
+      virtual
+      void
+      dump(std::ostream& ostr) throw (eh::Exception);
+
+      virtual
+      bool
+      concurrent() const throw ();
+
+      TimedStatData::Data
+      data() const throw (eh::Exception);
+
+      Time
+      max_time() const throw (eh::Exception);
+      Time
+      min_time() const throw (eh::Exception);
+      Time
+      total_time() const throw (eh::Exception);
+      Time
+      average_time() const throw (eh::Exception);
+
+    protected:
+      /**
+       * Times are kept in microseconds. The size is two cache lines, so
+       * data of the neighbour shards never share a line.
+       */
+      struct Shard
+      {
+        Shard() throw ();
+
+        void
+        consider(long long usec) throw ();
+
+        void
+        merge(Shard& total) const throw ();
+
+        void
+        reset() throw ();
+
+        unsigned long long count;
+        long long total;
+        long long min;
+        long long max;
+        char padding[128 - 2 * sizeof(long long) -
+          2 * sizeof(unsigned long long)];
+      };
+      typedef std::vector<Shard> ShardArray;
+
+      virtual
+      ~ShardedTimedStatSink() throw ();
+
+      unsigned
+      shard_index_() const throw (eh::Exception);
+
+      Shard
+      merge_() const throw ();
+
+      static
+      long long
+      subject_usec_(const Subject& subject) throw (InvalidArgument);
+
+      static
+      Time
+      time_(long long usec) throw ();
+
+      static
+      void
+      dump_(std::ostream& ostr, const Shard& total) throw (eh::Exception);
+
+    protected:
+      ShardArray shards_;
+    };
+    typedef ReferenceCounting::QualPtr<ShardedTimedStatSink>
+      ShardedTimedStatSink_var;
+
+    /**
+     * Latency histogram of TimedSubject times with log-linear buckets
+     * (HDR histogram layout): each power of two of microseconds is split
+     * into 2^SUB_BUCKET_BITS equal sub-buckets, so a percentile is reported
+     * with the relative error below 2^-SUB_BUCKET_BITS. Times over
+     * 2^MAX_BITS microseconds fall into the last bucket.
+     * Counters are sharded by threads like ShardedTimedStatSink ones.
+     * dump() adds p50, p90, p99 and p999 to the TimedStatSink output.
+     */
+    class HistogramStatSink : public ShardedTimedStatSink
+    {
+    public:
+      static const unsigned SUB_BUCKET_BITS = 5;
+      static const unsigned SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+      static const unsigned MAX_BITS = 40;
+      static const unsigned BUCKETS =
+        (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+      explicit
+      HistogramStatSink(unsigned shards = DEFAULT_SHARDS)
+        throw (InvalidArgument, eh::Exception);
+
+      virtual
+      void
+      consider(const Subject& subject) throw (InvalidArgument, eh::Exception);
+
+      virtual
+      void
+      reset() throw (eh::Exception);
+
+      virtual
+      StatSink*
+      clone() throw (eh::Exception);
+
+      virtual
+      void
+      dump(std::ostream& ostr) throw (eh::Exception);
+
+      /**
+       * @param fraction part of the meterings (0.99 for p99)
+       * @return the time not less than the specified part of the meterings
+       * have
+       */
+      Time
+      percentile(double fraction) const throw (eh::Exception);
+
+      static
+      unsigned
+      bucket(unsigned long long usec) throw ();
+
+      /**
+       * @param index bucket index
+       * @return the highest value falling into the bucket
+       */
+      static
+      unsigned long long
+      bucket_limit(unsigned index) throw ();
+
+    protected:
+      typedef std::vector<unsigned long long> Counters;
+
+      virtual
+      ~HistogramStatSink() throw ();
+
+      void
+      merge_counters_(Counters& counters) const throw (eh::Exception);
+
+      static
+      Time
+      percentile_(const Counters& counters, const Shard& total,
+        double fraction) throw ();
+
+    protected:
+      /**
+       * SHARD_STRIDE counters per shard, the tail is padding
+       */
+      static const unsigned SHARD_STRIDE = BUCKETS + 16;
+
+      Counters counters_;
+    };
+    typedef ReferenceCounting::QualPtr<HistogramStatSink>
+      HistogramStatSink_var;
   }
 }
 
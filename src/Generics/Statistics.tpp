@@ -19,6 +19,9 @@
 
 
 
+#include <climits>
+#include <algorithm>
+
 #include <Generics/Function.hpp>
 
 #include <Stream/MemoryStream.hpp>
@@ -38,6 +41,18 @@ namespace Generics
     }
 
 
+    //
+    // StatSink class
+    //
+
+    inline
+    bool
+    StatSink::concurrent() const throw ()
+    {
+      return false;
+    }
+
+
     //
     // NullDumpPolicy class
     //
@@ -112,7 +127,8 @@ namespace Generics
     CountBasedDumpPolicy::CountBasedDumpPolicy(std::ostream& ostr,
       unsigned long long dump_freq) throw (eh::Exception)
       : StreamDumpPolicy(ostr),
-        dump_freq_(dump_freq)
+        dump_freq_(dump_freq),
+        last_count_(0)
     {
     }
 
@@ -126,7 +142,10 @@ namespace Generics
     CountBasedDumpPolicy::need_dump(StatSink* stat)
       throw (eh::Exception)
     {
-      return (stat->considered_count() % dump_freq_) == 0;
+      const unsigned long long COUNT = stat->considered_count();
+      const bool DUMP = COUNT / dump_freq_ > last_count_ / dump_freq_;
+      last_count_ = COUNT;
+      return DUMP;
     }
 
     inline
@@ -366,6 +385,20 @@ namespace Generics
     Collection::Item::consider(const Subject& subject)
       throw (eh::Exception)
     {
+      if (stat_->concurrent())
+      {
+        // Lock free sinks are not serialized, the lock is for
+        // the dump policy and cloning
+        stat_->consider(subject);
+
+        Sync::PosixGuard guard(mutex_);
+        if (dump_policy_->need_dump(stat_))
+        {
+          stat_dumper_->execute_dumping(dump_policy_->clone(), clone_i());
+        }
+        return;
+      }
+
       Sync::PosixGuard guard(mutex_);
 
       stat_->consider(subject);
@@ -985,5 +1018,167 @@ namespace Generics
         "Min : " << data.min_value << std::endl <<
         "Avg : " << data.avg_value << std::endl;
     }
+
+
+    //
+    // ShardedTimedStatSink::Shard class
+    //
+
+    inline
+    ShardedTimedStatSink::Shard::Shard() throw ()
+      : count(0), total(0), min(LLONG_MAX), max(LLONG_MIN)
+    {
+    }
+
+    inline
+    void
+    ShardedTimedStatSink::Shard::consider(long long usec) throw ()
+    {
+      __atomic_fetch_add(&count, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&total, usec, __ATOMIC_RELAXED);
+
+      long long cur = __atomic_load_n(&min, __ATOMIC_RELAXED);
+      while (usec < cur && !__atomic_compare_exchange_n(&min, &cur, usec,
+        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      {
+      }
+
+      cur = __atomic_load_n(&max, __ATOMIC_RELAXED);
+      while (usec > cur && !__atomic_compare_exchange_n(&max, &cur, usec,
+        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      {
+      }
+    }
+
+    inline
+    void
+    ShardedTimedStatSink::Shard::merge(Shard& total_shard) const throw ()
+    {
+      total_shard.count += __atomic_load_n(&count, __ATOMIC_RELAXED);
+      total_shard.total += __atomic_load_n(&total, __ATOMIC_RELAXED);
+      total_shard.min = std::min(total_shard.min,
+        __atomic_load_n(&min, __ATOMIC_RELAXED));
+      total_shard.max = std::max(total_shard.max,
+        __atomic_load_n(&max, __ATOMIC_RELAXED));
+    }
+
+    inline
+    void
+    ShardedTimedStatSink::Shard::reset() throw ()
+    {
+      __atomic_store_n(&count, 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&total, 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&min, LLONG_MAX, __ATOMIC_RELAXED);
+      __atomic_store_n(&max, LLONG_MIN, __ATOMIC_RELAXED);
+    }
+
+
+    //
+    // ShardedTimedStatSink class
+    //
+
+    inline
+    unsigned
+    ShardedTimedStatSink::shard_index_() const throw (eh::Exception)
+    {
+      return thread_index() % shards_.size();
+    }
+
+    inline
+    long long
+    ShardedTimedStatSink::subject_usec_(const Subject& subject)
+      throw (InvalidArgument)
+    {
+      const TimedSubject* timed_subject =
+        dynamic_cast<const TimedSubject*>(&subject);
+
+      if (timed_subject == 0)
+      {
+        Stream::Error ostr;
+        ostr << FNS << "subject is not of TimedSubject type";
+        throw InvalidArgument(ostr);
+      }
+
+      return timed_subject->time().microseconds();
+    }
+
+    inline
+    void
+    ShardedTimedStatSink::consider(const Subject& subject)
+      throw (InvalidArgument, eh::Exception)
+    {
+      shards_[shard_index_()].consider(subject_usec_(subject));
+    }
+
+    inline
+    bool
+    ShardedTimedStatSink::concurrent() const throw ()
+    {
+      return true;
+    }
+
+    inline
+    unsigned
+    ShardedTimedStatSink::considered_count() const throw (eh::Exception)
+    {
+      unsigned long long count = 0;
+      for (ShardArray::const_iterator it = shards_.begin();
+        it != shards_.end(); ++it)
+      {
+        count += __atomic_load_n(&it->count, __ATOMIC_RELAXED);
+      }
+      return count;
+    }
+
+
+    //
+    // HistogramStatSink class
+    //
+
+    inline
+    unsigned
+    HistogramStatSink::bucket(unsigned long long usec) throw ()
+    {
+      if (usec < 2 * SUB_BUCKETS)
+      {
+        return usec;
+      }
+
+      const unsigned HIGH_BIT = 63 - __builtin_clzll(usec);
+      if (HIGH_BIT >= MAX_BITS)
+      {
+        return BUCKETS - 1;
+      }
+
+      const unsigned SHIFT = HIGH_BIT - SUB_BUCKET_BITS;
+      return (SHIFT + 1) * SUB_BUCKETS + (usec >> SHIFT) - SUB_BUCKETS;
+    }
+
+    inline
+    unsigned long long
+    HistogramStatSink::bucket_limit(unsigned index) throw ()
+    {
+      if (index < 2 * SUB_BUCKETS)
+      {
+        return index;
+      }
+
+      const unsigned SHIFT = index / SUB_BUCKETS - 1;
+      return ((static_cast<unsigned long long>(
+        index % SUB_BUCKETS + SUB_BUCKETS + 1)) << SHIFT) - 1;
+    }
+
+    inline
+    void
+    HistogramStatSink::consider(const Subject& subject)
+      throw (InvalidArgument, eh::Exception)
+    {
+      const long long USEC = subject_usec_(subject);
+      const unsigned SHARD = shard_index_();
+
+      shards_[SHARD].consider(USEC);
+      __atomic_fetch_add(&counters_[SHARD * SHARD_STRIDE +
+        bucket(USEC > 0 ? USEC : 0)], 1, __ATOMIC_RELAXED);
+    }
   }
 }
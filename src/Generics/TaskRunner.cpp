@@ -30,17 +30,147 @@
 namespace Generics
 {
   //
-  // TaskRunner::TaskRunnerJob class
+  // TaskRunner::TaskRunnerJobBase class
   //
 
-  TaskRunner::TaskRunnerJob::TaskRunnerJob(ActiveObjectCallback* callback,
-    unsigned number_of_threads, unsigned max_pending_tasks)
+  TaskRunner::TaskRunnerJobBase::TaskRunnerJobBase(
+    ActiveObjectCallback* callback, unsigned number_of_threads,
+    unsigned max_pending_tasks)
     throw (eh::Exception)
     : SingleJob(callback),
-      NUMBER_OF_THREADS_(number_of_threads), number_of_unused_threads_(0),
+      NUMBER_OF_THREADS_(number_of_threads),
       new_task_(0),
       not_full_(std::min<unsigned>(max_pending_tasks, SEM_VALUE_MAX)),
-      LIMITED_(max_pending_tasks)
+      LIMITED_(max_pending_tasks),
+      unfinished_tasks_(0)
+  {
+  }
+
+  TaskRunner::TaskRunnerJobBase::~TaskRunnerJobBase() throw ()
+  {
+  }
+
+  bool
+  TaskRunner::TaskRunnerJobBase::wait_for_queue_exhausting(
+    const Time* timeout) throw (eh::Exception)
+  {
+    Sync::ConditionalGuard guard(exhausted_);
+    while (unfinished_tasks_)
+    {
+      if (!guard.timed_wait(timeout))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void
+  TaskRunner::TaskRunnerJobBase::notify_on_queue_exhausting(Task* task)
+    throw (InvalidArgument, eh::Exception)
+  {
+    if (!task)
+    {
+      Stream::Error ostr;
+      ostr << FNS << "task is NULL";
+      throw InvalidArgument(ostr);
+    }
+
+    {
+      Sync::ConditionalGuard guard(exhausted_);
+      if (unfinished_tasks_)
+      {
+        exhausting_notifications_.emplace_back(
+          ReferenceCounting::add_ref(task));
+        return;
+      }
+    }
+
+    execute_(task);
+  }
+
+  void
+  TaskRunner::TaskRunnerJobBase::task_added_() throw ()
+  {
+    __gnu_cxx::__atomic_add(&unfinished_tasks_, 1);
+  }
+
+  void
+  TaskRunner::TaskRunnerJobBase::tasks_finished_(unsigned count)
+    throw (eh::Exception)
+  {
+    if (static_cast<unsigned>(
+      __gnu_cxx::__exchange_and_add(&unfinished_tasks_,
+        -static_cast<_Atomic_word>(count))) != count)
+    {
+      return;
+    }
+
+    Tasks notifications;
+    {
+      Sync::ConditionalGuard guard(exhausted_);
+      exhausted_.broadcast();
+      notifications.swap(exhausting_notifications_);
+    }
+
+    for (Tasks::iterator itor = notifications.begin();
+      itor != notifications.end(); ++itor)
+    {
+      execute_(*itor);
+    }
+  }
+
+  void
+  TaskRunner::TaskRunnerJobBase::terminate() throw ()
+  {
+    for (unsigned long i = NUMBER_OF_THREADS_; i; i--)
+    {
+      new_task_.release();
+    }
+  }
+
+  bool
+  TaskRunner::TaskRunnerJobBase::reserve_place_(const Time* timeout)
+    throw (eh::Exception)
+  {
+    return !LIMITED_ || (timeout ? not_full_.timed_acquire(timeout) :
+      not_full_.try_acquire());
+  }
+
+  void
+  TaskRunner::TaskRunnerJobBase::release_place_() throw (eh::Exception)
+  {
+    // Tell any blocked thread that the queue is ready for a "new item"
+    if (LIMITED_)
+    {
+      not_full_.release();
+    }
+  }
+
+  void
+  TaskRunner::TaskRunnerJobBase::execute_(Task* task)
+    throw (eh::Exception)
+  {
+    try
+    {
+      task->execute();
+    }
+    catch (const eh::Exception& ex)
+    {
+      callback()->error(String::SubString(ex.what()));
+    }
+  }
+
+
+  //
+  // TaskRunner::TaskRunnerJob class
+  //
+
+  TaskRunner::TaskRunnerJob::TaskRunnerJob(ActiveObjectCallback* callback,
+    unsigned number_of_threads, unsigned max_pending_tasks)
+    throw (eh::Exception)
+    : TaskRunnerJobBase(callback, number_of_threads, max_pending_tasks),
+      number_of_unused_threads_(0)
   {
   }
 
@@ -54,18 +184,33 @@ namespace Generics
     number_of_unused_threads_ = threads;
   }
 
+  unsigned
+  TaskRunner::TaskRunnerJob::task_count() const throw ()
+  {
+    Sync::PosixGuard guard(mutex());
+    return tasks_.size();
+  }
+
   void
   TaskRunner::TaskRunnerJob::clear() throw (eh::Exception)
   {
-    Sync::PosixGuard guard(mutex());
-    if (LIMITED_)
+    size_t removed;
     {
-      for (size_t i = tasks_.size(); i; i--)
+      Sync::PosixGuard guard(mutex());
+      removed = tasks_.size();
+      if (LIMITED_)
       {
-        not_full_.release();
+        for (size_t i = removed; i; i--)
+        {
+          not_full_.release();
+        }
       }
+      tasks_.clear();
+    }
+    if (removed)
+    {
+      tasks_finished_(removed);
     }
-    tasks_.clear();
   }
 
   void
@@ -81,17 +226,14 @@ namespace Generics
     }
 
     // Producer
-    if (LIMITED_)
+    if (!reserve_place_(timeout))
     {
-      if (!(timeout ? not_full_.timed_acquire(timeout) :
-        not_full_.try_acquire()))
-      {
-        Stream::Error ostr;
-        ostr << FNS << "TaskRunner overflow";
-        throw Overflow(ostr);
-      }
+      Stream::Error ostr;
+      ostr << FNS << "TaskRunner overflow";
+      throw Overflow(ostr);
     }
 
+    task_added_();
     {
       Sync::PosixGuard guard(mutex());
       try
@@ -100,10 +242,8 @@ namespace Generics
       }
       catch (...)
       {
-        if (LIMITED_)
-        {
-          not_full_.release();
-        }
+        release_place_();
+        tasks_finished_();
         throw;
       }
       add_thread(thread_runner);
@@ -113,24 +253,6 @@ namespace Generics
     new_task_.release();
   }
 
-  void
-  TaskRunner::TaskRunnerJob::wait_for_queue_exhausting()
-    throw (eh::Exception)
-  {
-    for (;;)
-    {
-      {
-        Sync::PosixGuard guard(mutex());
-        if (tasks_.empty())
-        {
-          return;
-        }
-      }
-      Generics::Time wait(0, 300000);
-      select(0, 0, 0, 0, &wait);
-    }
-  }
-
   void
   TaskRunner::TaskRunnerJob::work() throw ()
   {
@@ -154,19 +276,10 @@ namespace Generics
           tasks_.pop_front();
           number_of_unused_threads_--;
         }
-        // Tell any blocked thread that the queue is ready for a "new item"
-        if (LIMITED_)
-        {
-          not_full_.release();
-        }
-        try
-        {
-          task->execute();
-        }
-        catch (const eh::Exception& ex)
-        {
-          callback()->error(String::SubString(ex.what()));
-        }
+        release_place_();
+        execute_(task);
+        task = Task_var();
+        tasks_finished_();
 
         Sync::PosixGuard guard(mutex());
         number_of_unused_threads_++;
@@ -208,12 +321,286 @@ namespace Generics
     }
   }
 
+
+  //
+  // TaskRunner::WorkStealingJob class
+  //
+
+  Sync::Key<TaskRunner::WorkStealingJob::Worker>
+    TaskRunner::WorkStealingJob::current_worker_;
+
+  TaskRunner::WorkStealingJob::WorkStealingJob(
+    ActiveObjectCallback* callback, unsigned number_of_threads,
+    unsigned max_pending_tasks)
+    throw (eh::Exception)
+    : TaskRunnerJobBase(callback, number_of_threads, max_pending_tasks),
+      workers_(number_of_threads), next_worker_(0), pending_tasks_(0),
+      unused_threads_(0)
+  {
+    for (unsigned i = 0; i < number_of_threads; i++)
+    {
+      workers_[i].job = this;
+    }
+  }
+
+  TaskRunner::WorkStealingJob::~WorkStealingJob() throw ()
+  {
+  }
+
   void
-  TaskRunner::TaskRunnerJob::terminate() throw ()
+  TaskRunner::WorkStealingJob::started(unsigned threads) throw ()
   {
-    for (unsigned long i = NUMBER_OF_THREADS_; i; i--)
+    unused_threads_ = threads;
+  }
+
+  unsigned
+  TaskRunner::WorkStealingJob::task_count() const throw ()
+  {
+    return pending_tasks_;
+  }
+
+  void
+  TaskRunner::WorkStealingJob::clear() throw (eh::Exception)
+  {
+    // Removed tasks are claimed the same way as workers do it,
+    // so nobody looks for them after the removal
+    while (claim_task_())
     {
-      new_task_.release();
+      take_task_(0);
+      release_place_();
+      tasks_finished_();
+    }
+  }
+
+  void
+  TaskRunner::WorkStealingJob::enqueue_task(Task* task,
+    const Time* timeout, ThreadRunner& thread_runner)
+    throw (InvalidArgument, Overflow, NotActive, eh::Exception)
+  {
+    if (!task)
+    {
+      Stream::Error ostr;
+      ostr << FNS << "task is NULL";
+      throw InvalidArgument(ostr);
+    }
+
+    if (!reserve_place_(timeout))
+    {
+      Stream::Error ostr;
+      ostr << FNS << "TaskRunner overflow";
+      throw Overflow(ostr);
+    }
+
+    task_added_();
+    try
+    {
+      Worker* worker = current_worker_.get_data();
+      if (worker && worker->job == this)
+      {
+        Sync::PosixGuard guard(worker->mutex);
+        worker->tasks.push_back(Task_var(ReferenceCounting::add_ref(task)));
+      }
+      else
+      {
+        injected_.push(Task_var(ReferenceCounting::add_ref(task)));
+      }
+    }
+    catch (...)
+    {
+      release_place_();
+      tasks_finished_();
+      throw;
+    }
+
+    __gnu_cxx::__atomic_add(&pending_tasks_, 1);
+    add_thread_(thread_runner);
+
+    // Wake any working thread
+    new_task_.release();
+  }
+
+  void
+  TaskRunner::WorkStealingJob::work() throw ()
+  {
+    try
+    {
+      Worker* worker = &workers_[
+        __gnu_cxx::__exchange_and_add(&next_worker_, 1) %
+          NUMBER_OF_THREADS_];
+      current_worker_.set_data(worker);
+
+      for (;;)
+      {
+        new_task_.acquire();
+        if (is_terminating())
+        {
+          break;
+        }
+        if (!claim_task_())
+        {
+          // Wake up for a cleared task
+          continue;
+        }
+        Task_var task(take_task_(worker));
+        __gnu_cxx::__atomic_add(&unused_threads_, -1);
+
+        release_place_();
+        execute_(task);
+        task = Task_var();
+        tasks_finished_();
+
+        __gnu_cxx::__atomic_add(&unused_threads_, 1);
+      }
+
+      current_worker_.set_data(0);
+    }
+    catch (const eh::Exception& ex)
+    {
+      Stream::Error ostr;
+      ostr << FNS << "eh::Exception: " << ex.what();
+      callback()->critical(ostr.str());
+    }
+  }
+
+  bool
+  TaskRunner::WorkStealingJob::claim_task_() throw ()
+  {
+    for (;;)
+    {
+      _Atomic_word pending = pending_tasks_;
+      if (pending <= 0)
+      {
+        return false;
+      }
+      if (__sync_bool_compare_and_swap(&pending_tasks_, pending,
+        pending - 1))
+      {
+        return true;
+      }
+    }
+  }
+
+  Task_var
+  TaskRunner::WorkStealingJob::take_task_(Worker* worker)
+    throw (eh::Exception)
+  {
+    Task_var task;
+    for (;;)
+    {
+      if (worker)
+      {
+        Sync::PosixGuard guard(worker->mutex);
+        if (!worker->tasks.empty())
+        {
+          task = std::move(worker->tasks.back());
+          worker->tasks.pop_back();
+          return task;
+        }
+      }
+      if (take_injected_(worker, task) || steal_(worker, task))
+      {
+        return task;
+      }
+      // The claimed task is being pushed into the injection queue or
+      // is being moved from it by other thread
+      sched_yield();
+    }
+  }
+
+  bool
+  TaskRunner::WorkStealingJob::take_injected_(Worker* worker,
+    Task_var& task) throw (eh::Exception)
+  {
+    if (injected_.empty())
+    {
+      return false;
+    }
+
+    Sync::PosixGuard guard(injected_mutex_);
+    if (!injected_.pop_wait(task))
+    {
+      return false;
+    }
+
+    if (worker)
+    {
+      // Move a batch into the own deque to make the following tasks
+      // available without the injection queue locking. The oldest task
+      // is put to the back as the owner takes tasks from there.
+      Task_var batch[INJECTED_BATCH_SIZE];
+      unsigned size = 0;
+      while (size < INJECTED_BATCH_SIZE && injected_.pop(batch[size]))
+      {
+        size++;
+      }
+      if (size)
+      {
+        Sync::PosixGuard worker_guard(worker->mutex);
+        while (size)
+        {
+          worker->tasks.push_back(std::move(batch[--size]));
+        }
+      }
+    }
+
+    return true;
+  }
+
+  bool
+  TaskRunner::WorkStealingJob::steal_(Worker* worker, Task_var& task)
+    throw ()
+  {
+    const unsigned START = worker ? worker - workers_.get() + 1 : 0;
+    for (unsigned i = 0; i < NUMBER_OF_THREADS_; i++)
+    {
+      Worker& victim = workers_[(START + i) % NUMBER_OF_THREADS_];
+      if (&victim == worker)
+      {
+        continue;
+      }
+      Sync::PosixTryGuard guard(victim.mutex);
+      if (guard && !victim.tasks.empty())
+      {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void
+  TaskRunner::WorkStealingJob::add_thread_(ThreadRunner& thread_runner)
+    throw ()
+  {
+    if (thread_runner.running() == thread_runner.number_of_jobs())
+    {
+      return;
+    }
+
+    Sync::PosixGuard guard(mutex());
+
+    if (!thread_runner.running() ||
+      thread_runner.running() == thread_runner.number_of_jobs())
+    {
+      return;
+    }
+
+    if (pending_tasks_ <= unused_threads_)
+    {
+      return;
+    }
+
+    try
+    {
+      thread_runner.start_one();
+      __gnu_cxx::__atomic_add(&unused_threads_, 1);
+    }
+    catch (const eh::Exception& ex)
+    {
+      Stream::Error ostr;
+      ostr << FNS << "eh::Exception: " << ex.what();
+      callback()->warning(ostr.str());
     }
   }
 
@@ -224,13 +611,17 @@ namespace Generics
 
   TaskRunner::TaskRunner(ActiveObjectCallback* callback,
     unsigned threads_number, size_t stack_size,
-    unsigned max_pending_tasks, unsigned start_threads)
+    unsigned max_pending_tasks, unsigned start_threads,
+    QueueMode queue_mode)
     throw (InvalidArgument, Exception, eh::Exception)
     : ActiveObjectCommonImpl(
-        TaskRunnerJob_var(new TaskRunnerJob(callback, threads_number,
-          max_pending_tasks)),
+        queue_mode == QM_WORK_STEALING ?
+          TaskRunnerJobBase_var(new WorkStealingJob(callback,
+            threads_number, max_pending_tasks)) :
+          TaskRunnerJobBase_var(new TaskRunnerJob(callback,
+            threads_number, max_pending_tasks)),
         threads_number, stack_size, start_threads),
-      job_(static_cast<TaskRunnerJob&>(*SINGLE_JOB_))
+      job_(static_cast<TaskRunnerJobBase&>(*SINGLE_JOB_))
   {
   }
 
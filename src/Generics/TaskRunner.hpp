@@ -24,10 +24,15 @@
 #ifndef GENERICS_TASK_RUNNER_HPP
 #define GENERICS_TASK_RUNNER_HPP
 
+#include <Sync/Condition.hpp>
+#include <Sync/Key.hpp>
+#include <Sync/MPSCQueue.hpp>
 #include <Sync/Semaphore.hpp>
 
 #include <ReferenceCounting/Deque.hpp>
+#include <ReferenceCounting/Vector.hpp>
 
+#include <Generics/ArrayAutoPtr.hpp>
 #include <Generics/Scheduler.hpp>
 
 
@@ -62,6 +67,18 @@ namespace Generics
     DECLARE_EXCEPTION(Overflow, Exception);
     DECLARE_EXCEPTION(NotActive, Exception);
 
+    /**
+     * Organization of the task queue
+     */
+    enum QueueMode
+    {
+      // Single deque shared by all of the threads
+      QM_SHARED,
+      // Lock-free injection queue for the tasks enqueued from outside
+      // and per thread deques with the stealing between them
+      QM_WORK_STEALING
+    };
+
     /**
      * Constructor
      * @param callback not null callback is called on errors
@@ -69,11 +86,13 @@ namespace Generics
      * @param stack_size their stack sizes
      * @param max_pending_tasks maximum task queue length
      * @param start_threads initial number of threads to start (0 - all)
+     * @param queue_mode organization of the task queue
      */
     TaskRunner(ActiveObjectCallback* callback,
       unsigned threads_number, size_t stack_size = 0,
       unsigned max_pending_tasks = 0,
-      unsigned start_threads = 0)
+      unsigned start_threads = 0,
+      QueueMode queue_mode = QM_SHARED)
       throw (InvalidArgument, Exception, eh::Exception);
 
     /**
@@ -97,13 +116,38 @@ namespace Generics
     task_count() const throw ();
 
     /**
-     * Waits for the moment task queue is empty and returns control.
+     * Waits for the moment task queue is empty and all of the taken tasks
+     * are executed and returns control.
      * In MT environment tasks can be added at the very same moment of
      * return of control.
+     * Must not be called from the tasks of this TaskRunner.
      */
     void
     wait_for_queue_exhausting() throw (eh::Exception);
 
+    /**
+     * Waits for the moment task queue is empty and all of the taken tasks
+     * are executed, but not longer than timeout.
+     * @param timeout absolute time to wait up to. NULL timeout means
+     * infinite wait.
+     * @return false if timeout has expired
+     */
+    bool
+    wait_for_queue_exhausting(const Time* timeout) throw (eh::Exception);
+
+    /**
+     * Requests a single call of the task's execute() at the moment
+     * task queue is empty and all of the taken tasks are executed.
+     * The call is made by the thread executed the last task or by the
+     * calling thread if there are no tasks at the moment. The task should
+     * be short, for example it can enqueue the next stage of processing
+     * into another TaskRunner.
+     * @param task task to execute. Number of references is not increased
+     */
+    void
+    notify_on_queue_exhausting(Task* task)
+      throw (InvalidArgument, eh::Exception);
+
     /**
      * Clear task queue
      */
@@ -116,7 +160,101 @@ namespace Generics
     ~TaskRunner() throw ();
 
   private:
-    class TaskRunnerJob : public SingleJob
+    /**
+     * Common part of the jobs of the different queue modes
+     */
+    class TaskRunnerJobBase : public SingleJob
+    {
+    public:
+      TaskRunnerJobBase(ActiveObjectCallback* callback,
+        unsigned number_of_threads, unsigned max_pending_tasks)
+        throw (eh::Exception);
+
+      virtual
+      void
+      terminate() throw ();
+
+      virtual
+      void
+      enqueue_task(Task* task, const Time* timeout,
+        ThreadRunner& thread_runner)
+        throw (InvalidArgument, Overflow, NotActive, eh::Exception) = 0;
+
+      virtual
+      unsigned
+      task_count() const throw () = 0;
+
+      bool
+      wait_for_queue_exhausting(const Time* timeout)
+        throw (eh::Exception);
+
+      void
+      notify_on_queue_exhausting(Task* task)
+        throw (InvalidArgument, eh::Exception);
+
+      virtual
+      void
+      clear() throw (eh::Exception) = 0;
+
+    protected:
+      virtual
+      ~TaskRunnerJobBase() throw ();
+
+      /**
+       * Reserves place in the limited queue
+       * @param timeout absolute time to wait for the place up to
+       * @return false if the queue is full
+       */
+      bool
+      reserve_place_(const Time* timeout) throw (eh::Exception);
+
+      /**
+       * Returns place into the limited queue
+       */
+      void
+      release_place_() throw (eh::Exception);
+
+      /**
+       * Executes the task and reports errors
+       * @param task task to execute
+       */
+      void
+      execute_(Task* task) throw (eh::Exception);
+
+      /**
+       * Accounts the task going to be enqueued as unfinished
+       */
+      void
+      task_added_() throw ();
+
+      /**
+       * Accounts executed or removed tasks. Wakes up waiters and calls
+       * notification tasks if no unfinished tasks left.
+       * @param count number of finished tasks
+       */
+      void
+      tasks_finished_(unsigned count = 1) throw (eh::Exception);
+
+      const unsigned NUMBER_OF_THREADS_;
+      Sync::Semaphore new_task_;
+      Sync::Semaphore not_full_;
+      const bool LIMITED_;
+
+    private:
+      typedef ReferenceCounting::Vector<Task_var> Tasks;
+
+      // Enqueued and being executed tasks
+      volatile _Atomic_word unfinished_tasks_;
+      Sync::Condition exhausted_;
+      Tasks exhausting_notifications_;
+    };
+    typedef ReferenceCounting::FixedPtr<TaskRunnerJobBase>
+      TaskRunnerJobBase_var;
+
+    /**
+     * Single deque protected by the mutex
+     */
+    class TaskRunnerJob : public TaskRunnerJobBase
     {
     public:
       TaskRunnerJob(ActiveObjectCallback* callback,
@@ -132,20 +270,16 @@ namespace Generics
       started(unsigned threads) throw ();
 
       virtual
-      void
-      terminate() throw ();
-
       void
       enqueue_task(Task* task, const Time* timeout,
         ThreadRunner& thread_runner)
         throw (InvalidArgument, Overflow, NotActive, eh::Exception);
 
+      virtual
       unsigned
       task_count() const throw ();
 
-      void
-      wait_for_queue_exhausting() throw (eh::Exception);
-
+      virtual
       void
       clear() throw (eh::Exception);
 
@@ -159,16 +293,102 @@ namespace Generics
     private:
       typedef ReferenceCounting::Deque<Task_var> Tasks;
 
-      const unsigned NUMBER_OF_THREADS_;
       unsigned number_of_unused_threads_;
       Tasks tasks_;
-      Sync::Semaphore new_task_;
-      Sync::Semaphore not_full_;
-      const bool LIMITED_;
     };
-    typedef ReferenceCounting::FixedPtr<TaskRunnerJob> TaskRunnerJob_var;
 
-    TaskRunnerJob& job_;
+    /**
+     * Tasks enqueued from outside go into the lock-free injection queue,
+     * tasks enqueued by the working threads go into their own deques.
+     * Thread takes tasks from its own deque (LIFO), moves a batch from
+     * the injection queue or steals from the other threads (FIFO).
+     */
+    class WorkStealingJob : public TaskRunnerJobBase
+    {
+    public:
+      WorkStealingJob(ActiveObjectCallback* callback,
+        unsigned number_of_threads, unsigned max_pending_tasks)
+        throw (eh::Exception);
+
+      virtual
+      void
+      work() throw ();
+
+      virtual
+      void
+      started(unsigned threads) throw ();
+
+      virtual
+      void
+      enqueue_task(Task* task, const Time* timeout,
+        ThreadRunner& thread_runner)
+        throw (InvalidArgument, Overflow, NotActive, eh::Exception);
+
+      virtual
+      unsigned
+      task_count() const throw ();
+
+      virtual
+      void
+      clear() throw (eh::Exception);
+
+    protected:
+      virtual
+      ~WorkStealingJob() throw ();
+
+    private:
+      typedef ReferenceCounting::Deque<Task_var> Tasks;
+
+      struct Worker
+      {
+        Sync::PosixMutex mutex;
+        Tasks tasks;
+        // current_worker_ is shared by all of the jobs, the worker is
+        // used for enqueueing by its own job only
+        WorkStealingJob* job;
+        char padding[64];
+      };
+
+      /**
+       * Decrements the number of pending tasks if it is positive.
+       * Every successful claim is backed by exactly one task in the
+       * queues, the task can be found by take_task_.
+       * @return false if there are no unclaimed tasks
+       */
+      bool
+      claim_task_() throw ();
+
+      /**
+       * Finds a claimed task
+       * @param worker current thread's worker or NULL
+       * @return the found task
+       */
+      Task_var
+      take_task_(Worker* worker) throw (eh::Exception);
+
+      bool
+      take_injected_(Worker* worker, Task_var& task) throw (eh::Exception);
+
+      bool
+      steal_(Worker* worker, Task_var& task) throw ();
+
+      void
+      add_thread_(ThreadRunner& thread_runner) throw ();
+
+      static const unsigned INJECTED_BATCH_SIZE = 32;
+
+      static Sync::Key<Worker> current_worker_;
+
+      Generics::ArrayAutoPtr<Worker> workers_;
+      volatile _Atomic_word next_worker_;
+      volatile _Atomic_word pending_tasks_;
+      volatile _Atomic_word unused_threads_;
+
+      mutable Sync::PosixMutex injected_mutex_;
+      Sync::MPSCQueue<Task_var> injected_;
+    };
+
+    TaskRunnerJobBase& job_;
   };
   typedef ReferenceCounting::QualPtr<TaskRunner> TaskRunner_var;
   typedef ReferenceCounting::FixedPtr<TaskRunner> FixedTaskRunner_var;
@@ -354,19 +574,6 @@ namespace Generics
   }
 
 
-  //
-  // TaskRunner::TaskRunnerJob class
-  //
-
-  inline
-  unsigned
-  TaskRunner::TaskRunnerJob::task_count() const throw ()
-  {
-    Sync::PosixGuard guard(mutex());
-    return tasks_.size();
-  }
-
-
   //
   // TaskRunner class
   //
@@ -390,7 +597,23 @@ namespace Generics
   void
   TaskRunner::wait_for_queue_exhausting() throw (eh::Exception)
   {
-    job_.wait_for_queue_exhausting();
+    job_.wait_for_queue_exhausting(0);
+  }
+
+  inline
+  bool
+  TaskRunner::wait_for_queue_exhausting(const Time* timeout)
+    throw (eh::Exception)
+  {
+    return job_.wait_for_queue_exhausting(timeout);
+  }
+
+  inline
+  void
+  TaskRunner::notify_on_queue_exhausting(Task* task)
+    throw (InvalidArgument, eh::Exception)
+  {
+    job_.notify_on_queue_exhausting(task);
   }
 
   inline
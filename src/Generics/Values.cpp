@@ -74,6 +74,41 @@ namespace Generics
   {
   }
 
+  Values*
+  Values::snapshot() const throw (eh::Exception)
+  {
+    Values_var copy(new Values);
+
+    Sync::PosixGuard guard(mutex_);
+    copy->data_.rehash(data_.bucket_count());
+    for (Data::const_iterator itor(data_.begin()); itor != data_.end();
+      ++itor)
+    {
+      StoredValue& value = copy->data_[
+        Key(itor->first.hash(), itor->first.text().c_str())];
+      switch (itor->second.type)
+      {
+      case ST_SIGNEDINT:
+        copy->set_(value, ValuesHelper::Atomic<SignedInt>::load(
+          &itor->second.signed_int));
+        break;
+      case ST_UNSIGNEDINT:
+        copy->set_(value, ValuesHelper::Atomic<UnsignedInt>::load(
+          &itor->second.unsigned_int));
+        break;
+      case ST_FLOATING:
+        copy->set_(value, ValuesHelper::Atomic<Floating>::load(
+          &itor->second.floating));
+        break;
+      case ST_STRING:
+        copy->set_(value, itor->second.string);
+        break;
+      }
+    }
+
+    return copy.retn();
+  }
+
   void
   Values::swap(Values& values) throw (eh::Exception)
   {
@@ -24,6 +24,7 @@
 
 #include <limits>
 #include <functional>
+#include <type_traits>
 
 #include <ReferenceCounting/ReferenceCounting.hpp>
 
@@ -45,6 +46,61 @@ namespace Generics
   {
     template <typename ParamValue>
     struct StoredMember;
+
+    /**
+     * Access to the stored values which can be updated through
+     * Values::Counter handles concurrently with the locked access.
+     * Numeric values are accessed atomically, strings are not.
+     */
+    template <typename Type>
+    struct Atomic
+    {
+      static
+      Type
+      load(const Type* value) throw ();
+
+      static
+      void
+      store(Type* value, const Type& new_value) throw ();
+
+      template <typename Functor>
+      static
+      void
+      update(Type* value, const Type& arg, Functor functor)
+        throw (eh::Exception);
+
+      static
+      void
+      add(Type* value, const Type& arg) throw ();
+
+    private:
+      static
+      void
+      add_(Type* value, const Type& arg, std::true_type) throw ();
+
+      static
+      void
+      add_(Type* value, const Type& arg, std::false_type) throw ();
+    };
+
+    template <>
+    struct Atomic<std::string>
+    {
+      static
+      const std::string&
+      load(const std::string* value) throw ();
+
+      static
+      void
+      store(std::string* value, const std::string& new_value)
+        throw (eh::Exception);
+
+      template <typename Functor>
+      static
+      void
+      update(std::string* value, const std::string& arg, Functor functor)
+        throw (eh::Exception);
+    };
   }
 
 
@@ -53,6 +109,8 @@ namespace Generics
    * double, long, unsigned long and string. Allows addition of values to
    * existing keys (numeric addition for numeric types and concatenation
    * for string types).
+   * Hot numeric records can be pre-registered with counter(), the
+   * returned handles update them without hashing and locking.
    */
   class Values : public virtual ReferenceCounting::AtomicImpl
   {
@@ -69,6 +127,57 @@ namespace Generics
     typedef double Floating;
     typedef std::string String;
 
+    /**
+     * Handle of a registered numeric record, see counter().
+     * Updates and reads are lock free atomic operations on the record
+     * storage. The handle is valid while the record's owner exists, after
+     * swap() it refers to the record in the object the record moved to.
+     * The record type must not be changed by set() of another type.
+     */
+    template <typename Type>
+    class Counter
+    {
+    public:
+      /**
+       * Creates unbound handle, it must be assigned before usage
+       */
+      Counter() throw ();
+
+      /**
+       * Atomically adds the value to the record
+       * @param value value to add
+       */
+      void
+      add(const Type& value) const throw ();
+
+      /**
+       * Atomically assigns the record
+       * @param value new value
+       */
+      void
+      set(const Type& value) const throw ();
+
+      /**
+       * @return current value of the record
+       */
+      Type
+      get() const throw ();
+
+      /**
+       * @return if the handle is bound to a record
+       */
+      bool
+      bound() const throw ();
+
+    private:
+      explicit
+      Counter(Type* value) throw ();
+
+      Type* value_;
+
+      friend class Values;
+    };
+
     /**
      * Constructor
      * @param table_size initial size for underlying hash
@@ -170,6 +279,27 @@ namespace Generics
     void
     enumerate_all(Functor& functor) const throw (eh::Exception);
 
+    /**
+     * Registers a numeric record for the lock free access.
+     * The existing record of the same type is reused keeping its value.
+     * @param key associative key for the record
+     * @param initial value for the record if it does not exist
+     * @return handle for the record
+     */
+    template <typename Type>
+    Counter<Type>
+    counter(const Key& key, const Type& initial = Type())
+      throw (eh::Exception, InvalidType);
+
+    /**
+     * Creates an independent copy of the current content. Readers can
+     * enumerate or look up the copy without blocking the writers.
+     * Every value is read atomically, the set of records is consistent.
+     * @return the copy
+     */
+    Values*
+    snapshot() const throw (eh::Exception);
+
     /**
      * Locks the current object and swaps its content with the supplied one.
      * The supplied object is not locked.
@@ -356,6 +486,137 @@ namespace Generics
 
 namespace Generics
 {
+  namespace ValuesHelper
+  {
+    //
+    // Atomic class
+    //
+
+    template <typename Type>
+    Type
+    Atomic<Type>::load(const Type* value) throw ()
+    {
+      Type result;
+      __atomic_load(value, &result, __ATOMIC_RELAXED);
+      return result;
+    }
+
+    template <typename Type>
+    void
+    Atomic<Type>::store(Type* value, const Type& new_value) throw ()
+    {
+      Type copy(new_value);
+      __atomic_store(value, &copy, __ATOMIC_RELAXED);
+    }
+
+    template <typename Type>
+    template <typename Functor>
+    void
+    Atomic<Type>::update(Type* value, const Type& arg, Functor functor)
+      throw (eh::Exception)
+    {
+      Type cur = load(value);
+      Type next;
+      do
+      {
+        next = functor(arg, cur);
+      }
+      while (!__atomic_compare_exchange(value, &cur, &next, true,
+        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    }
+
+    template <typename Type>
+    void
+    Atomic<Type>::add(Type* value, const Type& arg) throw ()
+    {
+      add_(value, arg, std::is_integral<Type>());
+    }
+
+    template <typename Type>
+    void
+    Atomic<Type>::add_(Type* value, const Type& arg, std::true_type)
+      throw ()
+    {
+      __atomic_fetch_add(value, arg, __ATOMIC_RELAXED);
+    }
+
+    template <typename Type>
+    void
+    Atomic<Type>::add_(Type* value, const Type& arg, std::false_type)
+      throw ()
+    {
+      update(value, arg, std::plus<Type>());
+    }
+
+    inline
+    const std::string&
+    Atomic<std::string>::load(const std::string* value) throw ()
+    {
+      return *value;
+    }
+
+    inline
+    void
+    Atomic<std::string>::store(std::string* value,
+      const std::string& new_value) throw (eh::Exception)
+    {
+      *value = new_value;
+    }
+
+    template <typename Functor>
+    void
+    Atomic<std::string>::update(std::string* value, const std::string& arg,
+      Functor functor) throw (eh::Exception)
+    {
+      *value = functor(arg, *value);
+    }
+  }
+
+  //
+  // Values::Counter class
+  //
+
+  template <typename Type>
+  Values::Counter<Type>::Counter() throw ()
+    : value_(0)
+  {
+  }
+
+  template <typename Type>
+  Values::Counter<Type>::Counter(Type* value) throw ()
+    : value_(value)
+  {
+  }
+
+  template <typename Type>
+  void
+  Values::Counter<Type>::add(const Type& value) const throw ()
+  {
+    ValuesHelper::Atomic<Type>::add(value_, value);
+  }
+
+  template <typename Type>
+  void
+  Values::Counter<Type>::set(const Type& value) const throw ()
+  {
+    ValuesHelper::Atomic<Type>::store(value_, value);
+  }
+
+  template <typename Type>
+  Type
+  Values::Counter<Type>::get() const throw ()
+  {
+    return ValuesHelper::Atomic<Type>::load(value_);
+  }
+
+  template <typename Type>
+  bool
+  Values::Counter<Type>::bound() const throw ()
+  {
+    return value_;
+  }
+
+
   //
   // Values class
   //
@@ -385,8 +646,12 @@ namespace Generics
   typename ValuesHelper::StoredMember<Type>::Type*
   Values::set_(StoredValue& data, const Type& value) throw (eh::Exception)
   {
+    typedef typename ValuesHelper::StoredMember<Type>::Type Stored;
+
     data.type = ValuesHelper::StoredMember<Type>::TYPE;
-    return &(data.*ValuesHelper::StoredMember<Type>::MEMBER = value);
+    Stored* member = &(data.*ValuesHelper::StoredMember<Type>::MEMBER);
+    ValuesHelper::Atomic<Stored>::store(member, value);
+    return member;
   }
 
   template <typename Type>
@@ -401,11 +666,12 @@ namespace Generics
   Values::func_or_set_(const Key& key, const Type& value,
     Functor functor) throw (eh::Exception, InvalidType)
   {
-    typename ValuesHelper::StoredMember<Type>::Type* member =
-      get_<Type>(key);
+    typedef typename ValuesHelper::StoredMember<Type>::Type Stored;
+
+    Stored* member = get_<Type>(key);
     if (member)
     {
-      *member = functor(value, *member);
+      ValuesHelper::Atomic<Stored>::update(member, value, functor);
     }
     else
     {
@@ -422,16 +688,16 @@ namespace Generics
     switch (one.second.type)
     {
     case ST_SIGNEDINT:
-      functor(one.first, one.second.*
-        Generics::ValuesHelper::StoredMember<SignedInt>::MEMBER);
+      functor(one.first, ValuesHelper::Atomic<SignedInt>::load(
+        &(one.second.*ValuesHelper::StoredMember<SignedInt>::MEMBER)));
       break;
     case ST_UNSIGNEDINT:
-      functor(one.first, one.second.*
-        Generics::ValuesHelper::StoredMember<UnsignedInt>::MEMBER);
+      functor(one.first, ValuesHelper::Atomic<UnsignedInt>::load(
+        &(one.second.*ValuesHelper::StoredMember<UnsignedInt>::MEMBER)));
       break;
     case ST_FLOATING:
-      functor(one.first, one.second.*
-        Generics::ValuesHelper::StoredMember<Floating>::MEMBER);
+      functor(one.first, ValuesHelper::Atomic<Floating>::load(
+        &(one.second.*ValuesHelper::StoredMember<Floating>::MEMBER)));
       break;
     case ST_STRING:
       functor(one.first, one.second.*
@@ -455,7 +721,7 @@ namespace Generics
         {
           break;
         }
-        value = *member;
+        value = ValuesHelper::Atomic<Type>::load(member);
       }
       return value;
     }
@@ -471,7 +737,8 @@ namespace Generics
   {
     Sync::PosixGuard guard(mutex_);
     const Type* member = get_<Type>(key);
-    return member ? (value = *member, true) : false;
+    return member ?
+      (value = ValuesHelper::Atomic<Type>::load(member), true) : false;
   }
 
   template <typename Type>
@@ -489,10 +756,11 @@ namespace Generics
   {
     {
       Sync::PosixGuard guard(mutex_);
-      if (typename ValuesHelper::StoredMember<Type>::Type* member =
-        get_<Type>(key))
+      typedef typename ValuesHelper::StoredMember<Type>::Type Stored;
+      if (Stored* member = get_<Type>(key))
       {
-        *member = *member + value;
+        ValuesHelper::Atomic<Stored>::update(member, value,
+          std::plus<Stored>());
         return;
       }
     }
@@ -542,6 +810,19 @@ namespace Generics
     return !istr.bad() && istr.eof();
   }
 
+  template <typename Type>
+  Values::Counter<Type>
+  Values::counter(const Key& key, const Type& initial)
+    throw (eh::Exception, InvalidType)
+  {
+    static_assert(std::is_arithmetic<Type>::value,
+      "Only numeric records can have counters");
+
+    Sync::PosixGuard guard(mutex_);
+    Type* member = get_<Type>(key);
+    return Counter<Type>(member ? member : set_(data_[key], initial));
+  }
+
   template <typename Functor>
   void
   Values::enumerate_all(Functor& functor) const throw (eh::Exception)
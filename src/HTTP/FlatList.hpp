@@ -0,0 +1,271 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef HTTP_FLATLIST_HPP
+#define HTTP_FLATLIST_HPP
+
+#include <iterator>
+
+#include <HTTP/HttpMisc.hpp>
+
+
+namespace HTTP
+{
+  /**
+   * Flat list of name-value pairs (headers or parameters).
+   * Names and values are kept zero terminated one after another in the
+   * single data buffer, items keep offsets into it and the caseless hash
+   * of the name. The first INLINE_ITEMS items and INLINE_DATA bytes of
+   * data are stored in the object itself, so typical lists are built
+   * without memory allocations.
+   * Iteration yields SubElement (SubHeader or SubParam) views, they are
+   * valid until the list is modified. Iterators stay valid while items
+   * are only appended.
+   * The interface follows std::list used for HeaderList and ParamList in
+   * the parts used by the library: appending, iteration, size, clear.
+   * Items can not be changed in place.
+   */
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  class FlatList
+  {
+  private:
+    struct Item_
+    {
+      unsigned name;
+      unsigned name_size;
+      unsigned value;
+      unsigned value_size;
+      unsigned hash;
+    };
+
+  public:
+    typedef SubElement value_type;
+    typedef size_t size_type;
+
+    class const_iterator
+    {
+    public:
+      typedef std::bidirectional_iterator_tag iterator_category;
+      typedef SubElement value_type;
+      typedef ptrdiff_t difference_type;
+      typedef SubElement reference;
+
+      /**
+       * Holder of the element for operator ->
+       */
+      class pointer
+      {
+      public:
+        explicit
+        pointer(const SubElement& element) throw ();
+
+        const SubElement*
+        operator ->() const throw ();
+
+      private:
+        SubElement element_;
+      };
+
+      const_iterator() throw ();
+
+      SubElement
+      operator *() const throw ();
+
+      pointer
+      operator ->() const throw ();
+
+      const_iterator&
+      operator ++() throw ();
+
+      const_iterator
+      operator ++(int) throw ();
+
+      const_iterator&
+      operator --() throw ();
+
+      const_iterator
+      operator --(int) throw ();
+
+      bool
+      operator ==(const const_iterator& itor) const throw ();
+
+      bool
+      operator !=(const const_iterator& itor) const throw ();
+
+    private:
+      const_iterator(const FlatList* list, size_t index) throw ();
+
+      const FlatList* list_;
+      size_t index_;
+
+      friend class FlatList;
+    };
+
+    typedef const_iterator iterator;
+
+    FlatList() throw ();
+
+    FlatList(const FlatList& list) throw (eh::Exception);
+
+    FlatList(FlatList&& list) throw ();
+
+    /**
+     * Fills the list with the elements of other container,
+     * HeaderList and SubHeaderList for instance
+     */
+    template <typename InputIterator>
+    FlatList(InputIterator first, InputIterator last)
+      throw (eh::Exception);
+
+    ~FlatList() throw ();
+
+    FlatList&
+    operator =(const FlatList& list) throw (eh::Exception);
+
+    FlatList&
+    operator =(FlatList&& list) throw ();
+
+    size_type
+    size() const throw ();
+
+    bool
+    empty() const throw ();
+
+    void
+    clear() throw ();
+
+    /**
+     * Preallocates memory
+     * @param items expected number of items
+     * @param data expected total length of names and values
+     */
+    void
+    reserve(size_type items, size_type data) throw (eh::Exception);
+
+    const_iterator
+    begin() const throw ();
+
+    const_iterator
+    end() const throw ();
+
+    const_iterator
+    cbegin() const throw ();
+
+    const_iterator
+    cend() const throw ();
+
+    SubElement
+    front() const throw ();
+
+    SubElement
+    back() const throw ();
+
+    SubElement
+    operator [](size_type index) const throw ();
+
+    /**
+     * Appends the copy of the element.
+     * The element may refer to the data of the list itself.
+     */
+    void
+    push_back(const SubElement& element) throw (eh::Exception);
+
+    /**
+     * Appends the copy of the name and value,
+     * they may be std::string, const char* or SubString
+     */
+    template <typename Name, typename Value>
+    void
+    emplace_back(const Name& name, const Value& value)
+      throw (eh::Exception);
+
+    /**
+     * Searches for the first item with the name ignoring letters case
+     * @param name name to search for
+     * @return iterator to the item found or end()
+     */
+    const_iterator
+    find(const String::SubString& name) const throw ();
+
+    /**
+     * Searches for the next item with the name ignoring letters case
+     * @param name name to search for
+     * @param from iterator to start search from
+     * @return iterator to the item found or end()
+     */
+    const_iterator
+    find(const String::SubString& name, const_iterator from) const
+      throw ();
+
+    /**
+     * Caseless hash of ASCII string stored for the names
+     * @param str string to calculate hash of
+     * @return hash value
+     */
+    static
+    unsigned
+    caseless_hash(const String::SubString& str) throw ();
+
+  private:
+    SubElement
+    element_(size_t index) const throw ();
+
+    void
+    append_(const String::SubString& name, const String::SubString& value)
+      throw (eh::Exception);
+
+    void
+    reserve_items_(size_t items) throw (eh::Exception);
+
+    void
+    free_() throw ();
+
+    void
+    init_() throw ();
+
+    void
+    assign_(const FlatList& list) throw (eh::Exception);
+
+    Item_* items_;
+    size_t size_;
+    size_t items_capacity_;
+    char* data_;
+    size_t data_size_;
+    size_t data_capacity_;
+
+    Item_ inline_items_[INLINE_ITEMS];
+    char inline_data_[INLINE_DATA];
+  };
+
+  /**
+   * Flat replacement of HeaderList, enough for a typical request
+   */
+  typedef FlatList<SubHeader, 16, 1024> FlatHeaderList;
+
+  /**
+   * Flat replacement of ParamList
+   */
+  typedef FlatList<SubParam, 16, 512> FlatParamList;
+}
+
+#include <HTTP/FlatList.tpp>
+
+#endif
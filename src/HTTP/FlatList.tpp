@@ -0,0 +1,516 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cstring>
+#include <algorithm>
+#include <utility>
+
+#include <String/AsciiStringManip.hpp>
+
+
+namespace HTTP
+{
+  //
+  // FlatList::const_iterator::pointer class
+  //
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    pointer::pointer(const SubElement& element) throw ()
+    : element_(element)
+  {
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  const SubElement*
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    pointer::operator ->() const throw ()
+  {
+    return &element_;
+  }
+
+
+  //
+  // FlatList::const_iterator class
+  //
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    const_iterator() throw ()
+    : list_(0), index_(0)
+  {
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    const_iterator(const FlatList* list, size_t index) throw ()
+    : list_(list), index_(index)
+  {
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  SubElement
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    operator *() const throw ()
+  {
+    return list_->element_(index_);
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::
+    const_iterator::pointer
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    operator ->() const throw ()
+  {
+    return pointer(list_->element_(index_));
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator&
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    operator ++() throw ()
+  {
+    ++index_;
+    return *this;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    operator ++(int) throw ()
+  {
+    const_iterator itor(*this);
+    ++index_;
+    return itor;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator&
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    operator --() throw ()
+  {
+    --index_;
+    return *this;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    operator --(int) throw ()
+  {
+    const_iterator itor(*this);
+    --index_;
+    return itor;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  bool
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    operator ==(const const_iterator& itor) const throw ()
+  {
+    return index_ == itor.index_;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  bool
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator::
+    operator !=(const const_iterator& itor) const throw ()
+  {
+    return index_ != itor.index_;
+  }
+
+
+  //
+  // FlatList class
+  //
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::FlatList() throw ()
+  {
+    init_();
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::FlatList(
+    const FlatList& list) throw (eh::Exception)
+  {
+    init_();
+    assign_(list);
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::FlatList(
+    FlatList&& list) throw ()
+  {
+    init_();
+    *this = std::move(list);
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  template <typename InputIterator>
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::FlatList(
+    InputIterator first, InputIterator last) throw (eh::Exception)
+  {
+    init_();
+    try
+    {
+      for (; first != last; ++first)
+      {
+        append_(first->name, first->value);
+      }
+    }
+    catch (...)
+    {
+      free_();
+      throw;
+    }
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::~FlatList() throw ()
+  {
+    free_();
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>&
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::operator =(
+    const FlatList& list) throw (eh::Exception)
+  {
+    if (this != &list)
+    {
+      clear();
+      assign_(list);
+    }
+    return *this;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>&
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::operator =(
+    FlatList&& list) throw ()
+  {
+    if (this == &list)
+    {
+      return *this;
+    }
+
+    free_();
+    init_();
+
+    // Inline storage can only be copied, it fits anyway
+    if (list.items_ == list.inline_items_)
+    {
+      std::copy(list.items_, list.items_ + list.size_, items_);
+    }
+    else
+    {
+      items_ = list.items_;
+      items_capacity_ = list.items_capacity_;
+    }
+    size_ = list.size_;
+
+    if (list.data_ == list.inline_data_)
+    {
+      std::memcpy(data_, list.data_, list.data_size_);
+    }
+    else
+    {
+      data_ = list.data_;
+      data_capacity_ = list.data_capacity_;
+    }
+    data_size_ = list.data_size_;
+
+    list.init_();
+    return *this;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::size_type
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::size() const throw ()
+  {
+    return size_;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  bool
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::empty() const throw ()
+  {
+    return !size_;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  void
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::clear() throw ()
+  {
+    // Allocated memory is kept for the following use
+    size_ = 0;
+    data_size_ = 0;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  void
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::reserve(size_type items,
+    size_type data) throw (eh::Exception)
+  {
+    reserve_items_(items);
+    if (data > data_capacity_)
+    {
+      char* new_data = new char[data];
+      std::memcpy(new_data, data_, data_size_);
+      if (data_ != inline_data_)
+      {
+        delete [] data_;
+      }
+      data_ = new_data;
+      data_capacity_ = data;
+    }
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::begin() const throw ()
+  {
+    return const_iterator(this, 0);
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::end() const throw ()
+  {
+    return const_iterator(this, size_);
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::cbegin() const throw ()
+  {
+    return begin();
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::cend() const throw ()
+  {
+    return end();
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  SubElement
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::front() const throw ()
+  {
+    return element_(0);
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  SubElement
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::back() const throw ()
+  {
+    return element_(size_ - 1);
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  SubElement
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::operator [](
+    size_type index) const throw ()
+  {
+    return element_(index);
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  void
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::push_back(
+    const SubElement& element) throw (eh::Exception)
+  {
+    append_(element.name, element.value);
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  template <typename Name, typename Value>
+  void
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::emplace_back(
+    const Name& name, const Value& value) throw (eh::Exception)
+  {
+    append_(String::SubString(name), String::SubString(value));
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::find(
+    const String::SubString& name) const throw ()
+  {
+    return find(name, begin());
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  typename FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::const_iterator
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::find(
+    const String::SubString& name, const_iterator from) const throw ()
+  {
+    const unsigned HASH = caseless_hash(name);
+    const String::AsciiStringManip::Caseless NAME(name);
+
+    for (size_t i = from.index_; i < size_; i++)
+    {
+      const Item_& item = items_[i];
+      if (item.hash == HASH && item.name_size == name.size() &&
+        NAME.equal(String::SubString(data_ + item.name, item.name_size)))
+      {
+        return const_iterator(this, i);
+      }
+    }
+
+    return end();
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  unsigned
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::caseless_hash(
+    const String::SubString& str) throw ()
+  {
+    // FNV-1a over the lower case letters
+    unsigned hash = 2166136261u;
+    for (const char* cur = str.begin(); cur != str.end(); ++cur)
+    {
+      unsigned char ch = *cur;
+      if (static_cast<unsigned char>(ch - 'A') < 26)
+      {
+        ch += 'a' - 'A';
+      }
+      hash = (hash ^ ch) * 16777619u;
+    }
+    return hash;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  SubElement
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::element_(
+    size_t index) const throw ()
+  {
+    const Item_& item = items_[index];
+    return SubElement(String::SubString(data_ + item.name, item.name_size),
+      String::SubString(data_ + item.value, item.value_size));
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  void
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::append_(
+    const String::SubString& name, const String::SubString& value)
+    throw (eh::Exception)
+  {
+    reserve_items_(size_ + 1);
+
+    const size_t NEED = data_size_ + name.size() + value.size() + 2;
+    char* data = data_;
+    size_t capacity = data_capacity_;
+    if (NEED > capacity)
+    {
+      // The old data is kept until the copying, name and value
+      // may refer to it
+      capacity = std::max(NEED, capacity * 2);
+      data = new char[capacity];
+      std::memcpy(data, data_, data_size_);
+    }
+
+    Item_& item = items_[size_];
+    item.name = data_size_;
+    item.name_size = name.size();
+    item.value = data_size_ + name.size() + 1;
+    item.value_size = value.size();
+    item.hash = caseless_hash(name);
+
+    char* cur = data + data_size_;
+    std::memcpy(cur, name.data(), name.size());
+    cur += name.size();
+    *cur++ = '\0';
+    std::memcpy(cur, value.data(), value.size());
+    cur[value.size()] = '\0';
+
+    if (data != data_)
+    {
+      if (data_ != inline_data_)
+      {
+        delete [] data_;
+      }
+      data_ = data;
+      data_capacity_ = capacity;
+    }
+    data_size_ = NEED;
+    ++size_;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  void
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::reserve_items_(
+    size_t items) throw (eh::Exception)
+  {
+    if (items > items_capacity_)
+    {
+      const size_t CAPACITY = std::max(items, items_capacity_ * 2);
+      Item_* new_items = new Item_[CAPACITY];
+      std::copy(items_, items_ + size_, new_items);
+      if (items_ != inline_items_)
+      {
+        delete [] items_;
+      }
+      items_ = new_items;
+      items_capacity_ = CAPACITY;
+    }
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  void
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::free_() throw ()
+  {
+    if (items_ != inline_items_)
+    {
+      delete [] items_;
+    }
+    if (data_ != inline_data_)
+    {
+      delete [] data_;
+    }
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  void
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::init_() throw ()
+  {
+    items_ = inline_items_;
+    size_ = 0;
+    items_capacity_ = INLINE_ITEMS;
+    data_ = inline_data_;
+    data_size_ = 0;
+    data_capacity_ = INLINE_DATA;
+  }
+
+  template <typename SubElement, size_t INLINE_ITEMS, size_t INLINE_DATA>
+  void
+  FlatList<SubElement, INLINE_ITEMS, INLINE_DATA>::assign_(
+    const FlatList& list) throw (eh::Exception)
+  {
+    reserve(list.size_, list.data_size_);
+    std::copy(list.items_, list.items_ + list.size_, items_);
+    std::memcpy(data_, list.data_, list.data_size_);
+    size_ = list.size_;
+    data_size_ = list.data_size_;
+  }
+}
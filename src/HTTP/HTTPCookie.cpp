@@ -660,6 +660,14 @@ namespace HTTP
     load_from_headers_(headers, replace_duplicate);
   }
 
+  void
+  CookieList::load_from_headers(const FlatHeaderList& headers,
+    bool replace_duplicate)
+    throw (InvalidArgument, Exception, eh::Exception)
+  {
+    load_from_headers_(headers, replace_duplicate);
+  }
+
   std::string
   CookieList::cookie_header() throw (eh::Exception)
   {
@@ -32,6 +32,7 @@
 #include <Generics/Time.hpp>
 
 #include <HTTP/HttpMisc.hpp>
+#include <HTTP/FlatList.hpp>
 #include <HTTP/UrlAddress.hpp>
 
 
@@ -114,6 +115,11 @@ namespace HTTP
       bool replace_duplicate = false)
       throw (Exception, InvalidArgument, eh::Exception);
 
+    void
+    load_from_headers(const FlatHeaderList& headers,
+      bool replace_duplicate = false)
+      throw (Exception, InvalidArgument, eh::Exception);
+
     std::string
     cookie_header() throw (eh::Exception);
 
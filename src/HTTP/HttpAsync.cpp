@@ -19,6 +19,14 @@
 
 
 
+#include <map>
+#include <vector>
+
+#include <Sync/PosixLock.hpp>
+
+#include <String/AsciiStringManip.hpp>
+#include <String/StringManip.hpp>
+
 #include <HTTP/HttpConnection.hpp>
 #include <HTTP/HttpAsync.hpp>
 
@@ -61,6 +69,35 @@ namespace HTTP
   // ResponseInformation class
   //
 
+  void
+  ResponseInformation::response_header_views(SubHeaderArray& headers) const
+    throw (eh::Exception)
+  {
+    const HeaderList& rheaders = response_headers();
+
+    headers.assign(rheaders.begin(), rheaders.end());
+  }
+
+  bool
+  ResponseInformation::find_header(const String::SubString& name,
+    String::SubString& value) const throw ()
+  {
+    String::AsciiStringManip::Caseless header_name(name);
+    const HeaderList& rheaders = response_headers();
+
+    for (HeaderList::const_iterator itor(rheaders.begin());
+      itor != rheaders.end(); ++itor)
+    {
+      if (header_name == itor->name)
+      {
+        value = itor->value;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
   void
   ResponseInformation::find_headers(const char* name,
     HeaderList& headers) const throw (eh::Exception)
@@ -154,9 +191,34 @@ namespace HTTP
         const HeaderList& headers)
         throw (eh::Exception, Exception);
 
+      /**
+       * Takes idle connection to the peer
+       * @param key peer identifier
+       * @return connection or NULL if there is no idle one
+       */
+      HTTP_Connection*
+      get_connection_(const std::string& key) throw ();
+
+      /**
+       * Keeps the connection for the following requests to the peer
+       * @param key peer identifier
+       * @param connection connection to keep or destroy
+       */
+      void
+      release_connection_(const std::string& key,
+        HTTP_Connection* connection) throw ();
+
+      typedef std::vector<HTTP_Connection*> ConnectionArray;
+      typedef std::map<std::string, ConnectionArray> IdleConnections;
+
+      static const size_t MAX_IDLE_CONNECTIONS = 16;
+
       std::unique_ptr<Generics::Time> connect_timeout_;
       std::unique_ptr<Generics::Time> send_timeout_;
       std::unique_ptr<Generics::Time> recv_timeout_;
+
+      Sync::PosixMutex idle_lock_;
+      IdleConnections idle_connections_;
     };
 
     class Response : public ResponseInformation
@@ -285,6 +347,49 @@ namespace HTTP
 
     HttpConnectionWrapper::~HttpConnectionWrapper() throw ()
     {
+      for (IdleConnections::iterator itor(idle_connections_.begin());
+        itor != idle_connections_.end(); ++itor)
+      {
+        for (ConnectionArray::iterator connection(itor->second.begin());
+          connection != itor->second.end(); ++connection)
+        {
+          delete *connection;
+        }
+      }
+    }
+
+    HTTP_Connection*
+    HttpConnectionWrapper::get_connection_(const std::string& key) throw ()
+    {
+      Sync::PosixGuard guard(idle_lock_);
+      IdleConnections::iterator itor(idle_connections_.find(key));
+      if (itor == idle_connections_.end() || itor->second.empty())
+      {
+        return 0;
+      }
+      HTTP_Connection* connection = itor->second.back();
+      itor->second.pop_back();
+      return connection;
+    }
+
+    void
+    HttpConnectionWrapper::release_connection_(const std::string& key,
+      HTTP_Connection* connection) throw ()
+    {
+      try
+      {
+        Sync::PosixGuard guard(idle_lock_);
+        ConnectionArray& connections = idle_connections_[key];
+        if (connections.size() < MAX_IDLE_CONNECTIONS)
+        {
+          connections.push_back(connection);
+          return;
+        }
+      }
+      catch (...)
+      {
+      }
+      delete connection;
     }
 
     void
@@ -334,10 +439,6 @@ namespace HTTP
 
       try
       {
-        HeaderList response_headers;
-        std::copy(headers.begin(), headers.end(),
-          std::back_inserter(response_headers));
-
         std::string proxy;
         if (!peer.first.empty())
         {
@@ -346,14 +447,66 @@ namespace HTTP
           ostr.str().assign_to(proxy);
         }
 
-        HTTP_Connection connection(HTTPAddress(String::SubString(request)),
-          peer.first.empty() ? 0 : proxy.c_str());
+        const HTTPAddress URL((String::SubString(request)));
 
-        connection.connect(connect_timeout_.get());
+        // Connections are kept per proxy or per host and port
+        std::string key(proxy);
+        if (key.empty())
+        {
+          URL.host().assign_to(key);
+          key += ':';
+          String::StringManip::IntToStr(URL.port_number()).str().append_to(
+            key);
+        }
+
+        HeaderList response_headers;
+        int status;
+        for (;;)
+        {
+          std::unique_ptr<HTTP_Connection> connection(get_connection_(key));
+          const bool REUSED = connection.get();
+          if (REUSED)
+          {
+            if (!connection->alive())
+            {
+              // Closed by the peer while idle, drop it before sending
+              continue;
+            }
+            connection->set_url(URL);
+          }
+          else
+          {
+            connection.reset(new HTTP_Connection(URL,
+              proxy.empty() ? 0 : proxy.c_str()));
+            connection->connect(connect_timeout_.get());
+          }
+
+          response_headers.assign(headers.begin(), headers.end());
 
-        int status = connection.process_request(vx_method, ParamList(),
-          response_headers, http_body, callback != 0, send_timeout_.get(),
-          recv_timeout_.get());
+          try
+          {
+            status = connection->process_request(vx_method, ParamList(),
+              response_headers, http_body, callback != 0,
+              send_timeout_.get(), recv_timeout_.get());
+          }
+          catch (const HTTP_Connection::ConnectionClosed&)
+          {
+            // Closed by the peer while idle, repeat on another one.
+            // The peer could process the request before closing, so
+            // only idempotent requests are repeated.
+            if (REUSED && method == HM_GET)
+            {
+              continue;
+            }
+            throw;
+          }
+
+          if (connection->connected())
+          {
+            release_connection_(key, connection.release());
+          }
+          break;
+        }
 
         std::vector<char> response_body;
         if (http_body)
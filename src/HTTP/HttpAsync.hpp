@@ -98,12 +98,36 @@ namespace HTTP
 
     /**
      * Response headers
+     * Implementations may build the list on the first call, use
+     * response_header_views or find_header to avoid copying.
      * @return response headers
      */
     virtual
     const HeaderList&
     response_headers() const throw () = 0;
 
+    /**
+     * Fills the array with views over the response headers.
+     * Views are valid only until the callback returns.
+     * @param headers array to fill, its previous content is dropped
+     */
+    virtual
+    void
+    response_header_views(SubHeaderArray& headers) const
+      throw (eh::Exception);
+
+    /**
+     * Searches for the first header with the name (case insensitive)
+     * without copying. The value is valid only until the callback returns.
+     * @param name header name
+     * @param value the header value to place to
+     * @return if the header has been found
+     */
+    virtual
+    bool
+    find_header(const String::SubString& name,
+      String::SubString& value) const throw ();
+
     /**
      * Searches for specific header in the response
      * @param name header name
@@ -115,6 +139,8 @@ namespace HTTP
 
     /**
      * Response body
+     * The data is valid only until the callback returns,
+     * copy it to keep it longer.
      * @return response body data
      */
     virtual
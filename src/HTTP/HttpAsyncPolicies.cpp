@@ -19,6 +19,8 @@
 
 
 
+#include <algorithm>
+
 #include <HTTP/HttpAsyncPolicies.hpp>
 
 
@@ -256,11 +258,21 @@ namespace HTTP
   {
   }
 
+  void
+  PoolPolicyStatistics::request_finished(Identifier /*connection*/,
+    Identifier /*request*/, const Generics::Time& /*duration*/) throw ()
+  {
+  }
+
 
   //
   // PoolPolicyDecider class
   //
 
+  const PoolPolicyDecider::Identifier
+    PoolPolicyDecider::DEFERRED_IDENTIFIER =
+      &PoolPolicyDecider::DEFERRED_IDENTIFIER;
+
   PoolPolicyDecider::~PoolPolicyDecider() throw ()
   {
   }
@@ -301,6 +313,12 @@ namespace HTTP
   {
   }
 
+  Generics::Time
+  PoolPolicyTimeout::request_timeout(Identifier /*connection*/) throw ()
+  {
+    return Generics::Time::ZERO;
+  }
+
 
   //
   // PoolPolicySimpleStatistics::StateInfo class
@@ -963,6 +981,90 @@ namespace HTTP
   }
 
 
+  //
+  // PoolPolicyLeastRequestsDecider class
+  //
+
+  PoolPolicyLeastRequestsDecider::PoolPolicyLeastRequestsDecider(
+    unsigned connections_per_server, unsigned connections_per_threads,
+    unsigned pipelining_depth, unsigned server_requests)
+    throw (eh::Exception)
+    : PoolPolicySimpleDecider(connections_per_server,
+        connections_per_threads),
+      PIPELINING_DEPTH_(pipelining_depth ? pipelining_depth : 1),
+      SERVER_REQUESTS_(server_requests)
+  {
+  }
+
+  PoolPolicyLeastRequestsDecider::Identifier
+  PoolPolicyLeastRequestsDecider::choose_connection(
+    Identifier server, Identifier /*request*/) throw ()
+  {
+    try
+    {
+      Sync::PosixGuard guard(mutex_);
+
+      const Servers& servers = get_servers_();
+      Servers::const_iterator itor(servers.find(server));
+
+      if (itor == servers.end())
+      {
+        Stream::Error ostr;
+        ostr << FNS << "got unexpected server identifier";
+        error(ostr.str());
+        return SPECIAL_IDENTIFIER;
+      }
+
+      unsigned requests = 0;
+      ConnectionPtrs::const_iterator end = itor->second.end();
+      ConnectionPtrs::const_iterator connection_it = end;
+      for (ConnectionPtrs::const_iterator conn_id(itor->second.begin());
+        conn_id != end; ++conn_id)
+      {
+        const Connection& connection = conn_id->second->second;
+        requests += connection.items_count;
+
+        if (connection.state != StateInfo::CLOSING &&
+          (connection_it == end || connection.items_count <
+            connection_it->second->second.items_count))
+        {
+          connection_it = conn_id;
+        }
+      }
+
+      if (SERVER_REQUESTS_ && requests >= SERVER_REQUESTS_)
+      {
+        return DEFERRED_IDENTIFIER;
+      }
+
+      if (connection_it != end)
+      {
+        const unsigned items = connection_it->second->second.items_count;
+        if (!items || (itor->second.size() >= CONNECTIONS_PER_SERVER_ &&
+          items < PIPELINING_DEPTH_))
+        {
+          connection_it->second->second.state = StateInfo::ACTIVE_AWAITING;
+          return connection_it->second->first;
+        }
+      }
+
+      if (itor->second.size() < CONNECTIONS_PER_SERVER_)
+      {
+        return SPECIAL_IDENTIFIER;
+      }
+
+      return DEFERRED_IDENTIFIER;
+    }
+    catch (...)
+    {
+      Stream::Error ostr;
+      ostr << FNS << "failed";
+      error(ostr.str());
+    }
+    return SPECIAL_IDENTIFIER;
+  }
+
+
   //
   // class PoolPolicySimpleEmptyThread
   //
@@ -1202,4 +1304,150 @@ namespace HTTP
   {
     return TIMEOUT_;
   }
+
+
+  //
+  // PoolPolicyTailTimeout class
+  //
+
+  namespace
+  {
+    const unsigned TAIL_DURATIONS = 256;
+    const unsigned TAIL_MIN_DURATIONS = 32;
+    const unsigned TAIL_RECALCULATION_PERIOD = 16;
+  }
+
+  PoolPolicyTailTimeout::Latencies::Latencies(
+    const Generics::Time& timeout) throw ()
+    : position(0), added(0), timeout(timeout)
+  {
+  }
+
+  PoolPolicyTailTimeout::PoolPolicyTailTimeout(
+    const Generics::Time& timeout, const Generics::Time& min_timeout,
+    unsigned percentile, unsigned multiplier)
+    throw (eh::Exception)
+    : TIMEOUT_(timeout), MIN_TIMEOUT_(std::min(min_timeout, timeout)),
+      PERCENTILE_(std::min(percentile, 100u)),
+      MULTIPLIER_(multiplier ? multiplier : 1)
+  {
+    sorted_.reserve(TAIL_DURATIONS);
+  }
+
+  PoolPolicyTailTimeout::~PoolPolicyTailTimeout() throw ()
+  {
+  }
+
+  int
+  PoolPolicyTailTimeout::expiration_timeout(Identifier /*connection*/)
+    throw ()
+  {
+    return TIMEOUT_.tv_sec + (TIMEOUT_.tv_usec ? 1 : 0);
+  }
+
+  Generics::Time
+  PoolPolicyTailTimeout::request_timeout(Identifier connection) throw ()
+  {
+    try
+    {
+      Sync::PosixGuard guard(mutex_);
+
+      const Connections& connections = get_connections_();
+      Connections::const_iterator conn_it(connections.find(connection));
+      if (conn_it != connections.end())
+      {
+        ServerLatencies::const_iterator itor(
+          latencies_.find(conn_it->second.server));
+        if (itor != latencies_.end())
+        {
+          return itor->second.timeout;
+        }
+      }
+    }
+    catch (...)
+    {
+      Stream::Error ostr;
+      ostr << FNS << "failed";
+      error(ostr.str());
+    }
+    return TIMEOUT_;
+  }
+
+  void
+  PoolPolicyTailTimeout::request_finished(Identifier connection,
+    Identifier /*request*/, const Generics::Time& duration) throw ()
+  {
+    try
+    {
+      Sync::PosixGuard guard(mutex_);
+
+      const Connections& connections = get_connections_();
+      Connections::const_iterator conn_it(connections.find(connection));
+      if (conn_it == connections.end())
+      {
+        return;
+      }
+
+      ServerLatencies::iterator itor(
+        latencies_.find(conn_it->second.server));
+      if (itor == latencies_.end())
+      {
+        // Forget servers removed from the pool
+        const Servers& servers = get_servers_();
+        for (ServerLatencies::iterator lat_it(latencies_.begin());
+          lat_it != latencies_.end();)
+        {
+          if (servers.find(lat_it->first) == servers.end())
+          {
+            latencies_.erase(lat_it++);
+          }
+          else
+          {
+            ++lat_it;
+          }
+        }
+
+        itor = latencies_.insert(ServerLatencies::value_type(
+          conn_it->second.server, Latencies(TIMEOUT_))).first;
+        itor->second.durations.reserve(TAIL_DURATIONS);
+      }
+
+      Latencies& latencies = itor->second;
+      if (latencies.durations.size() < TAIL_DURATIONS)
+      {
+        latencies.durations.push_back(duration);
+      }
+      else
+      {
+        latencies.durations[latencies.position] = duration;
+      }
+      latencies.position = (latencies.position + 1) % TAIL_DURATIONS;
+
+      if (++latencies.added % TAIL_RECALCULATION_PERIOD == 0 &&
+        latencies.durations.size() >= TAIL_MIN_DURATIONS)
+      {
+        calculate_timeout_(latencies);
+      }
+    }
+    catch (...)
+    {
+      Stream::Error ostr;
+      ostr << FNS << "failed";
+      error(ostr.str());
+    }
+  }
+
+  void
+  PoolPolicyTailTimeout::calculate_timeout_(Latencies& latencies)
+    throw (eh::Exception)
+  {
+    sorted_.assign(latencies.durations.begin(), latencies.durations.end());
+    Durations::iterator nth(sorted_.begin() +
+      std::min<size_t>(sorted_.size() * PERCENTILE_ / 100,
+        sorted_.size() - 1));
+    std::nth_element(sorted_.begin(), nth, sorted_.end());
+
+    latencies.timeout = std::max(MIN_TIMEOUT_,
+      std::min(TIMEOUT_, *nth * MULTIPLIER_));
+  }
 }
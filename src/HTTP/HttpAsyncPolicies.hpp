@@ -23,6 +23,7 @@
 #define HTTP_HTTPASYNCPOLICIES_HPP
 
 #include <map>
+#include <vector>
 
 #include <Sync/Semaphore.hpp>
 
@@ -278,12 +279,51 @@ namespace HTTP
     RequestPolicy
     requests_failed(Identifier server) throw ();
 
-  private:
+  protected:
     const unsigned CONNECTIONS_PER_SERVER_;
     const unsigned CONNECTIONS_PER_THREADS_;
   };
 
 
+  //
+  // class PoolPolicyLeastRequestsDecider
+  //
+
+  /**
+   * Gives a request to the connection of the server having the least
+   * number of outstanding requests. Requests exceeding the limits stay
+   * in the server until one of its requests finishes, so a slow response
+   * delays only the requests queued to its own connection.
+   */
+  class PoolPolicyLeastRequestsDecider : public PoolPolicySimpleDecider
+  {
+  public:
+    /**
+     * Constructor
+     * @param connections_per_server maximum number of connections to
+     * a server
+     * @param connections_per_threads maximum number of connections
+     * handled by a thread
+     * @param pipelining_depth maximum number of requests queued to
+     * a connection
+     * @param server_requests maximum number of requests in progress
+     * for a server, 0 means no limit
+     */
+    PoolPolicyLeastRequestsDecider(unsigned connections_per_server,
+      unsigned connections_per_threads, unsigned pipelining_depth = 1,
+      unsigned server_requests = 0)
+      throw (eh::Exception);
+
+    virtual
+    Identifier
+    choose_connection(Identifier server, Identifier request) throw ();
+
+  private:
+    const unsigned PIPELINING_DEPTH_;
+    const unsigned SERVER_REQUESTS_;
+  };
+
+
   //
   // class PoolPolicySimpleEmptyThread
   //
@@ -449,6 +489,78 @@ namespace HTTP
   private:
     const time_t TIMEOUT_;
   };
+
+
+  //
+  // class PoolPolicyTailTimeout
+  //
+
+  /**
+   * Derives the request timeout of a server from the recent response
+   * times: the given percentile of them multiplied by the multiplier
+   * and bounded by the minimal and the initial timeouts.
+   */
+  class PoolPolicyTailTimeout :
+    public virtual PoolPolicySimpleStatistics,
+    public virtual PoolPolicyTimeout
+  {
+  public:
+    /**
+     * Constructor
+     * @param timeout request timeout until enough responses are received,
+     * the upper bound for the derived timeouts
+     * @param min_timeout the lower bound for the derived timeouts
+     * @param percentile percentile of the response times
+     * @param multiplier multiplier for the percentile
+     */
+    PoolPolicyTailTimeout(const Generics::Time& timeout,
+      const Generics::Time& min_timeout = Generics::Time(0, 10000),
+      unsigned percentile = 99, unsigned multiplier = 4)
+      throw (eh::Exception);
+
+    virtual
+    int
+    expiration_timeout(Identifier connection) throw ();
+
+    virtual
+    Generics::Time
+    request_timeout(Identifier connection) throw ();
+
+    virtual
+    void
+    request_finished(Identifier connection, Identifier request,
+      const Generics::Time& duration) throw ();
+
+  protected:
+    virtual
+    ~PoolPolicyTailTimeout() throw ();
+
+  private:
+    typedef std::vector<Generics::Time> Durations;
+
+    struct Latencies
+    {
+      Durations durations;
+      unsigned position;
+      unsigned added;
+      Generics::Time timeout;
+
+      explicit
+      Latencies(const Generics::Time& timeout) throw ();
+    };
+    typedef std::map<Identifier, Latencies> ServerLatencies;
+
+    void
+    calculate_timeout_(Latencies& latencies) throw (eh::Exception);
+
+    const Generics::Time TIMEOUT_;
+    const Generics::Time MIN_TIMEOUT_;
+    const unsigned PERCENTILE_;
+    const unsigned MULTIPLIER_;
+
+    ServerLatencies latencies_;
+    Durations sorted_;
+  };
 }
 
 #endif
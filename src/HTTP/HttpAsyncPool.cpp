@@ -24,6 +24,8 @@
 
 #include <eh/Errno.hpp>
 
+#include <String/AsciiStringManip.hpp>
+
 #include <HTTP/UrlAddress.hpp>
 
 #include "HttpAsyncPoolInternals.hpp"
@@ -138,6 +140,7 @@ namespace HTTP
 
       evtimer_set(&term_event_, close_callback_, this);
       evtimer_set(&try_close_event_, try_close_callback_, this);
+      evtimer_set(&request_timeout_event_, request_timeout_callback_, this);
     }
 
     Connection::~Connection() throw ()
@@ -187,6 +190,10 @@ namespace HTTP
         {
           evtimer_del(&term_event_);
         }
+        if (evtimer_pending(&request_timeout_event_, 0))
+        {
+          evtimer_del(&request_timeout_event_);
+        }
       }
     }
 
@@ -238,6 +245,7 @@ namespace HTTP
       queue_.register_event(*thread_interf->get_base());
       event_base_set(thread_interf->get_base(), &term_event_);
       event_base_set(thread_interf->get_base(), &try_close_event_);
+      event_base_set(thread_interf->get_base(), &request_timeout_event_);
       evhttp_connection_set_base(conn_, thread_interf->get_base());
 
       int timeout = policy_->expiration_timeout(this);
@@ -290,12 +298,12 @@ namespace HTTP
             "Connection", "keep-alive");
         }
 
-        HeaderList::const_iterator end = request->headers().end();
-        for (HeaderList::const_iterator it = request->headers().begin();
-          it != end && result != -1; ++it)
+        const FlatHeaderList& headers = request->flat_headers();
+        for (FlatHeaderList::const_iterator it = headers.begin();
+          it != headers.end() && result != -1; ++it)
         {
-          result = evhttp_add_header(req->output_headers, it->name.c_str(),
-                    it->value.c_str());
+          result = evhttp_add_header(req->output_headers, it->name.data(),
+                    it->value.data());
         }
       }
 
@@ -313,6 +321,11 @@ namespace HTTP
       {
         evhttp_make_request(conn_, req, request->evhttp_method(),
           request->http_request());
+
+        if (requests_.size() == 1)
+        {
+          start_request_timer_();
+        }
       }
       else
       {
@@ -353,6 +366,10 @@ namespace HTTP
         {
           evtimer_del(&term_event_);
         }
+        if (evtimer_pending(&request_timeout_event_, 0))
+        {
+          evtimer_del(&request_timeout_event_);
+        }
       }
 
       if (thread_interf_)
@@ -454,6 +471,18 @@ namespace HTTP
       Request_var user_req(requests_.front());
       requests_.pop_front();
 
+      policy_->request_finished(this, user_req,
+        Generics::Time::get_time_of_day() - request_started_);
+
+      if (!requests_.empty())
+      {
+        start_request_timer_();
+      }
+      else if (evtimer_pending(&request_timeout_event_, 0))
+      {
+        evtimer_del(&request_timeout_event_);
+      }
+
       evhttp_request* req_buf = evhttp_request_new(response_callback_, this);
       if (!req_buf)
       {
@@ -525,6 +554,60 @@ namespace HTTP
       }
     }
 
+    void
+    Connection::start_request_timer_() throw ()
+    {
+      request_started_ = Generics::Time::get_time_of_day();
+
+      if (evtimer_pending(&request_timeout_event_, 0))
+      {
+        evtimer_del(&request_timeout_event_);
+      }
+
+      Generics::Time timeout(policy_->request_timeout(this));
+      if (timeout != Generics::Time::ZERO &&
+        evtimer_add(&request_timeout_event_, &timeout) == -1)
+      {
+        Stream::Error ostr;
+        ostr << FNS << "evtimer_add failed.";
+        policy_->error(ostr.str());
+      }
+    }
+
+    void
+    Connection::request_timeout_callback_(int, short, void* arg) throw ()
+    {
+      static_cast<Connection*>(arg)->request_timeout_();
+    }
+
+    void
+    Connection::request_timeout_() throw ()
+    {
+      if (terminating_ || requests_.empty())
+      {
+        return;
+      }
+
+      policy_->request_finished(this, requests_.front(),
+        Generics::Time::get_time_of_day() - request_started_);
+
+      try
+      {
+        Stream::Stack<1024> ostr;
+        ostr << FNS << "Request timed out.";
+        ostr.str().assign_to(error_);
+      }
+      catch (...)
+      {
+        Stream::Error ostr;
+        ostr << FNS << "Can't send error description (Request timed out) "
+          "to HTTP::HttpInternals::Server.";
+        policy_->error(ostr.str());
+      }
+
+      process_close();
+    }
+
     void
     Connection::check_try_close() throw ()
     {
@@ -1002,43 +1085,75 @@ namespace HTTP
           throw Exception(ostr);
         }
 
-        PoolPolicy::Identifier id(policy_->choose_connection(
-          this, request));
-        if (id != PoolPolicy::SPECIAL_IDENTIFIER)
+        if (!deferred_requests_.empty() ||
+          !choose_connection_(request, connection))
         {
-          Connections::iterator itor(connections_.find(id));
-          if (itor == connections_.end())
-          {
-            Stream::Error ostr;
-            ostr << FNS << "Invalid connection";
-            throw Exception(ostr);
-          }
-          connection = itor->second;
+          deferred_requests_.push_back(
+            Request_var(ReferenceCounting::add_ref(request)));
         }
-        else
+      }
+
+      if (connection)
+      {
+        send_request_(connection, request);
+      }
+      else
+      {
+        send_deferred_requests_();
+      }
+    }
+
+    bool
+    Server::choose_connection_(Request* request, Connection_var& connection)
+      throw (eh::Exception)
+    {
+      PoolPolicy::Identifier id(policy_->choose_connection(this, request));
+      if (id == PoolPolicy::DEFERRED_IDENTIFIER)
+      {
+        return false;
+      }
+
+      if (id != PoolPolicy::SPECIAL_IDENTIFIER)
+      {
+        Connections::iterator itor(connections_.find(id));
+        if (itor == connections_.end())
         {
-          const HttpServer& addr = request->address();
-          connection = new Connection(this, addr.first.c_str(), addr.second);
+          Stream::Error ostr;
+          ostr << FNS << "Invalid connection";
+          throw Exception(ostr);
+        }
+        connection = itor->second;
+      }
+      else
+      {
+        const HttpServer& addr = request->address();
+        connection = new Connection(this, addr.first.c_str(), addr.second);
 
-          Connections::iterator conn_it = connections_.insert(
-            Connections::value_type(connection, connection)).first;
+        Connections::iterator conn_it = connections_.insert(
+          Connections::value_type(connection, connection)).first;
 
-          policy_->server_connection_added(this, connection);
+        policy_->server_connection_added(this, connection);
 
-          try
-          {
-            server_interface_->place_connection(connection);
-          }
-          catch (...)
-          {
-            policy_->server_connection_removed(this, connection);
-            connections_.erase(conn_it);
-            throw;
-          }
+        try
+        {
+          server_interface_->place_connection(connection);
+        }
+        catch (...)
+        {
+          policy_->server_connection_removed(this, connection);
+          connections_.erase(conn_it);
+          throw;
         }
-        policy_->connection_request_added(this, connection, request);
       }
+      policy_->connection_request_added(this, connection, request);
 
+      return true;
+    }
+
+    void
+    Server::send_request_(Connection* connection, Request* request)
+      throw (eh::Exception)
+    {
       try
       {
         connection->add_request(request);
@@ -1053,15 +1168,73 @@ namespace HTTP
       }
     }
 
+    void
+    Server::send_deferred_requests_() throw ()
+    {
+      for (;;)
+      {
+        Request_var request;
+        Connection_var connection;
+
+        try
+        {
+          Sync::PosixGuard guard(mutex_);
+
+          if (deactivating_ || deferred_requests_.empty())
+          {
+            return;
+          }
+
+          request = deferred_requests_.front();
+          if (!choose_connection_(request, connection))
+          {
+            return;
+          }
+          deferred_requests_.pop_front();
+        }
+        catch (const eh::Exception& ex)
+        {
+          {
+            Sync::PosixGuard guard(mutex_);
+            if (deferred_requests_.empty() ||
+              deferred_requests_.front() != request)
+            {
+              continue;
+            }
+            deferred_requests_.pop_front();
+          }
+
+          Stream::Error ostr;
+          ostr << FNS << "Can't send deferred request: " << ex.what();
+          add_task_on_error_(request, ostr.str());
+          continue;
+        }
+
+        try
+        {
+          send_request_(connection, request);
+        }
+        catch (const eh::Exception& ex)
+        {
+          Stream::Error ostr;
+          ostr << FNS << "Can't send deferred request: " << ex.what();
+          add_task_on_error_(request, ostr.str());
+        }
+      }
+    }
+
     void
     Server::deactivate() throw ()
     {
       deactivating_ = true;
       bool wait_for_connections;
+      Requests deferred_requests;
 
       {
         Sync::PosixGuard guard(mutex_);
 
+        deferred_requests.swap(deferred_requests_);
+
         for (Connections::iterator itor(connections_.begin());
           itor != connections_.end();)
         {
@@ -1071,6 +1244,14 @@ namespace HTTP
         wait_for_connections = !connections_.empty();
       }
 
+      while (!deferred_requests.empty())
+      {
+        Stream::Error ostr;
+        ostr << FNS << "Deactivated";
+        add_task_on_error_(deferred_requests.front(), ostr.str());
+        deferred_requests.pop_front();
+      }
+
       if (wait_for_connections)
       {
         connections_are_deactivated_.acquire();
@@ -1102,20 +1283,25 @@ namespace HTTP
     void
     Server::exclude_connection(Connection* connection) throw ()
     {
-      Sync::PosixGuard guard(mutex_);
-
-      Connections::iterator itor(connections_.find(connection));
-      if (itor != connections_.end())
       {
-        policy_->server_connection_removed(this, connection);
+        Sync::PosixGuard guard(mutex_);
 
-        connections_.erase(itor);
-      }
+        Connections::iterator itor(connections_.find(connection));
+        if (itor != connections_.end())
+        {
+          policy_->server_connection_removed(this, connection);
 
-      if (deactivating_ && connections_.empty())
-      {
-        connections_are_deactivated_.release();
+          connections_.erase(itor);
+        }
+
+        if (deactivating_ && connections_.empty())
+        {
+          connections_are_deactivated_.release();
+          return;
+        }
       }
+
+      send_deferred_requests_();
     }
 
     void
@@ -1142,6 +1328,7 @@ namespace HTTP
     Server::add_task_on_response(Request* req) throw ()
     {
       policy_->server_request_removed(this, req);
+      send_deferred_requests_();
       try
       {
         add_task_(req);
@@ -1260,6 +1447,8 @@ namespace HTTP
         }
         break;
       }
+
+      send_deferred_requests_();
     }
 
     void
@@ -1286,6 +1475,8 @@ namespace HTTP
         add_task_on_error_(request, error);
         break;
       }
+
+      send_deferred_requests_();
     }
 
     void
@@ -1307,7 +1498,9 @@ namespace HTTP
       : policy_(ReferenceCounting::add_ref(policy)), address_(peer),
         http_request_(http_request),
         callback_(ReferenceCounting::add_ref(callback)), method_(method),
-        headers_(headers), response_data_(0),
+        headers_(headers.begin(), headers.end()), headers_copied_(false),
+        response_data_(0),
+        response_headers_copied_(false),
         informer_(ReferenceCounting::add_ref(informer))
     {
       if (!body.empty())
@@ -1363,26 +1556,29 @@ namespace HTTP
     const HeaderList&
     Request::headers() const throw ()
     {
-      return headers_;
+      if (!headers_copied_)
+      {
+        headers_copied_ = true;
+        try
+        {
+          for (FlatHeaderList::const_iterator it = headers_.begin();
+            it != headers_.end(); ++it)
+          {
+            headers_list_.emplace_back(it->name.str(), it->value.str());
+          }
+        }
+        catch (...)
+        {
+        }
+      }
+
+      return headers_list_;
     }
 
     void
     Request::set_response(evhttp_request* response_data) throw ()
     {
       response_data_ = response_data;
-      char** headers =
-        evhttp_headers_to_array(response_data_->input_headers);
-      try
-      {
-        for (char** header = headers; *header; header += 2)
-        {
-          response_headers_.emplace_back(header[0], header[1]);
-        }
-      }
-      catch (...)
-      {
-      }
-      evhttp_headers_array_free(headers);
     }
 
     int
@@ -1399,9 +1595,64 @@ namespace HTTP
     const HeaderList&
     Request::response_headers() const throw ()
     {
+      if (!response_headers_copied_ && response_data_)
+      {
+        response_headers_copied_ = true;
+        try
+        {
+          for (const evkeyval* header =
+            response_data_->input_headers->tqh_first;
+            header; header = header->next.tqe_next)
+          {
+            response_headers_.emplace_back(header->key, header->value);
+          }
+        }
+        catch (...)
+        {
+        }
+      }
+
       return response_headers_;
     }
 
+    void
+    Request::response_header_views(SubHeaderArray& headers) const
+      throw (eh::Exception)
+    {
+      headers.clear();
+      if (response_data_)
+      {
+        for (const evkeyval* header =
+          response_data_->input_headers->tqh_first;
+          header; header = header->next.tqe_next)
+        {
+          headers.emplace_back(header->key, header->value);
+        }
+      }
+    }
+
+    bool
+    Request::find_header(const String::SubString& name,
+      String::SubString& value) const throw ()
+    {
+      if (response_data_)
+      {
+        String::AsciiStringManip::Caseless header_name(name);
+        for (const evkeyval* header =
+          response_data_->input_headers->tqh_first;
+          header; header = header->next.tqe_next)
+        {
+          if (header_name == String::SubString(header->key))
+          {
+            value = String::SubString(header->value);
+            return true;
+          }
+        }
+      }
+
+      return false;
+    }
+
     String::SubString
     Request::body() const throw ()
     {
@@ -1472,6 +1723,12 @@ namespace HTTP
       return String::SubString(&body_[0], body_.size());
     }
 
+    const FlatHeaderList&
+    Request::flat_headers() const throw ()
+    {
+      return headers_;
+    }
+
 
     //
     // Informer class
@@ -174,6 +174,20 @@ namespace HTTP
     server_request_removed(Identifier server, Identifier request)
       throw () = 0;
 
+    /**
+     * Called when a connection has got the response for a request or
+     * the request has timed out
+     * @param connection connection identifier
+     * @param request request identifier
+     * @param duration time since the request became the oldest one
+     * in the connection
+     * Does nothing by default
+     */
+    virtual
+    void
+    request_finished(Identifier connection, Identifier request,
+      const Generics::Time& duration) throw ();
+
 
   protected:
     /**
@@ -198,6 +212,8 @@ namespace HTTP
       RP_MORE_DETAILS_REQUIRED
     };
 
+    static const Identifier DEFERRED_IDENTIFIER;
+
     /**
      * Determines which thread to choose for a connection (or create new)
      * @return thread identifier of SPECIAL_IDENTIFIER for a new thread
@@ -212,6 +228,8 @@ namespace HTTP
      * @param server server identifier
      * @param request request identifier
      * @return connection identifier of SPECIAL_IDENTIFIER for a new connection
+     * or DEFERRED_IDENTIFIER to keep the request in the server until one of
+     * its requests finishes
      */
     virtual
     Identifier
@@ -348,6 +366,16 @@ namespace HTTP
     int
     expiration_timeout(Identifier connection) throw () = 0;
 
+    /**
+     * Provides timeout for the oldest request of the connection
+     * Called by Connection each time another request becomes the oldest
+     * @param connection connection identifier
+     * @return request timeout, ZERO for no limit (the default)
+     */
+    virtual
+    Generics::Time
+    request_timeout(Identifier connection) throw ();
+
   protected:
     /**
      * Destructor
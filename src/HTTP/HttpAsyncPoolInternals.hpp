@@ -29,11 +29,13 @@
 #include <vector>
 
 #include <Sync/Semaphore.hpp>
+#include <Sync/MPSCQueue.hpp>
 
 #include <ReferenceCounting/List.hpp>
 #include <ReferenceCounting/Map.hpp>
 
 #include <Generics/Descriptors.hpp>
+#include <HTTP/FlatList.hpp>
 
 #include <HTTP/HttpAsyncPool.hpp>
 
@@ -44,7 +46,11 @@ namespace HTTP
   {
     /**
      * This class allows transfer of Data from different threads into
-     * the working thread where Object works with event_base
+     * the working thread where Object works with event_base.
+     * Data is passed through the lock-free queue, the working thread is
+     * woken up through eventfd only when the first message after it has
+     * taken the previous ones arrives, so a burst of add() calls costs
+     * a single wakeup.
      */
     template <typename Object, typename Data>
     class SignalQueue
@@ -78,6 +84,7 @@ namespace HTTP
 
       /**
        * Adds data to the queue informing working thread about it
+       * if it is not informed yet
        * @param data data to transfer
        */
       void
@@ -104,13 +111,12 @@ namespace HTTP
       flush() throw (eh::Exception);
 
     private:
+      /// Bits of pending_
       enum RequestType
       {
-        RT_DATA,
-        RT_QUIT,
-        RT_CHECK,
-
-        RT_LAST
+        RT_DATA = 1,
+        RT_QUIT = 2,
+        RT_CHECK = 4
       };
 
       void
@@ -121,7 +127,10 @@ namespace HTTP
       read_callback_(int fd, short type, void* arg) throw ();
 
       void
-      signal(unsigned char data) throw (SyscallFailure);
+      signal(unsigned type) throw (SyscallFailure);
+
+      void
+      pass_data_() throw ();
 
       void
       terminate_() throw ();
@@ -130,18 +139,19 @@ namespace HTTP
       remove_event_() throw ();
 
 
-      typedef ReferenceCounting::List<Data> Queue;
+      typedef Sync::MPSCQueue<Data> Queue;
 
-      Sync::PosixMutex mutex_;
       Queue queue_;
-      Generics::NonBlockingReadPipe pipe_;
+      Generics::EventDescriptor event_fd_;
+      /// Requests posted since the working thread has taken them last time
+      unsigned pending_;
 
       Object& object_;
       DataCallback data_callback_;
       QuitCallback quit_callback_;
       CheckCallback check_callback_;
 
-      event pipe_read_;
+      event event_read_;
       bool removed_;
     };
 
@@ -323,6 +333,12 @@ namespace HTTP
       String::SubString
       req_body() throw ();
 
+      /**
+       * Request headers, names and values are zero terminated
+       */
+      const FlatHeaderList&
+      flat_headers() const throw ();
+
       const HttpServer&
       address() const throw ();
 
@@ -338,6 +354,9 @@ namespace HTTP
       const char*
       http_request() const throw ();
 
+      /**
+       * Copies the headers into HeaderList on the first call
+       */
       virtual
       const HeaderList&
       headers() const throw ();
@@ -348,10 +367,24 @@ namespace HTTP
       int
       response_code() const throw ();
 
+      /**
+       * Copies the headers from the response data on the first call,
+       * callbacks not calling it pay nothing for the copy
+       */
       virtual
       const HeaderList&
       response_headers() const throw ();
 
+      virtual
+      void
+      response_header_views(SubHeaderArray& headers) const
+        throw (eh::Exception);
+
+      virtual
+      bool
+      find_header(const String::SubString& name,
+        String::SubString& value) const throw ();
+
       virtual
       String::SubString
       body() const throw ();
@@ -382,11 +415,14 @@ namespace HTTP
       std::string http_request_;
       ResponseCallback_var callback_;
       HttpMethod method_;
-      HeaderList headers_;
+      FlatHeaderList headers_;
+      mutable bool headers_copied_;
+      mutable HeaderList headers_list_;
       std::vector<char> body_;
 
       evhttp_request* response_data_;
-      HeaderList response_headers_;
+      mutable bool response_headers_copied_;
+      mutable HeaderList response_headers_;
 
       std::string error_;
 
@@ -449,6 +485,16 @@ namespace HTTP
       void
       try_close_() throw ();
 
+      void
+      start_request_timer_() throw ();
+
+      static
+      void
+      request_timeout_callback_(int, short, void* arg) throw ();
+
+      void
+      request_timeout_() throw ();
+
 
       ConnThreadInterface_var thread_interf_;
       ConnServInterface_var serv_interf_;
@@ -465,6 +511,9 @@ namespace HTTP
 
       std::string error_;
       event try_close_event_;
+
+      Generics::Time request_started_;
+      event request_timeout_event_;
     };
 
 
@@ -524,6 +573,17 @@ namespace HTTP
       void
       deactivate_connection_(Connection* conn) throw ();
 
+      bool
+      choose_connection_(Request* request, Connection_var& connection)
+        throw (eh::Exception);
+
+      void
+      send_request_(Connection* connection, Request* request)
+        throw (eh::Exception);
+
+      void
+      send_deferred_requests_() throw ();
+
       void
       add_task_(Generics::Task* task) throw (eh::Exception);
 
@@ -547,6 +607,7 @@ namespace HTTP
       ServerInterface_var server_interface_;
 
       Connections connections_;
+      Requests deferred_requests_;
 
       Generics::TaskRunner_var task_runner_;
     };
@@ -32,7 +32,7 @@ namespace HTTP
       DataCallback data_callback, QuitCallback quit_callback,
       CheckCallback check_callback)
       throw (eh::Exception, SyscallFailure)
-      : object_(object),
+      : pending_(0), object_(object),
         data_callback_(data_callback), quit_callback_(quit_callback),
         check_callback_(check_callback), removed_(true)
     {
@@ -43,10 +43,10 @@ namespace HTTP
     SignalQueue<Object, Data>::register_event(event_base& base)
       throw (eh::Exception, Exception)
     {
-      event_set(&pipe_read_, pipe_.read_descriptor(), EV_READ | EV_PERSIST,
+      event_set(&event_read_, event_fd_.fd(), EV_READ | EV_PERSIST,
         read_callback_, this);
-      event_base_set(&base, &pipe_read_);
-      if (event_add(&pipe_read_, 0) == -1)
+      event_base_set(&base, &event_read_);
+      if (event_add(&event_read_, 0) == -1)
       {
         Stream::Error ostr;
         ostr << FNS << "event_add() failed.";
@@ -60,18 +60,9 @@ namespace HTTP
     SignalQueue<Object, Data>::add(Data& data)
       throw (eh::Exception, SyscallFailure)
     {
-      bool empty;
-
-      {
-        Sync::PosixGuard guard(mutex_);
-        empty = queue_.empty();
-        queue_.push_back(data);
-      }
-
-      if (empty)
-      {
-        signal(RT_DATA);
-      }
+      Data element(data);
+      queue_.push(std::move(element));
+      signal(RT_DATA);
     }
 
     template <typename Object, typename Data>
@@ -94,24 +85,12 @@ namespace HTTP
     {
       remove_event_();
 
-      for (;;)
-      {
-        Data data;
-        {
-          Sync::PosixGuard guard(mutex_);
-          if (queue_.empty())
-          {
-            break;
-          }
-          data = queue_.front();
-          queue_.pop_front();
-        }
-        (object_.*data_callback_)(data);
-      }
+      event_fd_.reset();
+      __atomic_store_n(&pending_, 0, __ATOMIC_RELEASE);
 
-      for (unsigned char data[256];
-        pipe_.read(data, sizeof(data)) == sizeof(data);)
+      for (Data data; queue_.pop_wait(data);)
       {
+        (object_.*data_callback_)(data);
       }
     }
 
@@ -119,65 +98,23 @@ namespace HTTP
     void
     SignalQueue<Object, Data>::handle_read_() throw ()
     {
-      bool states[RT_LAST];
-      std::fill(states, states + RT_LAST, false);
-
-      for (;;)
-      {
-        unsigned char data[256];
-        ssize_t res = pipe_.read(data, sizeof(data) - 1);
-        switch (res)
-        {
-        case -1:
-          if (errno == EAGAIN)
-          {
-            break;
-          }
-
-        case 0:
-          states[RT_QUIT] = true;
-          break;
-
-        default:
-          const bool cont = res == sizeof(data);
-          for (unsigned char* ptr = data; res--; ptr++)
-          {
-            states[*ptr] = true;
-          }
-          if (cont)
-          {
-            continue;
-          }
-          break;
-        }
-        break;
-      }
+      // Requests posted after the exchange signal the descriptor again
+      event_fd_.reset();
+      const unsigned PENDING =
+        __atomic_exchange_n(&pending_, 0, __ATOMIC_ACQ_REL);
 
-      if (states[RT_DATA])
+      if (PENDING & RT_DATA)
       {
-        for (;;)
-        {
-          Data data;
-          {
-            Sync::PosixGuard guard(mutex_);
-            if (queue_.empty())
-            {
-              break;
-            }
-            data = queue_.front();
-            queue_.pop_front();
-          }
-          (object_.*data_callback_)(data);
-        }
+        pass_data_();
       }
 
-      if (states[RT_QUIT])
+      if (PENDING & RT_QUIT)
       {
         terminate_();
       }
       else
       {
-        if (states[RT_CHECK])
+        if (PENDING & RT_CHECK)
         {
           (object_.*check_callback_)();
         }
@@ -195,28 +132,41 @@ namespace HTTP
 
     template <typename Object, typename Data>
     void
-    SignalQueue<Object, Data>::signal(unsigned char data)
+    SignalQueue<Object, Data>::signal(unsigned type)
       throw (SyscallFailure)
     {
-      for (;;)
+      // Only the first request after the working thread has taken
+      // the previous ones wakes it up
+      if (__atomic_fetch_or(&pending_, type, __ATOMIC_ACQ_REL))
+      {
+        return;
+      }
+
+      try
       {
-        ssize_t res = pipe_.signal(data);
-        switch (res)
+        if (event_fd_.signal() < 0)
         {
-        case -1:
-          eh::throw_errno_exception<SyscallFailure>(FNE, "send");
-
-        case 0:
-          {
-            Stream::Error ostr;
-            ostr << FNS << "send error: connection closed";
-            throw SyscallFailure(ostr);
-          }
-
-        default:
-          break;
+          eh::throw_errno_exception<SyscallFailure>(FNE, "write");
         }
-        break;
+      }
+      catch (...)
+      {
+        // The working thread is not woken up, so the next request
+        // must signal the descriptor itself
+        __atomic_store_n(&pending_, 0, __ATOMIC_RELEASE);
+        throw;
+      }
+    }
+
+    template <typename Object, typename Data>
+    void
+    SignalQueue<Object, Data>::pass_data_() throw ()
+    {
+      // Element which push is not complete yet is passed on the next
+      // wakeup, its producer signals after the push
+      for (Data data; queue_.pop(data);)
+      {
+        (object_.*data_callback_)(data);
       }
     }
 
@@ -234,7 +184,7 @@ namespace HTTP
     {
       if (!removed_)
       {
-        event_del(&pipe_read_);
+        event_del(&event_read_);
         removed_ = true;
       }
     }
@@ -22,7 +22,9 @@
 // File   : HttpConnection.cpp
 // Author : Pavel Gubin
 
-#include <sstream>
+#include <cstring>
+
+#include <sys/socket.h>
 
 #include <ace/SOCK_Connector.h>
 #include <ace/SOCK_Stream.h>
@@ -34,7 +36,7 @@
 
 #include <Generics/Time.hpp>
 
-#include <Stream/SocketStream.hpp>
+#include <Stream/MemoryStream.hpp>
 
 #include <HTTP/HttpConnection.hpp>
 
@@ -104,6 +106,17 @@ namespace HTTP
         ACE_INET_Addr(proxy_port_, proxy_host_.c_str());
     }
 
+    if (connected())
+    {
+      // ACE reports success for the connected socket, so a kept
+      // connection closed by the peer would be reused silently
+      if (alive())
+      {
+        return;
+      }
+      stream_.close();
+    }
+
     ACE_Time_Value connect_timeout_ace(
       connect_timeout ? *connect_timeout : Generics::Time());
     ACE_SOCK_Connector connector;
@@ -122,11 +135,28 @@ namespace HTTP
     connect(connect_timeout, local_ip, addr);
   }
 
+  bool
+  HTTP_Connection::alive() const throw ()
+  {
+    if (!connected())
+    {
+      return false;
+    }
+    // Idle connection has nothing to read: zero means the peer has
+    // closed it, data means the state of the connection is unknown
+    char data;
+    return ::recv(stream_.get_handle(), &data, 1,
+      MSG_PEEK | MSG_DONTWAIT) < 0 &&
+      (errno == EAGAIN || errno == EWOULDBLOCK);
+  }
+
 
 /// Execute HTTP request
 /**
-*   Forges HTTP request from arguments. Sends the request to the stream.
+*   Forges HTTP/1.1 request from arguments. Sends the request to the stream.
 *   Calls parse_response if the response is expected.
+*   The connection is kept open if the response allows it (see connected),
+*   it is closed otherwise.
 *
 *   @param[in] method: can be one of \b HM_Post or \b HM_Get
 *   @param[in] params: request parameters
@@ -155,15 +185,15 @@ namespace HTTP
     {
       unsigned int sent = 0;
 
-      std::ostringstream request;
+      String::SubString method_str;
       switch (method)
       {
       case HM_Post:
-        request << "POST ";
+        method_str = String::SubString("POST");
         break;
 
       case HM_Get:
-        request << "GET ";
+        method_str = String::SubString("GET");
         break;
 
       default:
@@ -172,7 +202,16 @@ namespace HTTP
         throw InvalidArgs(ostr);
       }
 
-      request << (proxy_host_.empty() ? url_.path() : url_.url());
+      std::string target;
+      if (proxy_host_.empty())
+      {
+        url_.path().assign_to(target);
+      }
+      else
+      {
+        target = url_.url();
+      }
+
       std::string params_seq;
       if (proxy_host_.empty())
       {
@@ -181,27 +220,27 @@ namespace HTTP
 
       if (!params.empty())
       {
-        std::ostringstream params_str;
+        if (!params_seq.empty())
+        {
+          params_seq += '&';
+        }
+
         for (HTTP::ParamList::const_iterator it = params.begin();
           it != params.end(); ++it)
         {
           if (it != params.begin())
           {
-            params_str << "&";
+            params_seq += '&';
           }
 
           std::string name;
           String::StringManip::mime_url_encode(it->name, name);
           std::string value;
           String::StringManip::mime_url_encode(it->value, value);
-          params_str << name << "=" << value;
-        }
-
-        if (!params_seq.empty())
-        {
-          params_seq += "&";
+          params_seq += name;
+          params_seq += '=';
+          params_seq += value;
         }
-        params_seq += params_str.str();
       }
 
       if (!params_seq.empty())
@@ -211,11 +250,12 @@ namespace HTTP
         {
           if (!proxy_host_.empty() && url_.query()[0] != '\0')
           {
-            request << params_seq.c_str();
+            target += params_seq;
           }
           else
           {
-            request << "?" << params_seq.c_str();
+            target += '?';
+            target += params_seq;
           }
         }
         else
@@ -225,43 +265,31 @@ namespace HTTP
         }
       }
 
-      request << " HTTP/1.0" << "\r\n";
-
-      // headers
-
-      bool add_host_hdr = true;
-      for (HTTP::HeaderList::iterator it = headers.begin();
-        it != headers.end(); ++it)
+      std::string host;
+      url_.host().assign_to(host);
+      if (url_.port_number() != 80)
       {
-        request << it->name << ": " << it->value << "\r\n";
-
-        if (it->name == String::AsciiStringManip::Caseless("Host"))
-        {
-          add_host_hdr = false;
-        }
+        host += ':';
+        String::StringManip::IntToStr(url_.port_number()).str().append_to(
+          host);
       }
 
-      unsigned int body_len = body ? body->total_size() : 0;
+      request_.clear();
+      serialize_request(request_, method_str, target, host, headers,
+        body ? body->total_size() : 0, need_response);
 
-      request << "Content-Length: " << body_len << "\r\n";
-      if (add_host_hdr)
-      {
-        request << "Host: " << url_.host();
-        if (url_.port_number() != 80)
-        {
-          request << ":" << url_.port_number();
-        }
-        request << "\r\n";
-      }
-      request << "\r\n";
-
-      const std::string& request_string = request.str();
-      ssize_t request_len = request_string.length();
+      ssize_t request_len = request_.length();
       ACE_Time_Value send_timeout_ace(
         send_timeout ? *send_timeout : Generics::Time());
-      if (stream_.send_n(request_string.data(), request_len,
+      // The peer could close the kept connection, avoid SIGPIPE
+      if (stream_.send_n(request_.data(), request_len, MSG_NOSIGNAL,
         send_timeout ? &send_timeout_ace : 0) != request_len)
       {
+        if (errno == EPIPE || errno == ECONNRESET)
+        {
+          eh::throw_errno_exception<ConnectionClosed>(
+            FNE, "failed to send HTTP headers");
+        }
         throw_exception(FNB, "failed to send HTTP headers");
       }
       sent += request_len;
@@ -270,7 +298,7 @@ namespace HTTP
       while (body_ptr)
       {
         if (stream_.send_n(body_ptr->base(), body_ptr->size(),
-          send_timeout ? &send_timeout_ace : 0) !=
+          MSG_NOSIGNAL, send_timeout ? &send_timeout_ace : 0) !=
             static_cast<ssize_t>(body_ptr->size()))
         {
           throw_exception(FNB, "failed to send data");
@@ -279,8 +307,6 @@ namespace HTTP
         body_ptr = body_ptr->cont();
       }
 
-//      stream_.close_writer();
-
       if (bytes_sent)
       {
         *bytes_sent = sent;
@@ -292,7 +318,10 @@ namespace HTTP
           response_latency);
       }
 
-      stream_.close();
+      if (!need_response || !parser_.keep_alive())
+      {
+        stream_.close();
+      }
     }
     catch (...)
     {
@@ -303,9 +332,12 @@ namespace HTTP
     return status;
   }
 
+
 /// Process HTTP response
 /**
-*   Gets HTTP response from the stream. Parses the response.
+*   Receives HTTP response from the stream and feeds it to the parser.
+*   Headers and body are replaced only when the response starts arriving,
+*   so an idempotent request can be repeated after ConnectionClosed.
 *   @param[out]  bytes_rcvd: number of bytes received from the stream
 */
 
@@ -315,123 +347,77 @@ namespace HTTP
     unsigned int* bytes_rcvd, Generics::Time* responce_latency)
     throw (eh::Exception, Exception)
   {
-    headers.clear();
-    if (body)
-    {
-      body->release();
-      body = 0;
-    }
-
-    Generics::Time resp_latency;
     Generics::Timer timer;
     timer.start();
 
-    std::string str;
-    Stream::SocketInStream in(stream_, recv_timeout);
-
-    unsigned int status_code = 0;
-
-    try
-    {
-      in >> str; // skip HTTP version
-
-      timer.stop();
-      resp_latency = timer.elapsed_time();
-
-      if (responce_latency)
-      {
-        *responce_latency = resp_latency;
-      }
-
-      timer.start();
-
-      in >> status_code; // read status code
+    ACE_Time_Value recv_timeout_ace(
+      recv_timeout ? *recv_timeout : Generics::Time());
 
-      std::getline(in, str, '\r'); // read reason phrase
-
-      if (status_code < 200 || status_code >= 400)
-      {
-        Stream::Error ostr;
-        ostr << FNS << "status code " << status_code << ", reason " << str;
-        throw StatusException(ostr, status_code);
-      }
+    parser_.reset();
 
-      if (in.get() != '\n')
-      {
-        Stream::Error ostr;
-        ostr << FNS << "invalid response format";
-        throw Exception(ostr);
-      }
+    unsigned int received = 0;
+    HttpBody* cur_block = 0;
 
-      ssize_t body_len = -1;
+    while (!parser_.complete())
+    {
+      ssize_t n = stream_.recv(recv_buffer_, sizeof(recv_buffer_),
+        recv_timeout ? &recv_timeout_ace : 0);
 
-      // reading headers
-      for (;;)
+      if (!received)
       {
-        std::getline(in, str, '\r');
-        if (in.get() != '\n')
+        if (!n || (n < 0 && errno == ECONNRESET))
         {
           Stream::Error ostr;
-          ostr << FNS << "invalid response format";
-          throw Exception(ostr);
+          ostr << FNS << "connection closed before the response";
+          throw ConnectionClosed(ostr);
         }
 
-        if (str.empty())
-        {
-          // got empty line
-          break;
-        }
-
-        std::string::size_type colon_pos = str.find(':');
-        if (colon_pos == std::string::npos)
-        {
-          Stream::Error ostr;
-          ostr << FNS << "cannot find colon in header";
-          throw Exception(ostr);
-        }
-
-        const char* const STR_START = str.c_str();
-        const char* name_start = STR_START;
-        while (std::isspace(*name_start))
+        timer.stop();
+        if (responce_latency)
         {
-          ++name_start;
+          *responce_latency = timer.elapsed_time();
         }
-        std::string name(name_start, STR_START + colon_pos);
 
-        const char* value_start = STR_START + colon_pos + 1;
-        while (std::isspace(*value_start))
+        if (n > 0)
         {
-          ++value_start;
+          headers.clear();
+          if (body)
+          {
+            body->release();
+            body = 0;
+          }
         }
-        std::string value(value_start);
+      }
 
-        headers.emplace_back(name, value);
+      if (n < 0)
+      {
+        throw_exception(FNB, "failed to receive response");
+      }
 
-        if (name == String::AsciiStringManip::Caseless("Content-Length"))
+      if (!n)
+      {
+        if (!parser_.finish())
         {
-          Stream::Parser istr(value.data(), value.size());
-          istr >> body_len;
+          Stream::Error ostr;
+          ostr << FNS << "unexpected EOF";
+          throw Exception(ostr);
         }
+        break;
       }
 
-      HttpBody* cur_block = body;
-      const ssize_t BUFFER_SIZE = 1000;
-      if (body_len > 0 || body_len == -1)
+      received += n;
+
+      const bool HEADERS_COMPLETE = parser_.headers_complete();
+      String::SubString data(recv_buffer_, n);
+      while (!data.empty() && !parser_.complete())
       {
-        while (in.good() && body_len)
+        String::SubString part;
+        data.erase_front(parser_.parse(data, part));
+
+        if (!part.empty())
         {
-          ssize_t to_read = body_len > 0 && body_len < BUFFER_SIZE ?
-            body_len : BUFFER_SIZE;
-          Generics::ArrayChar buf(to_read);
-          size_t n = in.rdbuf()->sgetn(buf.get(), to_read);
-          if (!n)
-          {
-            break;
-          }
-          HttpBody* new_block = new HttpBody(buf.get(), to_read);
-          buf.release();
-          new_block->size(n);
-          new_block->clr_flags(ACE_Message_Block::DONT_DELETE);
+          HttpBody* new_block = new HttpBody(part.size());
+          std::memcpy(new_block->base(), part.data(), part.size());
           if (cur_block)
           {
             cur_block->cont(new_block);
@@ -441,44 +427,40 @@ namespace HTTP
             body = new_block;
           }
           cur_block = new_block;
-          if (body_len > 0)
-          {
-            body_len -= n;
-          }
         }
+      }
 
-        if (body_len > 0)
+      if (!HEADERS_COMPLETE && parser_.headers_complete())
+      {
+        const unsigned int STATUS_CODE = parser_.status_code();
+        if (STATUS_CODE < 200 || STATUS_CODE >= 400)
         {
           Stream::Error ostr;
-          ostr << FNS << "unexpected EOF";
-          throw Exception(ostr);
+          ostr << FNS << "status code " << STATUS_CODE << ", reason " <<
+            parser_.reason();
+          throw StatusException(ostr, STATUS_CODE);
         }
       }
-    }
-    catch (const Exception& ex)
-    {
-      if (in.fail())
-      {
-        timer.stop();
-
-        Generics::Time tv = timer.elapsed_time();
 
-        tv += resp_latency;
-
-        Stream::Error ostr;
-        ostr << FNS << "reading response failed ( time: " << tv.tv_sec <<
-          " ). Exception:" << ex.what();
-        throw Exception(ostr);
+      if (!data.empty())
+      {
+        // Data after the response, the connection state is unknown
+        parser_.finish();
       }
+    }
 
-      throw;
+    const FlatHeaderList& response_headers = parser_.headers();
+    for (FlatHeaderList::const_iterator it = response_headers.begin();
+      it != response_headers.end(); ++it)
+    {
+      headers.emplace_back(it->name.str(), it->value.str());
     }
 
     if (bytes_rcvd)
     {
-      *bytes_rcvd = in.bytes_received();
+      *bytes_rcvd = received;
     }
 
-    return status_code;
+    return parser_.status_code();
   }
 }
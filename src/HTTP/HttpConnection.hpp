@@ -34,6 +34,7 @@
 
 #include <HTTP/UrlAddress.hpp>
 #include <HTTP/Http.hpp>
+#include <HTTP/HttpParser.hpp>
 
 
 namespace HTTP
@@ -51,6 +52,12 @@ namespace HTTP
     DECLARE_EXCEPTION(Exception, eh::DescriptiveException);
     DECLARE_EXCEPTION(InvalidArgs, Exception);
     DECLARE_EXCEPTION(Timeout, Exception);
+    /**
+     * The connection has been closed by the peer before the response.
+     * A kept alive connection could be closed while idle, an idempotent
+     * request can be repeated on a new connection then.
+     */
+    DECLARE_EXCEPTION(ConnectionClosed, Exception);
 
     class StatusException : public Exception
     {
@@ -77,6 +84,31 @@ namespace HTTP
     ACE_SOCK_Stream&
     stream() throw ();
 
+    /**
+     * Sets URL for the following requests over the established connection
+     * @param url URL with the same host and port
+     */
+    void
+    set_url(const HTTPAddress& url) throw (eh::Exception);
+
+    /**
+     * Connection is kept open after a response allowing it (keep-alive)
+     * @return if the connection can be used for the next request
+     */
+    bool
+    connected() const throw ();
+
+    /**
+     * Checks the kept connection without blocking before its reuse
+     * @return false if the connection is closed, the peer has closed it
+     * or has sent data without a request
+     */
+    bool
+    alive() const throw ();
+
+    void
+    close() throw ();
+
     void
     connect(const Generics::Time* connect_timeout = 0,
       const ACE_Addr& local_ip = ACE_Addr::sap_any)
@@ -107,10 +139,16 @@ namespace HTTP
       throw (eh::Exception, Exception);
 
   protected:
+    static const size_t RECV_BUFFER_SIZE = 16 * 1024;
+
     HTTPAddress url_;
     ACE_SOCK_Stream stream_;
     std::string proxy_host_;
     unsigned short proxy_port_;
+
+    std::string request_;
+    ResponseParser parser_;
+    char recv_buffer_[RECV_BUFFER_SIZE];
   };
 } // namespace HTTP
 
@@ -152,6 +190,27 @@ namespace HTTP
   {
     return stream_;
   }
+
+  inline
+  void
+  HTTP_Connection::set_url(const HTTPAddress& url) throw (eh::Exception)
+  {
+    url_ = url;
+  }
+
+  inline
+  bool
+  HTTP_Connection::connected() const throw ()
+  {
+    return stream_.get_handle() != ACE_INVALID_HANDLE;
+  }
+
+  inline
+  void
+  HTTP_Connection::close() throw ()
+  {
+    stream_.close();
+  }
 }
 
 #endif
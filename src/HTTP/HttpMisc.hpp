@@ -25,6 +25,7 @@
 #define HTTP_HTTPMISC_HPP
 
 #include <list>
+#include <vector>
 
 #include <String/SubString.hpp>
 
@@ -65,6 +66,8 @@ namespace HTTP
   };
 
   typedef std::list<SubHeader> SubHeaderList;
+  // Reusable storage for views over the headers of some response
+  typedef std::vector<SubHeader> SubHeaderArray;
 
   /**
    * HTTP Parameter
@@ -0,0 +1,480 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cstring>
+
+#include <Generics/Function.hpp>
+
+#include <Stream/MemoryStream.hpp>
+
+#include <String/AsciiStringManip.hpp>
+#include <String/StringManip.hpp>
+
+#include <HTTP/HttpParser.hpp>
+
+
+namespace
+{
+  const String::AsciiStringManip::Caseless CONTENT_LENGTH("Content-Length");
+  const String::AsciiStringManip::Caseless
+    TRANSFER_ENCODING("Transfer-Encoding");
+  const String::AsciiStringManip::Caseless CONNECTION("Connection");
+  const String::AsciiStringManip::Caseless HOST("Host");
+  const String::AsciiStringManip::Caseless CHUNKED("chunked");
+  const String::AsciiStringManip::Caseless CLOSE("close");
+  const String::AsciiStringManip::Caseless KEEP_ALIVE("keep-alive");
+
+  const char HTTP_PREFIX[] = "HTTP/1.";
+  const char CRLF[] = "\r\n";
+
+  /**
+   * Checks if the comma separated list contains the token
+   * @param last check the last token only
+   */
+  bool
+  has_token(String::SubString list,
+    const String::AsciiStringManip::Caseless& token, bool last = false)
+    throw ()
+  {
+    bool found = false;
+    for (;;)
+    {
+      const String::SubString::SizeType COMMA = list.find(',');
+      String::SubString element(list.substr(0, COMMA));
+      String::StringManip::trim(element);
+      if (!element.empty())
+      {
+        found = token.equal(element);
+        if (found && !last)
+        {
+          return true;
+        }
+      }
+      if (COMMA == String::SubString::NPOS)
+      {
+        return found;
+      }
+      list = list.substr(COMMA + 1);
+    }
+  }
+
+  template <typename Headers>
+  void
+  serialize(std::string& buffer, const String::SubString& method,
+    const String::SubString& target, const String::SubString& host,
+    const Headers& headers, size_t body_size, bool keep_alive)
+    throw (eh::Exception)
+  {
+    method.append_to(buffer);
+    buffer += ' ';
+    target.append_to(buffer);
+    buffer.append(" HTTP/1.1\r\n");
+
+    bool add_host = true;
+    bool add_connection = true;
+    bool add_length = true;
+    for (typename Headers::const_iterator it = headers.begin();
+      it != headers.end(); ++it)
+    {
+      const String::SubString NAME(it->name);
+      NAME.append_to(buffer);
+      buffer.append(": ");
+      String::SubString(it->value).append_to(buffer);
+      buffer.append(CRLF);
+
+      if (HOST == NAME)
+      {
+        add_host = false;
+      }
+      else if (CONNECTION == NAME)
+      {
+        add_connection = false;
+      }
+      else if (CONTENT_LENGTH == NAME)
+      {
+        add_length = false;
+      }
+    }
+
+    if (add_host)
+    {
+      HOST.str.append_to(buffer);
+      buffer.append(": ");
+      host.append_to(buffer);
+      buffer.append(CRLF);
+    }
+    if (add_connection)
+    {
+      CONNECTION.str.append_to(buffer);
+      buffer.append(keep_alive ? ": keep-alive\r\n" : ": close\r\n");
+    }
+    if (add_length)
+    {
+      CONTENT_LENGTH.str.append_to(buffer);
+      buffer.append(": ");
+      String::StringManip::IntToStr(body_size).str().append_to(buffer);
+      buffer.append(CRLF);
+    }
+    buffer.append(CRLF);
+  }
+}
+
+namespace HTTP
+{
+  //
+  // ResponseParser class
+  //
+
+  const size_t ResponseParser::DEFAULT_MAX_LINE;
+
+  ResponseParser::ResponseParser(size_t max_line) throw (eh::Exception)
+    : MAX_LINE_(max_line)
+  {
+    reset();
+  }
+
+  void
+  ResponseParser::reset(bool no_body) throw ()
+  {
+    state_ = S_STATUS;
+    no_body_ = no_body;
+    interim_ = false;
+    until_close_ = false;
+    keep_alive_ = false;
+    version_ = 0;
+    status_code_ = 0;
+    remaining_ = 0;
+    line_.clear();
+    reason_.clear();
+    headers_.clear();
+  }
+
+  size_t
+  ResponseParser::parse(const String::SubString& data,
+    String::SubString& body) throw (Exception, eh::Exception)
+  {
+    body.clear();
+
+    const char* cur = data.begin();
+    const char* const END = data.end();
+
+    while (cur != END && state_ != S_DONE)
+    {
+      if (state_ == S_BODY || state_ == S_CHUNK_DATA)
+      {
+        size_t size = END - cur;
+        if (!until_close_ && remaining_ < size)
+        {
+          size = remaining_;
+        }
+        body = String::SubString(cur, size);
+        cur += size;
+
+        if (!until_close_ && !(remaining_ -= size))
+        {
+          state_ = state_ == S_BODY ? S_DONE : S_CHUNK_END;
+        }
+        break;
+      }
+
+      String::SubString line;
+      if (!read_line_(cur, END, line))
+      {
+        break;
+      }
+
+      switch (state_)
+      {
+      case S_STATUS:
+        status_line_(line);
+        break;
+
+      case S_HEADER:
+        if (line.empty())
+        {
+          headers_end_();
+        }
+        else
+        {
+          header_line_(line);
+        }
+        break;
+
+      case S_CHUNK_SIZE:
+        chunk_size_line_(line);
+        break;
+
+      case S_CHUNK_END:
+        if (!line.empty())
+        {
+          Stream::Error ostr;
+          ostr << FNS << "no CRLF after chunk data";
+          throw Exception(ostr);
+        }
+        state_ = S_CHUNK_SIZE;
+        break;
+
+      case S_TRAILER:
+        if (line.empty())
+        {
+          state_ = S_DONE;
+        }
+        else
+        {
+          header_line_(line);
+        }
+        break;
+
+      default:
+        break;
+      }
+
+      line_.clear();
+    }
+
+    return cur - data.begin();
+  }
+
+  bool
+  ResponseParser::finish() throw ()
+  {
+    if (state_ == S_BODY && until_close_)
+    {
+      state_ = S_DONE;
+    }
+    keep_alive_ = false;
+    return state_ == S_DONE;
+  }
+
+  bool
+  ResponseParser::read_line_(const char*& cur, const char* end,
+    String::SubString& line) throw (Exception, eh::Exception)
+  {
+    const char* eol = static_cast<const char*>(
+      std::memchr(cur, '\n', end - cur));
+
+    if (line_.size() + ((eol ? eol : end) - cur) > MAX_LINE_)
+    {
+      Stream::Error ostr;
+      ostr << FNS << "line is longer than " << MAX_LINE_;
+      throw Exception(ostr);
+    }
+
+    if (!eol)
+    {
+      // Keep the partial line till the next portion
+      line_.append(cur, end);
+      cur = end;
+      return false;
+    }
+
+    if (line_.empty())
+    {
+      line = String::SubString(cur, eol);
+    }
+    else
+    {
+      line_.append(cur, eol);
+      line = String::SubString(line_);
+    }
+    cur = eol + 1;
+
+    if (!line.empty() && line[line.size() - 1] == '\r')
+    {
+      line.erase_back(1);
+    }
+    return true;
+  }
+
+  void
+  ResponseParser::status_line_(const String::SubString& line)
+    throw (Exception)
+  {
+    if (line.empty())
+    {
+      // Tolerate empty lines before the status line
+      return;
+    }
+
+    const size_t PREFIX_SIZE = sizeof(HTTP_PREFIX) - 1;
+    if (line.size() < PREFIX_SIZE + 5 ||
+      line.compare(0, PREFIX_SIZE, HTTP_PREFIX) ||
+      line[PREFIX_SIZE] < '0' || line[PREFIX_SIZE] > '9' ||
+      line[PREFIX_SIZE + 1] != ' ' ||
+      !String::StringManip::str_to_int(
+        line.substr(PREFIX_SIZE + 2, 3), status_code_) ||
+      status_code_ < 100 || status_code_ > 999 ||
+      (line.size() > PREFIX_SIZE + 5 && line[PREFIX_SIZE + 5] != ' '))
+    {
+      Stream::Error ostr;
+      ostr << FNS << "invalid status line '" << line << "'";
+      throw Exception(ostr);
+    }
+
+    version_ = line[PREFIX_SIZE] - '0';
+    if (line.size() > PREFIX_SIZE + 6)
+    {
+      line.substr(PREFIX_SIZE + 6).assign_to(reason_);
+    }
+    else
+    {
+      reason_.clear();
+    }
+    interim_ = status_code_ < 200 && status_code_ != 101;
+    headers_.clear();
+    state_ = S_HEADER;
+  }
+
+  void
+  ResponseParser::header_line_(const String::SubString& line)
+    throw (Exception, eh::Exception)
+  {
+    const String::SubString::SizeType COLON = line.find(':');
+    if (COLON == String::SubString::NPOS || !COLON)
+    {
+      Stream::Error ostr;
+      ostr << FNS << "invalid header '" << line << "'";
+      throw Exception(ostr);
+    }
+
+    String::SubString value(line.substr(COLON + 1));
+    String::StringManip::trim(value);
+    headers_.emplace_back(line.substr(0, COLON), value);
+  }
+
+  void
+  ResponseParser::headers_end_() throw (Exception)
+  {
+    if (interim_)
+    {
+      // 100 Continue and alike precede the final response
+      state_ = S_STATUS;
+      return;
+    }
+
+    keep_alive_ = version_ ? true : false;
+    FlatHeaderList::const_iterator itor(headers_.find(CONNECTION.str));
+    if (itor != headers_.end())
+    {
+      keep_alive_ = version_ ? !has_token(itor->value, CLOSE) :
+        has_token(itor->value, KEEP_ALIVE);
+    }
+
+    if (no_body_ || status_code_ == 204 || status_code_ == 304 ||
+      status_code_ < 200)
+    {
+      state_ = S_DONE;
+      return;
+    }
+
+    itor = headers_.find(TRANSFER_ENCODING.str);
+    if (itor != headers_.end())
+    {
+      if (has_token(itor->value, CHUNKED, true))
+      {
+        state_ = S_CHUNK_SIZE;
+        return;
+      }
+    }
+    else
+    {
+      itor = headers_.find(CONTENT_LENGTH.str);
+      if (itor != headers_.end())
+      {
+        if (!String::StringManip::str_to_int(itor->value, remaining_))
+        {
+          Stream::Error ostr;
+          ostr << FNS << "invalid Content-Length '" << itor->value << "'";
+          throw Exception(ostr);
+        }
+        state_ = remaining_ ? S_BODY : S_DONE;
+        return;
+      }
+    }
+
+    // The body lasts till the connection close
+    until_close_ = true;
+    keep_alive_ = false;
+    state_ = S_BODY;
+  }
+
+  void
+  ResponseParser::chunk_size_line_(const String::SubString& line)
+    throw (Exception)
+  {
+    // Chunk extensions are ignored
+    unsigned long long size = 0;
+    const char* cur = line.begin();
+    for (; cur != line.end(); ++cur)
+    {
+      const char CH = *cur;
+      unsigned digit;
+      if (CH >= '0' && CH <= '9')
+      {
+        digit = CH - '0';
+      }
+      else if ((CH | 0x20) >= 'a' && (CH | 0x20) <= 'f')
+      {
+        digit = (CH | 0x20) - 'a' + 10;
+      }
+      else
+      {
+        break;
+      }
+      if (size >> 60)
+      {
+        cur = line.begin();
+        break;
+      }
+      size = (size << 4) | digit;
+    }
+
+    if (cur == line.begin() || (cur != line.end() && *cur != ';' &&
+      *cur != ' ' && *cur != '\t'))
+    {
+      Stream::Error ostr;
+      ostr << FNS << "invalid chunk size '" << line << "'";
+      throw Exception(ostr);
+    }
+
+    remaining_ = size;
+    state_ = size ? S_CHUNK_DATA : S_TRAILER;
+  }
+
+
+  void
+  serialize_request(std::string& buffer, const String::SubString& method,
+    const String::SubString& target, const String::SubString& host,
+    const HeaderList& headers, size_t body_size, bool keep_alive)
+    throw (eh::Exception)
+  {
+    serialize(buffer, method, target, host, headers, body_size, keep_alive);
+  }
+
+  void
+  serialize_request(std::string& buffer, const String::SubString& method,
+    const String::SubString& target, const String::SubString& host,
+    const FlatHeaderList& headers, size_t body_size, bool keep_alive)
+    throw (eh::Exception)
+  {
+    serialize(buffer, method, target, host, headers, body_size, keep_alive);
+  }
+}
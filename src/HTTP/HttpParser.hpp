@@ -0,0 +1,239 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef HTTP_HTTPPARSER_HPP
+#define HTTP_HTTPPARSER_HPP
+
+#include <string>
+
+#include <Generics/Uncopyable.hpp>
+
+#include <HTTP/HttpMisc.hpp>
+#include <HTTP/FlatList.hpp>
+
+
+namespace HTTP
+{
+  /**
+   * Incremental HTTP/1.x response parser.
+   * Data is fed in portions of any size as it arrives from the socket,
+   * parsing resumes in the state the previous portion has left.
+   * Status line and headers are collected into FlatHeaderList, the body
+   * is returned as views over the fed data, so nothing is copied.
+   * Body framing: Content-Length, chunked transfer encoding (trailers
+   * are appended to the headers) and the connection close.
+   * Interim 1xx responses (except 101) are skipped.
+   * Memory is allocated only for lines split between portions and for
+   * headers not fitting into FlatHeaderList, reset() keeps it.
+   */
+  class ResponseParser : private Generics::Uncopyable
+  {
+  public:
+    DECLARE_EXCEPTION(Exception, HTTP::Exception);
+
+    static const size_t DEFAULT_MAX_LINE = 64 * 1024;
+
+    /**
+     * @param max_line maximum length of the status, header and
+     * chunk size lines
+     */
+    explicit
+    ResponseParser(size_t max_line = DEFAULT_MAX_LINE)
+      throw (eh::Exception);
+
+    /**
+     * Prepares the parser for the next response
+     * @param no_body the response has no body (HEAD request)
+     */
+    void
+    reset(bool no_body = false) throw ();
+
+    /**
+     * Parses the portion of the response.
+     * Stops after each part of the body and after the response end,
+     * the rest of the data should be passed again.
+     * @param data the portion of the response
+     * @param body the part of the body found, refers to data
+     * @return number of bytes consumed
+     */
+    size_t
+    parse(const String::SubString& data, String::SubString& body)
+      throw (Exception, eh::Exception);
+
+    /**
+     * Informs the parser the connection has been closed
+     * @return if the response is complete
+     */
+    bool
+    finish() throw ();
+
+    /**
+     * @return if status line and headers are parsed
+     */
+    bool
+    headers_complete() const throw ();
+
+    /**
+     * @return if the whole response is parsed
+     */
+    bool
+    complete() const throw ();
+
+    unsigned
+    status_code() const throw ();
+
+    const std::string&
+    reason() const throw ();
+
+    const FlatHeaderList&
+    headers() const throw ();
+
+    /**
+     * @return if the connection can be used for the next request
+     * after the response end
+     */
+    bool
+    keep_alive() const throw ();
+
+  private:
+    enum State
+    {
+      S_STATUS,
+      S_HEADER,
+      S_BODY,
+      S_CHUNK_SIZE,
+      S_CHUNK_DATA,
+      S_CHUNK_END,
+      S_TRAILER,
+      S_DONE
+    };
+
+    bool
+    read_line_(const char*& cur, const char* end, String::SubString& line)
+      throw (Exception, eh::Exception);
+
+    void
+    status_line_(const String::SubString& line) throw (Exception);
+
+    void
+    header_line_(const String::SubString& line)
+      throw (Exception, eh::Exception);
+
+    void
+    headers_end_() throw (Exception);
+
+    void
+    chunk_size_line_(const String::SubString& line) throw (Exception);
+
+    const size_t MAX_LINE_;
+
+    State state_;
+    bool no_body_;
+    bool interim_;
+    bool until_close_;
+    bool keep_alive_;
+    unsigned version_;
+    unsigned status_code_;
+    unsigned long long remaining_;
+    std::string line_;
+    std::string reason_;
+    FlatHeaderList headers_;
+  };
+
+  /**
+   * Serializes HTTP/1.1 request line and headers.
+   * Host, Content-Length and Connection headers are added
+   * unless they are present in headers.
+   * @param buffer string to append the request to
+   * @param method request method
+   * @param target request target (path and query or absolute URL)
+   * @param host value for Host header
+   * @param headers request headers
+   * @param body_size size of the body following the headers
+   * @param keep_alive if the connection should be kept
+   */
+  void
+  serialize_request(std::string& buffer, const String::SubString& method,
+    const String::SubString& target, const String::SubString& host,
+    const HeaderList& headers, size_t body_size, bool keep_alive)
+    throw (eh::Exception);
+
+  void
+  serialize_request(std::string& buffer, const String::SubString& method,
+    const String::SubString& target, const String::SubString& host,
+    const FlatHeaderList& headers, size_t body_size, bool keep_alive)
+    throw (eh::Exception);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace HTTP
+{
+  //
+  // ResponseParser class
+  //
+
+  inline
+  bool
+  ResponseParser::headers_complete() const throw ()
+  {
+    return state_ > S_HEADER;
+  }
+
+  inline
+  bool
+  ResponseParser::complete() const throw ()
+  {
+    return state_ == S_DONE;
+  }
+
+  inline
+  unsigned
+  ResponseParser::status_code() const throw ()
+  {
+    return status_code_;
+  }
+
+  inline
+  const std::string&
+  ResponseParser::reason() const throw ()
+  {
+    return reason_;
+  }
+
+  inline
+  const FlatHeaderList&
+  ResponseParser::headers() const throw ()
+  {
+    return headers_;
+  }
+
+  inline
+  bool
+  ResponseParser::keep_alive() const throw ()
+  {
+    return keep_alive_;
+  }
+}
+
+#endif
@@ -20,13 +20,58 @@
 
 
 
+#include <errno.h>
+
 #include <eh/Errno.hpp>
 
+#include <Sync/Condition.hpp>
+
 #include <Generics/ArrayAutoPtr.hpp>
 #include <Generics/Rand.hpp>
+#include <Generics/ThreadRunner.hpp>
 
 #include <Logger/FileLogger.hpp>
+#include <Logger/TimeCache.hpp>
+
 
+namespace
+{
+  /**
+   * Writes all of the data, skipping written part of iov
+   * @param fd file descriptor
+   * @param iov data to write
+   * @param count number of iov elements
+   * @return false on error, errno is set
+   */
+  bool
+  write_all(int fd, iovec*& iov, int& count) throw ()
+  {
+    while (count)
+    {
+      ssize_t written = ::writev(fd, iov, count);
+      if (written < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        return false;
+      }
+      while (count && static_cast<size_t>(written) >= iov->iov_len)
+      {
+        written -= iov->iov_len;
+        ++iov;
+        --count;
+      }
+      if (count)
+      {
+        iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+        iov->iov_len -= written;
+      }
+    }
+    return true;
+  }
+}
 
 namespace Logging
 {
@@ -34,6 +79,483 @@ namespace Logging
   {
     namespace Helper
     {
+      //
+      // Config class
+      //
+
+      const Generics::Time Config::DEFAULT_FLUSH_PERIOD(0, 100000);
+
+
+      //
+      // Handler::AsyncWriter class
+      //
+
+      /**
+       * Bounded ring of formatted records and the thread writing them.
+       * The ring has single producer (serialized publish() calls) and
+       * single consumer (the writer thread), positions are advanced
+       * without locks. The mutex is taken only for sleeping and wake ups.
+       */
+      class Handler::AsyncWriter : private Generics::Uncopyable
+      {
+      public:
+        AsyncWriter(Handler& handler, size_t buffer_size,
+          const Generics::Time& flush_period,
+          OverflowPolicy overflow_policy)
+          throw (eh::Exception);
+
+        /**
+         * Writes all of the queued records and stops the thread
+         */
+        ~AsyncWriter() throw ();
+
+        void
+        push(const LogRecord& record, const char* line, size_t size)
+          throw (Exception, eh::Exception);
+
+        void
+        flush() throw (Exception, eh::Exception);
+
+        AsyncStats
+        stats() const throw ();
+
+      private:
+        struct RecordHeader
+        {
+          size_t size;
+          Generics::Time time;
+          Generics::Time::TimeZone time_zone;
+        };
+
+        class Job : public Generics::ThreadJob
+        {
+        public:
+          explicit
+          Job(AsyncWriter& writer) throw ();
+
+          virtual
+          void
+          work() throw ();
+
+        protected:
+          virtual
+          ~Job() throw ();
+
+        private:
+          AsyncWriter& writer_;
+        };
+
+        /// Marks the unused end of the ring
+        static const size_t SKIP = ~static_cast<size_t>(0);
+        static const size_t ALIGN = sizeof(void*) * 2;
+        static const int MAX_IOV = 64;
+
+        static
+        size_t
+        record_size_(size_t size) throw ();
+
+        size_t
+        required_space_(unsigned long long write_pos, size_t record_size)
+          const throw ();
+
+        bool
+        has_space_(size_t record_size) const throw ();
+
+        bool
+        try_push_(const LogRecord& record, const char* line, size_t size,
+          size_t record_size)
+          throw (Exception, eh::Exception);
+
+        void
+        wait_progress_(unsigned long long write_pos, size_t record_size)
+          throw (Exception, eh::Exception);
+
+        bool
+        write_required_() const throw ();
+
+        void
+        work_() throw ();
+
+        void
+        write_records_() throw ();
+
+        void
+        write_batch_(iovec* iov, int count, unsigned long long records,
+          unsigned long long read_pos)
+          throw ();
+
+        Handler& handler_;
+        const size_t CAPACITY_;
+        const Generics::Time FLUSH_PERIOD_;
+        const OverflowPolicy OVERFLOW_POLICY_;
+        Generics::ArrayChar buffer_;
+
+        Sync::Condition condition_;
+        bool stop_;
+        unsigned waiters_;
+
+        unsigned long long write_pos_;
+        char padding_[64];
+        unsigned long long read_pos_;
+
+        AsyncStats stats_;
+
+        Generics::ThreadRunner runner_;
+      };
+
+      Handler::AsyncWriter::Job::Job(AsyncWriter& writer) throw ()
+        : writer_(writer)
+      {
+      }
+
+      Handler::AsyncWriter::Job::~Job() throw ()
+      {
+      }
+
+      void
+      Handler::AsyncWriter::Job::work() throw ()
+      {
+        writer_.work_();
+      }
+
+      Handler::AsyncWriter::AsyncWriter(Handler& handler,
+        size_t buffer_size, const Generics::Time& flush_period,
+        OverflowPolicy overflow_policy)
+        throw (eh::Exception)
+        : handler_(handler),
+          CAPACITY_((buffer_size + ALIGN - 1) / ALIGN * ALIGN),
+          FLUSH_PERIOD_(flush_period), OVERFLOW_POLICY_(overflow_policy),
+          buffer_(CAPACITY_), stop_(false), waiters_(0),
+          write_pos_(0), read_pos_(0),
+          runner_(Generics::ThreadJob_var(new Job(*this)), 1)
+      {
+        stats_.written = 0;
+        stats_.dropped = 0;
+        stats_.blocked = 0;
+        stats_.failed = 0;
+        runner_.start();
+      }
+
+      Handler::AsyncWriter::~AsyncWriter() throw ()
+      {
+        try
+        {
+          {
+            Sync::ConditionalGuard guard(condition_);
+            stop_ = true;
+          }
+          condition_.broadcast();
+        }
+        catch (const eh::Exception&)
+        {
+        }
+        runner_.wait_for_completion();
+      }
+
+      size_t
+      Handler::AsyncWriter::record_size_(size_t size) throw ()
+      {
+        return (sizeof(RecordHeader) + size + ALIGN - 1) / ALIGN * ALIGN;
+      }
+
+      size_t
+      Handler::AsyncWriter::required_space_(unsigned long long write_pos,
+        size_t record_size) const throw ()
+      {
+        // The record is never split, the ring end is skipped if required
+        const size_t TAIL = CAPACITY_ - write_pos % CAPACITY_;
+        return TAIL < record_size ? TAIL + record_size : record_size;
+      }
+
+      bool
+      Handler::AsyncWriter::has_space_(size_t record_size) const throw ()
+      {
+        const unsigned long long WRITE_POS =
+          __atomic_load_n(&write_pos_, __ATOMIC_ACQUIRE);
+        return CAPACITY_ -
+          (WRITE_POS - __atomic_load_n(&read_pos_, __ATOMIC_SEQ_CST)) >=
+          required_space_(WRITE_POS, record_size);
+      }
+
+      void
+      Handler::AsyncWriter::push(const LogRecord& record, const char* line,
+        size_t size)
+        throw (Exception, eh::Exception)
+      {
+        const size_t RECORD_SIZE = record_size_(size);
+        if (RECORD_SIZE > CAPACITY_)
+        {
+          __atomic_add_fetch(&stats_.dropped, 1, __ATOMIC_RELAXED);
+          return;
+        }
+
+        for (bool waited = false;
+          !try_push_(record, line, size, RECORD_SIZE); waited = true)
+        {
+          if (OVERFLOW_POLICY_ == OP_DROP)
+          {
+            __atomic_add_fetch(&stats_.dropped, 1, __ATOMIC_RELAXED);
+            return;
+          }
+          if (!waited)
+          {
+            __atomic_add_fetch(&stats_.blocked, 1, __ATOMIC_RELAXED);
+          }
+          wait_progress_(0, RECORD_SIZE);
+        }
+      }
+
+      bool
+      Handler::AsyncWriter::try_push_(const LogRecord& record,
+        const char* line, size_t size, size_t record_size)
+        throw (Exception, eh::Exception)
+      {
+        const unsigned long long WRITE_POS = write_pos_;
+        const unsigned long long USED =
+          WRITE_POS - __atomic_load_n(&read_pos_, __ATOMIC_ACQUIRE);
+        const size_t REQUIRED = required_space_(WRITE_POS, record_size);
+        if (CAPACITY_ - USED < REQUIRED)
+        {
+          return false;
+        }
+
+        char* buf = buffer_.get();
+        size_t offset = WRITE_POS % CAPACITY_;
+        if (REQUIRED != record_size)
+        {
+          if (CAPACITY_ - offset >= sizeof(RecordHeader))
+          {
+            RecordHeader skip;
+            skip.size = SKIP;
+            memcpy(buf + offset, &skip, sizeof(skip));
+          }
+          offset = 0;
+        }
+
+        RecordHeader header;
+        header.size = size;
+        header.time = record.time;
+        header.time_zone = record.time_zone;
+        memcpy(buf + offset, &header, sizeof(header));
+        memcpy(buf + offset + sizeof(header), line, size);
+
+        __atomic_store_n(&write_pos_, WRITE_POS + REQUIRED,
+          __ATOMIC_RELEASE);
+
+        // Wake up the writer at the half of the buffer without waiting
+        // for the flush period
+        if (FLUSH_PERIOD_ == Generics::Time::ZERO ||
+          (USED < CAPACITY_ / 2 && USED + REQUIRED >= CAPACITY_ / 2))
+        {
+          Sync::ConditionalGuard guard(condition_);
+          condition_.signal();
+        }
+
+        return true;
+      }
+
+      void
+      Handler::AsyncWriter::wait_progress_(unsigned long long write_pos,
+        size_t record_size)
+        throw (Exception, eh::Exception)
+      {
+        Sync::ConditionalGuard guard(condition_);
+        __atomic_add_fetch(&waiters_, 1, __ATOMIC_SEQ_CST);
+        try
+        {
+          condition_.broadcast();
+          while (record_size ? !has_space_(record_size) :
+            __atomic_load_n(&read_pos_, __ATOMIC_SEQ_CST) < write_pos)
+          {
+            guard.wait();
+          }
+        }
+        catch (...)
+        {
+          __atomic_sub_fetch(&waiters_, 1, __ATOMIC_SEQ_CST);
+          throw;
+        }
+        __atomic_sub_fetch(&waiters_, 1, __ATOMIC_SEQ_CST);
+      }
+
+      void
+      Handler::AsyncWriter::flush() throw (Exception, eh::Exception)
+      {
+        const unsigned long long WRITE_POS =
+          __atomic_load_n(&write_pos_, __ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&read_pos_, __ATOMIC_ACQUIRE) < WRITE_POS)
+        {
+          wait_progress_(WRITE_POS, 0);
+        }
+      }
+
+      AsyncStats
+      Handler::AsyncWriter::stats() const throw ()
+      {
+        AsyncStats stats;
+        stats.written = __atomic_load_n(&stats_.written, __ATOMIC_RELAXED);
+        stats.dropped = __atomic_load_n(&stats_.dropped, __ATOMIC_RELAXED);
+        stats.blocked = __atomic_load_n(&stats_.blocked, __ATOMIC_RELAXED);
+        stats.failed = __atomic_load_n(&stats_.failed, __ATOMIC_RELAXED);
+        return stats;
+      }
+
+      bool
+      Handler::AsyncWriter::write_required_() const throw ()
+      {
+        const unsigned long long USED =
+          __atomic_load_n(&write_pos_, __ATOMIC_ACQUIRE) - read_pos_;
+        return USED >= CAPACITY_ / 2 ||
+          (USED && (FLUSH_PERIOD_ == Generics::Time::ZERO ||
+            __atomic_load_n(&waiters_, __ATOMIC_SEQ_CST)));
+      }
+
+      void
+      Handler::AsyncWriter::work_() throw ()
+      {
+        for (bool stop = false; !stop; )
+        {
+          try
+          {
+            Sync::ConditionalGuard guard(condition_);
+            stop = stop_;
+            if (!stop && !write_required_())
+            {
+              if (FLUSH_PERIOD_ == Generics::Time::ZERO)
+              {
+                guard.wait();
+              }
+              else
+              {
+                guard.timed_wait(&FLUSH_PERIOD_, true);
+              }
+              stop = stop_;
+            }
+          }
+          catch (const eh::Exception&)
+          {
+          }
+
+          write_records_();
+        }
+      }
+
+      void
+      Handler::AsyncWriter::write_records_() throw ()
+      {
+        const char* buf = buffer_.get();
+        const unsigned long long WRITE_POS =
+          __atomic_load_n(&write_pos_, __ATOMIC_ACQUIRE);
+        unsigned long long read_pos = read_pos_;
+        bool checked = false;
+
+        iovec iov[MAX_IOV];
+        int count = 0;
+
+        while (read_pos != WRITE_POS)
+        {
+          const size_t OFFSET = read_pos % CAPACITY_;
+          const size_t TAIL = CAPACITY_ - OFFSET;
+          RecordHeader header;
+          if (TAIL >= sizeof(header))
+          {
+            memcpy(&header, buf + OFFSET, sizeof(header));
+          }
+          if (TAIL < sizeof(header) || header.size == SKIP)
+          {
+            read_pos += TAIL;
+            continue;
+          }
+
+          // Rotation policies see the records in the same order as
+          // in the synchronous mode, the file size includes the records
+          // not yet written
+          try
+          {
+            if (handler_.log_time_ < header.time)
+            {
+              handler_.log_time_ = header.time;
+            }
+
+            const Generics::ExtendedTime& TIME(
+              TimeCache::get_time(header.time, header.time_zone));
+            bool rotated;
+            if (!checked)
+            {
+              rotated = handler_.rotate_if_required(TIME);
+              checked = true;
+            }
+            else if ((rotated = handler_.need_rotation_()))
+            {
+              write_batch_(iov, count, count, read_pos);
+              count = 0;
+              handler_.rotate(TIME);
+            }
+            if (rotated && handler_.outfile_)
+            {
+              ::fstat(fileno(handler_.outfile_), &handler_.file_stat_);
+            }
+          }
+          catch (const eh::Exception&)
+          {
+            // The file will be reopened on the write
+          }
+
+          iov[count].iov_base = const_cast<char*>(buf) + OFFSET +
+            sizeof(header);
+          iov[count].iov_len = header.size;
+          ++count;
+          handler_.file_stat_.st_size += header.size;
+          read_pos += record_size_(header.size);
+
+          if (count == MAX_IOV)
+          {
+            write_batch_(iov, count, count, read_pos);
+            count = 0;
+          }
+        }
+
+        write_batch_(iov, count, count, read_pos);
+      }
+
+      void
+      Handler::AsyncWriter::write_batch_(iovec* iov, int count,
+        unsigned long long records, unsigned long long read_pos)
+        throw ()
+      {
+        if (count)
+        {
+          try
+          {
+            handler_.write_(iov, count);
+            __atomic_add_fetch(&stats_.written, records, __ATOMIC_RELAXED);
+          }
+          catch (const eh::Exception&)
+          {
+            __atomic_add_fetch(&stats_.failed, records, __ATOMIC_RELAXED);
+          }
+        }
+
+        if (read_pos == read_pos_)
+        {
+          return;
+        }
+
+        __atomic_store_n(&read_pos_, read_pos, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&waiters_, __ATOMIC_SEQ_CST))
+        {
+          try
+          {
+            Sync::ConditionalGuard guard(condition_);
+            condition_.broadcast();
+          }
+          catch (const eh::Exception&)
+          {
+          }
+        }
+      }
+
+
       //
       // Handler class
       //
@@ -83,6 +605,39 @@ namespace Logging
           eh::throw_errno_exception<Exception>(FNE,
             "failed to open file '", cur_file_name_, "'");
         }
+
+        if (config.async_buffer_size)
+        {
+          async_writer_.reset(new AsyncWriter(*this,
+            config.async_buffer_size, config.flush_period,
+            config.overflow_policy));
+        }
+      }
+
+      Handler::~Handler() throw ()
+      {
+        async_writer_.reset();
+
+        if (outfile_)
+        {
+          ::fclose(outfile_);
+          outfile_ = 0;
+        }
+      }
+
+      bool
+      Handler::need_rotation_() throw (Exception, eh::Exception)
+      {
+        for (Policies::PolicyList::iterator it = POLICIES_.begin();
+          it != POLICIES_.end(); ++it)
+        {
+          if ((*it)->need_rotation(*this))
+          {
+            return true;
+          }
+        }
+
+        return false;
       }
 
       bool
@@ -111,14 +666,10 @@ namespace Logging
           }
         }
 
-        for (Policies::PolicyList::iterator it = POLICIES_.begin();
-          it != POLICIES_.end(); ++it)
+        if (need_rotation_())
         {
-          if ((*it)->need_rotation(*this))
-          {
-            rotate(time);
-            return true;
-          }
+          rotate(time);
+          return true;
         }
 
         return false;
@@ -128,12 +679,27 @@ namespace Logging
       Handler::publish(const LogRecord& record)
         throw (Exception, eh::Exception)
       {
+        if (async_writer_.get())
+        {
+          FormatWrapper::Result line(formatter_.format(record));
+          if (!line.get())
+          {
+            Stream::Error ostr;
+            ostr << FNS << "failed to format log record";
+            throw Exception(ostr);
+          }
+
+          async_writer_->push(record, line.get(), strlen(line.get()));
+          return;
+        }
+
         if (log_time_ < record.time)
         {
           log_time_ = record.time;
         }
 
-        rotate_if_required(record.time.get_time(record.time_zone));
+        rotate_if_required(
+          TimeCache::get_time(record.time, record.time_zone));
 
         FormatWrapper::Result line(formatter_.format(record));
         if (!line.get())
@@ -170,6 +736,55 @@ namespace Logging
         }
       }
 
+      void
+      Handler::flush() throw (Exception, eh::Exception)
+      {
+        if (async_writer_.get())
+        {
+          async_writer_->flush();
+        }
+      }
+
+      AsyncStats
+      Handler::async_stats() const throw ()
+      {
+        if (async_writer_.get())
+        {
+          return async_writer_->stats();
+        }
+
+        AsyncStats stats = { 0, 0, 0, 0 };
+        return stats;
+      }
+
+      void
+      Handler::write_(iovec* iov, int count) throw (Exception, eh::Exception)
+      {
+        if (outfile_ && write_all(fileno(outfile_), iov, count))
+        {
+          return;
+        }
+
+        if (outfile_)
+        {
+          std::fclose(outfile_);
+          outfile_ = 0;
+        }
+        outfile_ = std::fopen(cur_file_name_, "a");
+        if (!outfile_)
+        {
+          eh::throw_errno_exception<Exception>(FNE,
+            "failed to reopen file '", cur_file_name_, "'");
+        }
+
+        if (!write_all(fileno(outfile_), iov, count))
+        {
+          eh::throw_errno_exception<Exception>(FNE,
+            "permanently fail to log message to file '",
+            cur_file_name_, "'");
+        }
+      }
+
       void
       Handler::rotate(const Generics::ExtendedTime& time)
       throw (Exception, eh::Exception)
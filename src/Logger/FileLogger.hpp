@@ -25,6 +25,9 @@
 #define LOGGER_FILE_LOGGER_HPP
 
 #include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <memory>
 
 #include <ReferenceCounting/List.hpp>
 
@@ -213,11 +216,38 @@ namespace Logging
 
     namespace Helper
     {
+      /**
+       * Behaviour of the asynchronous handler when its buffer is full
+       */
+      enum OverflowPolicy
+      {
+        OP_DROP, ///< drop the record
+        OP_BLOCK ///< wait until the writer frees enough space
+      };
+
+      /**
+       * Counters of the asynchronous handler
+       */
+      struct AsyncStats
+      {
+        /// Records written into the file
+        unsigned long long written;
+        /// Records dropped because of the buffer overflow
+        unsigned long long dropped;
+        /// Records which had to wait for the free space in the buffer
+        unsigned long long blocked;
+        /// Records lost because of the file errors
+        unsigned long long failed;
+      };
+
       /**
        * Configuration for File Handler
        */
       struct Config
       {
+        /// Default period of the asynchronous buffer flushing
+        static const Generics::Time DEFAULT_FLUSH_PERIOD;
+
         /**
          * Constructor
          */
@@ -232,11 +262,24 @@ namespace Logging
         unsigned from_num;
         unsigned order_num;
         size_t preallocated_size;
+        /// Size of the buffer of formatted records in bytes,
+        /// zero - write records synchronously in publish()
+        size_t async_buffer_size;
+        /// Maximum time records stay in the buffer unwritten,
+        /// zero - wake up the writer for each record
+        Generics::Time flush_period;
+        /// Behaviour on the buffer overflow
+        OverflowPolicy overflow_policy;
       };
 
       /**
        * File handler.
        * Writes formatted log line into file specified.
+       * In the asynchronous mode publish() only puts the formatted record
+       * into the bounded buffer, the background thread writes records
+       * by batches with writev(2) and performs rotations.
+       * As in the synchronous mode calls of publish() must be serialized
+       * by the caller.
        */
       class Handler :
         public virtual Logging::Handler,
@@ -253,6 +296,7 @@ namespace Logging
 
         /**
          * Writes record into the file, rotating file if needed.
+         * In the asynchronous mode queues the record for the writer.
          * @param record log record to publish
          */
         virtual
@@ -260,6 +304,20 @@ namespace Logging
         publish(const LogRecord& record)
           throw (Exception, eh::Exception);
 
+        /**
+         * Waits until all of the published records are written.
+         * Does nothing in the synchronous mode.
+         */
+        void
+        flush() throw (Exception, eh::Exception);
+
+        /**
+         * Counters of the asynchronous mode
+         * @return counters values, zeroes in the synchronous mode
+         */
+        AsyncStats
+        async_stats() const throw ();
+
         /**
          * Rotates a file.
          * @param time current time
@@ -310,12 +368,30 @@ namespace Logging
         get_time_zone() const throw ();
 
       protected:
+        class AsyncWriter;
+
         /**
          * Destructor
+         * Writes all of the queued records in the asynchronous mode
          */
         virtual
         ~Handler() throw ();
 
+        /**
+         * Checks rotation policies
+         * @return whether or not the file should be rotated
+         */
+        bool
+        need_rotation_() throw (Exception, eh::Exception);
+
+        /**
+         * Writes the data to the file reopening it once on failure
+         * @param iov data to write, modified on the partial write
+         * @param count number of iov elements
+         */
+        void
+        write_(iovec* iov, int count) throw (Exception, eh::Exception);
+
       protected:
         typedef char FileName[MAXPATHLEN];
 
@@ -334,6 +410,8 @@ namespace Logging
         Generics::Time log_create_time_;
         Generics::Time log_time_;
         struct stat file_stat_;
+
+        std::unique_ptr<AsyncWriter> async_writer_;
       };
     }
 
@@ -436,7 +514,8 @@ namespace Logging
         : file_name(file_name), policies(policies),
           formatter(ReferenceCounting::add_ref(formatter)),
           extended_name_format(false), from_num(1), order_num(1),
-          preallocated_size(preallocated_size)
+          preallocated_size(preallocated_size), async_buffer_size(0),
+          flush_period(DEFAULT_FLUSH_PERIOD), overflow_policy(OP_BLOCK)
       {
       }
 
@@ -445,16 +524,6 @@ namespace Logging
       // Handler class
       //
 
-      inline
-      Handler::~Handler() throw ()
-      {
-        if (outfile_)
-        {
-          ::fclose(outfile_);
-          outfile_ = 0;
-        }
-      }
-
       inline
       Generics::Time
       Handler::log_create_time() const throw ()
@@ -28,6 +28,7 @@
 #include <Generics/ArrayAutoPtr.hpp>
 
 #include <Logger/SimpleLogger.hpp>
+#include <Logger/TimeCache.hpp>
 
 
 namespace
@@ -201,16 +202,13 @@ namespace Logging
 
       if (log_time_)
       {
-        const Generics::ExtendedTime& record_time(
-          record.time.get_time(record.time_zone));
-
-        strftime(buff.get(), buff.size(), "%a %d %b %Y", &record_time);
-        buff.advance();
-
-        snprintf(buff.get(), buff.size(), " %02d:%02d:%02d:%06d ",
-          record_time.tm_hour, record_time.tm_min, record_time.tm_sec,
-          record_time.tm_usec);
-        buff.advance(17);
+        const String::SubString RECORD_TIME(
+          TimeCache::format(record.time, record.time_zone));
+        char* const BUFF = buff.get();
+        assert(buff.size() >= RECORD_TIME.size() + 1);
+        memcpy(BUFF, RECORD_TIME.data(), RECORD_TIME.size());
+        BUFF[RECORD_TIME.size()] = ' ';
+        buff.advance(RECORD_TIME.size() + 1);
       }
 
       if (log_code_)
@@ -0,0 +1,126 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Logger/TimeCache.hpp>
+
+
+namespace
+{
+  const size_t USEC_DIGITS = 6;
+}
+
+namespace Logging
+{
+  //
+  // TimeCache class
+  //
+
+  Sync::Key<TimeCache::Entry> TimeCache::key_(destroy_);
+
+  TimeCache::Entry::Entry() throw ()
+    : valid(false), sec(0), time_zone(Generics::Time::TZ_GMT),
+      time(tm(), 0, Generics::Time::TZ_GMT), formatted(false),
+      usec_offset(0)
+  {
+  }
+
+  void
+  TimeCache::destroy_(void* entry) throw ()
+  {
+    delete static_cast<Entry*>(entry);
+  }
+
+  TimeCache::Entry&
+  TimeCache::entry_(const Generics::Time& time,
+    Generics::Time::TimeZone time_zone)
+    throw (eh::Exception)
+  {
+    Entry* entry = key_.get_data();
+    if (!entry)
+    {
+      entry = new Entry;
+      try
+      {
+        key_.set_data(entry);
+      }
+      catch (...)
+      {
+        delete entry;
+        throw;
+      }
+    }
+
+    if (!entry->valid || entry->sec != time.tv_sec ||
+      entry->time_zone != time_zone)
+    {
+      entry->time = time.get_time(time_zone);
+      entry->sec = time.tv_sec;
+      entry->time_zone = time_zone;
+      entry->valid = true;
+      entry->formatted = false;
+    }
+    else
+    {
+      entry->time.tm_usec = time.tv_usec;
+    }
+
+    return *entry;
+  }
+
+  const Generics::ExtendedTime&
+  TimeCache::get_time(const Generics::Time& time,
+    Generics::Time::TimeZone time_zone)
+    throw (eh::Exception)
+  {
+    return entry_(time, time_zone).time;
+  }
+
+  String::SubString
+  TimeCache::format(const Generics::Time& time,
+    Generics::Time::TimeZone time_zone)
+    throw (eh::Exception)
+  {
+    Entry& entry = entry_(time, time_zone);
+
+    if (!entry.formatted)
+    {
+      size_t size = strftime(entry.text, sizeof(entry.text) - USEC_DIGITS,
+        "%a %d %b %Y", &entry.time);
+      size += snprintf(entry.text + size,
+        sizeof(entry.text) - USEC_DIGITS - size, " %02d:%02d:%02d:",
+        entry.time.tm_hour, entry.time.tm_min, entry.time.tm_sec);
+      entry.usec_offset = size;
+      entry.formatted = true;
+    }
+
+    char* usec = entry.text + entry.usec_offset + USEC_DIGITS;
+    for (int value = entry.time.tm_usec, i = USEC_DIGITS; i; i--)
+    {
+      *--usec = '0' + value % 10;
+      value /= 10;
+    }
+
+    return String::SubString(entry.text, entry.usec_offset + USEC_DIGITS);
+  }
+}
@@ -0,0 +1,92 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef LOGGER_TIME_CACHE_HPP
+#define LOGGER_TIME_CACHE_HPP
+
+#include <Sync/Key.hpp>
+
+#include <Generics/Time.hpp>
+
+#include <String/SubString.hpp>
+
+
+namespace Logging
+{
+  /**
+   * Per thread cache of the last logged second.
+   * Records of the same second reuse the broken down time and
+   * the formatted date and time, only microseconds are patched.
+   */
+  class TimeCache
+  {
+  public:
+    /**
+     * Breaks time down like Time::get_time() does
+     * @param time time to convert
+     * @param time_zone time zone to use
+     * @return broken down time valid until the next call in the thread
+     */
+    static
+    const Generics::ExtendedTime&
+    get_time(const Generics::Time& time, Generics::Time::TimeZone time_zone)
+      throw (eh::Exception);
+
+    /**
+     * Formats time as "%a %d %b %Y %H:%M:%S:<microseconds>"
+     * @param time time to format
+     * @param time_zone time zone to use
+     * @return formatted time valid until the next call in the thread
+     */
+    static
+    String::SubString
+    format(const Generics::Time& time, Generics::Time::TimeZone time_zone)
+      throw (eh::Exception);
+
+  private:
+    struct Entry
+    {
+      Entry() throw ();
+
+      bool valid;
+      time_t sec;
+      Generics::Time::TimeZone time_zone;
+      Generics::ExtendedTime time;
+      /// Formatting of the second is postponed until the first format()
+      bool formatted;
+      char text[64];
+      size_t usec_offset;
+    };
+
+    static
+    Entry&
+    entry_(const Generics::Time& time, Generics::Time::TimeZone time_zone)
+      throw (eh::Exception);
+
+    static
+    void
+    destroy_(void* entry) throw ();
+
+    static Sync::Key<Entry> key_;
+  };
+}
+
+#endif
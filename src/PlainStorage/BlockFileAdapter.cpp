@@ -152,6 +152,116 @@ namespace PlainStorage
         
   } // namespace
 
+  //
+  // ReadBlockFileAdapter::SegmentMap
+  //
+
+  ReadBlockFileAdapter::SegmentMap::SegmentMap(int prot,
+    std::size_t segment_blocks, std::size_t map_page_size)
+    throw (eh::Exception)
+    : PROT_(prot), SEGMENT_BLOCKS_(segment_blocks ? segment_blocks : 1),
+      MAP_PAGE_SIZE_(map_page_size), table_(0)
+  {
+  }
+
+  ReadBlockFileAdapter::SegmentMap::~SegmentMap() throw ()
+  {
+    if (table_)
+    {
+      // The newest table holds all of the segments
+      for (std::size_t i = 0; i < table_->size; i++)
+      {
+        if (table_->segments[i])
+        {
+          ::munmap(table_->segments[i], SEGMENT_BLOCKS_ * MAP_PAGE_SIZE_);
+        }
+      }
+    }
+    for (std::vector<Table*>::iterator itor = tables_.begin();
+      itor != tables_.end(); ++itor)
+    {
+      delete [] (*itor)->segments;
+      delete *itor;
+    }
+  }
+
+  void*
+  ReadBlockFileAdapter::SegmentMap::resolve(int file_desc,
+    BlockIndex index) throw (PosixException, eh::Exception)
+  {
+    const std::size_t SEGMENT = index / SEGMENT_BLOCKS_;
+    const std::size_t OFFSET = (index % SEGMENT_BLOCKS_) * MAP_PAGE_SIZE_;
+
+    Table* table = __atomic_load_n(&table_, __ATOMIC_ACQUIRE);
+    if (table && SEGMENT < table->size)
+    {
+      void* segment =
+        __atomic_load_n(&table->segments[SEGMENT], __ATOMIC_ACQUIRE);
+      if (segment)
+      {
+        return static_cast<char*>(segment) + OFFSET;
+      }
+    }
+
+    return static_cast<char*>(map_segment_(file_desc, SEGMENT)) + OFFSET;
+  }
+
+  void*
+  ReadBlockFileAdapter::SegmentMap::map_segment_(int file_desc,
+    std::size_t segment) throw (PosixException, eh::Exception)
+  {
+    Sync::PosixGuard guard(mutex_);
+
+    if (!table_ || segment >= table_->size)
+    {
+      // Grow the table, readers of the old one will come here
+      std::size_t size = table_ ? table_->size * 2 : 16;
+      if (size <= segment)
+      {
+        size = segment + 1;
+      }
+
+      std::unique_ptr<Table> table(new Table);
+      table->size = size;
+      table->segments = new void*[size]();
+      if (table_)
+      {
+        std::copy(table_->segments, table_->segments + table_->size,
+          table->segments);
+      }
+      try
+      {
+        tables_.push_back(table.get());
+      }
+      catch (...)
+      {
+        delete [] table->segments;
+        throw;
+      }
+      __atomic_store_n(&table_, table.release(), __ATOMIC_RELEASE);
+    }
+
+    void* mem_ptr = table_->segments[segment];
+    if (!mem_ptr)
+    {
+      const std::size_t SEGMENT_SIZE = SEGMENT_BLOCKS_ * MAP_PAGE_SIZE_;
+      mem_ptr = ::mmap(0, SEGMENT_SIZE, PROT_, MAP_SHARED, file_desc,
+        static_cast<off64_t>(segment) * SEGMENT_SIZE);
+      if (mem_ptr == MAP_FAILED)
+      {
+        eh::throw_errno_exception<PosixException>(FNE,
+          "Can't map to memory file segment: pos = ",
+          static_cast<off64_t>(segment) * SEGMENT_SIZE,
+          ", size = ", SEGMENT_SIZE);
+      }
+      __atomic_store_n(&table_->segments[segment], mem_ptr,
+        __ATOMIC_RELEASE);
+    }
+
+    return mem_ptr;
+  }
+
+
   //
   // ReadBlockFileAdapter::ReadBlockStruct
   //
@@ -284,15 +394,31 @@ namespace PlainStorage
     BlockFileAdapterContext context(
       file_desc_, file_size_, map_page_size_, block_size_);
     open_file(filename, O_RDONLY, 0, context);
+    init_segment_map_(PROT_READ);
   }
 
   void*
   ReadBlockFileAdapter::read_resolve_block_(BlockIndex block_index)
     throw (PosixException, eh::Exception)
   {
+    if (segment_map_.get())
+    {
+      return segment_map_->resolve(file_desc_, block_index);
+    }
     return resolve_block(block_index, file_desc_, PROT_READ, map_page_size_);
   }
 
+  void
+  ReadBlockFileAdapter::init_segment_map_(int prot) throw (eh::Exception)
+  {
+    if (segment_size_)
+    {
+      segment_map_.reset(new SegmentMap(prot,
+        (segment_size_ + map_page_size_ - 1) / map_page_size_,
+        map_page_size_));
+    }
+  }
+
   void
   WriteBlockFileAdapter::open_file_(const char* filename, OpenType open_type)
     throw (BadParam, PosixException, eh::Exception)
@@ -314,12 +440,18 @@ namespace PlainStorage
       ostr << FNS << "Not defined open mode";
       throw ReadBlockFileAdapter::BadParam(ostr);
     }
+    init_segment_map_(PROT_READ | PROT_WRITE);
   }
 
   void
   ReadBlockFileAdapter::read_unresolve_block_(void* mem_ptr)
     throw (PosixException, eh::Exception)
   {
+    if (segment_map_.get())
+    {
+      // Segments stay mapped until destruction
+      return;
+    }
     unresolve_block(mem_ptr, map_page_size_);
   }
 
@@ -337,6 +469,10 @@ namespace PlainStorage
       need_to_init = true;
     }
 
+    if (segment_map_.get())
+    {
+      return segment_map_->resolve(file_desc_, block_index);
+    }
     return resolve_block(block_index, file_desc_, PROT_READ | PROT_WRITE,
       map_page_size_);
   }
@@ -345,6 +481,10 @@ namespace PlainStorage
   WriteBlockFileAdapter::write_unresolve_block_(void* mem_ptr)
     throw (PosixException, eh::Exception)
   {
+    if (segment_map_.get())
+    {
+      return;
+    }
     if (::munmap(mem_ptr, map_page_size_) == -1)
     {
       eh::throw_errno_exception<PosixException>(
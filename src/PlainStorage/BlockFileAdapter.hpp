@@ -26,8 +26,15 @@
 #include <inttypes.h>
 #include <sys/types.h>
 
+#include <memory>
+#include <vector>
+
+#include <Sync/PosixLock.hpp>
+
 #include <ReferenceCounting/ReferenceCounting.hpp>
 
+#include <Generics/Uncopyable.hpp>
+
 namespace PlainStorage
 {
   typedef u_int32_t BlockIndex;
@@ -38,6 +45,10 @@ namespace PlainStorage
    * by next equation:
    * PageSize = ::getpagesize() * ceil(RequestedBlockSize / ::getpagesize())
    * Adapter allow read file by some portions in several stages
+   * By default every block is mapped on resolution and unmapped on
+   * release. With non zero segment size the file is mapped by large
+   * segments kept until destruction of the adapter, so resolution of
+   * a block is a pointer computation.
    */
   class ReadBlockFileAdapter
   {
@@ -45,6 +56,9 @@ namespace PlainStorage
   public:
     typedef u_int64_t FileOffset;
 
+    /// Recommended segment size for the segment mapping mode
+    static const unsigned long DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024;
+
     DECLARE_EXCEPTION(Exception, eh::DescriptiveException);
     DECLARE_EXCEPTION(PosixException, Exception);
     DECLARE_EXCEPTION(FileOpenFailure, Exception);
@@ -192,10 +206,13 @@ namespace PlainStorage
      * Constructor
      * @param filename The name of file to be open
      * @param block_size The size of Data block
+     * @param segment_size zero - map every block separately, otherwise
+     * map the file by segments of this size (rounded up to whole blocks)
      */
     ReadBlockFileAdapter(
       const char* filename,
-      unsigned long block_size)
+      unsigned long block_size,
+      unsigned long segment_size = 0)
       throw (eh::Exception);
 
     /**
@@ -227,12 +244,68 @@ namespace PlainStorage
     max_block_index() const throw (eh::Exception);
 
   protected:
+    /**
+     * Growable set of equal sized mappings of the file segments.
+     * Segments are mapped on the first access and stay mapped until
+     * destruction. Lookup of an already mapped segment takes no locks.
+     */
+    class SegmentMap : private Generics::Uncopyable
+    {
+    public:
+      /**
+       * Constructor
+       * @param prot protection type to pass to mmap(2)
+       * @param segment_blocks number of blocks in one segment
+       * @param map_page_size size of one block
+       */
+      SegmentMap(int prot, std::size_t segment_blocks,
+        std::size_t map_page_size)
+        throw (eh::Exception);
+
+      /**
+       * Unmaps all of the segments
+       */
+      ~SegmentMap() throw ();
+
+      /**
+       * Maps the segment if required
+       * @param file_desc file to map
+       * @param index index of the block
+       * @return address of the block
+       */
+      void*
+      resolve(int file_desc, BlockIndex index)
+        throw (PosixException, eh::Exception);
+
+    private:
+      struct Table
+      {
+        std::size_t size;
+        void** segments;
+      };
+
+      void*
+      map_segment_(int file_desc, std::size_t segment)
+        throw (PosixException, eh::Exception);
+
+      const int PROT_;
+      const std::size_t SEGMENT_BLOCKS_;
+      const std::size_t MAP_PAGE_SIZE_;
+
+      Sync::PosixMutex mutex_;
+      /// The newest table, previous ones are kept for concurrent readers
+      Table* table_;
+      std::vector<Table*> tables_;
+    };
 
     /**
      * This constructor do not open file
      * @param block_size The value for Data block size
+     * @param segment_size zero or size of the mapping segment
      */
-    ReadBlockFileAdapter(unsigned long block_size) throw (eh::Exception);
+    ReadBlockFileAdapter(unsigned long block_size,
+      unsigned long segment_size = 0)
+      throw (eh::Exception);
 
     void*
     read_resolve_block_(BlockIndex index)
@@ -251,6 +324,13 @@ namespace PlainStorage
     void
     open_file_(const char* filename) throw (PosixException, eh::Exception);
 
+    /**
+     * Creates segment_map_ if segment mapping mode is requested
+     * @param prot protection type to pass to mmap(2)
+     */
+    void
+    init_segment_map_(int prot) throw (eh::Exception);
+
     /// Description of opened file
     int file_desc_;
     /// The size of shared memory portion. Data block hold into some portions
@@ -261,6 +341,10 @@ namespace PlainStorage
     std::size_t block_size_;
     /// Total size, in bytes of opened file
     FileOffset file_size_;
+    /// Requested segment size, zero for the per block mapping
+    std::size_t segment_size_;
+    /// Mappings of the segments in the segment mapping mode
+    std::unique_ptr<SegmentMap> segment_map_;
   };
 
   /**
@@ -354,11 +438,14 @@ namespace PlainStorage
      * @param block_size The size for Data block
      * @param open_type Traits for opening file, by default if the file does not
      * exist it will be created
+     * @param segment_size zero - map every block separately, otherwise
+     * map the file by segments of this size (rounded up to whole blocks)
      */
     WriteBlockFileAdapter(
       const char* filename,
       unsigned long block_size,
-      OpenType open_type = OT_OPEN_OR_CREATE)
+      OpenType open_type = OT_OPEN_OR_CREATE,
+      unsigned long segment_size = 0)
       throw (eh::Exception);
 
     WriteBlockStruct*
@@ -504,12 +591,14 @@ namespace PlainStorage
   inline
   ReadBlockFileAdapter::ReadBlockFileAdapter(
     const char* file_name,
-    unsigned long block_size)
+    unsigned long block_size,
+    unsigned long segment_size)
     throw (eh::Exception)
     : file_desc_(-1),
       map_page_size_(0),
       block_size_(block_size),
-      file_size_(0)
+      file_size_(0),
+      segment_size_(segment_size)
   {
     open_file_(file_name);
   }
@@ -583,9 +672,11 @@ namespace PlainStorage
 
   inline
   ReadBlockFileAdapter::ReadBlockFileAdapter(
-    unsigned long block_size)
+    unsigned long block_size,
+    unsigned long segment_size)
     throw (eh::Exception)
-    : block_size_(block_size)
+    : block_size_(block_size),
+      segment_size_(segment_size)
   {
   }
 
@@ -621,9 +712,10 @@ namespace PlainStorage
   WriteBlockFileAdapter::WriteBlockFileAdapter(
     const char* filename,
     unsigned long block_size,
-    OpenType open_type)
+    OpenType open_type,
+    unsigned long segment_size)
     throw (eh::Exception)
-    : ReadBlockFileAdapter(block_size)
+    : ReadBlockFileAdapter(block_size, segment_size)
   {
     open_file_(filename, open_type);
   }
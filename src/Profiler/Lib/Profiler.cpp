@@ -21,167 +21,406 @@
 
 
 
-#include <iostream>
-#include <sstream>
-#include <fstream>
-
+#include <errno.h>
 #include <stdio.h>
-#include <unistd.h>
-#include <sys/time.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include <pthread.h>
 
+#include <map>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
 #include "Profiler.hpp"
 
 
-static _funcprof FuncProf[PROF_FUNCTIONS];
-static unsigned long FuncGraph[PROF_FUNCTIONS][PROF_FUNCTIONS];
-static pthread_mutex_t my_mutex[PROF_FUNCTIONS];
+namespace
+{
+  /**
+   * Ticks counter: TSC on x86, monotonic clock nanoseconds elsewhere.
+   * Ticks are converted into time on the dump only.
+   */
+  inline
+  unsigned long long
+  get_ticks() throw ()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+  }
+
+  unsigned long long
+  get_usecs() throw ()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+  }
+
+  /// Node for the calls beyond the call tree capacity
+  const unsigned int OVERFLOW_NODE = 1;
+  const unsigned int OVERFLOW_FUNCTION = ~0u;
 
-static pthread_mutex_t setspec_mutex  = PTHREAD_MUTEX_INITIALIZER;
-static unsigned int thread_number = 1;
+  pthread_once_t key_created = PTHREAD_ONCE_INIT;
+  pthread_key_t state_key;
 
-static unsigned int CurrentFunc[65535];
+  Profiling::ThreadState* threads = 0;
 
-static unsigned int res_atexit = 1;
-static pthread_once_t key_created = PTHREAD_ONCE_INIT;
-FILE* fp;
-FILE* fp1;
-static pthread_key_t pkey;
-int pvalue = 0;
+  unsigned long long start_ticks = 0;
+  unsigned long long start_usecs = 0;
 
-Profiling::Profiling (unsigned int func_index)
+  pthread_mutex_t names_mutex = PTHREAD_MUTEX_INITIALIZER;
+  std::map<std::string, unsigned int>* name_indexes = 0;
+  std::vector<std::string>* names = 0;
+}
+
+/**
+ * Call tree of the thread. Only the owner thread modifies it,
+ * nodes are never moved so the dump can read it at any time.
+ */
+struct Profiling::ThreadState
 {
-unsigned int* getspc;
-unsigned int* spc_value;
+  static const unsigned int CHUNK_SIZE = 4096;
+  static const unsigned int MAX_CHUNKS = 1024;
 
- pthread_once(&key_created, CreateMyKey);
- getspc = (unsigned int*)pthread_getspecific(pkey);
+  struct Node
+  {
+    unsigned int function;
+    unsigned int parent;
+    unsigned long long calls;
+    unsigned long long ticks;
+    unsigned long long child_ticks;
+    /// The last called function and its node, saves the lookup
+    unsigned int cached_function;
+    unsigned int cached_child;
+  };
+
+  ThreadState() throw ();
+
+  Node&
+  node(unsigned int index) throw ();
+
+  unsigned int
+  child(unsigned int function) throw ();
+
+  Node* chunks[MAX_CHUNKS];
+  /// Number of nodes, published for the dump
+  unsigned int size;
+  unsigned int current;
+  /// Zero when the owner thread is finished and the state can be reused
+  int busy;
+  std::unordered_map<unsigned long long, unsigned int> children;
+  ThreadState* next;
+};
+
+Profiling::ThreadState::ThreadState() throw ()
+  : chunks(), size(2), current(0), busy(1), next(0)
+{
+  chunks[0] = new Node[CHUNK_SIZE]();
+  chunks[0][OVERFLOW_NODE].function = OVERFLOW_FUNCTION;
+}
 
- if (getspc == 0)
+inline
+Profiling::ThreadState::Node&
+Profiling::ThreadState::node(unsigned int index) throw ()
+{
+  return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+}
+
+inline
+unsigned int
+Profiling::ThreadState::child(unsigned int function) throw ()
+{
+  Node& current_node = node(current);
+  if (current_node.cached_child && current_node.cached_function == function)
   {
-   spc_value = (unsigned int *)malloc(sizeof(unsigned int));
-   pthread_mutex_lock(&setspec_mutex);
-    *spc_value = thread_number;
-    pthread_setspecific(pkey, spc_value);
-    CurrentFunc[thread_number] = 0;
-    ++thread_number;
-    FuncProf[func_index].main_function = 1;
-   pthread_mutex_unlock(&setspec_mutex);
+    return current_node.cached_child;
   }
 
- _func_index = func_index;
+  const unsigned long long KEY =
+    static_cast<unsigned long long>(current) << 32 | function;
 
-  if (getspc == 0)
-   {
-    _getspc = *spc_value;
-   } else
-   {
-    _getspc = *getspc;
-   }
+  try
+  {
+    std::unordered_map<unsigned long long, unsigned int>::iterator it =
+      children.find(KEY);
+    if (it != children.end())
+    {
+      current_node.cached_function = function;
+      current_node.cached_child = it->second;
+      return it->second;
+    }
 
+    const unsigned int INDEX = size;
+    if (INDEX == CHUNK_SIZE * MAX_CHUNKS)
+    {
+      return OVERFLOW_NODE;
+    }
+    if (INDEX % CHUNK_SIZE == 0)
+    {
+      chunks[INDEX / CHUNK_SIZE] = new Node[CHUNK_SIZE]();
+    }
+    Node& new_node = node(INDEX);
+    new_node.function = function;
+    new_node.parent = current;
+    children[KEY] = INDEX;
+    __atomic_store_n(&size, INDEX + 1, __ATOMIC_RELEASE);
+    current_node.cached_function = function;
+    current_node.cached_child = INDEX;
+    return INDEX;
+  }
+  catch (...)
+  {
+    return OVERFLOW_NODE;
+  }
+}
 
- pthread_getcpuclockid(pthread_self(), &clock_id1);
- clock_gettime(clock_id1,&tm1);
+namespace
+{
+  void
+  release_state(void* state) throw ()
+  {
+    __atomic_store_n(&static_cast<Profiling::ThreadState*>(state)->busy, 0,
+      __ATOMIC_RELEASE);
+  }
 
- pthread_mutex_lock(&my_mutex[func_index]);
-  prev_func_index = CurrentFunc[_getspc];
-   if (prev_func_index != 0)
+  /**
+   * Takes the state of a finished thread or creates a new one
+   */
+  Profiling::ThreadState*
+  acquire_state() throw ()
+  {
+    for (Profiling::ThreadState* state =
+      __atomic_load_n(&threads, __ATOMIC_ACQUIRE);
+      state; state = state->next)
     {
-     FuncProf[prev_func_index].function_graph = 1;
-     ++FuncGraph[prev_func_index][func_index];
+      int free = 0;
+      if (__atomic_compare_exchange_n(&state->busy, &free, 1, false,
+        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+      {
+        return state;
+      }
     }
-  CurrentFunc[_getspc] = func_index;
-  FuncProf[func_index].function_index = func_index;
-  temp_tm = tm1;
-  ++FuncProf[func_index].number_of_calls;
- pthread_mutex_unlock(&my_mutex[func_index]);
-}
 
+    Profiling::ThreadState* state = new Profiling::ThreadState;
+    state->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&threads, &state->next, state,
+      true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+    return state;
+  }
 
-inline
-void
-Profiling::add_time(timespec& tm) throw ()
-{
-  timespec t = { tm.tv_sec + tm2.tv_sec - tm1.tv_sec,
-    tm.tv_nsec + tm2.tv_nsec - tm1.tv_nsec };
-  if (t.tv_nsec < 0)
+  /**
+   * Name of the function for the profile, without separators
+   */
+  std::string
+  function_name(unsigned int function) throw ()
   {
-    t.tv_sec--;
-    t.tv_nsec += 1000000000;
+    std::string name;
+    if (function == OVERFLOW_FUNCTION)
+    {
+      name = "[overflow]";
+    }
+    else if ((function & Profiling::REGISTERED_FUNCTION) && names &&
+      (function & ~Profiling::REGISTERED_FUNCTION) < names->size())
+    {
+      name = (*names)[function & ~Profiling::REGISTERED_FUNCTION];
+    }
+    else
+    {
+      char buf[16];
+      snprintf(buf, sizeof(buf), "%u", function);
+      name = buf;
+    }
+
+    for (std::string::iterator it = name.begin(); it != name.end(); ++it)
+    {
+      if (*it == ';' || *it == ' ' || *it == '\t' || *it == '\n')
+      {
+        *it = '_';
+      }
+    }
+    return name;
   }
-  tm = t;
+
+  struct Stat
+  {
+    unsigned long long calls;
+    unsigned long long ticks;
+    unsigned long long self_ticks;
+  };
 }
 
-Profiling::~Profiling()
+Profiling::Profiling(unsigned int func_index) throw ()
 {
- pthread_getcpuclockid(pthread_self(), &clock_id2);
- clock_gettime(clock_id2,&tm2);
+  pthread_once(&key_created, CreateMyKey);
 
- pthread_mutex_lock(&my_mutex[_func_index]);
+  state_ = static_cast<ThreadState*>(pthread_getspecific(state_key));
+  if (!state_)
   {
-   add_time(FuncProf[_func_index].tm);
-   CurrentFunc[_getspc] = prev_func_index;
+    state_ = acquire_state();
+    pthread_setspecific(state_key, state_);
   }
- pthread_mutex_unlock(&my_mutex[_func_index]);
 
- pthread_mutex_lock(&my_mutex[prev_func_index]);
-  add_time(FuncProf[prev_func_index].child_tm);
- pthread_mutex_unlock(&my_mutex[prev_func_index]);
+  prev_node_ = state_->current;
+  const unsigned int NODE = state_->child(func_index);
+  ThreadState::Node& node = state_->node(NODE);
+  __atomic_store_n(&node.calls, node.calls + 1, __ATOMIC_RELAXED);
+  state_->current = NODE;
+
+  start_ = get_ticks();
 }
 
-void Profiling::SaveLog()
+Profiling::~Profiling() throw ()
 {
+  const unsigned long long ELAPSED = get_ticks() - start_;
+
+  ThreadState::Node& node = state_->node(state_->current);
+  __atomic_store_n(&node.ticks, node.ticks + ELAPSED, __ATOMIC_RELAXED);
+  ThreadState::Node& parent = state_->node(prev_node_);
+  __atomic_store_n(&parent.child_ticks, parent.child_ticks + ELAPSED,
+    __ATOMIC_RELAXED);
+  state_->current = prev_node_;
+}
 
-unsigned int graph_num = 0;
-unsigned int basic_log_size = PROF_FUNCTIONS*sizeof(_funcprof);
-unsigned int graph_log_size = basic_log_size;
-std::string log_file, stat_file, temp_string;
-char grp_id[10];
-std::ifstream stat_handle;
+unsigned int
+Profiling::register_function(const char* name) throw ()
+{
+  pthread_mutex_lock(&names_mutex);
+  unsigned int index = 0;
+  try
+  {
+    if (!names)
+    {
+      name_indexes = new std::map<std::string, unsigned int>;
+      names = new std::vector<std::string>;
+    }
+    std::map<std::string, unsigned int>::iterator it =
+      name_indexes->find(name);
+    if (it != name_indexes->end())
+    {
+      index = it->second;
+    }
+    else
+    {
+      index = REGISTERED_FUNCTION | names->size();
+      names->push_back(name);
+      (*name_indexes)[name] = index;
+    }
+  }
+  catch (...)
+  {
+  }
+  pthread_mutex_unlock(&names_mutex);
+  return index;
+}
 
- snprintf(grp_id, sizeof(grp_id), "%u", static_cast<unsigned>(getpid()));
- temp_string = grp_id;
- stat_file = "/proc/." + temp_string + "/stat";
- stat_handle.open(stat_file.c_str(), std::ios::in);
-  if (stat_handle)
-   {
-    std::getline(stat_handle, log_file);
-    log_file = log_file.substr(log_file.find(" ") + 2, log_file.find(" ", log_file.find(" ") + 1) - 3 - log_file.find(" ")) + ".log";
-   }
+void
+Profiling::SaveLog()
+{
+  unsigned long long usecs = get_usecs() - start_usecs;
+  if (usecs < 10000)
+  {
+    // Too short run for the calibration
+    usleep(10000 - usecs);
+    usecs = get_usecs() - start_usecs;
+  }
+  const double TICKS_PER_USEC =
+    static_cast<double>(get_ticks() - start_ticks) / usecs;
 
- fp = fopen (log_file.c_str(), "w");
+  pthread_mutex_lock(&names_mutex);
 
- for (unsigned int i = 0; i < PROF_FUNCTIONS; i++)
+  std::map<std::string, Stat> stacks;
+  try
   {
-   if (FuncProf[i].function_graph)
+    for (ThreadState* state = __atomic_load_n(&threads, __ATOMIC_ACQUIRE);
+      state; state = state->next)
     {
-     FuncProf[i].function_graph = graph_log_size;
-     graph_log_size += PROF_FUNCTIONS * sizeof(unsigned long);
-     memcpy (&FuncGraph[graph_num][0], &FuncGraph[i][0], PROF_FUNCTIONS * sizeof(unsigned long));
-     graph_num++;
+      const unsigned int SIZE =
+        __atomic_load_n(&state->size, __ATOMIC_ACQUIRE);
+      // Parent node is always created before its children
+      std::vector<std::string> paths(SIZE);
+      for (unsigned int i = 1; i < SIZE; i++)
+      {
+        const ThreadState::Node& node = state->node(i);
+        const unsigned long long CALLS =
+          __atomic_load_n(&node.calls, __ATOMIC_RELAXED);
+        if (!CALLS && i == OVERFLOW_NODE)
+        {
+          continue;
+        }
+        paths[i] = node.parent ?
+          paths[node.parent] + ";" + function_name(node.function) :
+          function_name(node.function);
+
+        const unsigned long long TICKS =
+          __atomic_load_n(&node.ticks, __ATOMIC_RELAXED);
+        const unsigned long long CHILD_TICKS =
+          __atomic_load_n(&node.child_ticks, __ATOMIC_RELAXED);
+        Stat& stat = stacks[paths[i]];
+        stat.calls += CALLS;
+        stat.ticks += TICKS;
+        stat.self_ticks += TICKS > CHILD_TICKS ? TICKS - CHILD_TICKS : 0;
+      }
     }
   }
+  catch (...)
+  {
+  }
+
+  pthread_mutex_unlock(&names_mutex);
+
+  const std::string PROGRAM(program_invocation_short_name);
+  FILE* log = fopen((PROGRAM + ".log").c_str(), "w");
+  FILE* folded = fopen((PROGRAM + ".folded").c_str(), "w");
 
- if (fp)
+  if (log)
   {
-   fwrite (&FuncProf[0], 1, sizeof(_funcprof)*PROF_FUNCTIONS, fp);
-   fwrite (&FuncGraph[0][0], 1, graph_log_size - basic_log_size, fp);
-   fclose(fp);
+    fprintf(log, "# stack calls total_usec self_usec\n");
   }
-}
 
-void Profiling::CreateMyKey(void)
-{
-unsigned int i;
- for (i = 0; i < PROF_FUNCTIONS; i++)
+  for (std::map<std::string, Stat>::const_iterator it = stacks.begin();
+    it != stacks.end(); ++it)
   {
-   pthread_mutex_init(&my_mutex[i], 0);
+    const unsigned long long TOTAL_USEC =
+      static_cast<unsigned long long>(it->second.ticks / TICKS_PER_USEC);
+    const unsigned long long SELF_USEC =
+      static_cast<unsigned long long>(it->second.self_ticks / TICKS_PER_USEC);
+    if (log)
+    {
+      fprintf(log, "%s %llu %llu %llu\n", it->first.c_str(),
+        it->second.calls, TOTAL_USEC, SELF_USEC);
+    }
+    if (folded && SELF_USEC)
+    {
+      fprintf(folded, "%s %llu\n", it->first.c_str(), SELF_USEC);
+    }
   }
 
- res_atexit = atexit(SaveLog);
- pthread_key_create(&pkey, 0);
+  if (log)
+  {
+    fclose(log);
+  }
+  if (folded)
+  {
+    fclose(folded);
+  }
 }
 
-//}
+void
+Profiling::CreateMyKey(void)
+{
+  start_ticks = get_ticks();
+  start_usecs = get_usecs();
+
+  pthread_key_create(&state_key, release_state);
+  atexit(SaveLog);
+}
@@ -23,39 +23,65 @@
 
 #ifndef _PROFILER_H
 #define _PROFILER_H
-#define PROF_FUNCTIONS 3500
-
-#include <time.h>
-
-struct _funcprof
-{
-unsigned int function_index;
-unsigned int number_of_calls;
-timespec tm;
-unsigned int function_graph;
-timespec child_tm;
-unsigned int main_function;
-};
 
+/**
+ * Hierarchical profiler.
+ * Profiling object measures the scope it is created in. Every thread
+ * keeps its own call tree, the chain of Profiling objects on the stack
+ * is the shadow call stack, so entering and leaving a scope takes
+ * no locks and no system calls, time is measured in TSC ticks.
+ * Call trees of all threads are merged on exit into
+ * <program>.log (call tree with counters, consumed by Parser) and
+ * <program>.folded (folded stacks for flame graph tools).
+ */
 class Profiling
 {
-protected:
-unsigned int _getspc;
-unsigned int _func_index;
-unsigned int prev_func_index;
-timespec temp_tm;
-timespec tm1;
-timespec tm2;
-clockid_t clock_id1;
-clockid_t clock_id2;
-
 public:
- Profiling(unsigned int func_index);
- ~Profiling();
- static void SaveLog();
- static void CreateMyKey(void);
-protected:
- void
- add_time(timespec& tm) throw ();
+  /// Indexes returned by register_function() have this bit set
+  static const unsigned int REGISTERED_FUNCTION = 0x80000000;
+
+  /**
+   * Enters the function
+   * @param func_index index assigned by Parser or returned by
+   * register_function()
+   */
+  explicit
+  Profiling(unsigned int func_index) throw ();
+
+  /**
+   * Leaves the function
+   */
+  ~Profiling() throw ();
+
+  /**
+   * Registers function name for the profiling
+   * @param name name to show in the profile
+   * @return function index, the same for the same names
+   */
+  static
+  unsigned int
+  register_function(const char* name) throw ();
+
+  /**
+   * Merges call trees of the threads and writes the profile
+   */
+  static
+  void
+  SaveLog();
+
+  /**
+   * Initializes the profiler, called once
+   */
+  static
+  void
+  CreateMyKey(void);
+
+  struct ThreadState;
+
+private:
+  ThreadState* state_;
+  unsigned int prev_node_;
+  unsigned long long start_;
 };
+
 #endif
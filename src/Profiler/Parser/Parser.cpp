@@ -23,8 +23,11 @@
 
 
 #include <stdio.h>
+#include <algorithm>
 #include <sstream>
 #include <vector>
+#include <map>
+#include <set>
 #include <iostream>
 #include <fstream>
 #include <string.h>
@@ -37,48 +40,49 @@
 #include <math.h>
 
 #include "Parser.hpp"
-#include <Profiler/Lib/Profiler.hpp>
 
 std::string profiler_hpp = 
 "#ifndef _PROFILER_H\n"
 "#define _PROFILER_H\n"
-"#include <time.h>\n"
-"struct _funcprof\n"
-"{\n"
-"unsigned int function_index;\n"
-"unsigned int number_of_calls;\n"
-"timespec  tm;\n"
-"unsigned int function_graph;\n"
-"timespec child_tm;\n"
-"unsigned int main_function;\n"
-"};\n"
-"\n"
 "class Profiling\n"
 "{\n"
-"protected:\n"
-"unsigned int _getspc;\n"
-"unsigned int _func_index;\n"
-"unsigned int prev_func_index;\n"
-"timespec temp_tm;\n"
-"timespec tm1;\n"
-"timespec tm2;\n"
-"clockid_t clock_id1;\n"
-"clockid_t clock_id2;\n"
 "public:\n"
-" Profiling(unsigned int func_index);\n"
-" ~Profiling();\n"
-" static void SaveLog();\n"
-" static void CreateMyKey(void);\n"
+"static const unsigned int REGISTERED_FUNCTION = 0x80000000;\n"
+"explicit\n"
+"Profiling(unsigned int func_index) throw ();\n"
+"~Profiling() throw ();\n"
+"static unsigned int register_function(const char* name) throw ();\n"
+"static void SaveLog();\n"
+"static void CreateMyKey(void);\n"
+"struct ThreadState;\n"
+"private:\n"
+"ThreadState* state_;\n"
+"unsigned int prev_node_;\n"
+"unsigned long long start_;\n"
 "};\n"
 "#endif\n"
 "";
 
 
 
-static _funcprof FuncProf;
-unsigned int mask_par = 0, func_calls;
-unsigned int func_graph[PROF_FUNCTIONS];
-unsigned int func_saved[PROF_FUNCTIONS];
+/**
+ * Counters of the function or of the call from one function to another
+ */
+struct FunctionStat
+{
+  unsigned long long calls;
+  unsigned long long total_usec;
+  unsigned long long self_usec;
+};
+
+typedef std::map<std::string, FunctionStat> FunctionStatMap;
+
+FunctionStatMap functions;
+std::map<std::string, FunctionStatMap> function_calls;
+std::map<std::string, std::string> function_names;
+std::vector<std::string> root_functions;
+
+unsigned int mask_par = 0;
 
 std::string::size_type temp_pos[100];
 std::string file_mask[10];
@@ -96,11 +100,7 @@ std::string spaces = "                    ";
 std::string temp_file_line, temp_file_line1;
 std::stringstream temp_val; 
 
-typedef std::vector<std::string> FileLinesArray;
-FileLinesArray func_name;
-
-int function_number = 0;
-bool line_upd = false, cf = false, inc_upd = false, clean_flag = false, one_mark = false;
+bool line_upd = false, inc_upd = false, clean_flag = false, one_mark = false;
 char temp_str[10];
 int braces_num = 0, in_level = 0, class_braces_num[10];
 unsigned int line_num = 0, i_num = 0, last_line_num = 0;
@@ -131,16 +131,22 @@ std::string::iterator is;
      std::cout << "2. func=<number of profiled function> <logfile>" << std::endl;
      std::cout << "Example:" << std::endl;
      std::cout << "./Parser func=5 ChannelManager.log" << std::endl;
-     std::cout << "It creates a file 'Func_5.log' which contains some information about calls of the function with number 5 in the current directory." << std::endl;
+     std::cout << "It creates files 'Func_5.log' and 'Func_5.dot' which contain some information about calls of the function with number 5 in the current directory." << std::endl;
+     std::cout << "'main' instead of 'func=<number>' creates them for every thread entry function." << std::endl;
      std::cout << "IMPORTANT: File 'funclist' must be in the current directory." << std::endl;
 
-     std::cout << "3. clean=<extension 1>,<extension 2>,...,<extension n> <Directory 1> <Directory 2> ... <Directory N>" << std::endl;
+     std::cout << "3. flame <logfile>" << std::endl;
+     std::cout << "Example:" << std::endl;
+     std::cout << "./Parser flame ChannelManager.log > ChannelManager.folded" << std::endl;
+     std::cout << "It prints folded stacks with function names from 'funclist' for flame graph tools." << std::endl;
+
+     std::cout << "4. clean=<extension 1>,<extension 2>,...,<extension n> <Directory 1> <Directory 2> ... <Directory N>" << std::endl;
      std::cout << "Example:" << std::endl;
      std::cout << "./Parser clean=cpp,hpp projects/Ad/Server2/ChannelSvcs/ChannelManager projects/UnixCommons/src/Generics" << std::endl;
      std::cout << "It deletes calls to profiler services from *.cpp and *.hpp files in " 
     		  "projects/Ad/Server2/ChannelSvcs/ChannelManager and projects/UnixCommons/src/Generics directories." << std::endl;
      
-     std::cout << "4. help" << std::endl;
+     std::cout << "5. help" << std::endl;
      
     } else
   
@@ -177,287 +183,261 @@ std::string::iterator is;
      func_list.close();
     } else
 
-   if (!strncmp(argv[1],"func=",5) || !strncmp(argv[1],"main",4))  
+   if (!strncmp(argv[1], "func=", 5) || !strncmp(argv[1], "main", 4) ||
+     !strncmp(argv[1], "flame", 5))
     {
-     char* function_number_string;
-     FILE* log_list;
-     typedef std::vector<unsigned int> int_array;
-     int_array indexes_array, main_indexes_array;
-
-     if (!strncmp(argv[1],"func=",5))
-     {
-       function_number_string = &argv[1][5];
-       function_number = atoi(function_number_string);
-     }
-
-     cf = false;
-     log_list = fopen(argv[2], "r");
-     ifunc_list.open("funclist", std::ios::in);
-
-     if (!strncmp(argv[1],"main",4))
-     {
-       fseek(log_list, 0, SEEK_END);
-       long log_filesize = ftell(log_list);
-       fseek(log_list, 0, SEEK_SET);
-       void* plog_list = malloc(log_filesize);
-       fread(plog_list, PROF_FUNCTIONS, sizeof(_funcprof), log_list);
+     if (argc < 3)
+      {
+       std::cout << "Log file is not specified" << std::endl;
+       return 1;
+      }
 
-       for (unsigned int i = 1; i <= PROF_FUNCTIONS; i++)
-       {
-         _funcprof* _pfuncprof = (_funcprof*)((unsigned long)plog_list + i * sizeof(_funcprof));
-         if (_pfuncprof->main_function == 1)
-         {
-           main_indexes_array.push_back(i);
-         }
-       }
-     } else
-     {
-       main_indexes_array.push_back(function_number);
-     }
+     LoadFunctionNames();
 
-     if (log_list != 0)
-     {
-       func_name.push_back("");
-       while (ifunc_list && !ifunc_list.eof())
-       {
-         line_num++;
-         temp_file_line.erase(); 
-         std::getline(ifunc_list, temp_file_line);
-         is = temp_file_line.begin();
-         while ((*is != ' ') && (is != temp_file_line.end()))
-         {
-           is++;
-         }
-         if ((*is == ' ') && (is != temp_file_line.end()))
-	 {
-           is++;
-         }
-         func_name.push_back(std::string(temp_file_line, is - temp_file_line.begin(), std::string::npos));
-       }
+     if (!strncmp(argv[1], "flame", 5))
+      {
+       return SaveFlameGraph(argv[2]) ? 0 : 1;
+      }
 
-       for (unsigned int n = 0; n < main_indexes_array.size(); n++)
-       {
-         function_number = main_indexes_array[n];
-         indexes_array.clear();
+     if (!ReadProfile(argv[2]))
+      {
+       std::cout << "Cannot read profile " << argv[2] << std::endl;
+       return 1;
+      }
 
-         snprintf(temp_str, sizeof(temp_str), "%i", function_number);
-         std::string log_name = temp_str;
-         std::string dot_name = temp_str;
+     if (!strncmp(argv[1], "func=", 5))
+      {
+       SaveFunctionReport(argv[1] + 5);
+      }
+     else
+      {
+       for (unsigned int n = 0; n < root_functions.size(); n++)
+        {
+         SaveFunctionReport(root_functions[n]);
+        }
+      }
+    }
+  } 			//argc
+}
 
-         log_name = "Func_" + log_name + ".log";
-         dot_name = "Func_" + dot_name + ".dot";
-      
-         std::ofstream log_out(log_name.c_str(), std::ios::out);
-         std::ofstream dot_out(dot_name.c_str(), std::ios::out);      
-     
-         dot_out << "digraph FuncLog {" << std::endl 
-                 << "rankdir = LR;" << std::endl 
-                 << "node [color = red, fontsize = 14];" << std::endl
-                 << "edge [color = black, fontcolor = darkgrey, fontsize = 12];" << std::endl;
-      
-         indexes_array.push_back(function_number);
-         bool bf = true;
-         unsigned int func_index = 0;
+void LoadFunctionNames()
+{
+  std::ifstream func_list_in("funclist", std::ios::in);
+  std::string line;
 
-         for (unsigned int k = 0; k < PROF_FUNCTIONS; k++)
-         {
-           func_saved[k] = 0;
-         }
+  while (std::getline(func_list_in, line))
+  {
+    std::string::size_type pos = line.find(' ');
+    if (pos != std::string::npos)
+    {
+      function_names[line.substr(0, pos)] = line.substr(pos + 1);
+    }
+  }
+}
 
-         while (bf)
-         {
-           function_number = indexes_array[func_index];       
+std::string FunctionName(const std::string& function)
+{
+  std::map<std::string, std::string>::const_iterator it =
+    function_names.find(function);
+  return it == function_names.end() ? function : it->second;
+}
 
-           fseek(log_list, function_number * sizeof(_funcprof), 0);
-           fread(&FuncProf, 1, sizeof(_funcprof), log_list);
+/**
+ * Parses the line of the profile: <stack> <calls> <total_usec> <self_usec>
+ */
+bool ParseProfileLine(const std::string& line, std::vector<std::string>& frames, FunctionStat& stat)
+{
+  if (line.empty() || line[0] == '#')
+  {
+    return false;
+  }
 
-           if (func_saved[function_number] == 0)
-           {
-             func_calls = FuncProf.number_of_calls;
-             SaveFunctionLog(function_number, &log_out, &dot_out);
-             log_out << ">----------------------------------------------------------------------------------------------------------------------------------------" << std::endl;
-        
-             if (FuncProf.function_graph)
-             {
-               fseek(log_list, FuncProf.function_graph, SEEK_SET);
-               fread(&func_graph, 1, PROF_FUNCTIONS * sizeof(unsigned int), log_list);
-        
-               log_out << "Called Functions:" << std::endl;
-        
-               cf = true;
-               for (unsigned int i = 1; i < PROF_FUNCTIONS; i++)
-               {
-                 if (func_graph[i] != 0)
-                 {
-                   fseek(log_list, i * sizeof(_funcprof), 0);
-                   fread(&FuncProf, 1, sizeof(_funcprof), log_list);
-		   func_calls = func_graph[i];
-                   indexes_array.push_back(i);
-                   SaveFunctionLog(i, &log_out, &dot_out);
-                 }
-               }
-	     }
-             func_saved[function_number] = 1;	     
-             cf = false;
-             log_out << "<----------------------------------------------------------------------------------------------------------------------------------------" << std::endl;        
-           }
-	 
-           ++func_index;
+  std::istringstream istr(line);
+  std::string stack;
+  if (!(istr >> stack >> stat.calls >> stat.total_usec >> stat.self_usec))
+  {
+    return false;
+  }
 
-           if (func_index == indexes_array.size())
-           {
-             bf = false;
-           }
-         }
-         ifunc_list.close();
-         log_out.close();
-         dot_out << "}" << std::endl;
-         dot_out.close();
-       }
-       fclose(log_list);       
-     }	                //loglist
-    } 			//strncmp
-  } 			//argc
+  frames.clear();
+  std::string::size_type begin = 0;
+  for (std::string::size_type end; (end = stack.find(';', begin)) != std::string::npos; begin = end + 1)
+  {
+    frames.push_back(stack.substr(begin, end - begin));
+  }
+  frames.push_back(stack.substr(begin));
+  return true;
 }
 
-void SaveFunctionLog(unsigned int func_number, std::ofstream* _log_out, std::ofstream* _dot_out)
+bool ReadProfile(const char* log_name)
 {
-  int dec = 0, sign = 0;
-  double fraction = 0;
-  double int_part;
-  std::string time_buff, own_time_buff;
-  long double aver_sec;
-  long double aver_nsec;
-  double graph_time_sec, graph_time_msec, log_time_sec, temp_log_time_sec;
-  double func_time_sec;
-  unsigned int temp_func_calls = 0;
- 
-  double own_time_sec =
-    double(FuncProf.tm.tv_sec - FuncProf.child_tm.tv_sec) +
-    double(FuncProf.tm.tv_nsec - FuncProf.child_tm.tv_nsec) / 1E9;
-
-  own_time_buff = fcvt(own_time_sec, 6, &dec, &sign);
-  while (dec < 1)
+  std::ifstream log_in(log_name, std::ios::in);
+  if (!log_in)
   {
-    own_time_buff = "0" + own_time_buff;     
-    ++dec;
+    return false;
   }
-  own_time_buff.insert(dec, ".");
 
-  FuncProf.tm.tv_nsec = FuncProf.tm.tv_nsec / 1000;
-  temp_func_calls = FuncProf.number_of_calls;
-  temp_log_time_sec = double(FuncProf.tm.tv_sec) + double(FuncProf.tm.tv_nsec) / 1000000;
-    
-  if (cf)
+  std::string line;
+  std::vector<std::string> frames;
+  FunctionStat stat;
+
+  while (std::getline(log_in, line))
   {
-    graph_time_sec  = double(FuncProf.tm.tv_sec) / FuncProf.number_of_calls;
-    graph_time_sec = graph_time_sec * func_calls;
-    graph_time_msec = double(FuncProf.tm.tv_nsec) / FuncProf.number_of_calls;
-    graph_time_msec = (graph_time_msec / 1000000) * func_calls;
-    graph_time_msec = modf(graph_time_sec + graph_time_msec, &int_part);
-    func_time_sec = 1000000 * graph_time_msec;
-    FuncProf.tm.tv_nsec = int(func_time_sec);
-    FuncProf.tm.tv_sec  = int(int_part);
-      
-    log_time_sec = double(FuncProf.tm.tv_sec) + graph_time_msec;
+    if (!ParseProfileLine(line, frames, stat))
+    {
+      continue;
+    }
 
-    time_buff = fcvt(log_time_sec, 6, &dec, &sign);
-    while (dec < 1)
+    const std::string& function = frames.back();
+    FunctionStat& function_stat = functions[function];
+    function_stat.calls += stat.calls;
+    function_stat.self_usec += stat.self_usec;
+    // Time of the recursive calls is already counted in the outer call
+    if (std::find(frames.begin(), frames.end() - 1, function) == frames.end() - 1)
     {
-      time_buff = "0" + time_buff;     
-      ++dec;
+      function_stat.total_usec += stat.total_usec;
+    }
+
+    if (frames.size() == 1)
+    {
+      if (std::find(root_functions.begin(), root_functions.end(), function) == root_functions.end())
+      {
+        root_functions.push_back(function);
+      }
+    }
+    else
+    {
+      FunctionStat& call_stat = function_calls[frames[frames.size() - 2]][function];
+      call_stat.calls += stat.calls;
+      call_stat.total_usec += stat.total_usec;
+      call_stat.self_usec += stat.self_usec;
     }
-    time_buff.insert(dec, ".");
-     
-    *_dot_out << function_number << "->" << func_number << "[label = \x22" << func_calls << " calls\x22];" << std::endl;
-      
-    *_log_out << "	";
-    FuncProf.number_of_calls = func_calls;      
   }
-  else
+
+  return true;
+}
+
+bool SaveFlameGraph(const char* log_name)
+{
+  std::ifstream log_in(log_name, std::ios::in);
+  if (!log_in)
   {
-    log_time_sec = double(FuncProf.tm.tv_sec) + double(double(FuncProf.tm.tv_nsec) / 1000000);
-    func_time_sec = FuncProf.tm.tv_nsec;
+    std::cout << "Cannot read profile " << log_name << std::endl;
+    return false;
   }
-    
-  *_log_out << func_name[func_number] << std::endl;
-  temp_file_line.erase();
 
-  temp_val << FuncProf.function_index;
-  temp_file_line = temp_file_line + temp_val.str() + spaces;
-  temp_file_line = std::string(temp_file_line, 0, 13);    
-  temp_val.str("");
-    
-  temp_val << FuncProf.number_of_calls;    
-  temp_file_line = temp_file_line + temp_val.str() + spaces;    
-  temp_file_line = std::string(temp_file_line, 0, 26);
-  temp_val.str("");    
+  std::string line;
+  std::vector<std::string> frames;
+  FunctionStat stat;
 
-  temp_val << FuncProf.tm.tv_sec;    
-  temp_file_line = temp_file_line + temp_val.str() + spaces;    
-  temp_file_line = std::string(temp_file_line, 0, 39);
-  temp_val.str("");
+  while (std::getline(log_in, line))
+  {
+    if (!ParseProfileLine(line, frames, stat) || !stat.self_usec)
+    {
+      continue;
+    }
 
-  temp_val << func_time_sec;
+    for (unsigned int i = 0; i < frames.size(); i++)
+    {
+      std::string name = FunctionName(frames[i]);
+      name = name.substr(0, name.find('('));
+      for (std::string::iterator it = name.begin(); it != name.end(); ++it)
+      {
+        if (*it == ';' || *it == ' ' || *it == '\t')
+        {
+          *it = '_';
+        }
+      }
+      std::cout << (i ? ";" : "") << name;
+    }
+    std::cout << " " << stat.self_usec << std::endl;
+  }
 
-  temp_file_line = temp_file_line + temp_val.str() + spaces;    
-  temp_file_line = std::string(temp_file_line, 0, 55);
-  temp_val.str("");
-    
-  aver_sec  = double(FuncProf.tm.tv_sec) / FuncProf.number_of_calls;
+  return true;
+}
 
-  aver_nsec = func_time_sec / FuncProf.number_of_calls;     
-    
-  fraction = modf(aver_sec, &int_part);
+void SaveFunctionReport(const std::string& function)
+{
+  std::string log_name = "Func_" + function + ".log";
+  std::string dot_name = "Func_" + function + ".dot";
 
-  if ((int_part == 0) && (fraction < 0.0005))
-  {
-    time_buff = fcvt(1000000*fraction + aver_nsec, 10, &dec, &sign);
-    time_buff += " microseconds";		 
-  }
-  else
-  {
-    time_buff = fcvt(int_part + fraction + aver_nsec/1000000, 10, &dec, &sign);
-    time_buff += " seconds";		 
-  }
+  std::ofstream log_out(log_name.c_str(), std::ios::out);
+  std::ofstream dot_out(dot_name.c_str(), std::ios::out);
 
-  while (dec < 1)
-  {
-    time_buff = "0" + time_buff;     
-    ++dec;
-  }
-  time_buff.insert(dec, ".");
+  dot_out << "digraph FuncLog {" << std::endl
+          << "rankdir = LR;" << std::endl
+          << "node [color = red, fontsize = 14];" << std::endl
+          << "edge [color = black, fontcolor = darkgrey, fontsize = 12];" << std::endl;
 
-  temp_file_line = temp_file_line + time_buff + spaces;    
-  temp_val.str("");
-    
-  if (cf)
+  std::vector<std::string> queue(1, function);
+  std::set<std::string> saved;
+
+  for (unsigned int index = 0; index < queue.size(); index++)
   {
-    *_log_out << "\t";
-  }
+    const std::string& current = queue[index];
+    if (!saved.insert(current).second)
+    {
+      continue;
+    }
 
-  *_log_out << "Index    |   " << "Calls    |   " << "Seconds  |   " << "Microseconds |  " << "Average time in seconds/microseconds" << std::endl;
+    SaveFunctionLog(current, functions[current], false, &log_out, &dot_out);
+    log_out << ">----------------------------------------------------------------------------------------------------------------------------------------" << std::endl;
 
-  if (cf)
-  {
-    *_log_out << "\t";
+    std::map<std::string, FunctionStatMap>::const_iterator calls = function_calls.find(current);
+    if (calls != function_calls.end())
+    {
+      log_out << "Called Functions:" << std::endl;
+      for (FunctionStatMap::const_iterator it = calls->second.begin(); it != calls->second.end(); ++it)
+      {
+        dot_out << current << "->" << it->first << "[label = \x22" << it->second.calls << " calls\x22];" << std::endl;
+        SaveFunctionLog(it->first, it->second, true, &log_out, &dot_out);
+        queue.push_back(it->first);
+      }
+    }
+
+    log_out << "<----------------------------------------------------------------------------------------------------------------------------------------" << std::endl;
   }
 
-  *_log_out << temp_file_line << std::endl << std::endl;
-    
-  time_buff = fcvt(temp_log_time_sec, 6, &dec, &sign);
-  while (dec < 1)
+  dot_out << "}" << std::endl;
+}
+
+void SaveFunctionLog(const std::string& function, const FunctionStat& stat, bool called, std::ofstream* _log_out, std::ofstream* _dot_out)
+{
+  const char* indent = called ? "\t" : "";
+  const double average_usec = stat.calls ? double(stat.total_usec) / stat.calls : 0;
+
+  *_log_out << indent << FunctionName(function) << std::endl;
+  *_log_out << indent << "Index    |   " << "Calls    |   " << "Seconds  |   " << "Microseconds |  " << "Own microseconds |  " << "Average time in microseconds" << std::endl;
+
+  std::ostringstream line;
+  line << function << spaces;
+  temp_file_line = line.str().substr(0, 13);
+  line.str("");
+  line << stat.calls << spaces;
+  temp_file_line += line.str().substr(0, 13);
+  line.str("");
+  line << stat.total_usec / 1000000 << spaces;
+  temp_file_line += line.str().substr(0, 13);
+  line.str("");
+  line << stat.total_usec % 1000000 << spaces;
+  temp_file_line += line.str().substr(0, 16);
+  line.str("");
+  line << stat.self_usec << spaces;
+  temp_file_line += line.str().substr(0, 20);
+  line.str("");
+  line << average_usec;
+  temp_file_line += line.str();
+
+  *_log_out << indent << temp_file_line << std::endl << std::endl;
+
+  if (!called)
   {
-    time_buff = "0" + time_buff;     
-    ++dec;
+    *_dot_out << function << "[shape = rectangle, style = filled, fillcolor = lightgrey, label = \x22"
+              << FunctionName(function).substr(0, FunctionName(function).find("("))
+              << "\x5c\x6e" << stat.calls << " calls, " << stat.total_usec / 1E6 << " seconds"
+              << "\x5c\x6e" << "own time " << stat.self_usec / 1E6 << " seconds"
+              << "\x22];" << std::endl;
   }
-  time_buff.insert(dec, ".");
-    
-  *_dot_out << func_number << "[shape = rectangle, style = filled, fillcolor = lightgrey, label = \x22" 
-	    << func_name[func_number].substr(0, func_name[func_number].find("(")) 
-            << "\x5c\x6e" << temp_func_calls << " calls, " << time_buff << " seconds"
-            << "\x5c\x6e" << "own time " << own_time_buff << "seconds"
-            << "\x22];" << std::endl;
 }
 
 void ParseFiles(const char* current_dir_name)
@@ -618,9 +598,9 @@ unsigned int i = 0;
 	  old_profiler_hpp = true;
 	   if (clean_flag)
 	    {
-	     for (unsigned int k = 0; k < 30; k++)
+	     // Headers of all the versions end with the only #endif
+	     while (temp_file_line != "#endif" && std::getline(fp, temp_file_line))
 	      {
-	       std::getline(fp,temp_file_line);	       
 	       next_prof_str = false;
 	      }
 	     continue;
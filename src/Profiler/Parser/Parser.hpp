@@ -30,6 +30,12 @@ void ParseLine(std::string* _file_line, std::ofstream* fp_out);
 void SearchText(std::string* __file_line, std::string __mytext, int* __numtext);
 void SearchBrace(std::string* __pfile_line);
 void SearchEqualSign(std::string* __file_line, int* __numtext);
-void SaveFunctionLog(unsigned int func_number, std::ofstream* _log_out, std::ofstream* _dot_out);
+void LoadFunctionNames();
+std::string FunctionName(const std::string& function);
+bool ParseProfileLine(const std::string& line, std::vector<std::string>& frames, struct FunctionStat& stat);
+bool ReadProfile(const char* log_name);
+bool SaveFlameGraph(const char* log_name);
+void SaveFunctionReport(const std::string& function);
+void SaveFunctionLog(const std::string& function, const struct FunctionStat& stat, bool called, std::ofstream* _log_out, std::ofstream* _dot_out);
 
 #endif
@@ -20,6 +20,15 @@
 
 
 #include <cctype>
+#include <cstring>
+
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define ASCII_STRING_MANIP_SIMD
+#endif
 
 #include <String/AsciiStringManip.hpp>
 
@@ -133,6 +142,7 @@ namespace String
 
         if (!str)
         {
+          init_nibbles_();
           return;
         }
 
@@ -156,6 +166,7 @@ namespace String
             table_[static_cast<uint8_t>(*str)] = true;
           }
         }
+        init_nibbles_();
       }
 
       CharTable::CharTable(const CharTable& first, const CharTable& second)
@@ -165,6 +176,7 @@ namespace String
         {
           table_[i] = first.table_[i] || second.table_[i];
         }
+        init_nibbles_();
       }
 
       CharTable::CharTable(const CharTable& first, const CharTable& second,
@@ -175,7 +187,1400 @@ namespace String
           table_[i] = first.table_[i] || second.table_[i] ||
             third.table_[i];
         }
+        init_nibbles_();
+      }
+
+      void
+      CharTable::init_nibbles_() throw ()
+      {
+        std::fill(nibbles_, nibbles_ + 32, 0);
+        for (int i = 0; i < 256; i++)
+        {
+          if (table_[i])
+          {
+            nibbles_[(i & 0x0F) + (i & 0x80 ? 16 : 0)] |= 1 << (i >> 4 & 7);
+          }
+        }
+      }
+    }
+  }
+}
+
+namespace
+{
+  typedef String::AsciiStringManip::Category::CharTable CharTable;
+  typedef String::AsciiStringManip::Kernels::Functions Functions;
+
+  using String::AsciiStringManip::Tables::ASCII_TOLOWER_TABLE;
+  using String::AsciiStringManip::Tables::ASCII_TOUPPER_TABLE;
+
+  //
+  // Scalar kernel
+  //
+
+  const char*
+  find_table_scalar(const char* begin, const char* end,
+    const CharTable& table, bool owned) throw ()
+  {
+    for (; begin != end; ++begin)
+    {
+      if (table(*begin) == owned)
+      {
+        break;
+      }
+    }
+    return begin;
+  }
+
+  const char*
+  rfind_table_scalar(const char* begin, const char* end,
+    const CharTable& table, bool owned) throw ()
+  {
+    for (const char* pos = end; pos != begin;)
+    {
+      if (table(*--pos) == owned)
+      {
+        return pos;
+      }
+    }
+    return end;
+  }
+
+  const char*
+  find_chars_scalar(const char* begin, const char* end,
+    char symbol1, char symbol2, char symbol3, bool owned) throw ()
+  {
+    for (; begin != end; ++begin)
+    {
+      const char CH = *begin;
+      if ((CH == symbol1 || CH == symbol2 || CH == symbol3) == owned)
+      {
+        break;
+      }
+    }
+    return begin;
+  }
+
+  const char*
+  rfind_chars_scalar(const char* begin, const char* end,
+    char symbol1, char symbol2, char symbol3, bool owned) throw ()
+  {
+    for (const char* pos = end; pos != begin;)
+    {
+      const char CH = *--pos;
+      if ((CH == symbol1 || CH == symbol2 || CH == symbol3) == owned)
+      {
+        return pos;
+      }
+    }
+    return end;
+  }
+
+  void
+  to_lower_scalar(char* begin, char* end) throw ()
+  {
+    for (; begin != end; ++begin)
+    {
+      *begin = ASCII_TOLOWER_TABLE[static_cast<uint8_t>(*begin)];
+    }
+  }
+
+  void
+  to_upper_scalar(char* begin, char* end) throw ()
+  {
+    for (; begin != end; ++begin)
+    {
+      *begin = ASCII_TOUPPER_TABLE[static_cast<uint8_t>(*begin)];
+    }
+  }
+
+  const char*
+  find_block_scalar(const char* str, size_t size, const char* needle,
+    size_t needle_size) throw ()
+  {
+    if (needle_size > size)
+    {
+      return 0;
+    }
+    const char* const END = str + size - needle_size + 1;
+    for (const char* pos = str;
+      (pos = static_cast<const char*>(memchr(pos, *needle, END - pos)));
+      ++pos)
+    {
+      if (!memcmp(pos + 1, needle + 1, needle_size - 1))
+      {
+        return pos;
+      }
+    }
+    return 0;
+  }
+
+  const char*
+  rfind_block_scalar(const char* str, size_t size, const char* needle,
+    size_t needle_size) throw ()
+  {
+    if (needle_size > size)
+    {
+      return 0;
+    }
+    for (const char* end = str + size - needle_size + 1; ;)
+    {
+      const char* const POS =
+        static_cast<const char*>(memrchr(str, *needle, end - str));
+      if (!POS || !memcmp(POS + 1, needle + 1, needle_size - 1))
+      {
+        return POS;
+      }
+      end = POS;
+    }
+  }
+
+  /*
+   * Converters of ASCII chars, the kernels never pass bytes over 0x7F
+   * to them
+   */
+  struct LowerChar
+  {
+    char
+    operator ()(char ch) const throw ()
+    {
+      return ASCII_TOLOWER_TABLE[static_cast<uint8_t>(ch)];
+    }
+  };
+
+  struct UpperChar
+  {
+    char
+    operator ()(char ch) const throw ()
+    {
+      return ASCII_TOUPPER_TABLE[static_cast<uint8_t>(ch)];
+    }
+  };
+
+  struct SimplifyChar
+  {
+    char
+    operator ()(char ch) const throw ()
+    {
+      const char LOWER = ch | 0x20;
+      return (LOWER >= 'a' && LOWER <= 'z') || (ch >= '0' && ch <= '9') ?
+        LOWER : ' ';
+    }
+  };
+
+  size_t
+  ascii_size_scalar(const char* str, size_t size) throw ()
+  {
+    size_t i = 0;
+    while (i < size && !(str[i] & 0x80))
+    {
+      i++;
+    }
+    return i;
+  }
+
+  template <typename Convert>
+  size_t
+  ascii_convert_scalar(const char* src, size_t size, char* dest,
+    Convert convert) throw ()
+  {
+    size_t i = 0;
+    for (; i < size && !(src[i] & 0x80); i++)
+    {
+      dest[i] = convert(src[i]);
+    }
+    return i;
+  }
+
+  size_t
+  ascii_to_lower_scalar(const char* src, size_t size, char* dest) throw ()
+  {
+    return ascii_convert_scalar(src, size, dest, LowerChar());
+  }
+
+  size_t
+  ascii_to_upper_scalar(const char* src, size_t size, char* dest) throw ()
+  {
+    return ascii_convert_scalar(src, size, dest, UpperChar());
+  }
+
+  size_t
+  ascii_to_simplify_scalar(const char* src, size_t size, char* dest)
+    throw ()
+  {
+    return ascii_convert_scalar(src, size, dest, SimplifyChar());
+  }
+
+  const Functions SCALAR_FUNCTIONS =
+  {
+    find_table_scalar,
+    rfind_table_scalar,
+    find_chars_scalar,
+    rfind_chars_scalar,
+    to_lower_scalar,
+    to_upper_scalar,
+    find_block_scalar,
+    rfind_block_scalar,
+    ascii_size_scalar,
+    ascii_to_lower_scalar,
+    ascii_to_upper_scalar,
+    ascii_to_simplify_scalar
+  };
+
+#ifdef ASCII_STRING_MANIP_SIMD
+  bool ssse3_supported = false;
+  bool avx2_supported = false;
+
+  //
+  // SSE2 kernel, table scanning needs SSSE3
+  //
+
+  /*
+   * Table membership of 16 characters: the low nibble selects the masks
+   * byte, the high nibble selects the bit in it.
+   */
+  __attribute__((target("ssse3")))
+  inline
+  unsigned
+  table_mask_sse(const char* data, __m128i low, __m128i high) throw ()
+  {
+    const __m128i BLOCK =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i NIBBLE = _mm_set1_epi8(0x0F);
+    const __m128i LO = _mm_and_si128(BLOCK, NIBBLE);
+    const __m128i HI = _mm_and_si128(_mm_srli_epi16(BLOCK, 4), NIBBLE);
+    const __m128i IS_LOW = _mm_cmplt_epi8(HI, _mm_set1_epi8(8));
+    const __m128i ROW = _mm_or_si128(
+      _mm_and_si128(IS_LOW, _mm_shuffle_epi8(low, LO)),
+      _mm_andnot_si128(IS_LOW, _mm_shuffle_epi8(high, LO)));
+    const __m128i BIT = _mm_shuffle_epi8(
+      _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128), HI);
+    return _mm_movemask_epi8(
+      _mm_cmpeq_epi8(_mm_and_si128(ROW, BIT), BIT));
+  }
+
+  __attribute__((target("ssse3")))
+  const char*
+  find_table_sse(const char* begin, const char* end,
+    const CharTable& table, bool owned) throw ()
+  {
+    const __m128i LOW =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.nibbles()));
+    const __m128i HIGH = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(table.nibbles() + 16));
+    const unsigned INVERT = owned ? 0 : 0xFFFF;
+    for (; end - begin >= 16; begin += 16)
+    {
+      const unsigned MASK = table_mask_sse(begin, LOW, HIGH) ^ INVERT;
+      if (MASK)
+      {
+        return begin + __builtin_ctz(MASK);
+      }
+    }
+    return find_table_scalar(begin, end, table, owned);
+  }
+
+  __attribute__((target("ssse3")))
+  const char*
+  rfind_table_sse(const char* begin, const char* end,
+    const CharTable& table, bool owned) throw ()
+  {
+    const __m128i LOW =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.nibbles()));
+    const __m128i HIGH = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(table.nibbles() + 16));
+    const unsigned INVERT = owned ? 0 : 0xFFFF;
+    for (const char* pos = end; pos - begin >= 16; pos -= 16)
+    {
+      const unsigned MASK = table_mask_sse(pos - 16, LOW, HIGH) ^ INVERT;
+      if (MASK)
+      {
+        return pos - 16 + (31 - __builtin_clz(MASK));
+      }
+    }
+    const char* const TAIL = begin + (end - begin) % 16;
+    const char* const FOUND = rfind_table_scalar(begin, TAIL, table, owned);
+    return FOUND != TAIL ? FOUND : end;
+  }
+
+  inline
+  unsigned
+  chars_mask_sse2(const char* data, __m128i symbol1, __m128i symbol2,
+    __m128i symbol3) throw ()
+  {
+    const __m128i BLOCK =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    return _mm_movemask_epi8(_mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(BLOCK, symbol1),
+        _mm_cmpeq_epi8(BLOCK, symbol2)),
+      _mm_cmpeq_epi8(BLOCK, symbol3)));
+  }
+
+  const char*
+  find_chars_sse2(const char* begin, const char* end,
+    char symbol1, char symbol2, char symbol3, bool owned) throw ()
+  {
+    const __m128i SYMBOL1 = _mm_set1_epi8(symbol1);
+    const __m128i SYMBOL2 = _mm_set1_epi8(symbol2);
+    const __m128i SYMBOL3 = _mm_set1_epi8(symbol3);
+    const unsigned INVERT = owned ? 0 : 0xFFFF;
+    for (; end - begin >= 16; begin += 16)
+    {
+      const unsigned MASK =
+        chars_mask_sse2(begin, SYMBOL1, SYMBOL2, SYMBOL3) ^ INVERT;
+      if (MASK)
+      {
+        return begin + __builtin_ctz(MASK);
+      }
+    }
+    return find_chars_scalar(begin, end, symbol1, symbol2, symbol3, owned);
+  }
+
+  const char*
+  rfind_chars_sse2(const char* begin, const char* end,
+    char symbol1, char symbol2, char symbol3, bool owned) throw ()
+  {
+    const __m128i SYMBOL1 = _mm_set1_epi8(symbol1);
+    const __m128i SYMBOL2 = _mm_set1_epi8(symbol2);
+    const __m128i SYMBOL3 = _mm_set1_epi8(symbol3);
+    const unsigned INVERT = owned ? 0 : 0xFFFF;
+    for (const char* pos = end; pos - begin >= 16; pos -= 16)
+    {
+      const unsigned MASK =
+        chars_mask_sse2(pos - 16, SYMBOL1, SYMBOL2, SYMBOL3) ^ INVERT;
+      if (MASK)
+      {
+        return pos - 16 + (31 - __builtin_clz(MASK));
+      }
+    }
+    const char* const TAIL = begin + (end - begin) % 16;
+    const char* const FOUND = rfind_chars_scalar(begin, TAIL,
+      symbol1, symbol2, symbol3, owned);
+    return FOUND != TAIL ? FOUND : end;
+  }
+
+  /*
+   * Letters are selected with signed comparisons, bytes over 0x7F are
+   * negative and never match.
+   */
+  void
+  to_lower_sse2(char* begin, char* end) throw ()
+  {
+    const __m128i FROM = _mm_set1_epi8('A' - 1);
+    const __m128i TO = _mm_set1_epi8('Z' + 1);
+    const __m128i CASE = _mm_set1_epi8(0x20);
+    for (; end - begin >= 16; begin += 16)
+    {
+      __m128i* const DATA = reinterpret_cast<__m128i*>(begin);
+      const __m128i BLOCK = _mm_loadu_si128(DATA);
+      const __m128i UPPER = _mm_and_si128(_mm_cmpgt_epi8(BLOCK, FROM),
+        _mm_cmplt_epi8(BLOCK, TO));
+      _mm_storeu_si128(DATA,
+        _mm_or_si128(BLOCK, _mm_and_si128(UPPER, CASE)));
+    }
+    to_lower_scalar(begin, end);
+  }
+
+  void
+  to_upper_sse2(char* begin, char* end) throw ()
+  {
+    const __m128i FROM = _mm_set1_epi8('a' - 1);
+    const __m128i TO = _mm_set1_epi8('z' + 1);
+    const __m128i CASE = _mm_set1_epi8(0x20);
+    for (; end - begin >= 16; begin += 16)
+    {
+      __m128i* const DATA = reinterpret_cast<__m128i*>(begin);
+      const __m128i BLOCK = _mm_loadu_si128(DATA);
+      const __m128i LOWER = _mm_and_si128(_mm_cmpgt_epi8(BLOCK, FROM),
+        _mm_cmplt_epi8(BLOCK, TO));
+      _mm_storeu_si128(DATA,
+        _mm_xor_si128(BLOCK, _mm_and_si128(LOWER, CASE)));
+    }
+    to_upper_scalar(begin, end);
+  }
+
+  /*
+   * Byte string search: candidates are the positions where both the
+   * first and the last bytes of the needle match, only they are
+   * compared completely.
+   */
+  inline
+  unsigned
+  block_mask_sse2(const char* pos, size_t needle_size, __m128i first,
+    __m128i last) throw ()
+  {
+    return _mm_movemask_epi8(_mm_and_si128(
+      _mm_cmpeq_epi8(first,
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))),
+      _mm_cmpeq_epi8(last, _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(pos + needle_size - 1)))));
+  }
+
+  /**
+   * Checks the candidates of the block completely
+   * @param block the first candidate
+   * @param mask candidates bits
+   * @param reverse if the last matching candidate should be found
+   * @return the found candidate or NULL if none
+   */
+  inline
+  const char*
+  check_candidates(const char* block, unsigned mask, const char* needle,
+    size_t needle_size, bool reverse) throw ()
+  {
+    while (mask)
+    {
+      const unsigned BIT = reverse ? 31 - __builtin_clz(mask) :
+        __builtin_ctz(mask);
+      if (!memcmp(block + BIT + 1, needle + 1, needle_size - 2))
+      {
+        return block + BIT;
+      }
+      mask ^= 1u << BIT;
+    }
+    return 0;
+  }
+
+  const char*
+  find_block_sse2(const char* str, size_t size, const char* needle,
+    size_t needle_size) throw ()
+  {
+    if (needle_size < 2 || needle_size > size)
+    {
+      return find_block_scalar(str, size, needle, needle_size);
+    }
+    const __m128i FIRST = _mm_set1_epi8(*needle);
+    const __m128i LAST = _mm_set1_epi8(needle[needle_size - 1]);
+    // Candidates are [str, END)
+    const char* const END = str + size - needle_size + 1;
+    const char* pos = str;
+    for (; END - pos >= 16; pos += 16)
+    {
+      if (const char* found = check_candidates(pos,
+        block_mask_sse2(pos, needle_size, FIRST, LAST), needle,
+        needle_size, false))
+      {
+        return found;
+      }
+    }
+    if (pos == END || END - str < 16)
+    {
+      return find_block_scalar(pos, END - pos + needle_size - 1,
+        needle, needle_size);
+    }
+    // The rest is checked in the block overlapping the checked candidates
+    const char* const BLOCK = END - 16;
+    return check_candidates(BLOCK,
+      block_mask_sse2(BLOCK, needle_size, FIRST, LAST) &
+        (0xFFFF << (pos - BLOCK)), needle, needle_size, false);
+  }
+
+  const char*
+  rfind_block_sse2(const char* str, size_t size, const char* needle,
+    size_t needle_size) throw ()
+  {
+    if (needle_size < 2 || needle_size > size)
+    {
+      return rfind_block_scalar(str, size, needle, needle_size);
+    }
+    const __m128i FIRST = _mm_set1_epi8(*needle);
+    const __m128i LAST = _mm_set1_epi8(needle[needle_size - 1]);
+    const char* end = str + size - needle_size + 1;
+    const char* const END = end;
+    for (; end - str >= 16; end -= 16)
+    {
+      if (const char* found = check_candidates(end - 16,
+        block_mask_sse2(end - 16, needle_size, FIRST, LAST), needle,
+        needle_size, true))
+      {
+        return found;
+      }
+    }
+    if (end == str || END - str < 16)
+    {
+      return rfind_block_scalar(str, end - str + needle_size - 1,
+        needle, needle_size);
+    }
+    return check_candidates(str,
+      block_mask_sse2(str, needle_size, FIRST, LAST) &
+        ((1u << (end - str)) - 1), needle, needle_size, true);
+  }
+
+  /*
+   * ASCII runs: blocks are checked with the sign bits, the first one
+   * with a byte over 0x7F is finished by the scalar code. The tail is
+   * an overlapping last block, the conversions are idempotent so
+   * converting a part of it twice is harmless even in place.
+   */
+  inline
+  __m128i
+  in_range_sse2(__m128i block, char from, char to) throw ()
+  {
+    return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(from - 1)),
+      _mm_cmplt_epi8(block, _mm_set1_epi8(to + 1)));
+  }
+
+  struct LowerSSE2 : public LowerChar
+  {
+    using LowerChar::operator ();
+
+    __m128i
+    operator ()(__m128i block) const throw ()
+    {
+      return _mm_or_si128(block,
+        _mm_and_si128(in_range_sse2(block, 'A', 'Z'), _mm_set1_epi8(0x20)));
+    }
+  };
+
+  struct UpperSSE2 : public UpperChar
+  {
+    using UpperChar::operator ();
+
+    __m128i
+    operator ()(__m128i block) const throw ()
+    {
+      return _mm_xor_si128(block,
+        _mm_and_si128(in_range_sse2(block, 'a', 'z'), _mm_set1_epi8(0x20)));
+    }
+  };
+
+  struct SimplifySSE2 : public SimplifyChar
+  {
+    using SimplifyChar::operator ();
+
+    /*
+     * Digits have the case bit set already, so the lowered block gives
+     * both letters and digits
+     */
+    __m128i
+    operator ()(__m128i block) const throw ()
+    {
+      const __m128i LOWER = _mm_or_si128(block, _mm_set1_epi8(0x20));
+      const __m128i KEEP = _mm_or_si128(in_range_sse2(LOWER, 'a', 'z'),
+        in_range_sse2(block, '0', '9'));
+      return _mm_or_si128(_mm_and_si128(KEEP, LOWER),
+        _mm_andnot_si128(KEEP, _mm_set1_epi8(' ')));
+    }
+  };
+
+  size_t
+  ascii_size_sse2(const char* str, size_t size) throw ()
+  {
+    if (size < 16)
+    {
+      return ascii_size_scalar(str, size);
+    }
+    size_t i = 0;
+    for (; size - i >= 16; i += 16)
+    {
+      const unsigned MASK = _mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i)));
+      if (MASK)
+      {
+        return i + __builtin_ctz(MASK);
+      }
+    }
+    if (i == size)
+    {
+      return size;
+    }
+    const unsigned MASK = _mm_movemask_epi8(_mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(str + size - 16)));
+    return MASK ? size - 16 + __builtin_ctz(MASK) : size;
+  }
+
+  template <typename Convert>
+  size_t
+  ascii_convert_sse2(const char* src, size_t size, char* dest,
+    Convert convert) throw ()
+  {
+    if (size < 16)
+    {
+      return ascii_convert_scalar(src, size, dest, convert);
+    }
+    size_t i = 0;
+    for (; size - i >= 16; i += 16)
+    {
+      const __m128i BLOCK =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      const unsigned MASK = _mm_movemask_epi8(BLOCK);
+      if (MASK)
+      {
+        return i + ascii_convert_scalar(src + i, __builtin_ctz(MASK),
+          dest + i, convert);
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+        convert(BLOCK));
+    }
+    if (i == size)
+    {
+      return size;
+    }
+    i = size - 16;
+    const __m128i BLOCK =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const unsigned MASK = _mm_movemask_epi8(BLOCK);
+    if (MASK)
+    {
+      return i + ascii_convert_scalar(src + i, __builtin_ctz(MASK),
+        dest + i, convert);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), convert(BLOCK));
+    return size;
+  }
+
+  size_t
+  ascii_to_lower_sse2(const char* src, size_t size, char* dest) throw ()
+  {
+    return ascii_convert_sse2(src, size, dest, LowerSSE2());
+  }
+
+  size_t
+  ascii_to_upper_sse2(const char* src, size_t size, char* dest) throw ()
+  {
+    return ascii_convert_sse2(src, size, dest, UpperSSE2());
+  }
+
+  size_t
+  ascii_to_simplify_sse2(const char* src, size_t size, char* dest)
+    throw ()
+  {
+    return ascii_convert_sse2(src, size, dest, SimplifySSE2());
+  }
+
+  const Functions SSE2_FUNCTIONS =
+  {
+    find_table_sse,
+    rfind_table_sse,
+    find_chars_sse2,
+    rfind_chars_sse2,
+    to_lower_sse2,
+    to_upper_sse2,
+    find_block_sse2,
+    rfind_block_sse2,
+    ascii_size_sse2,
+    ascii_to_lower_sse2,
+    ascii_to_upper_sse2,
+    ascii_to_simplify_sse2
+  };
+
+  const Functions SSE2_NO_SSSE3_FUNCTIONS =
+  {
+    find_table_scalar,
+    rfind_table_scalar,
+    find_chars_sse2,
+    rfind_chars_sse2,
+    to_lower_sse2,
+    to_upper_sse2,
+    find_block_sse2,
+    rfind_block_sse2,
+    ascii_size_sse2,
+    ascii_to_lower_sse2,
+    ascii_to_upper_sse2,
+    ascii_to_simplify_sse2
+  };
+
+  //
+  // AVX2 kernel, tails are passed to SSE2 one. Upper halves of
+  // registers are cleared before the SSE2 code, otherwise every legacy
+  // SSE instruction is penalized.
+  //
+
+  __attribute__((target("avx2")))
+  inline
+  __m256i
+  broadcast(const uint8_t* data) throw ()
+  {
+    const __m128i HALF =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(HALF), HALF, 1);
+  }
+
+  __attribute__((target("avx2")))
+  inline
+  unsigned
+  table_mask_avx2(const char* data, __m256i low, __m256i high) throw ()
+  {
+    const __m256i BLOCK =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    const __m256i NIBBLE = _mm256_set1_epi8(0x0F);
+    const __m256i LO = _mm256_and_si256(BLOCK, NIBBLE);
+    const __m256i HI =
+      _mm256_and_si256(_mm256_srli_epi16(BLOCK, 4), NIBBLE);
+    const __m256i IS_LOW = _mm256_cmpgt_epi8(_mm256_set1_epi8(8), HI);
+    const __m256i ROW = _mm256_blendv_epi8(_mm256_shuffle_epi8(high, LO),
+      _mm256_shuffle_epi8(low, LO), IS_LOW);
+    const __m256i BIT = _mm256_shuffle_epi8(
+      _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128), HI);
+    return _mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_and_si256(ROW, BIT), BIT));
+  }
+
+  __attribute__((target("avx2")))
+  const char*
+  find_table_avx2(const char* begin, const char* end,
+    const CharTable& table, bool owned) throw ()
+  {
+    const __m256i LOW = broadcast(table.nibbles());
+    const __m256i HIGH = broadcast(table.nibbles() + 16);
+    const unsigned INVERT = owned ? 0 : 0xFFFFFFFF;
+    for (; end - begin >= 32; begin += 32)
+    {
+      const unsigned MASK = table_mask_avx2(begin, LOW, HIGH) ^ INVERT;
+      if (MASK)
+      {
+        return begin + __builtin_ctz(MASK);
+      }
+    }
+    _mm256_zeroupper();
+    return find_table_sse(begin, end, table, owned);
+  }
+
+  __attribute__((target("avx2")))
+  const char*
+  rfind_table_avx2(const char* begin, const char* end,
+    const CharTable& table, bool owned) throw ()
+  {
+    const __m256i LOW = broadcast(table.nibbles());
+    const __m256i HIGH = broadcast(table.nibbles() + 16);
+    const unsigned INVERT = owned ? 0 : 0xFFFFFFFF;
+    for (const char* pos = end; pos - begin >= 32; pos -= 32)
+    {
+      const unsigned MASK = table_mask_avx2(pos - 32, LOW, HIGH) ^ INVERT;
+      if (MASK)
+      {
+        return pos - 32 + (31 - __builtin_clz(MASK));
+      }
+    }
+    const char* const TAIL = begin + (end - begin) % 32;
+    _mm256_zeroupper();
+    const char* const FOUND = rfind_table_sse(begin, TAIL, table, owned);
+    return FOUND != TAIL ? FOUND : end;
+  }
+
+  __attribute__((target("avx2")))
+  inline
+  unsigned
+  chars_mask_avx2(const char* data, __m256i symbol1, __m256i symbol2,
+    __m256i symbol3) throw ()
+  {
+    const __m256i BLOCK =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    return _mm256_movemask_epi8(_mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(BLOCK, symbol1),
+        _mm256_cmpeq_epi8(BLOCK, symbol2)),
+      _mm256_cmpeq_epi8(BLOCK, symbol3)));
+  }
+
+  __attribute__((target("avx2")))
+  const char*
+  find_chars_avx2(const char* begin, const char* end,
+    char symbol1, char symbol2, char symbol3, bool owned) throw ()
+  {
+    const __m256i SYMBOL1 = _mm256_set1_epi8(symbol1);
+    const __m256i SYMBOL2 = _mm256_set1_epi8(symbol2);
+    const __m256i SYMBOL3 = _mm256_set1_epi8(symbol3);
+    const unsigned INVERT = owned ? 0 : 0xFFFFFFFF;
+    for (; end - begin >= 32; begin += 32)
+    {
+      const unsigned MASK =
+        chars_mask_avx2(begin, SYMBOL1, SYMBOL2, SYMBOL3) ^ INVERT;
+      if (MASK)
+      {
+        return begin + __builtin_ctz(MASK);
+      }
+    }
+    _mm256_zeroupper();
+    return find_chars_sse2(begin, end, symbol1, symbol2, symbol3, owned);
+  }
+
+  __attribute__((target("avx2")))
+  const char*
+  rfind_chars_avx2(const char* begin, const char* end,
+    char symbol1, char symbol2, char symbol3, bool owned) throw ()
+  {
+    const __m256i SYMBOL1 = _mm256_set1_epi8(symbol1);
+    const __m256i SYMBOL2 = _mm256_set1_epi8(symbol2);
+    const __m256i SYMBOL3 = _mm256_set1_epi8(symbol3);
+    const unsigned INVERT = owned ? 0 : 0xFFFFFFFF;
+    for (const char* pos = end; pos - begin >= 32; pos -= 32)
+    {
+      const unsigned MASK =
+        chars_mask_avx2(pos - 32, SYMBOL1, SYMBOL2, SYMBOL3) ^ INVERT;
+      if (MASK)
+      {
+        return pos - 32 + (31 - __builtin_clz(MASK));
+      }
+    }
+    const char* const TAIL = begin + (end - begin) % 32;
+    _mm256_zeroupper();
+    const char* const FOUND = rfind_chars_sse2(begin, TAIL,
+      symbol1, symbol2, symbol3, owned);
+    return FOUND != TAIL ? FOUND : end;
+  }
+
+  __attribute__((target("avx2")))
+  void
+  to_lower_avx2(char* begin, char* end) throw ()
+  {
+    const __m256i FROM = _mm256_set1_epi8('A' - 1);
+    const __m256i TO = _mm256_set1_epi8('Z' + 1);
+    const __m256i CASE = _mm256_set1_epi8(0x20);
+    for (; end - begin >= 32; begin += 32)
+    {
+      __m256i* const DATA = reinterpret_cast<__m256i*>(begin);
+      const __m256i BLOCK = _mm256_loadu_si256(DATA);
+      const __m256i UPPER = _mm256_and_si256(
+        _mm256_cmpgt_epi8(BLOCK, FROM), _mm256_cmpgt_epi8(TO, BLOCK));
+      _mm256_storeu_si256(DATA,
+        _mm256_or_si256(BLOCK, _mm256_and_si256(UPPER, CASE)));
+    }
+    _mm256_zeroupper();
+    to_lower_sse2(begin, end);
+  }
+
+  __attribute__((target("avx2")))
+  void
+  to_upper_avx2(char* begin, char* end) throw ()
+  {
+    const __m256i FROM = _mm256_set1_epi8('a' - 1);
+    const __m256i TO = _mm256_set1_epi8('z' + 1);
+    const __m256i CASE = _mm256_set1_epi8(0x20);
+    for (; end - begin >= 32; begin += 32)
+    {
+      __m256i* const DATA = reinterpret_cast<__m256i*>(begin);
+      const __m256i BLOCK = _mm256_loadu_si256(DATA);
+      const __m256i LOWER = _mm256_and_si256(
+        _mm256_cmpgt_epi8(BLOCK, FROM), _mm256_cmpgt_epi8(TO, BLOCK));
+      _mm256_storeu_si256(DATA,
+        _mm256_xor_si256(BLOCK, _mm256_and_si256(LOWER, CASE)));
+    }
+    _mm256_zeroupper();
+    to_upper_sse2(begin, end);
+  }
+
+  __attribute__((target("avx2")))
+  inline
+  unsigned
+  block_mask_avx2(const char* pos, size_t needle_size, __m256i first,
+    __m256i last) throw ()
+  {
+    return _mm256_movemask_epi8(_mm256_and_si256(
+      _mm256_cmpeq_epi8(first,
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos))),
+      _mm256_cmpeq_epi8(last, _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(pos + needle_size - 1)))));
+  }
+
+  __attribute__((target("avx2")))
+  const char*
+  find_block_avx2(const char* str, size_t size, const char* needle,
+    size_t needle_size) throw ()
+  {
+    if (needle_size < 2 || needle_size > size)
+    {
+      return find_block_scalar(str, size, needle, needle_size);
+    }
+    const __m256i FIRST = _mm256_set1_epi8(*needle);
+    const __m256i LAST = _mm256_set1_epi8(needle[needle_size - 1]);
+    const char* const END = str + size - needle_size + 1;
+    const char* pos = str;
+    for (; END - pos >= 32; pos += 32)
+    {
+      if (const char* found = check_candidates(pos,
+        block_mask_avx2(pos, needle_size, FIRST, LAST), needle,
+        needle_size, false))
+      {
+        _mm256_zeroupper();
+        return found;
+      }
+    }
+    if (pos != END && END - str >= 32)
+    {
+      const char* const BLOCK = END - 32;
+      const char* const FOUND = check_candidates(BLOCK,
+        block_mask_avx2(BLOCK, needle_size, FIRST, LAST) &
+          (0xFFFFFFFF << (pos - BLOCK)), needle, needle_size, false);
+      _mm256_zeroupper();
+      return FOUND;
+    }
+    _mm256_zeroupper();
+    return find_block_sse2(pos, END - pos + needle_size - 1,
+      needle, needle_size);
+  }
+
+  __attribute__((target("avx2")))
+  const char*
+  rfind_block_avx2(const char* str, size_t size, const char* needle,
+    size_t needle_size) throw ()
+  {
+    if (needle_size < 2 || needle_size > size)
+    {
+      return rfind_block_scalar(str, size, needle, needle_size);
+    }
+    const __m256i FIRST = _mm256_set1_epi8(*needle);
+    const __m256i LAST = _mm256_set1_epi8(needle[needle_size - 1]);
+    const char* const END = str + size - needle_size + 1;
+    const char* end = END;
+    for (; end - str >= 32; end -= 32)
+    {
+      if (const char* found = check_candidates(end - 32,
+        block_mask_avx2(end - 32, needle_size, FIRST, LAST), needle,
+        needle_size, true))
+      {
+        _mm256_zeroupper();
+        return found;
+      }
+    }
+    if (end != str && END - str >= 32)
+    {
+      const char* const FOUND = check_candidates(str,
+        block_mask_avx2(str, needle_size, FIRST, LAST) &
+          ((1u << (end - str)) - 1), needle, needle_size, true);
+      _mm256_zeroupper();
+      return FOUND;
+    }
+    _mm256_zeroupper();
+    return rfind_block_sse2(str, end - str + needle_size - 1,
+      needle, needle_size);
+  }
+
+  __attribute__((target("avx2")))
+  inline
+  __m256i
+  in_range_avx2(__m256i block, char from, char to) throw ()
+  {
+    return _mm256_and_si256(
+      _mm256_cmpgt_epi8(block, _mm256_set1_epi8(from - 1)),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(to + 1), block));
+  }
+
+  struct LowerAVX2
+  {
+    typedef LowerSSE2 Tail;
+
+    __attribute__((target("avx2")))
+    __m256i
+    operator ()(__m256i block) const throw ()
+    {
+      return _mm256_or_si256(block, _mm256_and_si256(
+        in_range_avx2(block, 'A', 'Z'), _mm256_set1_epi8(0x20)));
+    }
+  };
+
+  struct UpperAVX2
+  {
+    typedef UpperSSE2 Tail;
+
+    __attribute__((target("avx2")))
+    __m256i
+    operator ()(__m256i block) const throw ()
+    {
+      return _mm256_xor_si256(block, _mm256_and_si256(
+        in_range_avx2(block, 'a', 'z'), _mm256_set1_epi8(0x20)));
+    }
+  };
+
+  struct SimplifyAVX2
+  {
+    typedef SimplifySSE2 Tail;
+
+    __attribute__((target("avx2")))
+    __m256i
+    operator ()(__m256i block) const throw ()
+    {
+      const __m256i LOWER = _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+      const __m256i KEEP = _mm256_or_si256(
+        in_range_avx2(LOWER, 'a', 'z'), in_range_avx2(block, '0', '9'));
+      return _mm256_or_si256(_mm256_and_si256(KEEP, LOWER),
+        _mm256_andnot_si256(KEEP, _mm256_set1_epi8(' ')));
+    }
+  };
+
+  __attribute__((target("avx2")))
+  size_t
+  ascii_size_avx2(const char* str, size_t size) throw ()
+  {
+    size_t i = 0;
+    for (; size - i >= 32; i += 32)
+    {
+      const unsigned MASK = _mm256_movemask_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i)));
+      if (MASK)
+      {
+        _mm256_zeroupper();
+        return i + __builtin_ctz(MASK);
+      }
+    }
+    _mm256_zeroupper();
+    return i + ascii_size_sse2(str + i, size - i);
+  }
+
+  template <typename Convert>
+  __attribute__((target("avx2")))
+  size_t
+  ascii_convert_avx2(const char* src, size_t size, char* dest,
+    Convert convert) throw ()
+  {
+    size_t i = 0;
+    for (; size - i >= 32; i += 32)
+    {
+      const __m256i BLOCK =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+      const unsigned MASK = _mm256_movemask_epi8(BLOCK);
+      if (MASK)
+      {
+        _mm256_zeroupper();
+        return i + ascii_convert_scalar(src + i, __builtin_ctz(MASK),
+          dest + i, typename Convert::Tail());
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+        convert(BLOCK));
+    }
+    _mm256_zeroupper();
+    return i + ascii_convert_sse2(src + i, size - i, dest + i,
+      typename Convert::Tail());
+  }
+
+  size_t
+  ascii_to_lower_avx2(const char* src, size_t size, char* dest) throw ()
+  {
+    return ascii_convert_avx2(src, size, dest, LowerAVX2());
+  }
+
+  size_t
+  ascii_to_upper_avx2(const char* src, size_t size, char* dest) throw ()
+  {
+    return ascii_convert_avx2(src, size, dest, UpperAVX2());
+  }
+
+  size_t
+  ascii_to_simplify_avx2(const char* src, size_t size, char* dest)
+    throw ()
+  {
+    return ascii_convert_avx2(src, size, dest, SimplifyAVX2());
+  }
+
+  const Functions AVX2_FUNCTIONS =
+  {
+    find_table_avx2,
+    rfind_table_avx2,
+    find_chars_avx2,
+    rfind_chars_avx2,
+    to_lower_avx2,
+    to_upper_avx2,
+    find_block_avx2,
+    rfind_block_avx2,
+    ascii_size_avx2,
+    ascii_to_lower_avx2,
+    ascii_to_upper_avx2,
+    ascii_to_simplify_avx2
+  };
+#endif
+
+  pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+
+  void
+  init_cpu() throw ()
+  {
+#ifdef ASCII_STRING_MANIP_SIMD
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+      return;
+    }
+    ssse3_supported = ecx & bit_SSSE3;
+
+    // AVX state must be enabled by OS
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX) ||
+      __get_cpuid_max(0, 0) < 7)
+    {
+      return;
+    }
+    unsigned xcr0, xcr0_high;
+    __asm__ ("xgetbv" : "=a" (xcr0), "=d" (xcr0_high) : "c" (0));
+    if ((xcr0 & 6) != 6)
+    {
+      return;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    avx2_supported = ebx & bit_AVX2;
+#endif
+  }
+
+  const char*
+  find_table_dispatch(const char* begin, const char* end,
+    const CharTable& table, bool owned) throw ();
+  const char*
+  rfind_table_dispatch(const char* begin, const char* end,
+    const CharTable& table, bool owned) throw ();
+  const char*
+  find_chars_dispatch(const char* begin, const char* end,
+    char symbol1, char symbol2, char symbol3, bool owned) throw ();
+  const char*
+  rfind_chars_dispatch(const char* begin, const char* end,
+    char symbol1, char symbol2, char symbol3, bool owned) throw ();
+  void
+  to_lower_dispatch(char* begin, char* end) throw ();
+  void
+  to_upper_dispatch(char* begin, char* end) throw ();
+  const char*
+  find_block_dispatch(const char* str, size_t size, const char* needle,
+    size_t needle_size) throw ();
+  const char*
+  rfind_block_dispatch(const char* str, size_t size, const char* needle,
+    size_t needle_size) throw ();
+  size_t
+  ascii_size_dispatch(const char* str, size_t size) throw ();
+  size_t
+  ascii_to_lower_dispatch(const char* src, size_t size, char* dest)
+    throw ();
+  size_t
+  ascii_to_upper_dispatch(const char* src, size_t size, char* dest)
+    throw ();
+  size_t
+  ascii_to_simplify_dispatch(const char* src, size_t size, char* dest)
+    throw ();
+}
+
+namespace String
+{
+  namespace AsciiStringManip
+  {
+    bool
+    supported(Kernel kernel) throw ()
+    {
+      pthread_once(&cpu_once, init_cpu);
+
+      switch (kernel)
+      {
+      case K_SCALAR:
+        return true;
+#ifdef ASCII_STRING_MANIP_SIMD
+      case K_SSE2:
+        return true;
+      case K_AVX2:
+        return avx2_supported;
+#endif
+      default:
+        return false;
+      }
+    }
+
+    namespace Kernels
+    {
+      Functions selected =
+      {
+        find_table_dispatch,
+        rfind_table_dispatch,
+        find_chars_dispatch,
+        rfind_chars_dispatch,
+        to_lower_dispatch,
+        to_upper_dispatch,
+        find_block_dispatch,
+        rfind_block_dispatch,
+        ascii_size_dispatch,
+        ascii_to_lower_dispatch,
+        ascii_to_upper_dispatch,
+        ascii_to_simplify_dispatch
+      };
+
+      const Functions&
+      functions(Kernel kernel) throw ()
+      {
+        pthread_once(&cpu_once, init_cpu);
+
+#ifdef ASCII_STRING_MANIP_SIMD
+        if (kernel == K_AVX2 && avx2_supported)
+        {
+          return AVX2_FUNCTIONS;
+        }
+        if (kernel != K_SCALAR)
+        {
+          return ssse3_supported ? SSE2_FUNCTIONS : SSE2_NO_SSSE3_FUNCTIONS;
+        }
+#endif
+        return SCALAR_FUNCTIONS;
       }
     }
   }
 }
+
+namespace
+{
+  /**
+   * Replaces the dispatching functions with the selected kernel ones
+   * @return selected functions
+   */
+  const Functions&
+  select_functions() throw ()
+  {
+    using String::AsciiStringManip::Kernels::selected;
+
+    const Functions& FUNCTIONS =
+      String::AsciiStringManip::Kernels::functions(
+        String::AsciiStringManip::K_AVX2);
+    __atomic_store_n(&selected.find_table, FUNCTIONS.find_table,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.rfind_table, FUNCTIONS.rfind_table,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.find_chars, FUNCTIONS.find_chars,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.rfind_chars, FUNCTIONS.rfind_chars,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.to_lower, FUNCTIONS.to_lower,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.to_upper, FUNCTIONS.to_upper,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.find_block, FUNCTIONS.find_block,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.rfind_block, FUNCTIONS.rfind_block,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.ascii_size, FUNCTIONS.ascii_size,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.ascii_to_lower, FUNCTIONS.ascii_to_lower,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.ascii_to_upper, FUNCTIONS.ascii_to_upper,
+      __ATOMIC_RELEASE);
+    __atomic_store_n(&selected.ascii_to_simplify,
+      FUNCTIONS.ascii_to_simplify, __ATOMIC_RELEASE);
+    return FUNCTIONS;
+  }
+
+  const char*
+  find_table_dispatch(const char* begin, const char* end,
+    const CharTable& table, bool owned) throw ()
+  {
+    return select_functions().find_table(begin, end, table, owned);
+  }
+
+  const char*
+  rfind_table_dispatch(const char* begin, const char* end,
+    const CharTable& table, bool owned) throw ()
+  {
+    return select_functions().rfind_table(begin, end, table, owned);
+  }
+
+  const char*
+  find_chars_dispatch(const char* begin, const char* end,
+    char symbol1, char symbol2, char symbol3, bool owned) throw ()
+  {
+    return select_functions().find_chars(begin, end,
+      symbol1, symbol2, symbol3, owned);
+  }
+
+  const char*
+  rfind_chars_dispatch(const char* begin, const char* end,
+    char symbol1, char symbol2, char symbol3, bool owned) throw ()
+  {
+    return select_functions().rfind_chars(begin, end,
+      symbol1, symbol2, symbol3, owned);
+  }
+
+  void
+  to_lower_dispatch(char* begin, char* end) throw ()
+  {
+    select_functions().to_lower(begin, end);
+  }
+
+  void
+  to_upper_dispatch(char* begin, char* end) throw ()
+  {
+    select_functions().to_upper(begin, end);
+  }
+
+  const char*
+  find_block_dispatch(const char* str, size_t size, const char* needle,
+    size_t needle_size) throw ()
+  {
+    return select_functions().find_block(str, size, needle, needle_size);
+  }
+
+  const char*
+  rfind_block_dispatch(const char* str, size_t size, const char* needle,
+    size_t needle_size) throw ()
+  {
+    return select_functions().rfind_block(str, size, needle, needle_size);
+  }
+
+  size_t
+  ascii_size_dispatch(const char* str, size_t size) throw ()
+  {
+    return select_functions().ascii_size(str, size);
+  }
+
+  size_t
+  ascii_to_lower_dispatch(const char* src, size_t size, char* dest)
+    throw ()
+  {
+    return select_functions().ascii_to_lower(src, size, dest);
+  }
+
+  size_t
+  ascii_to_upper_dispatch(const char* src, size_t size, char* dest)
+    throw ()
+  {
+    return select_functions().ascii_to_upper(src, size, dest);
+  }
+
+  size_t
+  ascii_to_simplify_dispatch(const char* src, size_t size, char* dest)
+    throw ()
+  {
+    return select_functions().ascii_to_simplify(src, size, dest);
+  }
+}
+
+namespace String
+{
+  namespace AsciiStringManip
+  {
+    const char*
+    find_block(const char* str, size_t size, const char* needle,
+      size_t needle_size) throw ()
+    {
+      return __atomic_load_n(&Kernels::selected.find_block,
+        __ATOMIC_ACQUIRE)(str, size, needle, needle_size);
+    }
+
+    const char*
+    rfind_block(const char* str, size_t size, const char* needle,
+      size_t needle_size) throw ()
+    {
+      return __atomic_load_n(&Kernels::selected.rfind_block,
+        __ATOMIC_ACQUIRE)(str, size, needle, needle_size);
+    }
+
+    size_t
+    ascii_size(const char* str, size_t size) throw ()
+    {
+      return __atomic_load_n(&Kernels::selected.ascii_size,
+        __ATOMIC_ACQUIRE)(str, size);
+    }
+
+    size_t
+    ascii_to_lower(const char* src, size_t size, char* dest) throw ()
+    {
+      return __atomic_load_n(&Kernels::selected.ascii_to_lower,
+        __ATOMIC_ACQUIRE)(src, size, dest);
+    }
+
+    size_t
+    ascii_to_upper(const char* src, size_t size, char* dest) throw ()
+    {
+      return __atomic_load_n(&Kernels::selected.ascii_to_upper,
+        __ATOMIC_ACQUIRE)(src, size, dest);
+    }
+
+    size_t
+    ascii_to_simplify(const char* src, size_t size, char* dest) throw ()
+    {
+      return __atomic_load_n(&Kernels::selected.ascii_to_simplify,
+        __ATOMIC_ACQUIRE)(src, size, dest);
+    }
+  }
+}
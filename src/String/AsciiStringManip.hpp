@@ -63,6 +63,14 @@ namespace String
     to_upper(std::string& dest) throw ()
       __attribute__((always_inline));
 
+    void
+    to_lower(char* first, char* last) throw ()
+      __attribute__((always_inline));
+
+    void
+    to_upper(char* first, char* last) throw ()
+      __attribute__((always_inline));
+
     template <typename Iterator>
     void
     to_lower(Iterator first, Iterator last) throw (eh::Exception)
@@ -73,6 +81,48 @@ namespace String
     to_upper(Iterator first, Iterator last) throw (eh::Exception)
       __attribute__((always_inline));
 
+    /**
+     * Finds the leading run of ASCII (0-127) chars with the fastest
+     * kernel supported by CPU
+     * @param str string to check
+     * @param size its size
+     * @return length of the run
+     */
+    size_t
+    ascii_size(const char* str, size_t size) throw ();
+
+    /**
+     * Copies the leading run of ASCII chars converting them to lower case
+     * @param src string to convert
+     * @param size its size
+     * @param dest destination of the converted run
+     * @return length of the run
+     */
+    size_t
+    ascii_to_lower(const char* src, size_t size, char* dest) throw ();
+
+    /**
+     * Copies the leading run of ASCII chars converting them to upper case
+     * @param src string to convert
+     * @param size its size
+     * @param dest destination of the converted run
+     * @return length of the run
+     */
+    size_t
+    ascii_to_upper(const char* src, size_t size, char* dest) throw ();
+
+    /**
+     * Copies the leading run of ASCII chars the way String::Simplify
+     * does: letters are converted to lower case, digits are kept,
+     * other chars are replaced with spaces
+     * @param src string to convert
+     * @param size its size
+     * @param dest destination of the converted run
+     * @return length of the run
+     */
+    size_t
+    ascii_to_simplify(const char* src, size_t size, char* dest) throw ();
+
     namespace Category
     {
       /**
@@ -243,8 +293,22 @@ namespace String
         operator ()(char ch) const throw ()
           __attribute__((always_inline));
 
+        /**
+         * Masks for vectorized scanning, indexed by the low nibble of
+         * a character. The first 16 bytes have bit N set if the
+         * character with high nibble N is in the set, the second 16
+         * bytes do the same for high nibble 8 + N.
+         * @return 32 bytes of masks
+         */
+        const uint8_t*
+        nibbles() const throw ();
+
       private:
+        void
+        init_nibbles_() throw ();
+
         bool table_[256];
+        uint8_t nibbles_[32];
       };
 
       /**
@@ -458,6 +522,87 @@ namespace String
     void
     hex_to_buf(const SubString& data, char* buf) throw ()
       __attribute__((always_inline));
+
+    /**
+     * Implementations of the bulk scanning and case conversion. All of
+     * them give the same results, categories, to_lower() and to_upper()
+     * use the fastest one supported by CPU for blocks not shorter than
+     * INLINE_SIZE.
+     */
+    enum Kernel
+    {
+      K_SCALAR, ///< one byte per iteration
+      K_SSE2, ///< 16 bytes per iteration, CharTable scanning needs SSSE3
+      K_AVX2 ///< 32 bytes per iteration
+    };
+
+    /// Smaller blocks are processed inline byte by byte
+    const size_t INLINE_SIZE = 16;
+
+    /**
+     * Checks if the kernel can be used on this CPU
+     * @param kernel kernel to check
+     * @return whether or not the kernel is supported
+     */
+    bool
+    supported(Kernel kernel) throw ();
+
+    namespace Kernels
+    {
+      /**
+       * Functions of a kernel. find functions return the first
+       * character of [begin, end) which belongs (owned is true) or does
+       * not belong to the set, rfind functions return the last one,
+       * both return end if none. find_block and rfind_block are
+       * find_block() and rfind_block() declared in SubString.hpp, ascii_*
+       * are the functions of the same names.
+       */
+      struct Functions
+      {
+        const char*
+        (*find_table)(const char* begin, const char* end,
+          const Category::CharTable& table, bool owned);
+        const char*
+        (*rfind_table)(const char* begin, const char* end,
+          const Category::CharTable& table, bool owned);
+        const char*
+        (*find_chars)(const char* begin, const char* end,
+          char symbol1, char symbol2, char symbol3, bool owned);
+        const char*
+        (*rfind_chars)(const char* begin, const char* end,
+          char symbol1, char symbol2, char symbol3, bool owned);
+        void
+        (*to_lower)(char* begin, char* end);
+        void
+        (*to_upper)(char* begin, char* end);
+        const char*
+        (*find_block)(const char* str, size_t size, const char* needle,
+          size_t needle_size);
+        const char*
+        (*rfind_block)(const char* str, size_t size, const char* needle,
+          size_t needle_size);
+        size_t
+        (*ascii_size)(const char* str, size_t size);
+        size_t
+        (*ascii_to_lower)(const char* src, size_t size, char* dest);
+        size_t
+        (*ascii_to_upper)(const char* src, size_t size, char* dest);
+        size_t
+        (*ascii_to_simplify)(const char* src, size_t size, char* dest);
+      };
+
+      /**
+       * Kernel functions, unsupported kernels are replaced with
+       * the best supported ones
+       * @param kernel kernel to get functions of
+       * @return functions of the kernel
+       */
+      const Functions&
+      functions(Kernel kernel) throw ();
+
+      /// Functions of the fastest kernel, resolved on the first call
+      extern Functions selected;
+    }
   }
 }
 
@@ -521,6 +666,38 @@ namespace String
       return Tables::ASCII_TOUPPER_TABLE[static_cast<uint8_t>(ch)];
     }
 
+    inline
+    void
+    to_lower(char* first, char* last) throw ()
+    {
+      if (static_cast<size_t>(last - first) >= INLINE_SIZE)
+      {
+        __atomic_load_n(&Kernels::selected.to_lower, __ATOMIC_ACQUIRE)(
+          first, last);
+        return;
+      }
+      for (; first != last; ++first)
+      {
+        *first = Tables::ASCII_TOLOWER_TABLE[static_cast<uint8_t>(*first)];
+      }
+    }
+
+    inline
+    void
+    to_upper(char* first, char* last) throw ()
+    {
+      if (static_cast<size_t>(last - first) >= INLINE_SIZE)
+      {
+        __atomic_load_n(&Kernels::selected.to_upper, __ATOMIC_ACQUIRE)(
+          first, last);
+        return;
+      }
+      for (; first != last; ++first)
+      {
+        *first = Tables::ASCII_TOUPPER_TABLE[static_cast<uint8_t>(*first)];
+      }
+    }
+
     template <typename Iterator>
     inline
     void
@@ -674,6 +851,165 @@ namespace String
 
     namespace Category
     {
+      /**
+       * Scanning of [begin, end) for the characters of the predicate.
+       * Predicates known to have vectorized kernels are dispatched to
+       * them, others are checked byte by byte.
+       */
+      namespace Helper
+      {
+        template <typename Predicate>
+        inline
+        const char*
+        find(const Predicate& predicate, const char* begin,
+          const char* end, bool owned) throw ()
+        {
+          for (; begin != end; ++begin)
+          {
+            if (predicate(*begin) == owned)
+            {
+              break;
+            }
+          }
+          return begin;
+        }
+
+        template <typename Predicate>
+        inline
+        const char*
+        rfind(const Predicate& predicate, const char* begin,
+          const char* end, bool owned) throw ()
+        {
+          for (const char* pos = end; pos != begin;)
+          {
+            if (predicate(*--pos) == owned)
+            {
+              return pos;
+            }
+          }
+          return end;
+        }
+
+        inline
+        const char*
+        find(const CharTable& table, const char* begin, const char* end,
+          bool owned) throw ()
+        {
+          if (static_cast<size_t>(end - begin) < INLINE_SIZE)
+          {
+            return find<CharTable>(table, begin, end, owned);
+          }
+          return __atomic_load_n(&Kernels::selected.find_table,
+            __ATOMIC_ACQUIRE)(begin, end, table, owned);
+        }
+
+        inline
+        const char*
+        rfind(const CharTable& table, const char* begin, const char* end,
+          bool owned) throw ()
+        {
+          if (static_cast<size_t>(end - begin) < INLINE_SIZE)
+          {
+            return rfind<CharTable>(table, begin, end, owned);
+          }
+          return __atomic_load_n(&Kernels::selected.rfind_table,
+            __ATOMIC_ACQUIRE)(begin, end, table, owned);
+        }
+
+        template <typename Predicate>
+        inline
+        const char*
+        find_chars(const Predicate& predicate, const char* begin,
+          const char* end, char symbol1, char symbol2, char symbol3,
+          bool owned) throw ()
+        {
+          if (static_cast<size_t>(end - begin) < INLINE_SIZE)
+          {
+            return find<Predicate>(predicate, begin, end, owned);
+          }
+          return __atomic_load_n(&Kernels::selected.find_chars,
+            __ATOMIC_ACQUIRE)(begin, end, symbol1, symbol2, symbol3, owned);
+        }
+
+        template <typename Predicate>
+        inline
+        const char*
+        rfind_chars(const Predicate& predicate, const char* begin,
+          const char* end, char symbol1, char symbol2, char symbol3,
+          bool owned) throw ()
+        {
+          if (static_cast<size_t>(end - begin) < INLINE_SIZE)
+          {
+            return rfind<Predicate>(predicate, begin, end, owned);
+          }
+          return __atomic_load_n(&Kernels::selected.rfind_chars,
+            __ATOMIC_ACQUIRE)(begin, end, symbol1, symbol2, symbol3, owned);
+        }
+
+        template <const char SYMBOL>
+        inline
+        const char*
+        find(const Char1<SYMBOL>& predicate, const char* begin,
+          const char* end, bool owned) throw ()
+        {
+          return find_chars(predicate, begin, end,
+            SYMBOL, SYMBOL, SYMBOL, owned);
+        }
+
+        template <const char SYMBOL>
+        inline
+        const char*
+        rfind(const Char1<SYMBOL>& predicate, const char* begin,
+          const char* end, bool owned) throw ()
+        {
+          return rfind_chars(predicate, begin, end,
+            SYMBOL, SYMBOL, SYMBOL, owned);
+        }
+
+        template <const char SYMBOL1, const char SYMBOL2>
+        inline
+        const char*
+        find(const Char2<SYMBOL1, SYMBOL2>& predicate, const char* begin,
+          const char* end, bool owned) throw ()
+        {
+          return find_chars(predicate, begin, end,
+            SYMBOL1, SYMBOL2, SYMBOL2, owned);
+        }
+
+        template <const char SYMBOL1, const char SYMBOL2>
+        inline
+        const char*
+        rfind(const Char2<SYMBOL1, SYMBOL2>& predicate, const char* begin,
+          const char* end, bool owned) throw ()
+        {
+          return rfind_chars(predicate, begin, end,
+            SYMBOL1, SYMBOL2, SYMBOL2, owned);
+        }
+
+        template <const char SYMBOL1, const char SYMBOL2,
+          const char SYMBOL3>
+        inline
+        const char*
+        find(const Char3<SYMBOL1, SYMBOL2, SYMBOL3>& predicate,
+          const char* begin, const char* end, bool owned) throw ()
+        {
+          return find_chars(predicate, begin, end,
+            SYMBOL1, SYMBOL2, SYMBOL3, owned);
+        }
+
+        template <const char SYMBOL1, const char SYMBOL2,
+          const char SYMBOL3>
+        inline
+        const char*
+        rfind(const Char3<SYMBOL1, SYMBOL2, SYMBOL3>& predicate,
+          const char* begin, const char* end, bool owned) throw ()
+        {
+          return rfind_chars(predicate, begin, end,
+            SYMBOL1, SYMBOL2, SYMBOL3, owned);
+        }
+      }
+
+
       //
       // Category class
       //
@@ -737,19 +1073,13 @@ namespace String
       Category<Predicate>::find_owned(const char* str, const char* end,
         unsigned long* octets_length) const throw ()
       {
-        for (; str != end; ++str)
+        str = Helper::find(static_cast<const Predicate&>(*this), str, end,
+          true);
+        if (str != end && octets_length)
         {
-          if (is_owned(*str))
-          {
-            if (octets_length)
-            {
-              *octets_length = 1;
-            }
-
-            return str;
-          }
+          *octets_length = 1;
         }
-        return end;
+        return str;
       }
 
       template <typename Predicate>
@@ -775,14 +1105,8 @@ namespace String
         const char* end) const
         throw ()
       {
-        for (; str != end; ++str)
-        {
-          if (!is_owned(*str))
-          {
-            return str;
-          }
-        }
-        return end;
+        return Helper::find(static_cast<const Predicate&>(*this), str, end,
+          false);
       }
 
       template <typename Predicate>
@@ -792,15 +1116,8 @@ namespace String
         const char* start) const
         throw ()
       {
-        const char* const NOT_FOUND = pos;
-        while (start != pos)
-        {
-          if (is_owned(*--pos))
-          {
-            return pos;
-          }
-        }
-        return NOT_FOUND;
+        return Helper::rfind(static_cast<const Predicate&>(*this), start,
+          pos, true);
       }
 
       template <typename Predicate>
@@ -810,15 +1127,8 @@ namespace String
         const char* start) const
         throw ()
       {
-        const char* const NOT_FOUND = pos;
-        while (start != pos)
-        {
-          if (!is_owned(*--pos))
-          {
-            return pos;
-          }
-        }
-        return NOT_FOUND;
+        return Helper::rfind(static_cast<const Predicate&>(*this), start,
+          pos, false);
       }
 
 
@@ -838,6 +1148,7 @@ namespace String
         {
           table_[i] = predicate(i);
         }
+        init_nibbles_();
       }
 
       inline
@@ -847,6 +1158,13 @@ namespace String
         return table_[static_cast<uint8_t>(ch)];
       }
 
+      inline
+      const uint8_t*
+      CharTable::nibbles() const throw ()
+      {
+        return nibbles_;
+      }
+
 
       //
       // Char1 class
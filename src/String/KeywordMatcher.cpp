@@ -0,0 +1,247 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <map>
+
+#include <Generics/Function.hpp>
+
+#include <Stream/MemoryStream.hpp>
+
+#include <String/KeywordMatcher.hpp>
+
+
+namespace
+{
+  /**
+   * Trie node used during the construction
+   */
+  struct Node
+  {
+    typedef std::map<uint16_t, uint32_t> Children;
+
+    Children children;
+    std::vector<uint32_t> outputs;
+    uint32_t fail;
+    uint32_t report;
+    uint32_t index;
+  };
+
+  struct FindFirst
+  {
+    FindFirst() throw ()
+      : position(String::SubString::NPOS), keyword(0)
+    {
+    }
+
+    bool
+    operator ()(size_t found_keyword, size_t found_position) throw ()
+    {
+      position = found_position;
+      keyword = found_keyword;
+      return false;
+    }
+
+    size_t position;
+    size_t keyword;
+  };
+
+  struct Collect
+  {
+    explicit
+    Collect(String::KeywordMatcher::Matches& matches) throw ()
+      : matches(matches)
+    {
+    }
+
+    bool
+    operator ()(size_t keyword, size_t position) throw (eh::Exception)
+    {
+      const String::KeywordMatcher::Match MATCH = { keyword, position };
+      matches.push_back(MATCH);
+      return true;
+    }
+
+    String::KeywordMatcher::Matches& matches;
+  };
+}
+
+namespace String
+{
+  void
+  KeywordMatcher::init_(const std::vector<SubString>& keywords,
+    bool caseless)
+    throw (Exception, eh::Exception)
+  {
+    // Class 0 stands for the bytes absent in the keywords
+    std::fill(classes_, classes_ + 256, 0);
+    uint16_t classes = 1;
+    std::vector<Node> nodes(1);
+
+    for (std::vector<SubString>::const_iterator itor = keywords.begin();
+      itor != keywords.end(); ++itor)
+    {
+      if (itor->empty())
+      {
+        Stream::Error ostr;
+        ostr << FNS << "empty keyword " << itor - keywords.begin();
+        throw Exception(ostr);
+      }
+
+      uint32_t node = 0;
+      for (SubString::ConstPointer ptr = itor->begin(); ptr != itor->end();
+        ++ptr)
+      {
+        uint8_t ch = *ptr;
+        if (caseless && ch >= 'A' && ch <= 'Z')
+        {
+          ch += 'a' - 'A';
+        }
+        if (!classes_[ch])
+        {
+          classes_[ch] = classes++;
+          if (caseless && ch >= 'a' && ch <= 'z')
+          {
+            classes_[ch - 'a' + 'A'] = classes_[ch];
+          }
+        }
+
+        const std::pair<Node::Children::iterator, bool> RESULT =
+          nodes[node].children.insert(
+            Node::Children::value_type(classes_[ch], nodes.size()));
+        node = RESULT.first->second;
+        if (RESULT.second)
+        {
+          nodes.push_back(Node());
+        }
+      }
+      nodes[node].outputs.push_back(lengths_.size());
+      lengths_.push_back(itor->size());
+    }
+
+    // Failure links in breadth first order, states are numbered in it
+    std::vector<uint32_t> order;
+    order.reserve(nodes.size());
+    order.push_back(0);
+    nodes[0].fail = 0;
+    nodes[0].report = 0;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+      const uint32_t NODE = order[i];
+      nodes[NODE].index = i;
+      for (Node::Children::const_iterator child =
+        nodes[NODE].children.begin(); child != nodes[NODE].children.end();
+        ++child)
+      {
+        uint32_t fail = 0;
+        if (NODE)
+        {
+          for (uint32_t suffix = nodes[NODE].fail; ;
+            suffix = nodes[suffix].fail)
+          {
+            const Node::Children::const_iterator NEXT =
+              nodes[suffix].children.find(child->first);
+            if (NEXT != nodes[suffix].children.end())
+            {
+              fail = NEXT->second;
+              break;
+            }
+            if (!suffix)
+            {
+              break;
+            }
+          }
+        }
+        Node& node = nodes[child->second];
+        node.fail = fail;
+        node.report = node.outputs.empty() ? nodes[fail].report :
+          child->second;
+        order.push_back(child->second);
+      }
+    }
+
+    root_.assign(classes, 0);
+    states_.resize(nodes.size() + 1);
+    labels_.reserve(nodes.size() - 1);
+    targets_.reserve(nodes.size() - 1);
+    outputs_.reserve(lengths_.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+      const Node& NODE = nodes[order[i]];
+      State& state = states_[i];
+      state.edges = labels_.size();
+      state.outputs = outputs_.size();
+      state.fail = nodes[NODE.fail].index;
+      state.report = NODE.report ? nodes[NODE.report].index : 0;
+
+      for (Node::Children::const_iterator child = NODE.children.begin();
+        child != NODE.children.end(); ++child)
+      {
+        const uint32_t TARGET = nodes[child->second].index;
+        if (i)
+        {
+          labels_.push_back(child->first);
+          targets_.push_back(TARGET);
+        }
+        else
+        {
+          root_[child->first] = TARGET;
+        }
+      }
+      outputs_.insert(outputs_.end(), NODE.outputs.begin(),
+        NODE.outputs.end());
+    }
+
+    State& sentinel = states_.back();
+    sentinel.edges = labels_.size();
+    sentinel.outputs = outputs_.size();
+    sentinel.fail = 0;
+    sentinel.report = 0;
+    // next_() takes the address of the first label
+    labels_.push_back(0);
+  }
+
+  bool
+  KeywordMatcher::contains(const SubString& text) const throw ()
+  {
+    return find(text) != SubString::NPOS;
+  }
+
+  size_t
+  KeywordMatcher::find(const SubString& text, size_t* keyword) const
+    throw ()
+  {
+    FindFirst find_first;
+    match(text, find_first);
+    if (keyword)
+    {
+      *keyword = find_first.keyword;
+    }
+    return find_first.position;
+  }
+
+  void
+  KeywordMatcher::find_all(const SubString& text, Matches& matches) const
+    throw (eh::Exception)
+  {
+    Collect collect(matches);
+    match(text, collect);
+  }
+}
@@ -0,0 +1,225 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef STRING_KEYWORDMATCHER_HPP
+#define STRING_KEYWORDMATCHER_HPP
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <eh/Exception.hpp>
+
+#include <Generics/Uncopyable.hpp>
+
+#include <String/SubString.hpp>
+
+
+namespace String
+{
+  /**
+   * Aho-Corasick automaton over a fixed set of keywords. Finds the
+   * occurrences of all the keywords in one pass over the text instead
+   * of calling find() for every keyword. The text is not copied.
+   * Keywords are identified by their indexes in the sequence passed to
+   * the constructor, all the occurrences of duplicates are reported.
+   * The object is immutable after the construction, searches can be
+   * performed from several threads at the same time.
+   */
+  class KeywordMatcher : private Generics::Uncopyable
+  {
+  public:
+    DECLARE_EXCEPTION(Exception, eh::DescriptiveException);
+
+    /**
+     * Occurrence of a keyword in a text
+     */
+    struct Match
+    {
+      size_t keyword; ///< index of the keyword
+      size_t position; ///< offset of the occurrence in the text
+    };
+    typedef std::vector<Match> Matches;
+
+    /**
+     * Constructor
+     * @param begin the first keyword, SubString must be constructible
+     * from the value
+     * @param end the end of the keywords
+     * @param caseless if ASCII letters should match regardless of
+     * their case
+     */
+    template <typename Iterator>
+    KeywordMatcher(Iterator begin, Iterator end, bool caseless = false)
+      throw (Exception, eh::Exception);
+
+    /**
+     * @return number of keywords
+     */
+    size_t
+    size() const throw ();
+
+    /**
+     * @param text text to search in
+     * @return if the text contains any keyword
+     */
+    bool
+    contains(const SubString& text) const throw ();
+
+    /**
+     * Finds the occurrence ending first, the longest of such ones
+     * @param text text to search in
+     * @param keyword if not NULL, the index of the found keyword is
+     * stored here
+     * @return offset of the occurrence or SubString::NPOS if none
+     */
+    size_t
+    find(const SubString& text, size_t* keyword = 0) const throw ();
+
+    /**
+     * Finds all the occurrences, including overlapping ones. They are
+     * ordered by their ends, the longer ones first for the same end.
+     * @param text text to search in
+     * @param matches occurrences are appended here
+     */
+    void
+    find_all(const SubString& text, Matches& matches) const
+      throw (eh::Exception);
+
+    /**
+     * Reports all the occurrences in the order of find_all()
+     * @param text text to search in
+     * @param callback is called as callback(keyword, position) for
+     * every occurrence, the search is stopped if it returns false
+     * @return false if the search has been stopped by the callback
+     */
+    template <typename Callback>
+    bool
+    match(const SubString& text, Callback& callback) const;
+
+  private:
+    struct State
+    {
+      uint32_t edges; ///< the first edge, edges of state end at the next
+      uint32_t outputs; ///< the first keyword ending in the state
+      uint32_t fail; ///< the longest proper suffix state
+      uint32_t report; ///< the nearest suffix state with outputs or 0
+    };
+    typedef std::vector<State> States;
+
+    void
+    init_(const std::vector<SubString>& keywords, bool caseless)
+      throw (Exception, eh::Exception);
+
+    uint32_t
+    next_(uint32_t state, uint8_t ch) const throw ();
+
+    uint16_t classes_[256];
+    std::vector<uint32_t> root_;
+    States states_;
+    std::vector<uint16_t> labels_;
+    std::vector<uint32_t> targets_;
+    std::vector<uint32_t> outputs_;
+    std::vector<uint32_t> lengths_;
+  };
+}
+
+//
+// INLINES
+//
+
+namespace String
+{
+  template <typename Iterator>
+  KeywordMatcher::KeywordMatcher(Iterator begin, Iterator end,
+    bool caseless)
+    throw (Exception, eh::Exception)
+  {
+    std::vector<SubString> keywords;
+    for (; begin != end; ++begin)
+    {
+      keywords.push_back(SubString(*begin));
+    }
+    init_(keywords, caseless);
+  }
+
+  inline
+  size_t
+  KeywordMatcher::size() const throw ()
+  {
+    return lengths_.size();
+  }
+
+  inline
+  uint32_t
+  KeywordMatcher::next_(uint32_t state, uint8_t ch) const throw ()
+  {
+    const uint16_t CLASS = classes_[ch];
+    if (!CLASS)
+    {
+      return 0;
+    }
+
+    while (state)
+    {
+      const uint16_t* const BEGIN = &labels_[0] + states_[state].edges;
+      const uint16_t* const END = &labels_[0] + states_[state + 1].edges;
+      const uint16_t* const FOUND = std::lower_bound(BEGIN, END, CLASS);
+      if (FOUND != END && *FOUND == CLASS)
+      {
+        return targets_[FOUND - &labels_[0]];
+      }
+      state = states_[state].fail;
+    }
+    return root_[CLASS];
+  }
+
+  template <typename Callback>
+  bool
+  KeywordMatcher::match(const SubString& text, Callback& callback) const
+  {
+    const uint8_t* const DATA =
+      reinterpret_cast<const uint8_t*>(text.data());
+    uint32_t state = 0;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+      state = next_(state, DATA[i]);
+      for (uint32_t report = states_[state].report; report;
+        report = states_[states_[report].fail].report)
+      {
+        for (uint32_t output = states_[report].outputs;
+          output != states_[report + 1].outputs; output++)
+        {
+          const uint32_t KEYWORD = outputs_[output];
+          if (!callback(static_cast<size_t>(KEYWORD),
+            i + 1 - lengths_[KEYWORD]))
+          {
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+}
+
+#endif
@@ -19,12 +19,29 @@
 
 
 
+#include <algorithm>
+
+#include <Sync/Key.hpp>
+
 #include <String/StringManip.hpp>
 #include <String/RegEx.hpp>
 
 
+namespace
+{
+  void
+  destroy_match_data(void* data) throw ()
+  {
+    delete static_cast<String::RegEx::MatchData*>(data);
+  }
+
+  Sync::Key<String::RegEx::MatchData> match_data_key(destroy_match_data);
+}
+
 namespace String
 {
+  const int RegEx::OVECTOR_SIZE;
+
   RegEx&
   RegEx::operator =(const RegEx& side)
     throw (Exception, eh::Exception)
@@ -39,6 +56,7 @@ namespace String
         expr_size_ = side.expr_size_;
         re_ = side.re_;
         re_size_ = side.re_size_;
+        extra_ = side.extra_;
         substrcount_ = side.substrcount_;
 
         pcre_refcount(side.re_, 1);
@@ -50,7 +68,7 @@ namespace String
 
   void
   RegEx::set_expression(const String::SubString& regex, int options,
-    Generics::Allocator::Base* allocator)
+    Generics::Allocator::Base* allocator, bool jit)
     throw (Exception, eh::Exception)
   {
     if (!regex.data())
@@ -99,14 +117,32 @@ namespace String
     memcpy(rea, re, re_len);
     pcre_free(re);
 
+    // Study the relocated copy as it is the one passed to pcre_exec
+    pcre_extra* extra = 0;
+    if (jit)
+    {
+      extra = pcre_study(rea, PCRE_STUDY_JIT_COMPILE, &error);
+      if (error)
+      {
+        alloc->deallocate(rea, re_size);
+        alloc->deallocate(expr, expr_size);
+
+        Stream::Error ostr;
+        ostr << FNS << "Couldn't study expression '" << regex <<
+          "', Reason: " << error;
+        throw Exception(ostr);
+      }
+    }
+
     clear_();
 
     allocator_ = alloc;
     expr_ = expr;
     expr_len_ = regex.size();
-    expr_size_ = expr_size_;
+    expr_size_ = expr_size;
     re_ = rea;
-    re_size_ = re_size_;
+    re_size_ = re_size;
+    extra_ = extra;
     pcre_fullinfo(re_, 0, PCRE_INFO_CAPTURECOUNT, &substrcount_);
     substrcount_++;
 
@@ -125,9 +161,17 @@ namespace String
       throw Exception(ostr);
     }
 
-    Generics::ArrayAutoPtr<int> ovector(3 * substrcount_);
-    if (pcre_exec(re_, 0, subject.data(), subject.size(),
-      0, options, &ovector[0], 3 * substrcount_) <= 0)
+    // Only expressions with many substrings require allocation
+    const int OVECTOR = std::max(3 * substrcount_, OVECTOR_SIZE);
+    int stack_ovector[OVECTOR_SIZE];
+    Generics::ArrayAutoPtr<int> heap_ovector;
+    int* ovector = stack_ovector;
+    if (OVECTOR > OVECTOR_SIZE)
+    {
+      heap_ovector.reset(OVECTOR);
+      ovector = heap_ovector.get();
+    }
+    if (exec_(subject, options, ovector, OVECTOR) <= 0)
     {
       return false;
     }
@@ -167,7 +211,7 @@ namespace String
     result.clear();
     size_t offset = 0;
     while (offset <= subject.size() &&
-      pcre_exec(re_, 0, subject.data(), subject.size(),
+      pcre_exec(re_, extra_, subject.data(), subject.size(),
         offset, options, &ovector[0], 3 * substrcount_) > 0)
     {
       size_t res_offset = result.size() - first_capture;
@@ -195,16 +239,50 @@ namespace String
   }
 
   bool
-  RegEx::match(const String::SubString& subject, int options) const
-    throw ()
+  RegEx::search(MatchData& data, const String::SubString& subject,
+    int options) const
+    throw (Exception, eh::Exception)
   {
     if (!re_)
     {
-      return false;
+      Stream::Error ostr;
+      ostr << FNS << "Expression is not compiled";
+      throw Exception(ostr);
     }
 
-    int ovector[90];
-    return pcre_exec(re_, 0, subject.data(), subject.size(),
-      0, options, ovector, 90) > 0;
+    const size_t OVECTOR = std::max(3 * substrcount_, OVECTOR_SIZE);
+    if (data.ovector_.size() < OVECTOR)
+    {
+      data.ovector_.resize(OVECTOR);
+    }
+
+    data.subject_ = subject;
+    const int RES = exec_(subject, options, &data.ovector_[0],
+      data.ovector_.size());
+    data.size_ = RES > 0 ? RES : 0;
+    return RES > 0;
+  }
+
+  RegEx::MatchData&
+  RegEx::thread_match_data() throw (Exception, eh::Exception)
+  {
+    MatchData* data = match_data_key.get_data();
+    if (!data)
+    {
+      data = new MatchData;
+      try
+      {
+        match_data_key.set_data(data);
+      }
+      catch (const eh::Exception& ex)
+      {
+        delete data;
+
+        Stream::Error ostr;
+        ostr << FNS << "Failed to keep match data: " << ex.what();
+        throw Exception(ostr);
+      }
+    }
+    return *data;
   }
 }
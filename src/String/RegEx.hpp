@@ -30,6 +30,7 @@
 #include <String/SubString.hpp>
 
 #include <Generics/Allocator.hpp>
+#include <Generics/Uncopyable.hpp>
 
 
 namespace String
@@ -42,16 +43,59 @@ namespace String
   public:
     DECLARE_EXCEPTION(Exception, eh::DescriptiveException);
 
+    typedef std::vector<SubString> Result;
+
+    /**
+     * Reusable storage of the found substrings offsets. It grows up to
+     * the largest number of substrings of the expressions it is used
+     * with and is not reallocated after that, so search() with it
+     * allocates nothing.
+     */
+    class MatchData : private Generics::Uncopyable
+    {
+    public:
+      /**
+       * Constructor
+       */
+      MatchData() throw ();
+
+      /**
+       * Number of substrings found by the last search
+       * @return zero if it failed
+       */
+      int
+      size() const throw ();
+
+      /**
+       * Substring found by the last search
+       * @param index substring number, zero is the whole match
+       * @return substring of the subject or empty one if it was not set
+       */
+      SubString
+      operator [](int index) const throw ();
+
+    private:
+      friend class RegEx;
+
+      SubString subject_;
+      std::vector<int> ovector_;
+      int size_;
+    };
+
     /**
      * Constructor
      * Compiles regexp if required
      * @param regex regular expression
      * @param options compilation options (see pcreapi(3))
      * @param allocator custom allocator for expression and compiled regex
+     * @param jit compile the expression into machine code
+     * (see pcrejit(3)), falls back to the interpreter if JIT is not
+     * supported
      */
     explicit
     RegEx(const String::SubString& regex = String::SubString(),
-      int options = 0, Generics::Allocator::Base* allocator = 0)
+      int options = 0, Generics::Allocator::Base* allocator = 0,
+      bool jit = false)
       throw (Exception, eh::Exception);
 
     /**
@@ -84,15 +128,13 @@ namespace String
      * @param regex regular expression
      * @param options compilation options (see pcreapi(3))
      * @param allocator custom allocator for expression and compiled regex
+     * @param jit compile the expression into machine code
      */
     void
     set_expression(const String::SubString& regex, int options = 0,
-      Generics::Allocator::Base* allocator = 0)
+      Generics::Allocator::Base* allocator = 0, bool jit = false)
       throw (Exception, eh::Exception);
 
-
-    typedef std::vector<SubString> Result;
-
     /**
      * Returns total number of substrings in regular expressions
      * @return expected number of substrings
@@ -113,6 +155,20 @@ namespace String
       int options = 0) const
       throw (Exception, eh::Exception);
 
+    /**
+     * Performes execution of compiled regular expression
+     * and keeps offsets of the found substrings in data
+     * @param data storage for the found substrings, may be
+     * thread_match_data()
+     * @param subject string to match, referenced by data
+     * @param options execution options (see pcreapi(3))
+     * @return if match occurred or not
+     */
+    bool
+    search(MatchData& data, const String::SubString& subject,
+      int options = 0) const
+      throw (Exception, eh::Exception);
+
     /**
      * Performes execution of compiled regular expression and returns
      * all of the found substrings, in the sense of /g Perl regexp
@@ -137,6 +193,37 @@ namespace String
     match(const String::SubString& subject, int options = 0) const
       throw ();
 
+    /**
+     * Performes "quick" execution of the sequence of compiled regular
+     * expressions until the first match
+     * @param first the first regexp of the sequence
+     * @param last the end of the sequence
+     * @param subject string to match
+     * @param options execution options (see pcreapi(3))
+     * @return the first regexp matching subject or last if none
+     */
+    template <typename Iterator>
+    static
+    Iterator
+    match_any(Iterator first, Iterator last,
+      const String::SubString& subject, int options = 0)
+      throw ();
+
+    /**
+     * MatchData of the calling thread, created on the first call
+     * @return storage for search()
+     */
+    static
+    MatchData&
+    thread_match_data() throw (Exception, eh::Exception);
+
+    /**
+     * Checks if the expression is compiled into machine code
+     * @return whether or not JIT is used
+     */
+    bool
+    jit() const throw ();
+
     /**
      * Compiled regular expression
      * @return original regular expression
@@ -146,6 +233,21 @@ namespace String
 
 
   private:
+    /// ovector size enough for the back references without allocations
+    static const int OVECTOR_SIZE = 90;
+
+    /**
+     * Executes the expression
+     * @param subject string to match
+     * @param options execution options
+     * @param ovector offsets vector
+     * @param size its size
+     * @return pcre_exec() result
+     */
+    int
+    exec_(const String::SubString& subject, int options, int* ovector,
+      int size) const throw ();
+
     /**
      * Provides data members initialization
      */
@@ -164,6 +266,7 @@ namespace String
     size_t expr_size_;
     pcre* re_;
     size_t re_size_;
+    pcre_extra* extra_;
     int substrcount_;
   };
 
@@ -180,10 +283,11 @@ namespace String
      * Compiles regexp if required
      * @param regex regular expression
      * @param options compilation options (see pcreapi(3))
+     * @param jit compile the expression into machine code
      */
     explicit
     BasicRegEx(const String::SubString& regex = String::SubString(),
-      int options = 0) throw (Exception, eh::Exception);
+      int options = 0, bool jit = false) throw (Exception, eh::Exception);
 
   private:
     static Generics::Allocator::Base_var alloc_;
@@ -196,6 +300,36 @@ namespace String
 
 namespace String
 {
+  //
+  // RegEx::MatchData class
+  //
+
+  inline
+  RegEx::MatchData::MatchData() throw ()
+    : size_(0)
+  {
+  }
+
+  inline
+  int
+  RegEx::MatchData::size() const throw ()
+  {
+    return size_;
+  }
+
+  inline
+  SubString
+  RegEx::MatchData::operator [](int index) const throw ()
+  {
+    if (index < 0 || index >= size_ || ovector_[2 * index] < 0)
+    {
+      return SubString();
+    }
+    return subject_.substr(ovector_[2 * index],
+      ovector_[2 * index + 1] - ovector_[2 * index]);
+  }
+
+
   //
   // RegEx class
   //
@@ -209,6 +343,7 @@ namespace String
     expr_size_ = 0;
     re_ = 0;
     re_size_ = 0;
+    extra_ = 0;
     substrcount_ = 0;
   }
 
@@ -220,6 +355,10 @@ namespace String
     {
       if (pcre_refcount(re_, -1) == 0)
       {
+        if (extra_)
+        {
+          pcre_free_study(extra_);
+        }
         allocator_->deallocate(expr_, expr_size_);
         allocator_->deallocate(re_, re_size_);
       }
@@ -230,14 +369,14 @@ namespace String
 
   inline
   RegEx::RegEx(const String::SubString& regex, int options,
-    Generics::Allocator::Base* allocator)
+    Generics::Allocator::Base* allocator, bool jit)
     throw (Exception, eh::Exception)
   {
     init_();
 
     if (regex.data())
     {
-      set_expression(regex, options, allocator);
+      set_expression(regex, options, allocator, jit);
     }
   }
 
@@ -277,6 +416,57 @@ namespace String
     return SubString(expr_, expr_len_);
   }
 
+  inline
+  int
+  RegEx::exec_(const String::SubString& subject, int options,
+    int* ovector, int size) const throw ()
+  {
+    return pcre_exec(re_, extra_, subject.data(), subject.size(),
+      0, options, ovector, size);
+  }
+
+  inline
+  bool
+  RegEx::match(const String::SubString& subject, int options) const
+    throw ()
+  {
+    if (!re_)
+    {
+      return false;
+    }
+
+    int ovector[OVECTOR_SIZE];
+    return exec_(subject, options, ovector, OVECTOR_SIZE) > 0;
+  }
+
+  template <typename Iterator>
+  Iterator
+  RegEx::match_any(Iterator first, Iterator last,
+    const String::SubString& subject, int options)
+    throw ()
+  {
+    int ovector[OVECTOR_SIZE];
+    for (; first != last; ++first)
+    {
+      const RegEx& regex = *first;
+      if (regex.re_ &&
+        regex.exec_(subject, options, ovector, OVECTOR_SIZE) > 0)
+      {
+        break;
+      }
+    }
+    return first;
+  }
+
+  inline
+  bool
+  RegEx::jit() const throw ()
+  {
+    int jit = 0;
+    return extra_ && !pcre_fullinfo(re_, extra_, PCRE_INFO_JIT, &jit) &&
+      jit;
+  }
+
 
   //
   // BasicRegEx class
@@ -288,8 +478,8 @@ namespace String
 
   template <typename Alloc>
   BasicRegEx<Alloc>::BasicRegEx(const String::SubString& regex,
-    int options) throw (Exception, eh::Exception)
-    : RegEx(regex, options, alloc_)
+    int options, bool jit) throw (Exception, eh::Exception)
+    : RegEx(regex, options, alloc_, jit)
   {
   }
 }
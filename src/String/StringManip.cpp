@@ -1472,8 +1472,7 @@ namespace String
       if (begin != end)
       {
         // We have at least one non-space character at str.begin
-        while (trim_set(*--end));
-        ++end;
+        end = trim_set.rfind_nonowned(end, begin) + 1;
       }
       str.assign(begin, end - begin);
     }
@@ -53,6 +53,34 @@ namespace String
       throw ();
   };
 
+  namespace AsciiStringManip
+  {
+    /**
+     * Finds the first occurrence of the byte string in the block with
+     * the fastest kernel supported by CPU (see AsciiStringManip.hpp)
+     * @param str block to search in
+     * @param size its size
+     * @param needle string to search for
+     * @param needle_size its size, not zero
+     * @return pointer to the occurrence or NULL if none
+     */
+    const char*
+    find_block(const char* str, size_t size, const char* needle,
+      size_t needle_size) throw ();
+
+    /**
+     * Finds the last occurrence of the byte string in the block
+     * @param str block to search in
+     * @param size its size
+     * @param needle string to search for
+     * @param needle_size its size, not zero
+     * @return pointer to the occurrence or NULL if none
+     */
+    const char*
+    rfind_block(const char* str, size_t size, const char* needle,
+      size_t needle_size) throw ();
+  }
+
   template <typename CharType>
   struct CheckerNone
   {
@@ -23,6 +23,7 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 
 
 namespace String
@@ -65,6 +66,15 @@ namespace String
     return 0;
   }
 
+  template <>
+  inline
+  const char*
+  CharTraits<char>::find(const char* str, size_t size, const char& ch)
+    throw ()
+  {
+    return static_cast<const char*>(memchr(str, ch, size));
+  }
+
   template <typename CharType>
   CharType*
   CharTraits<CharType>::copy(CharType* str1, const CharType* str2,
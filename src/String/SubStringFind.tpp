@@ -23,6 +23,142 @@
 
 namespace String
 {
+  namespace SubStringSearch
+  {
+    /**
+     * Search algorithms for BasicSubString. Byte strings with exact
+     * comparison are searched with vectorized kernels, others with
+     * standard algorithms.
+     */
+    template <typename CharType, typename Traits>
+    struct Search
+    {
+      /**
+       * @return the first occurrence of needle in [begin, end) or end
+       */
+      static
+      CharType*
+      find(CharType* begin, CharType* end, CharType* needle,
+        size_t size) throw ();
+
+      /**
+       * @return the last occurrence of needle in [begin, end) or end
+       */
+      static
+      CharType*
+      rfind(CharType* begin, CharType* end, CharType* needle,
+        size_t size) throw ();
+
+      /**
+       * @return the last occurrence of ch in [begin, end) or end
+       */
+      static
+      CharType*
+      rfind(CharType* begin, CharType* end, CharType ch) throw ();
+    };
+
+    struct CharSearch
+    {
+      static
+      const char*
+      find(const char* begin, const char* end, const char* needle,
+        size_t size) throw ();
+
+      static
+      const char*
+      rfind(const char* begin, const char* end, const char* needle,
+        size_t size) throw ();
+
+      static
+      const char*
+      rfind(const char* begin, const char* end, char ch) throw ();
+    };
+
+    template <>
+    struct Search<const char, CharTraits<char> > : public CharSearch
+    {
+    };
+
+    template <>
+    struct Search<char, CharTraits<char> > : public CharSearch
+    {
+    };
+
+    template <typename CharType, typename Traits>
+    CharType*
+    Search<CharType, Traits>::find(CharType* begin, CharType* end,
+      CharType* needle, size_t size) throw ()
+    {
+      return std::search(begin, end, needle, needle + size, Traits::eq);
+    }
+
+    template <typename CharType, typename Traits>
+    CharType*
+    Search<CharType, Traits>::rfind(CharType* begin, CharType* end,
+      CharType* needle, size_t size) throw ()
+    {
+      if (static_cast<size_t>(end - begin) >= size)
+      {
+        for (CharType* data = end - size; ; data--)
+        {
+          if (!Traits::compare(data, needle, size))
+          {
+            return data;
+          }
+          if (data == begin)
+          {
+            break;
+          }
+        }
+      }
+      return end;
+    }
+
+    template <typename CharType, typename Traits>
+    CharType*
+    Search<CharType, Traits>::rfind(CharType* begin, CharType* end,
+      CharType ch) throw ()
+    {
+      for (CharType* last = end; last != begin;)
+      {
+        if (Traits::eq(*--last, ch))
+        {
+          return last;
+        }
+      }
+      return end;
+    }
+
+    inline
+    const char*
+    CharSearch::find(const char* begin, const char* end,
+      const char* needle, size_t size) throw ()
+    {
+      const char* const FOUND = AsciiStringManip::find_block(begin,
+        end - begin, needle, size);
+      return FOUND ? FOUND : end;
+    }
+
+    inline
+    const char*
+    CharSearch::rfind(const char* begin, const char* end,
+      const char* needle, size_t size) throw ()
+    {
+      const char* const FOUND = AsciiStringManip::rfind_block(begin,
+        end - begin, needle, size);
+      return FOUND ? FOUND : end;
+    }
+
+    inline
+    const char*
+    CharSearch::rfind(const char* begin, const char* end, char ch)
+      throw ()
+    {
+      const void* const FOUND = memrchr(begin, ch, end - begin);
+      return FOUND ? static_cast<const char*>(FOUND) : end;
+    }
+  }
+
   //
   // Find char forward
   //
@@ -59,15 +195,15 @@ namespace String
       return pos >= length_ ? NPOS : 0;
     }
 
-    SizeType length = get_available_length_(pos, length_);
-    if (str.length_ > length)
+    if (pos > length_ || str.length_ > length_ - pos)
     {
       return NPOS;
     }
 
     const ConstPointer END = begin_ + length_;
-    const ConstPointer FOUND = std::search(begin_ + pos, END,
-      str.begin_, str.begin_ + str.length_, Traits::eq);
+    const ConstPointer FOUND =
+      SubStringSearch::Search<CharType, Traits>::find(begin_ + pos, END,
+        str.begin_, str.length_);
     return FOUND != END ? FOUND - begin_ : NPOS;
   }
 
@@ -101,17 +237,12 @@ namespace String
   {
     if (length_)
     {
-      ConstPointer last = begin_ + std::min(length_ - 1, pos);
-      for (;; --last)
+      const ConstPointer END = begin_ + std::min(length_ - 1, pos) + 1;
+      const ConstPointer FOUND =
+        SubStringSearch::Search<CharType, Traits>::rfind(begin_, END, ch);
+      if (FOUND != END)
       {
-        if (Traits::eq(*last, ch))
-        {
-          return last - begin_;
-        }
-        if (last == begin_)
-        {
-          return NPOS;
-        }
+        return FOUND - begin_;
       }
     }
     return NPOS;
@@ -147,19 +278,11 @@ namespace String
       pos = length_ - str.length_;
     }
 
-    for (ConstPointer data = begin_ + pos; ; data--)
-    {
-      if (!Traits::compare(data, str.begin_, str.length_))
-      {
-        return data - begin_;
-      }
-      if (data == begin_)
-      {
-        break;
-      }
-    }
-
-    return NPOS;
+    const ConstPointer END = begin_ + pos + str.length_;
+    const ConstPointer FOUND =
+      SubStringSearch::Search<CharType, Traits>::rfind(begin_, END,
+        str.begin_, str.length_);
+    return FOUND != END ? FOUND - begin_ : NPOS;
   }
 
   template <typename CharType, typename Traits, typename Checker>
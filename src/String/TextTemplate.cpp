@@ -263,6 +263,204 @@ namespace String
       init(istr, start_lexeme, end_lexeme);
     }
 
+
+    //
+    // Compiled class
+    //
+
+    const size_t Compiled::NO_SLOT = static_cast<size_t>(-1);
+
+    Compiled::Compiled(const SubString& str,
+      const SubString& start_lexeme, const SubString& end_lexeme)
+      throw (InvalidTemplate, TextTemplException, eh::Exception)
+      : text_size_(0)
+    {
+      init(str, start_lexeme, end_lexeme);
+    }
+
+    void
+    Compiled::init(const SubString& str,
+      const SubString& start_lexeme, const SubString& end_lexeme)
+      throw (InvalidTemplate, TextTemplException, eh::Exception)
+    {
+      str.assign_to(text_);
+
+      compile_(start_lexeme, end_lexeme);
+    }
+
+    void
+    Compiled::init(std::istream& istr,
+      const SubString& start_lexeme, const SubString& end_lexeme)
+      throw (InvalidTemplate, TextTemplException, eh::Exception)
+    {
+      std::getline(istr, text_, '\0');
+      if (istr.bad() || !istr.eof())
+      {
+        Stream::Error ostr;
+        ostr << FNS << "unable to read from istream.";
+        throw TextTemplException(ostr);
+      }
+
+      compile_(start_lexeme, end_lexeme);
+    }
+
+    void
+    Compiled::compile_(const SubString& start_lexeme,
+      const SubString& end_lexeme)
+      throw (InvalidTemplate, TextTemplException, eh::Exception)
+    {
+      operations_.clear();
+      keys_.clear();
+      occurrences_.clear();
+      slots_.clear();
+      text_size_ = 0;
+
+      if (start_lexeme.empty())
+      {
+        Stream::Error ostr;
+        ostr << FNS << "empty start_lexeme.";
+        throw TextTemplException(ostr);
+      }
+
+      if (end_lexeme.empty())
+      {
+        Stream::Error ostr;
+        ostr << FNS << "empty end_lexeme.";
+        throw TextTemplException(ostr);
+      }
+
+      const SubString TEXT(text_);
+
+      // Split a template string on keys, the same keys share a slot
+      for (SubString::SizeType pos = 0; pos < TEXT.size();)
+      {
+        SubString::SizeType begin = TEXT.find(start_lexeme, pos);
+        const SubString::SizeType TEXT_END =
+          begin == SubString::NPOS ? TEXT.size() : begin;
+
+        if (TEXT_END != pos)
+        {
+          const Operation OPERATION = { NO_SLOT, pos, TEXT_END - pos };
+          operations_.push_back(OPERATION);
+          text_size_ += OPERATION.size;
+        }
+
+        if (begin == SubString::NPOS)
+        {
+          break;
+        }
+
+        begin += start_lexeme.length();
+
+        SubString::SizeType end = TEXT.find(end_lexeme, begin);
+        if (end == SubString::NPOS)
+        {
+          Stream::Error ostr;
+          ostr << FNS <<
+            "invalid template: closing lexeme (" << end_lexeme <<
+            ") not found. Template:\n'" << TEXT << "'";
+          throw InvalidTemplate(ostr);
+        }
+
+        const SubString KEY(TEXT.substr(begin, end - begin));
+        const std::pair<Slots::iterator, bool> INSERTED =
+          slots_.insert(Slots::value_type(KEY, keys_.size()));
+        if (INSERTED.second)
+        {
+          keys_.push_back(KEY);
+          occurrences_.push_back(0);
+        }
+        const Operation OPERATION = { INSERTED.first->second, 0, 0 };
+        operations_.push_back(OPERATION);
+        ++occurrences_[OPERATION.slot];
+
+        pos = end + end_lexeme.length();
+      }
+    }
+
+    size_t
+    Compiled::slot(const SubString& key) const throw ()
+    {
+      Slots::const_iterator it = slots_.find(key);
+      return it == slots_.end() ? NO_SLOT : it->second;
+    }
+
+    void
+    Compiled::instantiate(const Values& values, std::string& result) const
+      throw (UnknownName, eh::Exception)
+    {
+      if (values.size() < keys_.size())
+      {
+        Stream::Error ostr;
+        ostr << FNS << "no value for key '" << keys_[values.size()] <<
+          "'";
+        throw UnknownName(ostr);
+      }
+
+      size_t size = text_size_;
+      for (size_t i = 0; i < keys_.size(); ++i)
+      {
+        size += values[i].size() * occurrences_[i];
+      }
+
+      result.clear();
+      result.reserve(size);
+
+      const char* const TEXT = text_.data();
+      for (Operations::const_iterator it = operations_.begin();
+        it != operations_.end(); ++it)
+      {
+        if (it->slot == NO_SLOT)
+        {
+          result.append(TEXT + it->offset, it->size);
+        }
+        else
+        {
+          values[it->slot].append_to(result);
+        }
+      }
+    }
+
+    std::string
+    Compiled::instantiate(const ArgsCallback& args) const
+      throw (UnknownName, TextTemplException, eh::Exception)
+    {
+      std::vector<std::string> strings(keys_.size());
+      Values values(keys_.size());
+
+      for (size_t i = 0; i < keys_.size(); ++i)
+      {
+        if (!args.get_argument(keys_[i], strings[i]))
+        {
+          Stream::Error ostr;
+          ostr << FNS << "failed to substitute key '" << keys_[i] << "'";
+          throw UnknownName(ostr);
+        }
+        values[i] = strings[i];
+      }
+
+      std::string result;
+      instantiate(values, result);
+      return result;
+    }
+
+    void
+    Compiled::keys(const ArgsCallback& args, Keys& keys) const
+      throw (UnknownName, TextTemplException, eh::Exception)
+    {
+      keys.clear();
+      for (SlotKeys::const_iterator it = keys_.begin();
+        it != keys_.end(); ++it)
+      {
+        std::string name;
+        args.get_argument(*it, name, false);
+        if (!name.empty())
+        {
+          keys.insert(std::move(name));
+        }
+      }
+    }
+
     namespace
     {
       /**
@@ -575,5 +773,43 @@ namespace String
         throw TextTemplException(ostr);
       }
     }
+
+
+    //
+    // CompiledUpdateStrategy class
+    //
+
+    void
+    CompiledUpdateStrategy::update()
+      throw (TextTemplException, eh::Exception)
+    {
+      try
+      {
+        Stream::FileParser file(fname_.c_str());
+
+        try
+        {
+          text_template_.init(file, start_lexeme(), end_lexeme());
+        }
+        catch (const TextTemplException& ex)
+        {
+          Stream::Error ostr;
+          ostr << FNS << "failed to initialize with file " << fname_ <<
+            ": " << ex.what();
+          throw TextTemplException(ostr);
+        }
+      }
+      catch (const TextTemplException&)
+      {
+        throw;
+      }
+      catch (const eh::Exception& ex)
+      {
+        Stream::Error ostr;
+        ostr << FNS << "failed to open file '" << fname_ << "': " <<
+          ex.what();
+        throw TextTemplException(ostr);
+      }
+    }
   }
 }
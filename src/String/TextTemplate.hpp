@@ -26,6 +26,7 @@
 
 #include <istream>
 #include <set>
+#include <vector>
 
 #include <ReferenceCounting/ReferenceCounting.hpp>
 #include <ReferenceCounting/Deque.hpp>
@@ -369,6 +370,180 @@ namespace String
         throw (InvalidTemplate, TextTemplException, eh::Exception);
     };
 
+    /**
+     * Text template compiled into a flat array of operations: ranges of
+     * the stored template text and variable slots. Every distinct key
+     * gets a slot index once during compilation, values are supplied
+     * by slot index, so instantiation does no lookups and no virtual
+     * calls, and the result size is computed before it is built.
+     */
+    class Compiled : private Generics::Uncopyable
+    {
+    public:
+      /**
+       * Values of slots indexed by slot numbers, referenced while
+       * instantiating
+       */
+      typedef std::vector<SubString> Values;
+
+      static const size_t NO_SLOT;
+
+      /**
+       * Constructor.
+       */
+      Compiled() throw ();
+
+      /**
+       * Constructor. Calls init.
+       * @param str template to copy and compile
+       * @param start_lexeme Start lexeme.
+       * @param end_lexeme End lexeme.
+       * @exception InvalidTemplate Invalid template.
+       * @exception TextTemplException Other errors.
+       * @exception eh::Exception std::exception.
+       */
+      explicit
+      Compiled(const SubString& str,
+        const SubString& start_lexeme = Basic::DEFAULT_LEXEME,
+        const SubString& end_lexeme = Basic::DEFAULT_LEXEME)
+        throw (InvalidTemplate, TextTemplException, eh::Exception);
+
+      /**
+       * Compiles a pattern.
+       * @param str template to copy and compile
+       * @param start_lexeme Start lexeme.
+       * @param end_lexeme End lexeme.
+       * @exception InvalidTemplate Invalid template.
+       * @exception TextTemplException Other errors.
+       * @exception eh::Exception std::exception.
+       */
+      void
+      init(const SubString& str,
+        const SubString& start_lexeme = Basic::DEFAULT_LEXEME,
+        const SubString& end_lexeme = Basic::DEFAULT_LEXEME)
+        throw (InvalidTemplate, TextTemplException, eh::Exception);
+
+      /**
+       * Compiles a pattern.
+       * @param istr stream to read and compile
+       * @param start_lexeme Start lexeme.
+       * @param end_lexeme End lexeme.
+       * @exception InvalidTemplate Invalid template.
+       * @exception TextTemplException Other errors.
+       * @exception eh::Exception std::exception.
+       */
+      void
+      init(std::istream& istr,
+        const SubString& start_lexeme = Basic::DEFAULT_LEXEME,
+        const SubString& end_lexeme = Basic::DEFAULT_LEXEME)
+        throw (InvalidTemplate, TextTemplException, eh::Exception);
+
+      /**
+       * Number of distinct keys in the template
+       * @return number of slots
+       */
+      size_t
+      slots() const throw ();
+
+      /**
+       * Key of the slot
+       * @param slot slot number, less than slots()
+       * @return key text
+       */
+      const SubString&
+      key(size_t slot) const throw ();
+
+      /**
+       * Finds the slot of the key, to be done once per key
+       * @param key key text
+       * @return slot number or NO_SLOT if the template has no such key
+       */
+      size_t
+      slot(const SubString& key) const throw ();
+
+      /**
+       * Instantiation of a pattern. result is reserved once for the whole
+       * output.
+       * @param values values for all the slots
+       * @param result instantiated template
+       * @exception UnknownName values for some slots are not supplied.
+       * @exception eh::Exception std::exception.
+       */
+      void
+      instantiate(const Values& values, std::string& result) const
+        throw (UnknownName, eh::Exception);
+
+      /**
+       * Instantiation of a pattern.
+       * @param values values for all the slots
+       * @return instantiated template
+       * @exception UnknownName values for some slots are not supplied.
+       * @exception eh::Exception std::exception.
+       */
+      std::string
+      instantiate(const Values& values) const
+        throw (UnknownName, eh::Exception);
+
+      /**
+       * Instantiation of a pattern, args is asked once per slot.
+       * @param args supplier of values for found keys
+       * @return instantiated template
+       * @exception UnknownName Invalid or unknown key.
+       * @exception TextTemplException Other errors.
+       * @exception eh::Exception std::exception.
+       */
+      std::string
+      instantiate(const ArgsCallback& args) const
+        throw (UnknownName, TextTemplException, eh::Exception);
+
+      /**
+       * Building a set of keys args contains values for.
+       * @param args supplier of values for found keys
+       * @param keys resulted keys set
+       * @exception UnknownName Invalid or unknown key.
+       * @exception TextTemplException Other errors.
+       * @exception eh::Exception std::exception.
+       */
+      void
+      keys(const ArgsCallback& args, Keys& keys) const
+        throw (UnknownName, TextTemplException, eh::Exception);
+
+      /**
+       * Tests whether the template is contains items or not
+       * @return true if contains
+       */
+      bool
+      empty() const throw ();
+
+    private:
+      /**
+       * Appends text_[offset, offset + size) if slot is NO_SLOT,
+       * the slot value otherwise
+       */
+      struct Operation
+      {
+        size_t slot;
+        size_t offset;
+        size_t size;
+      };
+
+      typedef std::vector<Operation> Operations;
+      typedef std::vector<SubString> SlotKeys;
+      typedef Generics::GnuHashTable<Generics::SubStringHashAdapter, size_t>
+        Slots;
+
+      void
+      compile_(const SubString& start_lexeme, const SubString& end_lexeme)
+        throw (InvalidTemplate, TextTemplException, eh::Exception);
+
+      std::string text_;
+      Operations operations_;
+      SlotKeys keys_;
+      std::vector<size_t> occurrences_;
+      Slots slots_;
+      size_t text_size_;
+    };
+
 
     /**
      * General adapter for ArgsContainer
@@ -657,6 +832,70 @@ namespace String
       IStream text_template_;
       std::string fname_;
     };
+
+    /**
+     * CompiledUpdateStrategy is UpdateStrategy keeping the template
+     * compiled, for use with FileCache.
+     */
+    class CompiledUpdateStrategy
+    {
+    public:
+      /**
+       * Declare Compiled class to be a FileCache buffer
+       */
+      typedef const Compiled Buffer;
+
+      /**
+       * Constructs CompiledUpdateStrategy object that will hold
+       * text template file name and use it to update Compiled instance.
+       * @param fname file name.
+       */
+      explicit
+      CompiledUpdateStrategy(const char* fname) throw (eh::Exception);
+
+      /**
+       * Destructs CompiledUpdateStrategy object
+       */
+      virtual
+      ~CompiledUpdateStrategy() throw ();
+
+      /**
+       * Provides reference to Compiled object as a in-memory buffer of a
+       * template file.
+       * @return Returns reference to the stored Compiled object.
+       */
+      Buffer&
+      get() throw ();
+
+      /**
+       * Recompiles stored Compiled object from a template file.
+       * Called by FileCache when file changes.
+       */
+      void
+      update() throw (TextTemplException, eh::Exception);
+
+      /**
+       * Provides text template lexeme which starts template variable entry.
+       * Should be implemented in derived class.
+       * @return Returns starting lexeme.
+       */
+      virtual
+      SubString
+      start_lexeme() const throw (eh::Exception) = 0;
+
+      /**
+       * Provides text template lexeme which ends template variable entry.
+       * Should be implemented in derived class.
+       * @return Returns ending lexeme.
+       */
+      virtual
+      SubString
+      end_lexeme() const throw (eh::Exception) = 0;
+
+    private:
+      Compiled text_template_;
+      std::string fname_;
+    };
   }
 }
 
@@ -730,6 +969,48 @@ namespace String
     }
 
 
+    //
+    // Compiled class
+    //
+
+    inline
+    Compiled::Compiled() throw ()
+      : text_size_(0)
+    {
+    }
+
+    inline
+    size_t
+    Compiled::slots() const throw ()
+    {
+      return keys_.size();
+    }
+
+    inline
+    const SubString&
+    Compiled::key(size_t slot) const throw ()
+    {
+      return keys_[slot];
+    }
+
+    inline
+    bool
+    Compiled::empty() const throw ()
+    {
+      return operations_.empty();
+    }
+
+    inline
+    std::string
+    Compiled::instantiate(const Values& values) const
+      throw (UnknownName, eh::Exception)
+    {
+      std::string result;
+      instantiate(values, result);
+      return result;
+    }
+
+
     //
     // ArgsContainerAdapter class
     //
@@ -847,6 +1128,30 @@ namespace String
     {
       return text_template_;
     }
+
+
+    //
+    // CompiledUpdateStrategy class
+    //
+
+    inline
+    CompiledUpdateStrategy::CompiledUpdateStrategy(const char* fname)
+      throw (eh::Exception)
+      : fname_(fname ? fname : "")
+    {
+    }
+
+    inline
+    CompiledUpdateStrategy::~CompiledUpdateStrategy() throw ()
+    {
+    }
+
+    inline
+    CompiledUpdateStrategy::Buffer&
+    CompiledUpdateStrategy::get() throw ()
+    {
+      return text_template_;
+    }
   }
 }
 
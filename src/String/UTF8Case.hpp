@@ -46,6 +46,16 @@ namespace String
       void
       backward(int step) throw ();
 
+      /**
+       * Converts the run of ASCII chars at the current position at once
+       * @param convert one of AsciiStringManip::ascii_to_*() functions
+       * @param dest destination, moved past the converted run
+       * @return length of the run
+       */
+      size_t
+      ascii(size_t (*convert)(const char*, size_t, char*), char*& dest)
+        throw ();
+
     private:
       const char* current_;
       const char* const END_;
@@ -187,6 +197,21 @@ namespace String
     {
       current_ -= step;
     }
+
+    inline
+    size_t
+    Iterator::ascii(size_t (*convert)(const char*, size_t, char*),
+      char*& dest) throw ()
+    {
+      if (current_ == END_ || (*current_ & 0x80))
+      {
+        return 0;
+      }
+      const size_t SIZE = convert(current_, END_ - current_, dest);
+      current_ += SIZE;
+      dest += SIZE;
+      return SIZE;
+    }
   }
 
   inline
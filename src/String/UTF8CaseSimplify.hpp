@@ -23,6 +23,7 @@
 #ifndef STRING_UTF8_CASE_SIMPLIFY_HPP
 #define STRING_UTF8_CASE_SIMPLIFY_HPP
 
+#include <String/AsciiStringManip.hpp>
 #include <String/UTF8Case.hpp>
 #include <String/UTF8Tables.hpp>
 #include <String/UTF8Handler.hpp>
@@ -177,6 +178,8 @@ String::ToSimplify::to_simplify(String::Helper::Iterator it, char*& dest,
     {
     case 1:
       *dest++ = TABLE_1[FIRST];
+      // Mostly ASCII text is converted by blocks
+      it.ascii(AsciiStringManip::ascii_to_simplify, dest);
       continue;
 
     case 2:
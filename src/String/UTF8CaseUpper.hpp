@@ -23,6 +23,7 @@
 #ifndef STRING_UTF8_CASE_UPPER_HPP
 #define STRING_UTF8_CASE_UPPER_HPP
 
+#include <String/AsciiStringManip.hpp>
 #include <String/UTF8Case.hpp>
 #include <String/UTF8Tables.hpp>
 #include <String/UTF8Handler.hpp>
@@ -39,6 +40,8 @@ String::ToUpper::to_upper(Helper::Iterator it, char*& dest, size_t& counter)
     {
     case 1:
       *dest++ = TABLE_1[FIRST];
+      // Mostly ASCII text is converted by blocks
+      counter += it.ascii(AsciiStringManip::ascii_to_upper, dest);
       continue;
     case 2:
       {
@@ -28,6 +28,8 @@
 
 #include <Generics/ArrayAutoPtr.hpp>
 
+#include <String/AsciiStringManip.hpp>
+
 
 namespace String
 {
@@ -57,6 +59,16 @@ namespace String
     const char*
     is_correct_utf8_string(const char* str) throw ();
 
+    /**
+     * Checks each symbol in the string to be UTF8-valid one, runs of
+     * ASCII chars are checked by blocks.
+     * @param str string to check
+     * @param size its size
+     * @return pointer to invalid or truncated symbol or 0
+     */
+    const char*
+    is_correct_utf8_string(const char* str, size_t size) throw ();
+
     unsigned long
     get_octet_count(char ch) throw ();
 
@@ -196,6 +208,29 @@ namespace String
       return 0;
     }
 
+    inline
+    const char*
+    is_correct_utf8_string(const char* str, size_t size) throw ()
+    {
+      const char* const END = str + size;
+      for (unsigned long octets_count; str != END; str += octets_count)
+      {
+        if (!(*str & 0x80))
+        {
+          // Single ASCII chars between words are not worth the call
+          octets_count = str + 1 != END && !(str[1] & 0x80) ?
+            AsciiStringManip::ascii_size(str, END - str) : 1;
+          continue;
+        }
+        if (get_octet_count(*str) > static_cast<size_t>(END - str) ||
+          !is_correct_utf8_sequence(str, octets_count))
+        {
+          return str;
+        }
+      }
+      return 0;
+    }
+
     /**
      * Index into the table below with the first byte of a UTF-8 sequence to
      * get the number of trailing bytes that are supposed to follow it.
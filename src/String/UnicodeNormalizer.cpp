@@ -24,7 +24,11 @@
 
 #include <cstddef>
 #include <algorithm>
+#include <vector>
 
+#include <Generics/Uncopyable.hpp>
+
+#include <String/UTF8Handler.hpp>
 #include <String/UnicodeNormalizer.hpp>
 
 /**
@@ -815,6 +819,228 @@ namespace String
 
       return output;
     }
+
+
+    namespace
+    {
+      /**
+       * Quick check data: stable symbols of the alphabetic blocks and
+       * the symbols that can be composed with the preceding ones
+       */
+      class QuickCheck
+      {
+      public:
+        QuickCheck() throw (eh::Exception);
+
+        bool
+        is_stable(wchar_t wch, bool idna2008) const throw ();
+
+      private:
+        static const wchar_t CACHED_ = 0x3400;
+        static const size_t BITS_ = 64;
+
+        bool
+        check_(wchar_t wch, bool idna2008) const throw ();
+
+        std::vector<wchar_t> combiners_;
+        uint64_t stable_[2][CACHED_ / BITS_];
+      } quick_check;
+
+      QuickCheck::QuickCheck() throw (eh::Exception)
+      {
+        const size_t SIZE = sizeof(Composition::COMPOSITE_HASH) /
+          sizeof(*Composition::COMPOSITE_HASH);
+        combiners_.reserve(SIZE + V_COUNT + T_COUNT);
+        for (size_t i = 0; i < SIZE; i++)
+        {
+          const Composition::CompositeHashRecord& RECORD =
+            Composition::COMPOSITE_HASH[i];
+          if (RECORD.value)
+          {
+            combiners_.push_back(RECORD.combiner);
+          }
+        }
+        // Hangul LV and LVT syllables are composed algorithmically
+        for (int i = 0; i < V_COUNT; i++)
+        {
+          combiners_.push_back(V_BASE + i);
+        }
+        for (int i = 0; i < T_COUNT; i++)
+        {
+          combiners_.push_back(T_BASE + i);
+        }
+        std::sort(combiners_.begin(), combiners_.end());
+        combiners_.erase(std::unique(combiners_.begin(), combiners_.end()),
+          combiners_.end());
+
+        for (int form = 0; form < 2; form++)
+        {
+          uint64_t* const STABLE = stable_[form];
+          std::fill(STABLE, STABLE + CACHED_ / BITS_, 0);
+          for (wchar_t wch = 0; wch < CACHED_; wch++)
+          {
+            if (check_(wch, form))
+            {
+              STABLE[wch / BITS_] |= static_cast<uint64_t>(1) <<
+                (wch % BITS_);
+            }
+          }
+        }
+      }
+
+      bool
+      QuickCheck::is_stable(wchar_t wch, bool idna2008) const throw ()
+      {
+        if (static_cast<uint32_t>(wch) < static_cast<uint32_t>(CACHED_))
+        {
+          return stable_[idna2008][wch / BITS_] &
+            (static_cast<uint64_t>(1) << (wch % BITS_));
+        }
+        return check_(wch, idna2008);
+      }
+
+      bool
+      QuickCheck::check_(wchar_t wch, bool idna2008) const throw ()
+      {
+        // Precomposed Hangul syllables are decomposed and composed back
+        if (wch >= S_BASE && wch < S_BASE + S_COUNT)
+        {
+          return true;
+        }
+
+        wchar_t decomposed[18];
+        return (idna2008 ? decompose_2008(wch, decomposed) :
+          decompose_2003(wch, decomposed)) == decomposed + 1 &&
+          *decomposed == wch && is_starter(wch) &&
+          !std::binary_search(combiners_.begin(), combiners_.end(), wch);
+      }
+
+      /**
+       * Decodes UTF-8 symbol
+       * @param cur The pointer to the symbol
+       * @param end The end of the text
+       * @param wch The decoded symbol
+       * @return The pointer beyond the symbol or 0 if it is invalid
+       */
+      inline
+      const char*
+      decode(const char* cur, const char* end, wchar_t& wch) throw ()
+      {
+        if (!(*cur & 0x80))
+        {
+          wch = *cur;
+          return cur + 1;
+        }
+        const unsigned long LENGTH = UTF8Handler::get_octet_count(*cur);
+        if (!LENGTH || LENGTH > static_cast<unsigned long>(end - cur) ||
+          !UTF8Handler::utf8_char_to_wchar(cur, LENGTH, wch))
+        {
+          return 0;
+        }
+        return cur + LENGTH;
+      }
+
+      /**
+       * Collects UTF-8 text from the input and normalized runs of it.
+       * Nothing is written to output until the first run is added.
+       */
+      class RunNormalizer : private Generics::Uncopyable
+      {
+      public:
+        RunNormalizer(const SubString& input, bool idna2008,
+          std::string& output) throw ();
+
+        /**
+         * Copies the input up to the run and appends the normalized run
+         * @param first The beginning of the run in the input
+         * @param last The end of the run
+         * @return false if the run can not be normalized
+         */
+        bool
+        append(const char* first, const char* last) throw (eh::Exception);
+
+        /**
+         * Copies the rest of input if any run has been added
+         * @return input or output
+         */
+        SubString
+        finish() throw (eh::Exception);
+
+      private:
+        const SubString input_;
+        const bool idna2008_;
+        std::string& output_;
+        const char* copied_;
+        std::wstring symbols_;
+        std::wstring normalized_;
+      };
+
+      RunNormalizer::RunNormalizer(const SubString& input, bool idna2008,
+        std::string& output) throw ()
+        : input_(input), idna2008_(idna2008), output_(output),
+          copied_(input.begin())
+      {
+      }
+
+      bool
+      RunNormalizer::append(const char* first, const char* last)
+        throw (eh::Exception)
+      {
+        if (copied_ == input_.begin())
+        {
+          output_.clear();
+        }
+        output_.append(copied_, first);
+        copied_ = last;
+
+        // Symbols are not more than octets
+        symbols_.resize(last - first);
+        wchar_t* symbols_end = &symbols_[0];
+        while (first != last)
+        {
+          first = decode(first, last, *symbols_end++);
+        }
+
+        normalized_.resize((symbols_end - &symbols_[0]) * 18);
+        wchar_t* const BEGIN = &normalized_[0];
+        wchar_t* end = normalize(&symbols_[0], symbols_end, BEGIN,
+          idna2008_ ? decompose_2008 : decompose_2003);
+        if (!end)
+        {
+          return false;
+        }
+        end = compose_string(BEGIN, end);
+
+        for (const wchar_t* cur = BEGIN; cur != end; ++cur)
+        {
+          char utf8[6];
+          unsigned long size;
+          if (!UTF8Handler::wchar_to_utf8_char(*cur, utf8, size))
+          {
+            return false;
+          }
+          output_.append(utf8, size);
+        }
+        return true;
+      }
+
+      SubString
+      RunNormalizer::finish() throw (eh::Exception)
+      {
+        if (copied_ == input_.begin())
+        {
+          return input_;
+        }
+        output_.append(copied_, input_.end());
+        return SubString(output_);
+      }
+    }
+
+    bool
+    is_stable(wchar_t wch, bool idna2008) throw ()
+    {
+      return quick_check.is_stable(wch, idna2008);
+    }
   }
 
   bool
@@ -838,4 +1064,58 @@ namespace String
     output.resize(out - &output[0]);
     return true;
   }
+
+  bool
+  lower_and_normalize(const String::SubString& input,
+    String::SubString& output, std::string& buffer, bool idna2008)
+    throw (eh::Exception)
+  {
+    if (input.empty())
+    {
+      return false;
+    }
+
+    Normalizer::RunNormalizer normalizer(input, idna2008, buffer);
+    const char* const END = input.end();
+    const char* run = 0;
+    const char* previous = input.begin();
+
+    for (const char* cur = input.begin(); cur != END;)
+    {
+      wchar_t wch;
+      const char* const NEXT = Normalizer::decode(cur, END, wch);
+      if (!NEXT)
+      {
+        return false;
+      }
+
+      if (!Normalizer::is_stable(wch, idna2008))
+      {
+        if (!run)
+        {
+          // The preceding stable symbol may be composed with this one
+          run = previous;
+        }
+      }
+      else if (run)
+      {
+        if (!normalizer.append(run, cur))
+        {
+          return false;
+        }
+        run = 0;
+      }
+
+      previous = cur;
+      cur = NEXT;
+    }
+
+    if (run && !normalizer.append(run, END))
+    {
+      return false;
+    }
+
+    output = normalizer.finish();
+    return true;
+  }
 }
@@ -43,6 +43,24 @@ namespace String
   lower_and_normalize(const String::WSubString& input,
     std::wstring& output, bool idna2008) throw (eh::Exception);
 
+  /**
+   * UTF-8 version of the above. Symbols the normalization keeps as is
+   * are recognized by the quick check and copied, only the runs around
+   * the others are converted and normalized.
+   * @param input UTF-8 text
+   * @param output normalized text, refers to input if it is normalized
+   * already or to buffer otherwise
+   * @param buffer storage for the normalized text, untouched if input
+   * is normalized already
+   * @param idna2008 if IDNA2008 rules (NFC) are applied
+   * (IDNA2003 with NFKC otherwise)
+   * @return if transformation was successful or not
+   */
+  bool
+  lower_and_normalize(const String::SubString& input,
+    String::SubString& output, std::string& buffer, bool idna2008)
+    throw (eh::Exception);
+
   namespace Normalizer
   {
     /**
@@ -116,6 +134,16 @@ namespace String
     normalize(const wchar_t* input, const wchar_t* last, wchar_t* output)
       throw ();
 
+    /**
+     * Quick check of the symbol
+     * @param wch The character to check
+     * @param idna2008 if IDNA2008 rules are applied
+     * @return true if the normalization keeps the character as is and
+     * never composes it with the preceding ones
+     */
+    bool
+    is_stable(wchar_t wch, bool idna2008) throw ();
+
     namespace Combining
     {
       typedef const uint8_t CombiningClassBlock[256];
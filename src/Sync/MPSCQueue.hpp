@@ -0,0 +1,201 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+// MPSCQueue.hpp
+#ifndef SYNC_MPSC_QUEUE_HPP
+#define SYNC_MPSC_QUEUE_HPP
+
+#include <sched.h>
+
+#include <utility>
+
+#include <eh/Exception.hpp>
+
+#include <Generics/Uncopyable.hpp>
+
+
+namespace Sync
+{
+  /**
+   * Unbounded multiple producers single consumer queue.
+   * push() never locks: it is one atomic exchange and one store.
+   * pop() must not be called concurrently, serialize consumers
+   * externally if there are several of them.
+   * Element is moved out from the queue node on pop().
+   */
+  template <typename Data>
+  class MPSCQueue : private Generics::Uncopyable
+  {
+  public:
+    MPSCQueue() throw (eh::Exception);
+
+    /**
+     * Destroys all the elements left
+     */
+    ~MPSCQueue() throw ();
+
+    /**
+     * Puts the element at the end of the queue. Safe to be called
+     * from any number of threads at the same time.
+     * @param data element to move into the queue
+     */
+    void
+    push(Data&& data) throw (eh::Exception);
+
+    /**
+     * Takes the element from the beginning of the queue.
+     * Single consumer only.
+     * @param data taken element holder
+     * @return false if the queue is empty, or the only element is being
+     * pushed at the moment.
+     */
+    bool
+    pop(Data& data) throw ();
+
+    /**
+     * Takes the element, waits for an incomplete push() of the
+     * element if it is in progress.
+     * Single consumer only.
+     * @param data taken element holder
+     * @return false if the queue is empty
+     */
+    bool
+    pop_wait(Data& data) throw ();
+
+    /**
+     * Approximate check, producers and the consumer can change the state
+     * immediately. Safe to be called from any thread.
+     * @return true if no elements in the queue
+     */
+    bool
+    empty() const throw ();
+
+  private:
+    struct Node
+    {
+      Node() throw (eh::Exception);
+      explicit
+      Node(Data&& value) throw (eh::Exception);
+
+      Node* next;
+      Data data;
+    };
+
+    Node* head_;
+    char padding_[64 - sizeof(Node*)];
+    Node* tail_;
+  };
+}
+
+namespace Sync
+{
+  //
+  // MPSCQueue::Node class
+  //
+
+  template <typename Data>
+  MPSCQueue<Data>::Node::Node() throw (eh::Exception)
+    : next(0)
+  {
+  }
+
+  template <typename Data>
+  MPSCQueue<Data>::Node::Node(Data&& value) throw (eh::Exception)
+    : next(0), data(std::move(value))
+  {
+  }
+
+
+  //
+  // MPSCQueue class
+  //
+
+  template <typename Data>
+  MPSCQueue<Data>::MPSCQueue() throw (eh::Exception)
+    : head_(new Node), tail_(head_)
+  {
+  }
+
+  template <typename Data>
+  MPSCQueue<Data>::~MPSCQueue() throw ()
+  {
+    while (tail_)
+    {
+      Node* next = tail_->next;
+      delete tail_;
+      tail_ = next;
+    }
+  }
+
+  template <typename Data>
+  void
+  MPSCQueue<Data>::push(Data&& data) throw (eh::Exception)
+  {
+    Node* node = new Node(std::move(data));
+    Node* prev = __atomic_exchange_n(&head_, node, __ATOMIC_ACQ_REL);
+    // Consumer can not see the node until this store
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+  }
+
+  template <typename Data>
+  bool
+  MPSCQueue<Data>::pop(Data& data) throw ()
+  {
+    Node* tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+    Node* next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (!next)
+    {
+      return false;
+    }
+    // next becomes the stub node
+    data = std::move(next->data);
+    next->data = Data();
+    // empty() can read tail_ from other threads
+    __atomic_store_n(&tail_, next, __ATOMIC_RELEASE);
+    delete tail;
+    return true;
+  }
+
+  template <typename Data>
+  bool
+  MPSCQueue<Data>::pop_wait(Data& data) throw ()
+  {
+    while (!pop(data))
+    {
+      if (empty())
+      {
+        return false;
+      }
+      sched_yield();
+    }
+    return true;
+  }
+
+  template <typename Data>
+  bool
+  MPSCQueue<Data>::empty() const throw ()
+  {
+    return __atomic_load_n(&head_, __ATOMIC_ACQUIRE) ==
+      __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+  }
+}
+
+#endif
@@ -28,6 +28,7 @@
 #include "TestAllocator.hpp"
 
 #include <eh/Exception.hpp>
+#include <Generics/Allocator.hpp>
 #include <Generics/ArrayAutoPtr.hpp>
 #include <Generics/MemBuf.hpp>
 #include <Generics/Rand.hpp>
@@ -478,6 +479,126 @@ collect_statistics() throw (eh::Exception)
   }
 }
 
+/**
+ * Allocates and releases blocks of random sizes through
+ * Generics::Allocator::Base keeping a number of them alive,
+ * the usage pattern of MemBuf and stream buffers.
+ */
+class BaseAllocatorTest
+{
+public:
+  static const std::size_t LIVE_BLOCKS = 64;
+  static const std::size_t OPERATIONS = 200000;
+
+  explicit
+  BaseAllocatorTest(std::size_t threads) throw ();
+
+  void
+  operator()() throw (eh::Exception);
+
+  Generics::Allocator::Base_var allocator;
+
+private:
+  const std::size_t OPERATIONS_;
+};
+
+BaseAllocatorTest::BaseAllocatorTest(std::size_t threads) throw ()
+  : OPERATIONS_(OPERATIONS / threads)
+{
+}
+
+void
+BaseAllocatorTest::operator()() throw (eh::Exception)
+{
+  Generics::Allocator::Base::Pointer blocks[LIVE_BLOCKS] = {};
+  std::size_t sizes[LIVE_BLOCKS] = {};
+  unsigned long seed = safe_rand();
+
+  for (std::size_t i = 0; i < OPERATIONS_; ++i)
+  {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const std::size_t SLOT = (seed >> 33) % LIVE_BLOCKS;
+    if (blocks[SLOT])
+    {
+      allocator->deallocate(blocks[SLOT], sizes[SLOT]);
+    }
+    // 16 bytes - 16 Kbytes, small blocks are more frequent
+    std::size_t size = (16 << ((seed >> 40) % 11)) + (seed >> 52) % 16;
+    const std::size_t REQUESTED = size;
+    blocks[SLOT] = allocator->allocate(size);
+    if (size < REQUESTED)
+    {
+      throw TestException("allocated block is smaller than requested");
+    }
+    sizes[SLOT] = size;
+    static_cast<unsigned char*>(blocks[SLOT])[0] = 0;
+    static_cast<unsigned char*>(blocks[SLOT])[size - 1] = 0;
+  }
+
+  for (std::size_t i = 0; i < LIVE_BLOCKS; ++i)
+  {
+    if (blocks[i])
+    {
+      allocator->deallocate(blocks[i], sizes[i]);
+    }
+  }
+}
+
+void
+do_base_allocators_test(std::size_t threads) throw (eh::Exception)
+{
+  Generics::Allocator::Base_var ALLOCATORS[] =
+  {
+    Generics::Allocator::Base_var(new Generics::Allocator::Default(4)),
+    Generics::Allocator::Base_var(
+      new Generics::Allocator::VarSizeList(4, 256)),
+    Generics::Allocator::Base_var(
+      new Generics::Allocator::ConstSizeArray(1024, 16 * 1024 + 16)),
+    Generics::Allocator::Base_var(new Generics::Allocator::ThreadMagazines),
+  };
+  const char* NAMES[] =
+  {
+    "Default",
+    "VarSizeList",
+    "ConstSizeArray",
+    "ThreadMagazines",
+  };
+
+  BaseAllocatorTest test(threads);
+  TestCommons::MTTester<BaseAllocatorTest&> mt_tester(test, threads);
+
+  std::cout << "\n\tBase allocators, " << threads << " threads, " <<
+    BaseAllocatorTest::OPERATIONS << " alloc/free" << std::endl;
+
+  for (std::size_t i = 0; i < sizeof(ALLOCATORS) / sizeof(ALLOCATORS[0]);
+    ++i)
+  {
+    test.allocator = ALLOCATORS[i];
+
+    Generics::Timer timer;
+    timer.start();
+    mt_tester.run(threads, 0, threads);
+    timer.stop();
+
+    std::cout.width(28);
+    std::cout << NAMES[i] << '|' << timer.elapsed_time() << '|';
+    ALLOCATORS[i]->print_cached(std::cout);
+    std::cout << std::endl;
+
+    test.allocator.reset();
+  }
+}
+
+void
+collect_base_statistics() throw (eh::Exception)
+{
+  const std::size_t THREADS[] = { 1, 4, 8, 16, 32 };
+  for (std::size_t i = 0; i < sizeof(THREADS) / sizeof(THREADS[0]); ++i)
+  {
+    do_base_allocators_test(THREADS[i]);
+  }
+}
+
 int
 main()
 {
@@ -490,6 +611,7 @@ main()
 
     std::cout << "Test passes " << METERS << std::endl;
 
+    collect_base_statistics();
     collect_statistics();
     
     std::cout << "Test complete" << std::endl;
@@ -0,0 +1,274 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <iostream>
+#include <list>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Generics/Arena.hpp>
+#include <Generics/MemBuf.hpp>
+#include <Generics/Time.hpp>
+#include <Stream/MemoryStream.hpp>
+
+
+namespace
+{
+  const size_t REQUESTS = 2000;
+  const size_t ELEMENTS = 500;
+
+  bool failed = false;
+
+  void
+  fail(const char* what) throw ()
+  {
+    std::cerr << "FAIL: " << what << std::endl;
+    failed = true;
+  }
+
+  typedef std::basic_string<char, std::char_traits<char>,
+    Generics::ArenaAllocator<char> > ArenaString;
+  typedef std::list<int, Generics::ArenaAllocator<int> > ArenaList;
+  typedef std::map<int, ArenaString, std::less<int>,
+    Generics::ArenaAllocator<std::pair<const int, ArenaString> > >
+      ArenaMap;
+  typedef Stream::MemoryStream::OutputMemoryStream<char,
+    std::char_traits<char>, Generics::ArenaAllocator<char>,
+    Generics::Arena*> ArenaStream;
+}
+
+void
+test_size_classes() throw (eh::Exception)
+{
+  Generics::Arena_var arena(new Generics::Arena);
+
+  for (size_t size = 1; size <= Generics::Arena::MAX_CLASS_SIZE * 2;
+    size += size / 8 + 1)
+  {
+    size_t real_size = size;
+    void* ptr = arena->allocate(real_size);
+    if (real_size < size || real_size > size + size / 4 + 16)
+    {
+      fail("size classes: allocated size");
+    }
+    if (reinterpret_cast<size_t>(ptr) % Generics::Arena::ALIGN)
+    {
+      fail("size classes: alignment");
+    }
+    memset(ptr, 0xAA, real_size);
+    arena->deallocate(ptr, real_size);
+
+    // The same class block is taken from the free list
+    size_t again_size = size;
+    void* again = arena->allocate(again_size);
+    if (size <= Generics::Arena::MAX_CLASS_SIZE && again != ptr)
+    {
+      fail("size classes: free list reuse");
+    }
+    arena->deallocate(again, again_size);
+  }
+
+  if (arena->allocated())
+  {
+    fail("size classes: allocated after deallocation");
+  }
+}
+
+void
+test_reset() throw (eh::Exception)
+{
+  Generics::Arena_var arena(new Generics::Arena(4096));
+
+  size_t cached = 0;
+  for (int pass = 0; pass < 3; pass++)
+  {
+    for (size_t i = 0; i < 1000; i++)
+    {
+      static_cast<char*>(arena->allocate_block(i % 100 + 1))[0] = 'a';
+    }
+    size_t big = 100000;
+    arena->allocate(big);
+
+    if (pass && arena->cached() != cached)
+    {
+      fail("reset: chunks are not reused");
+    }
+    cached = arena->cached();
+    arena->reset();
+    if (arena->allocated())
+    {
+      fail("reset: allocated after reset");
+    }
+  }
+
+  arena->release();
+  if (arena->cached() > Generics::Arena::MAX_CLASS_SIZE * 2)
+  {
+    fail("release: chunks are not released");
+  }
+}
+
+void
+test_containers() throw (eh::Exception)
+{
+  Generics::Arena_var arena(new Generics::Arena);
+  Generics::ArenaAllocator<char> allocator(arena);
+
+  for (int pass = 0; pass < 3; pass++)
+  {
+    {
+      ArenaList list(allocator);
+      ArenaMap map(std::less<int>(), allocator);
+      for (int i = 0; i < 1000; i++)
+      {
+        list.push_back(i);
+        ArenaString str(allocator);
+        str.assign(i % 50 + 20, 'a' + i % 26);
+        map.insert(ArenaMap::value_type(i, str));
+      }
+      int sum = 0;
+      for (ArenaList::const_iterator it = list.begin(); it != list.end();
+        ++it)
+      {
+        sum += *it;
+      }
+      if (sum != 999 * 1000 / 2 || map.size() != 1000 ||
+        map.find(500)->second !=
+          ArenaString(500 % 50 + 20, 'a' + 500 % 26, allocator))
+      {
+        fail("containers: content");
+      }
+    }
+    if (arena->allocated())
+    {
+      fail("containers: allocated after destruction");
+    }
+    arena->reset();
+  }
+}
+
+void
+test_streams() throw (eh::Exception)
+{
+  Generics::Arena_var arena(new Generics::Arena);
+
+  {
+    Generics::MemBuf buf(100, arena);
+    memset(buf.data(), 'b', buf.size());
+    Generics::MemBuf big(100000, arena);
+    memset(big.data(), 'c', big.size());
+    Generics::MemBuf copy(buf, arena.in());
+    if (copy.size() != 100 || static_cast<char*>(copy.data())[99] != 'b')
+    {
+      fail("streams: MemBuf copy");
+    }
+  }
+  if (arena->allocated())
+  {
+    fail("streams: MemBuf allocated after destruction");
+  }
+
+  {
+    ArenaStream ostr(16, arena.in());
+    for (int i = 0; i < 10000; i++)
+    {
+      ostr << i << ' ';
+    }
+    std::ostringstream check;
+    for (int i = 0; i < 10000; i++)
+    {
+      check << i << ' ';
+    }
+    if (ostr.str() != check.str())
+    {
+      fail("streams: OutputMemoryStream content");
+    }
+  }
+  arena->reset();
+}
+
+template <typename Allocator>
+void
+benchmark_request(const Allocator& allocator) throw (eh::Exception)
+{
+  typedef typename Allocator::template rebind<int>::other IntAllocator;
+  typedef std::basic_string<char, std::char_traits<char>,
+    typename Allocator::template rebind<char>::other> Str;
+  typedef std::map<int, Str, std::less<int>,
+    typename Allocator::template rebind<std::pair<const int, Str> >::other>
+      Map;
+
+  std::list<int, IntAllocator> list(allocator);
+  Map map(std::less<int>(), allocator);
+  for (size_t i = 0; i < ELEMENTS; i++)
+  {
+    list.push_back(i);
+    map.insert(typename Map::value_type(i,
+      Str(i % 40 + 20, 'x', allocator)));
+  }
+}
+
+void
+benchmark() throw (eh::Exception)
+{
+  Generics::Timer timer;
+  timer.start();
+  for (size_t i = 0; i < REQUESTS; i++)
+  {
+    benchmark_request(std::allocator<char>());
+  }
+  timer.stop();
+  std::cout << "std::allocator: " << timer.elapsed_time() << std::endl;
+
+  Generics::Arena_var arena(new Generics::Arena);
+  timer.start();
+  for (size_t i = 0; i < REQUESTS; i++)
+  {
+    benchmark_request(Generics::ArenaAllocator<char>(arena));
+    arena->reset();
+  }
+  timer.stop();
+  std::cout << "Arena: " << timer.elapsed_time() << " ";
+  arena->print_cached(std::cout);
+  std::cout << std::endl;
+}
+
+int
+main()
+{
+  try
+  {
+    test_size_classes();
+    test_reset();
+    test_containers();
+    test_streams();
+    benchmark();
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "FAIL: " << ex.what() << std::endl;
+    failed = true;
+  }
+
+  return failed;
+}
@@ -26,6 +26,7 @@
 #include <ReferenceCounting/Map.hpp>
 
 #include <Generics/BoundedMap.hpp>
+#include <Generics/ShardedBoundedMap.hpp>
 #include <Generics/GnuHashTable.hpp>
 
 #include <TestCommons/MTTester.hpp>
@@ -326,6 +327,79 @@ test_size() throw (eh::Exception)
   show_stats(map.statistics());
 }
 
+void
+test_sharded() throw (eh::Exception)
+{
+  typedef Generics::NumericHashAdapter<int> Key;
+  typedef Generics::ShardedBoundedMap<Key, DeleteNotifierPtr> Map;
+
+  const char* when = 0;
+  Checker ch(4);
+
+  // One segment to make the clock order predictable
+  CHECK(Map map(3, Generics::Time(3),
+    Generics::DefaultSizePolicy<Key, DeleteNotifierPtr>(), 1));
+  ch(when, 0, 0, 0, 0);
+
+  CHECK({ DeleteNotifierPtr d(new DeleteNotifier(ch[0]));
+    map.insert(Map::value_type(Key(0), d)); });
+  ch(when, 0, 0, 0, 0);
+
+  CHECK_(map.find(Key(0)) != map.end());
+  ch(when, 0, 0, 0, 0);
+
+  CHECK(map.erase(map.find(Key(0))));
+  ch(when, 1, 0, 0, 0);
+
+  CHECK({ DeleteNotifierPtr d(new DeleteNotifier(ch[0]));
+    map.insert(Map::value_type(Key(0), d)); });
+  ch(when, 0, 0, 0, 0);
+
+  CHECK({ DeleteNotifierPtr d(new DeleteNotifier(ch[1]));
+    map.insert(Map::value_type(Key(1), d)); });
+  ch(when, 0, 0, 0, 0);
+
+  CHECK({ DeleteNotifierPtr d(new DeleteNotifier(ch[2]));
+    map.insert(Map::value_type(Key(2), d)); });
+  ch(when, 0, 0, 0, 0);
+
+  // Insertion of the fourth item within timeout
+  CHECK({ DeleteNotifierPtr d(new DeleteNotifier(ch[3]));
+    map.insert(Map::value_type(Key(3), d)); });
+  ch(when, 0, 0, 0, 1);
+
+  // Referenced items get the second chance
+  sleep(4);
+  CHECK_(map.find(Key(0)) != map.end());
+  ch(when, 0, 0, 0, 0);
+
+  CHECK({ DeleteNotifierPtr d(new DeleteNotifier(ch[3]));
+    map.insert(Map::value_type(Key(3), d)); });
+  ch(when, 0, 1, 0, 0);
+
+  CHECK_(map.find(Key(0)) != map.end());
+  ch(when, 0, 0, 0, 0);
+
+  // Replacement
+  CHECK({DeleteNotifierPtr d(new DeleteNotifier(ch[1]));
+    map[Key(3)] = d; });
+  ch(when, 0, 0, 0, 1);
+
+  CHECK_(map.size() == 3);
+  ch(when, 0, 0, 0, 0);
+
+  CHECK(map.clear());
+  ch(when, 1, 1, 1, 0);
+
+  Generics::BoundedMapStat stat(map.statistics());
+  check("test_sharded", "inserted_new", stat.inserted_new == 5, true);
+  check("test_sharded", "removed_outdated", stat.removed_outdated == 1,
+    true);
+  check("test_sharded", "not_inserted", stat.not_inserted == 1, true);
+  check("test_sharded", "replaced", stat.replaced == 1, true);
+  show_stats(stat);
+}
+
 #undef CHECK
 #undef CHECK_
 
@@ -478,6 +552,83 @@ test_copy() throw (eh::Exception)
   std::cout << "test_copy complete\n";
 }
 
+template <typename Map>
+class FindTest
+{
+public:
+  FindTest(Map& map, int keys) throw ()
+    : map_(map), keys_(keys)
+  {
+  }
+
+  void
+  operator ()() throw (eh::Exception)
+  {
+    unsigned seed = rand();
+    for (int i = 0; i < 10000; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      if (map_.find(typename Map::key_type((seed >> 8) % keys_)) ==
+        map_.end())
+      {
+        throw Exception("Item not found");
+      }
+    }
+  }
+
+private:
+  Map& map_;
+  int keys_;
+};
+
+template <typename Map>
+void
+measure_find(const char* name, Map& map, int keys, int threads)
+  throw (eh::Exception)
+{
+  for (int i = 0; i < keys; i++)
+  {
+    map.insert(typename Map::value_type(i, i));
+  }
+
+  const int TASKS = threads * 20;
+  FindTest<Map> find(map, keys);
+  TestCommons::MTTester<FindTest<Map>&> test(find, threads);
+  Generics::Timer timer;
+  timer.start();
+  test.run(threads, 0, TASKS);
+  timer.stop();
+  std::cout << name << " " << threads << " threads: " <<
+    TASKS * 10000 / timer.elapsed_time().as_double() <<
+    " finds/sec" << std::endl;
+}
+
+void
+test_find_performance() throw (eh::Exception)
+{
+  typedef Generics::NumericHashAdapter<int> Key;
+  const int KEYS = 100000;
+  const int THREADS[] = { 1, 4, 16 };
+
+  for (size_t i = 0; i < sizeof(THREADS) / sizeof(*THREADS); i++)
+  {
+    {
+      Generics::BoundedMap<Key, int> map(KEYS, Generics::Time(10));
+      measure_find("BoundedMap", map, KEYS, THREADS[i]);
+    }
+    {
+      Generics::ShardedBoundedMap<Key, int> map(KEYS, Generics::Time(10));
+      measure_find("ShardedBoundedMap", map, KEYS, THREADS[i]);
+    }
+    {
+      Generics::ShardedBoundedMap<Key, int,
+        Generics::DefaultSizePolicy<Key, int>, Sync::Policy::PosixThread>
+        map(KEYS, Generics::Time(10));
+      measure_find("ShardedBoundedMap (mutex)", map, KEYS, THREADS[i]);
+    }
+  }
+}
+
 int
 main()
 {
@@ -489,6 +640,8 @@ main()
     test_size();
     test_multi();
     test_copy();
+    test_sharded();
+    test_find_performance();
 
     result = 0;
   }
@@ -19,19 +19,151 @@
 
 
 
+#include <string.h>
 #include <unistd.h>
 
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 #include <Generics/CRC.hpp>
+#include <Generics/Rand.hpp>
+#include <Generics/Time.hpp>
 #include <Logger/StreamLogger.hpp>
 
+namespace
+{
+  const Generics::CRC::Kernel KERNELS[] =
+  {
+    Generics::CRC::K_BYTE,
+    Generics::CRC::K_SLICE8,
+    Generics::CRC::K_SLICE16,
+    Generics::CRC::K_PCLMUL
+  };
+
+  const char* KERNEL_NAMES[] =
+  {
+    "byte",
+    "slice8",
+    "slice16",
+    "pclmul"
+  };
+
+  const size_t KERNELS_NUMBER = sizeof(KERNELS) / sizeof(*KERNELS);
+}
+
+/**
+ * Compares all of the kernels with the byte one on random data
+ * of different sizes and alignments
+ */
+bool
+check_kernels() throw ()
+{
+  unsigned char buffer[1024 + 16];
+  for (size_t i = 0; i < sizeof(buffer); i++)
+  {
+    buffer[i] = Generics::safe_rand(256);
+  }
+
+  for (size_t size = 0; size <= 1024; size += size < 300 ? 1 : 61)
+  {
+    for (size_t offset = 0; offset < 16; offset += 5)
+    {
+      const uint32_t INIT = Generics::safe_rand();
+      const unsigned char* data = buffer + offset;
+      const uint32_t QUICK =
+        Generics::CRC::quick(Generics::CRC::K_BYTE, INIT, data, size);
+      const uint32_t REVERSED =
+        Generics::CRC::reversed(Generics::CRC::K_BYTE, INIT, data, size);
+
+      bool ok = Generics::CRC::quick(INIT, data, size) == QUICK &&
+        Generics::CRC::reversed(INIT, data, size) == REVERSED;
+      for (size_t k = 0; k < KERNELS_NUMBER; k++)
+      {
+        if (Generics::CRC::supported(KERNELS[k]))
+        {
+          ok = ok && Generics::CRC::quick(KERNELS[k], INIT, data, size) ==
+            QUICK && Generics::CRC::reversed(KERNELS[k], INIT, data, size) ==
+            REVERSED;
+        }
+      }
+      if (!ok)
+      {
+        std::cerr << "Kernels mismatch for size " << size << " offset " <<
+          offset << std::endl;
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Prints throughput of the kernels for different block sizes
+ */
+void
+benchmark() throw (eh::Exception)
+{
+  const size_t SIZES[] = { 64, 256, 1024, 4096, 65536, 1024 * 1024 };
+  const size_t TOTAL = 64 * 1024 * 1024;
+
+  std::vector<unsigned char> buffer(SIZES[sizeof(SIZES) / sizeof(*SIZES) - 1]);
+  for (size_t i = 0; i < buffer.size(); i++)
+  {
+    buffer[i] = i * 7;
+  }
+
+  std::cout << "GB/s      ";
+  for (size_t k = 0; k < KERNELS_NUMBER; k++)
+  {
+    std::cout << "quick/" << KERNEL_NAMES[k] << " reversed/" <<
+      KERNEL_NAMES[k] << " ";
+  }
+  std::cout << std::endl;
+
+  uint32_t crc = 0;
+  for (size_t s = 0; s < sizeof(SIZES) / sizeof(*SIZES); s++)
+  {
+    std::cout << SIZES[s] << "\t";
+    for (size_t k = 0; k < KERNELS_NUMBER; k++)
+    {
+      for (int reversed = 0; reversed < 2; reversed++)
+      {
+        if (!Generics::CRC::supported(KERNELS[k]))
+        {
+          std::cout << " -";
+          continue;
+        }
+
+        Generics::Timer timer;
+        timer.start();
+        for (size_t done = 0; done < TOTAL; done += SIZES[s])
+        {
+          crc = reversed ?
+            Generics::CRC::reversed(KERNELS[k], crc, &buffer[0], SIZES[s]) :
+            Generics::CRC::quick(KERNELS[k], crc, &buffer[0], SIZES[s]);
+        }
+        timer.stop();
+
+        std::cout << " " << TOTAL / timer.elapsed_time().as_double() / 1e9;
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  // Keep the calculations
+  if (crc == 1)
+  {
+    std::cout << std::endl;
+  }
+}
+
 int main(int argc, char** argv)
 {
   const size_t CrcBufLength = 1024 * 1024;
   int quant = 0;
-  bool has_expected;
+  bool has_expected = false;
   unsigned long expected = 0;
 
   if (argc > 1)
@@ -51,6 +183,9 @@ int main(int argc, char** argv)
       std::cerr << "Accepts command line argument (if numeric) as quantifying "
         "factor: calculates as many times as specified for speed measurement "
         "purposes" << std::endl;
+      std::cerr << "With the expected CRC, the file name and 'perf' as "
+        "the fourth argument also measures the kernels throughput" <<
+        std::endl;
       exit(3);
     }
   }
@@ -89,6 +224,16 @@ int main(int argc, char** argv)
       std::cerr << "Got " << crc << " while expecting " << expected << std::endl;
       return 1;
     }
+
+    if (!check_kernels())
+    {
+      return 1;
+    }
+
+    if (argc > 4 && strcmp(argv[4], "perf") == 0)
+    {
+      benchmark();
+    }
   }
   else
   {
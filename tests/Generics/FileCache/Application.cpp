@@ -0,0 +1,226 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cstdio>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+
+#include <unistd.h>
+#include <utime.h>
+
+#include <Generics/FileCache.hpp>
+#include <Generics/ThreadRunner.hpp>
+
+
+namespace
+{
+  const char FILE_NAME[] = "./file_cache.test";
+  const char TMP_FILE_NAME[] = "./file_cache.test.tmp";
+  const unsigned READERS = 8;
+  const unsigned RELOADS = 100;
+
+  bool failed = false;
+
+  void
+  fail(const char* what) throw ()
+  {
+    std::cerr << "FAIL: " << what << std::endl;
+    failed = true;
+  }
+
+  /**
+   * Replaces the file with a new one having the specified modification time
+   */
+  void
+  write_file(const std::string& content, time_t mtime)
+    throw (eh::Exception)
+  {
+    {
+      std::ofstream ostr(TMP_FILE_NAME);
+      ostr << content;
+    }
+    utimbuf times = { mtime, mtime };
+    if (utime(TMP_FILE_NAME, &times) ||
+      rename(TMP_FILE_NAME, FILE_NAME))
+    {
+      throw Generics::CacheExceptions::CacheException("Failed to replace");
+    }
+  }
+
+  std::string
+  version_content(unsigned version) throw (eh::Exception)
+  {
+    // Every version consists of one repeated character
+    return std::string(4096 + version, 'a' + version % 26);
+  }
+}
+
+void
+test_mmap_strategy() throw (eh::Exception)
+{
+  typedef Generics::FileCache<Generics::MMapFileUpdateStrategy> Cache;
+
+  const time_t NOW = time(0);
+  write_file("first", NOW - 100);
+  Cache::Cache_var cache(new Cache(FILE_NAME));
+
+  if (**cache->get() != "first")
+  {
+    fail("mmap strategy: initial content");
+  }
+
+  write_file("second", NOW - 50);
+  if (**cache->get() != "second")
+  {
+    fail("mmap strategy: reloaded content");
+  }
+
+  write_file("", NOW - 10);
+  if (!(**cache->get()).empty())
+  {
+    fail("mmap strategy: empty file");
+  }
+}
+
+void
+test_swapping() throw (eh::Exception)
+{
+  typedef Generics::SwappingCache<Generics::SimpleFileCheckStrategy,
+    Generics::MMapFileUpdateStrategy> Cache;
+
+  const time_t NOW = time(0);
+  write_file("first", NOW - 100);
+  Cache::Cache_var cache(new Cache(FILE_NAME));
+
+  Cache::BufferHolder_var first(cache->get());
+  if (**first != "first")
+  {
+    fail("swapping: initial content");
+  }
+
+  // The previous version is held, the new one must be published anyway
+  write_file("second", NOW - 50);
+  Cache::BufferHolder_var second(cache->get());
+  if (**second != "second")
+  {
+    fail("swapping: reloaded content");
+  }
+  if (**first != "first")
+  {
+    fail("swapping: held version changed");
+  }
+
+  first.reset();
+  if (**cache->get() != "second")
+  {
+    fail("swapping: current version");
+  }
+}
+
+typedef Generics::SwappingCache<Generics::SimpleFileCheckStrategy,
+  Generics::MMapFileUpdateStrategy> SwappingFileCache;
+
+class Reader : public Generics::ThreadJob
+{
+public:
+  Reader(SwappingFileCache* cache, volatile bool& stop) throw ()
+    : cache_(ReferenceCounting::add_ref(cache)), stop_(stop)
+  {
+  }
+
+  virtual
+  void
+  work() throw ()
+  {
+    try
+    {
+      while (!stop_)
+      {
+        SwappingFileCache::BufferHolder_var holder(cache_->get());
+        const String::SubString& content = **holder;
+        if (content.empty() ||
+          static_cast<size_t>(std::count(content.begin(), content.end(),
+            content[0])) != content.size())
+        {
+          fail("swapping MT: torn content");
+          return;
+        }
+      }
+    }
+    catch (const eh::Exception& ex)
+    {
+      std::cerr << "FAIL: " << ex.what() << std::endl;
+      failed = true;
+    }
+  }
+
+private:
+  SwappingFileCache::Cache_var cache_;
+  volatile bool& stop_;
+};
+
+void
+test_swapping_mt() throw (eh::Exception)
+{
+  const time_t NOW = time(0);
+  write_file(version_content(0), NOW - RELOADS - 1);
+  SwappingFileCache::Cache_var cache(new SwappingFileCache(FILE_NAME));
+
+  volatile bool stop = false;
+  Generics::ThreadJob_var reader(new Reader(cache, stop));
+  Generics::ThreadRunner readers(reader, READERS);
+  readers.start();
+
+  for (unsigned i = 1; i <= RELOADS; i++)
+  {
+    write_file(version_content(i), NOW - RELOADS - 1 + i);
+    usleep(1000);
+  }
+
+  stop = true;
+  readers.wait_for_completion();
+
+  if (**cache->get() != version_content(RELOADS))
+  {
+    fail("swapping MT: last version");
+  }
+}
+
+int
+main()
+{
+  try
+  {
+    test_mmap_strategy();
+    test_swapping();
+    test_swapping_mt();
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "FAIL: " << ex.what() << std::endl;
+    failed = true;
+  }
+
+  unlink(FILE_NAME);
+
+  return failed;
+}
@@ -21,6 +21,9 @@
 
 // @file Application.cpp
 
+#include <algorithm>
+#include <vector>
+
 #include <Logger/StreamLogger.hpp>
 #include <Logger/ActiveObjectCallback.hpp>
 
@@ -72,6 +75,185 @@ ActivateDeactivatePlanner::test() throw (eh::Exception)
   }
 }
 
+class EmptyGoal :
+  public Generics::Goal,
+  public ReferenceCounting::AtomicImpl
+{
+public:
+  virtual
+  void
+  deliver() throw (eh::Exception)
+  {
+  }
+
+protected:
+  virtual
+  ~EmptyGoal() throw ()
+  {
+  }
+};
+
+/**
+ * Goal recording its delivery, counts alive goals
+ */
+class RecordingGoal :
+  public Generics::Goal,
+  public ReferenceCounting::AtomicImpl
+{
+public:
+  typedef std::vector<unsigned> Delivered;
+
+  RecordingGoal(unsigned id, Delivered& delivered, Sync::PosixMutex& mutex,
+    volatile _Atomic_word& alive) throw ()
+    : id_(id), delivered_(delivered), mutex_(mutex), alive_(alive)
+  {
+    __gnu_cxx::__atomic_add(&alive_, 1);
+  }
+
+  virtual
+  void
+  deliver() throw (eh::Exception)
+  {
+    Sync::PosixGuard guard(mutex_);
+    delivered_.push_back(id_);
+  }
+
+protected:
+  virtual
+  ~RecordingGoal() throw ()
+  {
+    __gnu_cxx::__atomic_add(&alive_, -1);
+  }
+
+private:
+  const unsigned id_;
+  Delivered& delivered_;
+  Sync::PosixMutex& mutex_;
+  volatile _Atomic_word& alive_;
+};
+
+/**
+ * Checks the order of the goals with the same time and that
+ * the handles don't keep delivered and unscheduled goals
+ */
+bool
+test_delivery() throw (eh::Exception)
+{
+  static const unsigned GOALS = 4;
+
+  RecordingGoal::Delivered delivered;
+  Sync::PosixMutex mutex;
+  volatile _Atomic_word alive = 0;
+
+  Generics::Planner_var planner(new Generics::Planner(callback));
+  const Generics::Time TIME(Generics::Time::get_time_of_day());
+  std::vector<Generics::Planner::GoalHandle_var> handles;
+  for (unsigned i = 0; i < GOALS; i++)
+  {
+    handles.push_back(planner->schedule(
+      Generics::Goal_var(new RecordingGoal(i, delivered, mutex, alive)),
+      TIME));
+  }
+  planner->unschedule(handles[1]);
+
+  planner->activate_object();
+  for (unsigned i = 0; i < 1000 && alive; i++)
+  {
+    usleep(1000);
+  }
+  planner->deactivate_object();
+  planner->wait_object();
+
+  bool result = true;
+  const unsigned EXPECTED[] = { 3, 2, 0 };
+  if (delivered != RecordingGoal::Delivered(EXPECTED,
+    EXPECTED + sizeof(EXPECTED) / sizeof(*EXPECTED)))
+  {
+    std::cerr << "FAIL: goals with the same time delivered in "
+      "a wrong order" << std::endl;
+    result = false;
+  }
+  if (alive)
+  {
+    std::cerr << "FAIL: " << alive << " goals kept by handles" <<
+      std::endl;
+    result = false;
+  }
+
+  return result;
+}
+
+/**
+ * Schedules and cancels many goals with far delivery times
+ */
+class ScheduleUnschedulePerformance
+{
+public:
+  bool
+  test() throw (eh::Exception);
+
+private:
+  static const unsigned GOALS = 1000000;
+
+  typedef std::vector<Generics::Planner::GoalHandle_var> Handles;
+};
+
+bool
+ScheduleUnschedulePerformance::test() throw (eh::Exception)
+{
+  bool result = true;
+
+  Generics::Planner_var planner(new Generics::Planner(callback));
+  planner->activate_object();
+
+  Generics::Goal_var goal(new EmptyGoal);
+  const Generics::Time BASE(Generics::Time::get_time_of_day() + 3600);
+  Handles handles;
+  handles.reserve(GOALS);
+
+  Generics::Timer timer;
+  timer.start();
+  for (unsigned i = 0; i < GOALS; i++)
+  {
+    handles.push_back(planner->schedule(goal,
+      BASE + Generics::Time(rand() % 3600, rand() % 1000000)));
+  }
+  timer.stop();
+  std::cout << "schedule of " << GOALS << " goals: " <<
+    timer.elapsed_time() << std::endl;
+
+  std::random_shuffle(handles.begin(), handles.end());
+
+  timer.start();
+  for (Handles::iterator itor(handles.begin()); itor != handles.end();
+    ++itor)
+  {
+    if (!planner->unschedule(*itor))
+    {
+      result = false;
+    }
+  }
+  timer.stop();
+  std::cout << "unschedule of " << GOALS << " goals: " <<
+    timer.elapsed_time() << std::endl;
+
+  if (!result)
+  {
+    std::cerr << "FAIL: scheduled goal not found" << std::endl;
+  }
+  if (planner->unschedule(handles.front()) ||
+    planner->unschedule(goal))
+  {
+    std::cerr << "FAIL: unscheduled goal found" << std::endl;
+    result = false;
+  }
+
+  planner->deactivate_object();
+  planner->wait_object();
+
+  return result;
+}
+
 int
 main()
 {
@@ -81,6 +263,15 @@ main()
   {
     ActivateDeactivatePlanner tester;
     tester.test();
+    if (!test_delivery())
+    {
+      return -1;
+    }
+    ScheduleUnschedulePerformance performance;
+    if (!performance.test())
+    {
+      return -1;
+    }
     std::cout << "SUCCESS" << std::endl;
     return 0;
   }
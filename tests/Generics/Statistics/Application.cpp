@@ -0,0 +1,335 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+#include <Generics/Statistics.hpp>
+#include <Generics/ThreadRunner.hpp>
+#include <Generics/Time.hpp>
+
+
+namespace
+{
+  const unsigned THREADS = 8;
+  const unsigned SAMPLES = 100000;
+  const unsigned BENCHMARK_SAMPLES = 4000000;
+  const unsigned BENCHMARK_THREADS[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+  bool failed = false;
+
+  void
+  fail(const char* what) throw ()
+  {
+    std::cerr << "FAIL: " << what << std::endl;
+    failed = true;
+  }
+
+  /**
+   * Considers times 1..count microseconds (shifted by offset)
+   */
+  class Considerer : public Generics::ThreadJob
+  {
+  public:
+    Considerer(Generics::Statistics::StatSink* sink, unsigned count,
+      unsigned offset = 0) throw ()
+      : sink_(ReferenceCounting::add_ref(sink)), count_(count),
+        offset_(offset)
+    {
+    }
+
+    virtual
+    void
+    work() throw ()
+    {
+      try
+      {
+        Generics::Statistics::TimedSubject subject(Generics::Time::ZERO);
+        for (unsigned i = 1; i <= count_; i++)
+        {
+          subject.time(Generics::Time(0, i + offset_));
+          sink_->consider(subject);
+        }
+      }
+      catch (const eh::Exception& ex)
+      {
+        std::cerr << "FAIL: " << ex.what() << std::endl;
+        failed = true;
+      }
+    }
+
+  private:
+    Generics::Statistics::StatSink_var sink_;
+    const unsigned count_;
+    const unsigned offset_;
+  };
+
+  /**
+   * Counts the dumps requested by Collection
+   */
+  class CountingDumpRunner :
+    public virtual Generics::Statistics::NullDumpRunner
+  {
+  public:
+    CountingDumpRunner() throw ()
+      : dumps_(0)
+    {
+    }
+
+    virtual
+    void
+    execute_dumping(Generics::Statistics::DumpPolicy* policy,
+      Generics::Statistics::StatSink* stat) throw (eh::Exception)
+    {
+      Generics::Statistics::DumpPolicy_var policy_holder(policy);
+      Generics::Statistics::StatSink_var stat_holder(stat);
+      __gnu_cxx::__atomic_add(&dumps_, 1);
+    }
+
+    int
+    dumps() const throw ()
+    {
+      return dumps_;
+    }
+
+  protected:
+    virtual
+    ~CountingDumpRunner() throw ()
+    {
+    }
+
+  private:
+    volatile _Atomic_word dumps_;
+  };
+
+  void
+  run(Generics::Statistics::StatSink* sink, unsigned threads,
+    unsigned count) throw (eh::Exception)
+  {
+    Generics::ThreadRunner runner(
+      Generics::ThreadJob_var(new Considerer(sink, count)), threads);
+    runner.start();
+    runner.wait_for_completion();
+  }
+}
+
+void
+check_sharded() throw (eh::Exception)
+{
+  Generics::Statistics::TimedStatSink_var plain(
+    new Generics::Statistics::TimedStatSink);
+  Generics::Statistics::ShardedTimedStatSink_var sharded(
+    new Generics::Statistics::ShardedTimedStatSink(THREADS / 2));
+
+  run(plain, THREADS, SAMPLES);
+  run(sharded, THREADS, SAMPLES);
+
+  const Generics::Statistics::TimedStatData::Data EXPECTED = plain->data();
+  const Generics::Statistics::TimedStatData::Data DATA = sharded->data();
+  if (DATA.count != THREADS * SAMPLES || DATA.count != EXPECTED.count ||
+    DATA.min_time != EXPECTED.min_time ||
+    DATA.max_time != EXPECTED.max_time ||
+    DATA.total_time != EXPECTED.total_time ||
+    sharded->average_time() != plain->average_time())
+  {
+    std::cerr << "Expected:" << std::endl << *plain << "Got:" <<
+      std::endl << *sharded;
+    fail("sharded: merged data differs");
+  }
+
+  Generics::Statistics::StatSink_var clone(sharded->clone());
+  if (clone->considered_count() != THREADS * SAMPLES)
+  {
+    fail("sharded: clone");
+  }
+
+  sharded->reset();
+  if (sharded->considered_count() ||
+    sharded->max_time() != Generics::Time::ZERO)
+  {
+    fail("sharded: reset");
+  }
+}
+
+void
+check_histogram() throw (eh::Exception)
+{
+  typedef Generics::Statistics::HistogramStatSink Histogram;
+
+  unsigned prev = 0;
+  for (unsigned long long usec = 0; usec < (1ULL << 24); usec += 1 + usec / 64)
+  {
+    const unsigned BUCKET = Histogram::bucket(usec);
+    if (BUCKET < prev || BUCKET >= Histogram::BUCKETS ||
+      Histogram::bucket_limit(BUCKET) < usec ||
+      (BUCKET && Histogram::bucket_limit(BUCKET - 1) >= usec))
+    {
+      std::cerr << "usec " << usec << " bucket " << BUCKET << std::endl;
+      fail("histogram: bucket bounds");
+      return;
+    }
+    prev = BUCKET;
+  }
+  if (Histogram::bucket(~0ULL) != Histogram::BUCKETS - 1)
+  {
+    fail("histogram: overflow bucket");
+  }
+
+  Generics::Statistics::HistogramStatSink_var histogram(
+    new Histogram(THREADS));
+  run(histogram, THREADS, SAMPLES);
+
+  const double FRACTIONS[] = { 0.5, 0.9, 0.99, 0.999, 1 };
+  for (unsigned i = 0; i < sizeof(FRACTIONS) / sizeof(*FRACTIONS); i++)
+  {
+    const double EXPECTED = FRACTIONS[i] * SAMPLES;
+    const double GOT = histogram->percentile(FRACTIONS[i]).microseconds();
+    if (GOT < EXPECTED || GOT > EXPECTED * (1 + 1.0 / Histogram::SUB_BUCKETS))
+    {
+      std::cerr << "p" << FRACTIONS[i] << ": expected " << EXPECTED <<
+        " got " << GOT << std::endl;
+      fail("histogram: percentile");
+    }
+  }
+  if (histogram->min_time() != Generics::Time(0, 1) ||
+    histogram->max_time() != Generics::Time(0, SAMPLES))
+  {
+    fail("histogram: extremes");
+  }
+
+  histogram->dump(std::cout);
+  std::cout << std::endl;
+
+  histogram->reset();
+  if (histogram->percentile(0.5) != Generics::Time::ZERO)
+  {
+    fail("histogram: reset");
+  }
+}
+
+void
+check_collection() throw (eh::Exception)
+{
+  Generics::Statistics::DumpRunner_var runner(
+    new Generics::Statistics::NullDumpRunner);
+  Generics::Statistics::Collection_var collection(
+    new Generics::Statistics::Collection(runner));
+  Generics::Statistics::DumpPolicy_var policy(
+    new Generics::Statistics::NullDumpPolicy);
+  collection->add("sharded",
+    new Generics::Statistics::ShardedTimedStatSink, policy);
+
+  Generics::Statistics::StatSink_var item(collection->get("sharded"));
+  run(item, THREADS, SAMPLES);
+  if (item->considered_count() != THREADS * SAMPLES)
+  {
+    fail("collection: considered count");
+  }
+
+  // Every dump_freq-th consider() is dumped exactly once, both for
+  // the ordinary sinks and the concurrent ones
+  const unsigned DUMP_FREQ = 1000;
+  Generics::Statistics::StatSink_var sinks[] =
+  {
+    Generics::Statistics::StatSink_var(
+      new Generics::Statistics::TimedStatSink),
+    Generics::Statistics::StatSink_var(
+      new Generics::Statistics::ShardedTimedStatSink),
+  };
+  for (unsigned i = 0; i < sizeof(sinks) / sizeof(*sinks); i++)
+  {
+    ReferenceCounting::QualPtr<CountingDumpRunner> counting_runner(
+      new CountingDumpRunner);
+    Generics::Statistics::Collection_var counted(
+      new Generics::Statistics::Collection(counting_runner));
+    Generics::Statistics::DumpPolicy_var count_policy(
+      new Generics::Statistics::CountBasedDumpPolicy(std::cout,
+        DUMP_FREQ));
+    counted->add("counted", ReferenceCounting::add_ref(sinks[i]),
+      count_policy);
+
+    run(Generics::Statistics::StatSink_var(counted->get("counted")),
+      THREADS, SAMPLES);
+    if (counting_runner->dumps() != static_cast<int>(
+      THREADS * SAMPLES / DUMP_FREQ))
+    {
+      fail("collection: count based dumps");
+    }
+  }
+}
+
+void
+benchmark() throw (eh::Exception)
+{
+  std::cout << "consider() cost, ns per call" << std::endl <<
+    std::setw(8) << "threads" << std::setw(12) << "mutex" <<
+    std::setw(12) << "sharded" << std::setw(12) << "histogram" << std::endl;
+
+  for (unsigned i = 0;
+    i < sizeof(BENCHMARK_THREADS) / sizeof(*BENCHMARK_THREADS); i++)
+  {
+    const unsigned THREADS = BENCHMARK_THREADS[i];
+    Generics::Statistics::StatSink_var sinks[] =
+    {
+      Generics::Statistics::StatSink_var(
+        new Generics::Statistics::TimedStatSink),
+      Generics::Statistics::StatSink_var(
+        new Generics::Statistics::ShardedTimedStatSink(
+          std::max(THREADS, 16u))),
+      Generics::Statistics::StatSink_var(
+        new Generics::Statistics::HistogramStatSink(
+          std::max(THREADS, 16u)))
+    };
+
+    std::cout << std::setw(8) << THREADS;
+    for (unsigned j = 0; j < sizeof(sinks) / sizeof(*sinks); j++)
+    {
+      Generics::Timer timer;
+      timer.start();
+      run(sinks[j], THREADS, BENCHMARK_SAMPLES / THREADS);
+      timer.stop();
+      std::cout << std::setw(12) << std::fixed << std::setprecision(1) <<
+        timer.elapsed_time().as_double() * 1e9 / BENCHMARK_SAMPLES;
+    }
+    std::cout << std::endl;
+  }
+}
+
+int
+main()
+{
+  try
+  {
+    check_sharded();
+    check_histogram();
+    check_collection();
+    benchmark();
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "FAIL: " << ex.what() << std::endl;
+    failed = true;
+  }
+
+  return failed;
+}
@@ -168,6 +168,75 @@ TestTasker::do_release_queue_test() throw (eh::Exception)
     << std::endl;
 }
 
+class TimeStampTask : public Generics::TaskImpl
+{
+public:
+  TimeStampTask() throw ();
+
+  virtual void
+  execute() throw ();
+
+  Generics::Time time;
+};
+
+TimeStampTask::TimeStampTask() throw ()
+{
+}
+
+void
+TimeStampTask::execute() throw ()
+{
+  time = Generics::Time::get_time_of_day();
+}
+
+void
+TestTasker::do_exhausting_test() throw (eh::Exception)
+{
+  std::cout << "Test queue exhausting" << std::endl;
+  const std::size_t THREADS_AMOUNT = 3;
+  spawn_tasker_(THREADS_AMOUNT);
+
+  // Queue is empty almost at once, but the tasks are executed for 1 sec
+  const Generics::Time START = Generics::Time::get_time_of_day();
+  for (std::size_t i = 0; i < THREADS_AMOUNT; ++i)
+  {
+    task_runner_->enqueue_task(Generics::Task_var(new TestTask1s));
+  }
+  ReferenceCounting::QualPtr<TimeStampTask> notification(
+    new TimeStampTask);
+  task_runner_->notify_on_queue_exhausting(notification);
+
+  const Generics::Time SHORT_TIMEOUT(
+    Generics::Time::get_time_of_day() + Generics::Time(0, 300000));
+  if (task_runner_->wait_for_queue_exhausting(&SHORT_TIMEOUT))
+  {
+    std::cerr << "FAIL: exhausting before tasks execution" << std::endl;
+  }
+
+  task_runner_->wait_for_queue_exhausting();
+  const Generics::Time WAITED = Generics::Time::get_time_of_day() - START;
+  (WAITED < Generics::Time(0, 900000) ||
+    WAITED > Generics::Time(1, 300000) ?
+      std::cerr << "FAIL: " : std::cout << "Result: ")
+    << "Exhausting waiting for " << WAITED << std::endl;
+
+  if (notification->time == Generics::Time::ZERO ||
+    notification->time - START < Generics::Time(0, 900000))
+  {
+    std::cerr << "FAIL: notification time " << notification->time <<
+      std::endl;
+  }
+
+  // Nothing to wait for, the notification is executed at once
+  ReferenceCounting::QualPtr<TimeStampTask> immediate(new TimeStampTask);
+  task_runner_->notify_on_queue_exhausting(immediate);
+  if (immediate->time == Generics::Time::ZERO)
+  {
+    std::cerr << "FAIL: notification of the exhausted queue is not called"
+      << std::endl;
+  }
+}
+
 int
 main()
 {
@@ -177,6 +246,7 @@ main()
     TestTasker tasker;
     tasker.do_test();
     tasker.do_release_queue_test();
+    tasker.do_exhausting_test();
     std::cout << "SUCCESS" << std::endl;
   }
   catch (const eh::Exception& ex)
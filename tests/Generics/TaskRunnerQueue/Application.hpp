@@ -40,6 +40,9 @@ public:
   void
   do_release_queue_test() throw (eh::Exception);
 
+  void
+  do_exhausting_test() throw (eh::Exception);
+
 private:
   void
   spawn_tasker_(std::size_t threads_number, std::size_t queue_size = 0)
@@ -22,8 +22,10 @@
 // Application.cpp
 
 #include <iostream>
+#include <iomanip>
 
 #include <Generics/TaskRunner.hpp>
+#include <Generics/Time.hpp>
 
 #include <Logger/StreamLogger.hpp>
 #include <Logger/ActiveObjectCallback.hpp>
@@ -86,6 +88,295 @@ STask::execute() throw (eh::Exception)
 }
 
 
+namespace Throughput
+{
+  DECLARE_EXCEPTION(Exception, eh::DescriptiveException);
+
+  const unsigned THREADS = 32;
+  const unsigned PRODUCERS = 8;
+  const unsigned TASKS_PER_PRODUCER = 100000;
+  // Every external task enqueues CHILDREN tasks into the same runner
+  const unsigned CHILDREN = 3;
+  const unsigned TOTAL =
+    PRODUCERS * TASKS_PER_PRODUCER * (CHILDREN + 1);
+  // Limit for waiting for the enqueued tasks to be executed
+  const Generics::Time DEADLINE(60);
+
+  volatile _Atomic_word executed = 0;
+  // Tasks which will never be executed as their enqueueing failed
+  volatile _Atomic_word lost = 0;
+
+  class ChildTask : public Generics::TaskImpl
+  {
+  public:
+    virtual
+    void
+    execute() throw (eh::Exception)
+    {
+      __gnu_cxx::__atomic_add(&executed, 1);
+    }
+
+  protected:
+    virtual
+    ~ChildTask() throw ()
+    {
+    }
+  };
+
+  class ParentTask : public Generics::TaskImpl
+  {
+  public:
+    ParentTask(Generics::TaskRunner* task_runner,
+      Generics::Task* child) throw ()
+      : task_runner_(ReferenceCounting::add_ref(task_runner)),
+        child_(ReferenceCounting::add_ref(child))
+    {
+    }
+
+    virtual
+    void
+    execute() throw (eh::Exception)
+    {
+      __gnu_cxx::__atomic_add(&executed, 1);
+      for (unsigned i = 0; i < CHILDREN; i++)
+      {
+        try
+        {
+          task_runner_->enqueue_task(child_);
+        }
+        catch (...)
+        {
+          __gnu_cxx::__atomic_add(&lost, CHILDREN - i);
+          throw;
+        }
+      }
+    }
+
+  protected:
+    virtual
+    ~ParentTask() throw ()
+    {
+    }
+
+  private:
+    Generics::TaskRunner_var task_runner_;
+    Generics::Task_var child_;
+  };
+
+  class Producer : public Generics::ThreadJob
+  {
+  public:
+    Producer(Generics::TaskRunner* task_runner, Generics::Task* task)
+      throw ()
+      : task_runner_(ReferenceCounting::add_ref(task_runner)),
+        task_(ReferenceCounting::add_ref(task))
+    {
+    }
+
+    virtual
+    void
+    work() throw ()
+    {
+      unsigned i = 0;
+      try
+      {
+        for (; i < TASKS_PER_PRODUCER; i++)
+        {
+          task_runner_->enqueue_task(task_);
+        }
+      }
+      catch (const eh::Exception& ex)
+      {
+        __gnu_cxx::__atomic_add(&lost,
+          (TASKS_PER_PRODUCER - i) * (CHILDREN + 1));
+        std::cerr << "FAIL: " << ex.what() << std::endl;
+      }
+    }
+
+  protected:
+    virtual
+    ~Producer() throw ()
+    {
+    }
+
+  private:
+    Generics::TaskRunner_var task_runner_;
+    Generics::Task_var task_;
+  };
+
+  Generics::Time
+  measure(Generics::ActiveObjectCallback* callback,
+    Generics::TaskRunner::QueueMode queue_mode)
+    throw (eh::Exception)
+  {
+    executed = 0;
+    lost = 0;
+
+    Generics::TaskRunner_var task_runner(new Generics::TaskRunner(
+      callback, THREADS, 0, 0, 0, queue_mode));
+    Generics::Task_var task(new ParentTask(task_runner,
+      Generics::Task_var(new ChildTask)));
+    Generics::ThreadJob_var producer(new Producer(task_runner, task));
+
+    task_runner->activate_object();
+
+    Generics::Timer timer;
+    timer.start();
+    {
+      Generics::ThreadRunner producers(producer, PRODUCERS);
+      producers.start();
+      producers.wait_for_completion();
+    }
+    const Generics::Time STOP(Generics::Time::get_time_of_day() +
+      DEADLINE);
+    while (static_cast<unsigned>(executed + lost) != TOTAL &&
+      Generics::Time::get_time_of_day() < STOP)
+    {
+      sched_yield();
+    }
+    timer.stop();
+
+    task_runner->deactivate_object();
+    task_runner->wait_object();
+    task = Generics::Task_var();
+
+    if (static_cast<unsigned>(executed) != TOTAL)
+    {
+      Stream::Error ostr;
+      ostr << FNS << "executed " << executed << " tasks of " << TOTAL <<
+        ", " << lost << " failed to enqueue";
+      throw Exception(ostr);
+    }
+
+    return timer.elapsed_time();
+  }
+
+  /**
+   * Compares throughput of the shared queue and work stealing modes
+   */
+  void
+  compare(Generics::ActiveObjectCallback* callback) throw (eh::Exception)
+  {
+    static const struct
+    {
+      const char* name;
+      Generics::TaskRunner::QueueMode mode;
+    } MODES[] =
+    {
+      { "shared queue", Generics::TaskRunner::QM_SHARED },
+      { "work stealing", Generics::TaskRunner::QM_WORK_STEALING },
+    };
+
+    std::cout << "Throughput: " << THREADS << " threads, " <<
+      PRODUCERS << " producers, " << TOTAL << " tasks" << std::endl;
+    for (unsigned i = 0; i < sizeof(MODES) / sizeof(*MODES); i++)
+    {
+      const Generics::Time TIME = measure(callback, MODES[i].mode);
+      const double SECONDS = TIME.tv_sec + TIME.tv_usec / 1000000.0;
+      std::cout << std::setw(14) << MODES[i].name << ": " << TIME <<
+        ", " << std::fixed << std::setprecision(0) <<
+        TOTAL / SECONDS << " tasks/sec" << std::endl;
+    }
+  }
+}
+
+/**
+ * Checks that a task enqueued from a working thread of one runner
+ * into another runner is executed by the latter
+ */
+namespace CrossRunner
+{
+  // Limit for waiting for the task execution
+  const Generics::Time DEADLINE(10);
+
+  volatile _Atomic_word child_executed = 0;
+  volatile _Atomic_word parent_finished = 0;
+
+  void
+  wait(volatile _Atomic_word& flag) throw ()
+  {
+    const Generics::Time STOP(Generics::Time::get_time_of_day() +
+      DEADLINE);
+    while (!flag && Generics::Time::get_time_of_day() < STOP)
+    {
+      usleep(1000);
+    }
+  }
+
+  class ChildTask : public Generics::TaskImpl
+  {
+  public:
+    virtual
+    void
+    execute() throw (eh::Exception)
+    {
+      __gnu_cxx::__atomic_add(&child_executed, 1);
+    }
+
+  protected:
+    virtual
+    ~ChildTask() throw ()
+    {
+    }
+  };
+
+  class ParentTask : public Generics::TaskImpl
+  {
+  public:
+    explicit
+    ParentTask(Generics::TaskRunner* other) throw ()
+      : other_(ReferenceCounting::add_ref(other))
+    {
+    }
+
+    virtual
+    void
+    execute() throw (eh::Exception)
+    {
+      other_->enqueue_task(Generics::Task_var(new ChildTask));
+      // The only thread of this runner is busy here, so the child is
+      // executed only if it has been put into the other runner
+      wait(child_executed);
+      __gnu_cxx::__atomic_add(&parent_finished, 1);
+    }
+
+  protected:
+    virtual
+    ~ParentTask() throw ()
+    {
+    }
+
+  private:
+    Generics::TaskRunner_var other_;
+  };
+
+  void
+  check(Generics::ActiveObjectCallback* callback) throw (eh::Exception)
+  {
+    Generics::TaskRunner_var first(new Generics::TaskRunner(
+      callback, 1, 0, 0, 1, Generics::TaskRunner::QM_WORK_STEALING));
+    Generics::TaskRunner_var second(new Generics::TaskRunner(
+      callback, 1, 0, 0, 1, Generics::TaskRunner::QM_WORK_STEALING));
+    first->activate_object();
+    second->activate_object();
+
+    first->enqueue_task(Generics::Task_var(new ParentTask(second)));
+    wait(parent_finished);
+
+    // Reported before the deactivation, a lost task can block it
+    if (!child_executed)
+    {
+      std::cerr << "FAIL: task enqueued into other runner is not "
+        "executed by it" << std::endl;
+    }
+
+    first->deactivate_object();
+    second->deactivate_object();
+    first->wait_object();
+    second->wait_object();
+  }
+}
+
 int
 main()
 {
@@ -116,6 +407,13 @@ main()
     }
     tr->deactivate_object();
     tr->wait_object();
+
+    CrossRunner::check(callback);
+    Throughput::compare(callback);
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "FAIL: " << ex.what() << std::endl;
   }
   catch (...)
   {
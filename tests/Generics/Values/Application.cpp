@@ -0,0 +1,296 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <iostream>
+#include <iomanip>
+
+#include <Generics/Values.hpp>
+#include <Generics/ThreadRunner.hpp>
+#include <Generics/Time.hpp>
+
+
+namespace
+{
+  const unsigned THREADS = 8;
+  const unsigned UPDATES = 200000;
+  const unsigned BENCHMARK_UPDATES = 4000000;
+
+  const char HITS[] = "hits";
+  const char BYTES[] = "bytes";
+  const char LOAD[] = "load";
+
+  bool failed = false;
+
+  void
+  fail(const char* what) throw ()
+  {
+    std::cerr << "FAIL: " << what << std::endl;
+    failed = true;
+  }
+
+  /**
+   * Updates the registered records through the handles and
+   * the same records through the string keyed API
+   */
+  class Updater : public Generics::ThreadJob
+  {
+  public:
+    Updater(Generics::Values* values, unsigned count) throw (eh::Exception)
+      : values_(ReferenceCounting::add_ref(values)), count_(count),
+        hits_(values->counter<Generics::Values::UnsignedInt>(HITS)),
+        bytes_(values->counter<Generics::Values::SignedInt>(BYTES)),
+        load_(values->counter<Generics::Values::Floating>(LOAD))
+    {
+    }
+
+    virtual
+    void
+    work() throw ()
+    {
+      try
+      {
+        for (unsigned i = 0; i < count_; i++)
+        {
+          hits_.add(1);
+          bytes_.add(-2);
+          load_.add(0.5);
+          if (i % 100 == 0)
+          {
+            values_->add(HITS, Generics::Values::UnsignedInt(1));
+          }
+        }
+      }
+      catch (const eh::Exception& ex)
+      {
+        std::cerr << "FAIL: " << ex.what() << std::endl;
+        failed = true;
+      }
+    }
+
+  private:
+    Generics::Values_var values_;
+    const unsigned count_;
+    Generics::Values::Counter<Generics::Values::UnsignedInt> hits_;
+    Generics::Values::Counter<Generics::Values::SignedInt> bytes_;
+    Generics::Values::Counter<Generics::Values::Floating> load_;
+  };
+
+  /**
+   * Counts the enumerated records
+   */
+  struct Counter
+  {
+    Counter() throw ()
+      : size(0), records(0)
+    {
+    }
+
+    void
+    operator ()(size_t count) throw ()
+    {
+      size = count;
+    }
+
+    template <typename Type>
+    void
+    operator ()(const Generics::Values::Key&, const Type&) throw ()
+    {
+      ++records;
+    }
+
+    size_t size;
+    size_t records;
+  };
+
+  class StringAdder : public Generics::ThreadJob
+  {
+  public:
+    StringAdder(Generics::Values* values, unsigned count) throw ()
+      : values_(ReferenceCounting::add_ref(values)), count_(count)
+    {
+    }
+
+    virtual
+    void
+    work() throw ()
+    {
+      try
+      {
+        const Generics::Values::Key KEY(HITS);
+        for (unsigned i = 0; i < count_; i++)
+        {
+          values_->add(KEY, Generics::Values::UnsignedInt(1));
+        }
+      }
+      catch (const eh::Exception& ex)
+      {
+        std::cerr << "FAIL: " << ex.what() << std::endl;
+        failed = true;
+      }
+    }
+
+  private:
+    Generics::Values_var values_;
+    const unsigned count_;
+  };
+
+  class HandleAdder : public Generics::ThreadJob
+  {
+  public:
+    HandleAdder(Generics::Values* values, unsigned count)
+      throw (eh::Exception)
+      : hits_(values->counter<Generics::Values::UnsignedInt>(HITS)),
+        count_(count)
+    {
+    }
+
+    virtual
+    void
+    work() throw ()
+    {
+      for (unsigned i = 0; i < count_; i++)
+      {
+        hits_.add(1);
+      }
+    }
+
+  private:
+    Generics::Values::Counter<Generics::Values::UnsignedInt> hits_;
+    const unsigned count_;
+  };
+}
+
+void
+check_counters() throw (eh::Exception)
+{
+  Generics::Values_var values(new Generics::Values);
+  values->set(HITS, Generics::Values::UnsignedInt(10));
+  values->set("name", std::string("test"));
+
+  {
+    Generics::ThreadRunner runner(
+      Generics::ThreadJob_var(new Updater(values, UPDATES)), THREADS);
+    runner.start();
+    runner.wait_for_completion();
+  }
+
+  // The existing record keeps its value
+  const Generics::Values::UnsignedInt EXPECTED_HITS =
+    10 + THREADS * UPDATES + THREADS * (UPDATES / 100);
+  if (values->get<Generics::Values::UnsignedInt>(HITS) != EXPECTED_HITS)
+  {
+    fail("counters: unsigned records");
+  }
+  if (values->get<Generics::Values::SignedInt>(BYTES) !=
+    -2 * static_cast<Generics::Values::SignedInt>(THREADS * UPDATES))
+  {
+    fail("counters: signed records");
+  }
+  if (values->get<Generics::Values::Floating>(LOAD) !=
+    0.5 * THREADS * UPDATES)
+  {
+    fail("counters: floating records");
+  }
+
+  Generics::Values::Counter<Generics::Values::UnsignedInt> hits(
+    values->counter<Generics::Values::UnsignedInt>(HITS));
+  hits.set(5);
+  if (hits.get() != 5 ||
+    values->get<Generics::Values::UnsignedInt>(HITS) != 5)
+  {
+    fail("counters: set");
+  }
+
+  try
+  {
+    values->counter<Generics::Values::Floating>(HITS);
+    fail("counters: type is not checked");
+  }
+  catch (const Generics::Values::InvalidType&)
+  {
+  }
+
+  Generics::Values_var snapshot(values->snapshot());
+  hits.add(1);
+  Counter counter;
+  snapshot->enumerate_all(counter);
+  if (counter.size != 4 || counter.records != 4 ||
+    snapshot->get<Generics::Values::UnsignedInt>(HITS) != 5 ||
+    snapshot->get<std::string>("name") != "test")
+  {
+    fail("snapshot: content");
+  }
+}
+
+void
+benchmark() throw (eh::Exception)
+{
+  Generics::Values_var values(new Generics::Values);
+  values->counter<Generics::Values::UnsignedInt>(HITS);
+
+  const unsigned THREAD_COUNTS[] = { 1, 4, 16 };
+  std::cout << "add() cost, ns per call" << std::endl <<
+    std::setw(8) << "threads" << std::setw(12) << "string" <<
+    std::setw(12) << "handle" << std::endl;
+
+  for (unsigned i = 0; i < sizeof(THREAD_COUNTS) / sizeof(*THREAD_COUNTS);
+    i++)
+  {
+    const unsigned THREADS = THREAD_COUNTS[i];
+    const unsigned COUNT = BENCHMARK_UPDATES / THREADS;
+    Generics::ThreadJob_var jobs[] =
+    {
+      Generics::ThreadJob_var(new StringAdder(values, COUNT)),
+      Generics::ThreadJob_var(new HandleAdder(values, COUNT))
+    };
+
+    std::cout << std::setw(8) << THREADS;
+    for (unsigned j = 0; j < sizeof(jobs) / sizeof(*jobs); j++)
+    {
+      Generics::Timer timer;
+      timer.start();
+      Generics::ThreadRunner runner(jobs[j], THREADS);
+      runner.start();
+      runner.wait_for_completion();
+      timer.stop();
+      std::cout << std::setw(12) << std::fixed << std::setprecision(1) <<
+        timer.elapsed_time().as_double() * 1e9 / BENCHMARK_UPDATES;
+    }
+    std::cout << std::endl;
+  }
+}
+
+int
+main()
+{
+  try
+  {
+    check_counters();
+    benchmark();
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "FAIL: " << ex.what() << std::endl;
+    failed = true;
+  }
+
+  return failed;
+}
@@ -20,6 +20,9 @@
 
 
 #include <vector>
+
+#include <ReferenceCounting/List.hpp>
+
 #include "Tests.hpp"
 
 const unsigned int TEST_DURATION = 35;
@@ -27,6 +30,8 @@ const unsigned int MAKING_REQUESTS_DURATION = 30;
 const unsigned int TASK_RUNNER_THR_COUNT = 20;
 const unsigned int TASKS_PER_TEST = 1;
 const unsigned int FUNCTORS_PER_TASK = 4;
+const unsigned int SUBMISSION_TASKS = 4;
+const unsigned int SUBMISSION_FUNCTORS = 200;
 const char NOTIFICATION_MSG[] = "///////////////////////////////////////////////\n"
                                 " TO KNOW MORE ABOUT SCENARIOUS RUN WITH \"help\""
                                 "\n///////////////////////////////////////////////";
@@ -56,7 +61,8 @@ void usage()
             << NonExistanceTest::usage() << '\n'
             << BadAddressTest::usage() << '\n'
             << BadRespTest::usage() << '\n'
-            << InterruptTest::usage() << std::endl;
+            << InterruptTest::usage() << '\n'
+            << SubmissionTest::usage() << std::endl;
 }
 
 int
@@ -141,6 +147,14 @@ main(int argc, char* argv[])
       finish_semaphore.acquire();
     }
 
+    // Submission throughput is measured without the concurrent tests
+    CTTestInterface_var submission_test(
+      new SubmissionTest(finish_semaphore, pool.in(), SUBMISSION_TASKS,
+        SUBMISSION_FUNCTORS));
+    tests.push_back(submission_test);
+    tests_runner->enqueue_task(submission_test.in());
+    finish_semaphore.acquire();
+
     pool->deactivate_object();
     pool->wait_object();
     tests_runner->deactivate_object();
@@ -479,3 +479,96 @@ BadRespTest::checkup_and_print_stat() throw (eh::Exception)
 BadRespTest::~BadRespTest() throw ()
 {
 }
+
+//
+// SubmissionTest
+//
+
+const char submission_test_name[] = "SubmissionTest";
+
+const char*
+SubmissionTest::usage() throw()
+{
+  return "[SubmissionTest]\n"
+         "1. Sends the fixed number of GET and POST requests to server\n"
+         "   (echo.pl script) from several threads at once and measures\n"
+         "   the time spent in adding them into the pool.\n"
+         "2. It is expected, that all requests were successfully added\n"
+         "   and that all responses were got.\n";
+}
+
+//
+// class SubmissionTest
+//
+
+SubmissionTest::SubmissionTest(Sync::Semaphore& finish_semaphore,
+  HTTP::HttpInterface* pool, unsigned int tasks_per_test,
+  unsigned int functors_per_task)
+  throw (eh::Exception):
+    CTTestInterface(pool, 0, 0, tasks_per_test, functors_per_task)
+{
+  my_cb_ = new SimpleCounterCallback(
+    HTTP::PoolPolicy_var(new SimplePolicy).in());
+  HTTP::ResponseCallback_var proxy(new CallBackProxy(finish_semaphore,
+    my_cb_));
+  requester_.reset(new Requester(*this, pool_.in(), proxy,
+    ECHO_GET_REQUEST, ECHO_POST_REQUEST, ECHO_POST_STRING));
+}
+
+void
+SubmissionTest::execute() throw ()
+{
+  try
+  {
+    TestCommons::MTTester<Requester&> tester(*requester_, tasks_count_);
+    Generics::Timer timer;
+    timer.start();
+    // Waits for all of the functors to be completed
+    tester.run(functors_count_, 0, functors_count_);
+    timer.stop();
+    submission_time_ = timer.elapsed_time();
+    requester_->release_callback();
+  }
+  catch (const eh::Exception& e)
+  {
+    std::cerr << "[ERROR]: Exception caught: " << e.what() << std::endl;
+  }
+  catch (...)
+  {
+    std::cerr << "[ERROR]: Unknown exception caught" << std::endl;
+  }
+}
+
+std::string
+SubmissionTest::checkup_and_print_stat() throw (eh::Exception)
+{
+  if (stat_.str().empty())
+  {
+    if (!is_error(submission_test_name, &requester_->get_counter(),
+         &my_cb_->get_counter(), 0) && !my_cb_->get_counter().succeeded())
+    {
+      std::cerr << "[ERROR] " << submission_test_name << " failed. Description: "
+                << "There are no succeeded requests ( "
+                << my_cb_->get_counter().succeeded() << " succeeded and "
+                << my_cb_->get_counter().failed() << " failed )" << std::endl;
+    }
+
+    const int ADDED = requester_->get_counter().succeeded();
+    const long long MICROSECONDS = submission_time_.microseconds();
+
+    stat_ << submission_test_name << " statistics:\n";
+    requester_->print_stat(stat_);
+    stat_ << "Submission: " << ADDED << " requests in " <<
+      submission_time_ << " (" <<
+      (MICROSECONDS ? ADDED * 1000000ll / MICROSECONDS : 0) <<
+      " requests/s)\n";
+    my_cb_->print_stat(stat_);
+    my_cb_->print_errors(stat_);
+  }
+
+  return stat_.str();
+}
+
+SubmissionTest::~SubmissionTest() throw ()
+{
+}
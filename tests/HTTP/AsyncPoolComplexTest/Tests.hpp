@@ -216,4 +216,36 @@ private:
   bool log_needed_;
 };
 
+//
+// class SubmissionTest
+//
+
+class SubmissionTest : public CTTestInterface
+{
+public:
+
+  static const char* usage() throw();
+
+  SubmissionTest(Sync::Semaphore& finish_semaphore,
+                 HTTP::HttpInterface* pool, unsigned int tasks_per_test,
+                 unsigned int functors_per_task)
+    throw (eh::Exception);
+
+  virtual void
+  execute() throw ();
+
+  virtual std::string
+  checkup_and_print_stat() throw (eh::Exception);
+
+protected:
+
+  virtual
+  ~SubmissionTest() throw ();
+
+private:
+
+  SimpleCounterCallback_var my_cb_;
+  Generics::Time submission_time_;
+};
+
 #endif
@@ -362,6 +362,23 @@ public:
   {
     counter_.success();
     checker_(data.method(), data.body());
+
+    // Header views must agree with the owned copy of the headers
+    SubHeaderArray views;
+    data.response_header_views(views);
+    if (views.size() != data.response_headers().size())
+    {
+      counter_.failure(String::SubString("Header views count mismatch"));
+    }
+    for (SubHeaderArray::const_iterator itor(views.begin());
+      itor != views.end(); ++itor)
+    {
+      String::SubString value;
+      if (!data.find_header(itor->name, value))
+      {
+        counter_.failure(String::SubString("Header view is not found"));
+      }
+    }
   }
 
   virtual void
@@ -0,0 +1,261 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <iostream>
+
+#include <Generics/Time.hpp>
+#include <String/AsciiStringManip.hpp>
+#include <HTTP/FlatList.hpp>
+#include <HTTP/HTTPCookie.hpp>
+
+
+namespace
+{
+  const unsigned ITERATIONS = 200000;
+
+  // A typical request with 15 headers
+  const char REQUEST[] =
+    "GET /services/nslookup?app=PS&v=1.3.0&tid=108&rnd=388334 HTTP/1.1\r\n"
+    "Host: ad.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:31.0) "
+      "Gecko/20100101 Firefox/31.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+      "*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Charset: utf-8\r\n"
+    "Referer: http://www.example.com/news/index.html\r\n"
+    "Cookie: uid=H4e3896f-bdb5-5347-f1fd-42c7b11d65df; lc=en; s=1\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "X-Forwarded-For: 10.0.0.1, 10.0.0.2\r\n"
+    "X-Request-Id: 13F9ED00E45511D89A0800304852BBCE\r\n"
+    "If-Modified-Since: Wed, 03 Aug 2005 13:01:59 GMT\r\n"
+    "DNT: 1\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n";
+
+  const char* const LOOKUPS[] =
+  {
+    "host",
+    "cookie",
+    "content-length",
+    "x-forwarded-for",
+    "authorization"
+  };
+
+  bool failed = false;
+
+  void
+  fail(const char* what) throw ()
+  {
+    std::cerr << "FAIL: " << what << std::endl;
+    failed = true;
+  }
+
+  void
+  append(HTTP::HeaderList& headers, const String::SubString& name,
+    const String::SubString& value) throw (eh::Exception)
+  {
+    headers.emplace_back(name.str(), value.str());
+  }
+
+  void
+  append(HTTP::FlatHeaderList& headers, const String::SubString& name,
+    const String::SubString& value) throw (eh::Exception)
+  {
+    headers.emplace_back(name, value);
+  }
+
+  /**
+   * Splits the request into headers
+   */
+  template <typename List>
+  void
+  parse(const String::SubString& request, List& headers)
+    throw (eh::Exception)
+  {
+    String::SubString::SizeType start = request.find("\r\n") + 2;
+    for (;;)
+    {
+      const String::SubString::SizeType END = request.find("\r\n", start);
+      if (END == start || END == String::SubString::NPOS)
+      {
+        break;
+      }
+      const String::SubString LINE(request.substr(start, END - start));
+      const String::SubString::SizeType COLON = LINE.find(':');
+      append(headers, LINE.substr(0, COLON), LINE.substr(COLON + 2));
+      start = END + 2;
+    }
+  }
+
+  bool
+  find(const HTTP::HeaderList& headers, const char* name,
+    String::SubString& value) throw ()
+  {
+    const String::AsciiStringManip::Caseless NAME(name);
+    for (HTTP::HeaderList::const_iterator itor(headers.begin());
+      itor != headers.end(); ++itor)
+    {
+      if (NAME == itor->name)
+      {
+        value = itor->value;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool
+  find(const HTTP::FlatHeaderList& headers, const char* name,
+    String::SubString& value) throw ()
+  {
+    HTTP::FlatHeaderList::const_iterator itor(
+      headers.find(String::SubString(name)));
+    if (itor == headers.end())
+    {
+      return false;
+    }
+    value = itor->value;
+    return true;
+  }
+}
+
+void
+test_flat_list() throw (eh::Exception)
+{
+  HTTP::FlatHeaderList headers;
+  headers.emplace_back("Host", "example.com");
+  headers.push_back(HTTP::Header("Set-Cookie", "a=1"));
+  headers.emplace_back(std::string("SET-COOKIE"), std::string("b=2"));
+
+  if (headers.size() != 3 || headers.front().name != "Host" ||
+    headers.back().value != "b=2")
+  {
+    fail("append");
+  }
+
+  HTTP::FlatHeaderList::const_iterator itor(
+    headers.find(String::SubString("set-cookie")));
+  if (itor == headers.end() || itor->value != "a=1")
+  {
+    fail("find");
+  }
+  itor = headers.find(String::SubString("set-cookie"), ++itor);
+  if (itor == headers.end() || itor->value != "b=2")
+  {
+    fail("find next");
+  }
+  if (headers.find(String::SubString("Cookie")) != headers.end())
+  {
+    fail("find absent");
+  }
+  if (headers[0].name.data()[headers[0].name.size()] != '\0')
+  {
+    fail("zero termination");
+  }
+
+  // Outgrow inline storage appending the own data
+  for (unsigned i = 0; i < 100; i++)
+  {
+    headers.push_back(headers[i % 3]);
+  }
+  headers.emplace_back("Long", std::string(5000, 'x'));
+  if (headers.size() != 104 || headers[103].value.size() != 5000 ||
+    headers[102].value != headers[99].value)
+  {
+    fail("growth");
+  }
+
+  HTTP::FlatHeaderList copy(headers);
+  HTTP::FlatHeaderList moved(std::move(headers));
+  if (copy.size() != 104 || moved.size() != 104 || !headers.empty() ||
+    copy[50].name != moved[50].name ||
+    copy.find(String::SubString("LONG")) == copy.end())
+  {
+    fail("copy and move");
+  }
+
+  HTTP::HeaderList list;
+  parse(String::SubString(REQUEST), list);
+  HTTP::FlatHeaderList flat(list.begin(), list.end());
+  if (flat.size() != 15 || list.size() != 15)
+  {
+    fail("range construction");
+  }
+
+  HTTP::CookieList cookies;
+  cookies.load_from_headers(flat);
+  if (cookies.size() != 3)
+  {
+    fail("cookie list");
+  }
+}
+
+template <typename List>
+void
+benchmark(const char* name) throw (eh::Exception)
+{
+  const String::SubString REQUEST_STR(REQUEST);
+  unsigned found = 0;
+
+  Generics::CPUTimer timer;
+  timer.start();
+  for (unsigned i = 0; i < ITERATIONS; i++)
+  {
+    List headers;
+    parse(REQUEST_STR, headers);
+    for (size_t j = 0; j < sizeof(LOOKUPS) / sizeof(*LOOKUPS); j++)
+    {
+      String::SubString value;
+      found += find(headers, LOOKUPS[j], value);
+    }
+  }
+  timer.stop();
+
+  if (found != ITERATIONS * 4)
+  {
+    fail("benchmark lookups");
+  }
+
+  std::cout << name << ": " <<
+    timer.elapsed_time().microseconds() * 1000 / ITERATIONS <<
+    " ns per request" << std::endl;
+}
+
+int
+main()
+{
+  try
+  {
+    test_flat_list();
+    benchmark<HTTP::HeaderList>("HeaderList");
+    benchmark<HTTP::FlatHeaderList>("FlatHeaderList");
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "FAIL: " << ex.what() << std::endl;
+    failed = true;
+  }
+
+  return failed;
+}
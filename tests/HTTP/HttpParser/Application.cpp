@@ -0,0 +1,511 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <iostream>
+#include <string>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <Generics/Time.hpp>
+#include <Generics/ThreadRunner.hpp>
+#include <HTTP/HttpParser.hpp>
+#include <HTTP/HttpAsync.hpp>
+
+
+namespace
+{
+  const unsigned BENCHMARK_REQUESTS = 2000;
+  const unsigned CLOSED_REQUESTS = 20;
+
+  bool failed = false;
+
+  void
+  fail(const char* what) throw ()
+  {
+    std::cerr << "FAIL: " << what << std::endl;
+    failed = true;
+  }
+
+  /**
+   * Feeds the response in portions of the size
+   * @return body collected
+   */
+  std::string
+  feed(HTTP::ResponseParser& parser, const String::SubString& response,
+    size_t portion) throw (eh::Exception)
+  {
+    std::string body;
+    parser.reset();
+    for (size_t pos = 0; pos < response.size() && !parser.complete();
+      pos += portion)
+    {
+      String::SubString data(response.substr(pos, portion));
+      while (!data.empty() && !parser.complete())
+      {
+        String::SubString part;
+        data.erase_front(parser.parse(data, part));
+        part.append_to(body);
+      }
+    }
+    return body;
+  }
+
+  /**
+   * Checks parsing of the response split into portions of all sizes
+   */
+  void
+  check(const char* name, const char* response, unsigned status,
+    const char* body, bool keep_alive, bool finish = false)
+    throw (eh::Exception)
+  {
+    const String::SubString RESPONSE(response);
+    HTTP::ResponseParser parser;
+
+    for (size_t portion = 1; portion <= RESPONSE.size(); portion++)
+    {
+      const std::string BODY(feed(parser, RESPONSE, portion));
+      if (finish && !parser.finish())
+      {
+        std::cerr << name << ": portion " << portion << std::endl;
+        fail("response is not complete on close");
+        return;
+      }
+      if (!parser.complete() || parser.status_code() != status ||
+        BODY != body || parser.keep_alive() != keep_alive)
+      {
+        std::cerr << name << ": portion " << portion << ", status " <<
+          parser.status_code() << ", body '" << BODY << "'" << std::endl;
+        fail("parsing");
+        return;
+      }
+    }
+  }
+
+  void
+  check_invalid(const char* name, const char* response) throw ()
+  {
+    HTTP::ResponseParser parser;
+    try
+    {
+      feed(parser, String::SubString(response), 1024);
+      std::cerr << name << std::endl;
+      fail("invalid response is accepted");
+    }
+    catch (const HTTP::ResponseParser::Exception&)
+    {
+    }
+  }
+}
+
+void
+test_parser() throw (eh::Exception)
+{
+  check("content length",
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Length: 5\r\n"
+    "\r\n"
+    "hello",
+    200, "hello", true);
+
+  check("chunked",
+    "HTTP/1.1 200 OK\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "2;ext=1\r\nhe\r\n"
+    "A\r\nllo, world\r\n"
+    "0\r\n"
+    "X-Trailer: 1\r\n"
+    "\r\n",
+    200, "hello, world", true);
+
+  check("continue",
+    "HTTP/1.1 100 Continue\r\n"
+    "\r\n"
+    "HTTP/1.1 201 Created\r\n"
+    "Connection: close\r\n"
+    "Content-Length: 2\r\n"
+    "\r\n"
+    "ok",
+    201, "ok", false);
+
+  check("HTTP/1.0 keep-alive",
+    "HTTP/1.0 200 OK\r\n"
+    "Connection: Keep-Alive\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n",
+    200, "", true);
+
+  check("no content",
+    "HTTP/1.1 204 No Content\n"
+    "Server: test\n"
+    "\n",
+    204, "", true);
+
+  check("till close",
+    "HTTP/1.0 200 OK\r\n"
+    "\r\n"
+    "close delimited",
+    200, "close delimited", false, true);
+
+  check_invalid("status line", "HTTP/2 200 OK\r\n\r\n");
+  check_invalid("header", "HTTP/1.1 200 OK\r\nno colon\r\n\r\n");
+  check_invalid("chunk size",
+    "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nxyz\r\n");
+  check_invalid("content length",
+    "HTTP/1.1 200 OK\r\nContent-Length: -1\r\n\r\n");
+
+  HTTP::ResponseParser parser;
+  feed(parser, String::SubString(
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/plain\r\n"
+    "Set-Cookie: a=1\r\n"
+    "Set-Cookie:b=2  \r\n"
+    "Content-Length: 0\r\n"
+    "\r\n"), 7);
+  const HTTP::FlatHeaderList& headers = parser.headers();
+  HTTP::FlatHeaderList::const_iterator itor(
+    headers.find(String::SubString("set-cookie"), ++headers.begin()));
+  if (headers.size() != 4 || parser.reason() != "OK" ||
+    itor == headers.end() || (++itor)->value != "b=2")
+  {
+    fail("headers");
+  }
+}
+
+void
+test_serializer() throw (eh::Exception)
+{
+  HTTP::HeaderList headers;
+  headers.push_back(HTTP::Header("Accept", "*/*"));
+
+  std::string request;
+  HTTP::serialize_request(request, String::SubString("GET"),
+    String::SubString("/path?a=1"), String::SubString("host:8080"),
+    headers, 0, true);
+  if (request !=
+    "GET /path?a=1 HTTP/1.1\r\n"
+    "Accept: */*\r\n"
+    "Host: host:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n")
+  {
+    fail("serialize");
+  }
+
+  HTTP::FlatHeaderList flat_headers;
+  flat_headers.emplace_back("host", "other");
+  flat_headers.emplace_back("Connection", "close");
+  request.clear();
+  HTTP::serialize_request(request, String::SubString("POST"),
+    String::SubString("/"), String::SubString("host"),
+    flat_headers, 12, true);
+  if (request !=
+    "POST / HTTP/1.1\r\n"
+    "host: other\r\n"
+    "Connection: close\r\n"
+    "Content-Length: 12\r\n"
+    "\r\n")
+  {
+    fail("serialize with own headers");
+  }
+}
+
+/**
+ * Loopback server answering every request by "hello",
+ * alternately with Content-Length and chunked encoding
+ */
+class Server : public Generics::ThreadJob
+{
+public:
+  /**
+   * @param close_always close the connection after every response
+   * without announcing it in the response
+   */
+  explicit
+  Server(bool close_always = false) throw ()
+    : socket_(socket(AF_INET, SOCK_STREAM, 0)), port_(0), connections_(0),
+      close_always_(close_always)
+  {
+    sockaddr_in addr = sockaddr_in();
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(socket_, reinterpret_cast<sockaddr*>(&addr), len) ||
+      listen(socket_, 16) ||
+      getsockname(socket_, reinterpret_cast<sockaddr*>(&addr), &len))
+    {
+      fail("server start");
+    }
+    port_ = ntohs(addr.sin_port);
+  }
+
+  unsigned short
+  port() const throw ()
+  {
+    return port_;
+  }
+
+  unsigned
+  connections() const throw ()
+  {
+    return connections_;
+  }
+
+  void
+  stop() throw ()
+  {
+    shutdown(socket_, SHUT_RDWR);
+  }
+
+  virtual
+  void
+  work() throw ()
+  {
+    int connection;
+    while ((connection = accept(socket_, 0, 0)) >= 0)
+    {
+      ++connections_;
+      serve_(connection);
+      close(connection);
+    }
+  }
+
+protected:
+  virtual
+  ~Server() throw ()
+  {
+    close(socket_);
+  }
+
+private:
+  void
+  serve_(int connection) throw ()
+  {
+    static const char CONTENT_LENGTH[] =
+      "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+    static const char CHUNKED[] =
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "2\r\nhe\r\n3\r\nllo\r\n0\r\n\r\n";
+
+    std::string request;
+    char buf[4096];
+    unsigned requests = 0;
+    for (;;)
+    {
+      const std::string::size_type END = request.find("\r\n\r\n");
+      if (END == std::string::npos)
+      {
+        ssize_t size = recv(connection, buf, sizeof(buf), 0);
+        if (size <= 0)
+        {
+          return;
+        }
+        request.append(buf, size);
+        continue;
+      }
+
+      // Requests have no bodies here
+      const bool CLOSE =
+        request.find("Connection: close") < END;
+      request.erase(0, END + 4);
+
+      const char* response = requests++ % 2 ? CHUNKED : CONTENT_LENGTH;
+      const size_t SIZE = requests % 2 ?
+        sizeof(CONTENT_LENGTH) - 1 : sizeof(CHUNKED) - 1;
+      if (send(connection, response, SIZE, MSG_NOSIGNAL) !=
+        static_cast<ssize_t>(SIZE) || CLOSE || close_always_)
+      {
+        return;
+      }
+    }
+  }
+
+  int socket_;
+  unsigned short port_;
+  unsigned connections_;
+  const bool close_always_;
+};
+typedef ReferenceCounting::QualPtr<Server> Server_var;
+
+class Callback :
+  public HTTP::ResponseCallback,
+  public ReferenceCounting::AtomicImpl
+{
+public:
+  Callback() throw ()
+    : successes_(0)
+  {
+  }
+
+  unsigned
+  successes() const throw ()
+  {
+    return successes_;
+  }
+
+  virtual
+  void
+  on_response(const HTTP::ResponseInformation& data) throw ()
+  {
+    if (data.response_code() == 200 &&
+      data.body() == String::SubString("hello"))
+    {
+      ++successes_;
+    }
+    else
+    {
+      fail("unexpected response");
+    }
+  }
+
+  virtual
+  void
+  on_error(const String::SubString& description,
+    const HTTP::RequestInformation& /*data*/) throw ()
+  {
+    std::cerr << "FAIL: " << description << std::endl;
+    failed = true;
+  }
+
+protected:
+  virtual
+  ~Callback() throw ()
+  {
+  }
+
+private:
+  unsigned successes_;
+};
+typedef ReferenceCounting::QualPtr<Callback> Callback_var;
+
+/**
+ * Measures requests per second of the sync client
+ * @param keep_alive reuse the connection or reconnect for every request
+ */
+void
+benchmark(bool keep_alive) throw (eh::Exception)
+{
+  Server_var server(new Server);
+  Generics::ThreadRunner runner(server, 1);
+  runner.start();
+
+  HTTP::HttpInterface_var http(HTTP::CreateSyncHttp());
+  Callback_var callback(new Callback);
+
+  std::string url("http://127.0.0.1:");
+  url += String::StringManip::IntToStr(server->port()).str().str();
+  url += "/bench";
+
+  HTTP::HeaderList headers;
+  if (!keep_alive)
+  {
+    headers.push_back(HTTP::Header("Connection", "close"));
+  }
+
+  Generics::Timer timer;
+  timer.start();
+  for (unsigned i = 0; i < BENCHMARK_REQUESTS; i++)
+  {
+    http->add_get_request(url.c_str(), callback, HTTP::HttpServer(),
+      headers);
+  }
+  timer.stop();
+
+  http.reset();
+  server->stop();
+  runner.wait_for_completion();
+
+  if (callback->successes() != BENCHMARK_REQUESTS ||
+    server->connections() != (keep_alive ? 1 : BENCHMARK_REQUESTS))
+  {
+    std::cerr << "successes " << callback->successes() <<
+      ", connections " << server->connections() << std::endl;
+    fail("benchmark");
+  }
+
+  std::cout << (keep_alive ? "keep-alive" : "connection per request") <<
+    ": " << BENCHMARK_REQUESTS / timer.elapsed_time().as_double() <<
+    " requests/s, " << server->connections() << " connections" <<
+    std::endl;
+}
+
+/**
+ * Sends POST requests to the server closing every connection after
+ * the response. The kept connection closed by the peer must be
+ * detected before the request is sent, not after it has failed.
+ */
+void
+check_closed_kept_connection() throw (eh::Exception)
+{
+  Server_var server(new Server(true));
+  Generics::ThreadRunner runner(server, 1);
+  runner.start();
+
+  HTTP::HttpInterface_var http(HTTP::CreateSyncHttp());
+  Callback_var callback(new Callback);
+
+  std::string url("http://127.0.0.1:");
+  url += String::StringManip::IntToStr(server->port()).str().str();
+  url += "/post";
+
+  for (unsigned i = 0; i < CLOSED_REQUESTS; i++)
+  {
+    http->add_post_request(url.c_str(), callback);
+    // Let the closure reach the client
+    usleep(10000);
+  }
+
+  http.reset();
+  server->stop();
+  runner.wait_for_completion();
+
+  if (callback->successes() != CLOSED_REQUESTS ||
+    server->connections() != CLOSED_REQUESTS)
+  {
+    std::cerr << "successes " << callback->successes() <<
+      ", connections " << server->connections() << std::endl;
+    fail("closed kept connection");
+  }
+}
+
+int
+main()
+{
+  try
+  {
+    test_parser();
+    test_serializer();
+    benchmark(false);
+    benchmark(true);
+    check_closed_kept_connection();
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "FAIL: " << ex.what() << std::endl;
+    failed = true;
+  }
+
+  return failed;
+}
@@ -0,0 +1,428 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <Sync/PosixLock.hpp>
+#include <Sync/Semaphore.hpp>
+
+#include <String/StringManip.hpp>
+
+#include <HTTP/HttpAsyncPool.hpp>
+#include <HTTP/HttpAsyncPolicies.hpp>
+
+using namespace HTTP;
+
+
+namespace
+{
+  const unsigned CONNECTIONS = 4;
+  const unsigned REQUESTS = 400;
+  const unsigned BURST = 8;
+  const unsigned SLOW_PERIOD = 80;
+  const useconds_t BURST_INTERVAL = 20000;
+  const useconds_t FAST_DELAY = 1000;
+  const useconds_t SLOW_DELAY = 200000;
+
+  bool failed = false;
+
+  void
+  fail(const char* what) throw ()
+  {
+    std::cerr << "FAIL: " << what << std::endl;
+    failed = true;
+  }
+}
+
+/**
+ * Local HTTP/1.1 server answering every request for "/slow" after
+ * SLOW_DELAY and all the others after FAST_DELAY. Each connection is
+ * served by its own thread, one request at a time.
+ */
+class SlowServer
+{
+public:
+  DECLARE_EXCEPTION(Exception, eh::DescriptiveException);
+
+  SlowServer() throw (eh::Exception, Exception)
+    : socket_(::socket(AF_INET, SOCK_STREAM, 0))
+  {
+    sockaddr_in address = sockaddr_in();
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (socket_ < 0 ||
+      bind(socket_, reinterpret_cast<sockaddr*>(&address), length) ||
+      getsockname(socket_, reinterpret_cast<sockaddr*>(&address),
+        &length) ||
+      listen(socket_, 64))
+    {
+      throw Exception("Can't start the local server");
+    }
+    port_ = ntohs(address.sin_port);
+
+    pthread_t thread;
+    if (pthread_create(&thread, 0, accept_proc_, this))
+    {
+      throw Exception("Can't start the accepting thread");
+    }
+    pthread_detach(thread);
+  }
+
+  unsigned
+  port() const throw ()
+  {
+    return port_;
+  }
+
+private:
+  static
+  void*
+  accept_proc_(void* arg) throw ()
+  {
+    SlowServer* server = static_cast<SlowServer*>(arg);
+    for (;;)
+    {
+      int connection = accept(server->socket_, 0, 0);
+      if (connection < 0)
+      {
+        return 0;
+      }
+
+      pthread_t thread;
+      if (pthread_create(&thread, 0, connection_proc_,
+        reinterpret_cast<void*>(static_cast<intptr_t>(connection))))
+      {
+        close(connection);
+        continue;
+      }
+      pthread_detach(thread);
+    }
+  }
+
+  static
+  void*
+  connection_proc_(void* arg) throw ()
+  {
+    static const char RESPONSE[] =
+      "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+
+    const int connection =
+      static_cast<int>(reinterpret_cast<intptr_t>(arg));
+    std::string input;
+    char buffer[4096];
+    for (;;)
+    {
+      std::string::size_type end = input.find("\r\n\r\n");
+      if (end == std::string::npos)
+      {
+        ssize_t size = recv(connection, buffer, sizeof(buffer), 0);
+        if (size <= 0)
+        {
+          break;
+        }
+        input.append(buffer, size);
+        continue;
+      }
+
+      const std::string::size_type line_end = input.find("\r\n");
+      const bool slow = input.substr(0, line_end).find("/slow ") !=
+        std::string::npos;
+      input.erase(0, end + 4);
+
+      usleep(slow ? SLOW_DELAY : FAST_DELAY);
+      if (send(connection, RESPONSE, sizeof(RESPONSE) - 1,
+        MSG_NOSIGNAL) < 0)
+      {
+        break;
+      }
+    }
+    close(connection);
+    return 0;
+  }
+
+  int socket_;
+  unsigned port_;
+};
+
+template <typename Decider, typename Timeout>
+class TestPolicy :
+  public virtual PoolPolicy,
+  public Decider,
+  public PoolPolicySimpleEmptyConnection,
+  public PoolPolicySimpleEmptyThread,
+  public PoolPolicySimpleRequests,
+  public Timeout,
+  public virtual Generics::ActiveObjectCallback
+{
+public:
+  template <typename... Args>
+  TestPolicy(Args... timeout_args) throw (eh::Exception)
+    : Decider(CONNECTIONS, CONNECTIONS), Timeout(timeout_args...)
+  {
+  }
+
+  virtual void
+  report_error(Severity /*severity*/, const String::SubString& description,
+    const char* /*error_code*/) throw ()
+  {
+    std::cerr << "Policy error: " << description << std::endl;
+  }
+
+protected:
+  virtual
+  ~TestPolicy() throw ()
+  {
+  }
+};
+
+typedef TestPolicy<PoolPolicySimpleDecider, PoolPolicySimpleTimeout>
+  SimplePolicy;
+typedef TestPolicy<PoolPolicyLeastRequestsDecider, PoolPolicySimpleTimeout>
+  LeastRequestsPolicy;
+typedef TestPolicy<PoolPolicyLeastRequestsDecider, PoolPolicyTailTimeout>
+  TailTimeoutPolicy;
+
+/**
+ * Collects the times between sending requests and getting
+ * their responses or errors
+ */
+class Results
+{
+public:
+  typedef std::vector<Generics::Time> Durations;
+
+  Results() throw (eh::Exception)
+    : semaphore_(0), fast_errors_(0), slow_errors_(0)
+  {
+  }
+
+  void
+  add(bool slow, bool error, const Generics::Time& duration) throw ()
+  {
+    {
+      Sync::PosixGuard guard(mutex_);
+      (slow ? slow_ : fast_).push_back(duration);
+      if (error)
+      {
+        ++(slow ? slow_errors_ : fast_errors_);
+      }
+    }
+    semaphore_.release();
+  }
+
+  void
+  wait(unsigned requests) throw ()
+  {
+    for (unsigned i = 0; i < requests; i++)
+    {
+      semaphore_.acquire();
+    }
+  }
+
+  static
+  Generics::Time
+  percentile(Durations durations, unsigned percent) throw (eh::Exception)
+  {
+    if (durations.empty())
+    {
+      return Generics::Time::ZERO;
+    }
+    Durations::iterator nth(durations.begin() +
+      std::min<size_t>(durations.size() * percent / 100,
+        durations.size() - 1));
+    std::nth_element(durations.begin(), nth, durations.end());
+    return *nth;
+  }
+
+  const Durations&
+  fast() const throw ()
+  {
+    return fast_;
+  }
+
+  const Durations&
+  slow() const throw ()
+  {
+    return slow_;
+  }
+
+  unsigned
+  fast_errors() const throw ()
+  {
+    return fast_errors_;
+  }
+
+  unsigned
+  slow_errors() const throw ()
+  {
+    return slow_errors_;
+  }
+
+private:
+  Sync::PosixMutex mutex_;
+  Sync::Semaphore semaphore_;
+  Durations fast_;
+  Durations slow_;
+  unsigned fast_errors_;
+  unsigned slow_errors_;
+};
+
+class Callback :
+  public ResponseCallback,
+  public ReferenceCounting::AtomicImpl
+{
+public:
+  Callback(Results& results, bool slow) throw ()
+    : results_(results), slow_(slow),
+      started_(Generics::Time::get_time_of_day())
+  {
+  }
+
+  virtual void
+  on_response(const ResponseInformation& /*data*/) throw ()
+  {
+    results_.add(slow_, false,
+      Generics::Time::get_time_of_day() - started_);
+  }
+
+  virtual void
+  on_error(const String::SubString& /*description*/,
+    const RequestInformation& /*data*/) throw ()
+  {
+    results_.add(slow_, true,
+      Generics::Time::get_time_of_day() - started_);
+  }
+
+protected:
+  virtual
+  ~Callback() throw ()
+  {
+  }
+
+private:
+  Results& results_;
+  const bool slow_;
+  const Generics::Time started_;
+};
+
+/**
+ * Sends REQUESTS requests in bursts of BURST ones, every SLOW_PERIOD-th
+ * of them is slow, and reports the latencies
+ */
+void
+run(const char* name, PoolPolicy* policy, unsigned port,
+  Generics::Time& fast_p99, Generics::Time& slow_p99)
+  throw (eh::Exception)
+{
+  PoolPolicy_var policy_var(policy);
+
+  Generics::TaskRunner_var task_runner(
+    new Generics::TaskRunner(policy, 2));
+  task_runner->activate_object();
+
+  HttpActiveInterface_var pool(CreatePool(policy, task_runner));
+  pool->activate_object();
+
+  const std::string url = "http://127.0.0.1:" +
+    String::StringManip::IntToStr(port).str().str();
+  const std::string fast_url = url + "/fast";
+  const std::string slow_url = url + "/slow";
+
+  Results results;
+  for (unsigned i = 1; i <= REQUESTS; i++)
+  {
+    const bool slow = i % SLOW_PERIOD == 0;
+    ResponseCallback_var callback(new Callback(results, slow));
+    pool->add_get_request((slow ? slow_url : fast_url).c_str(), callback);
+    if (i % BURST == 0)
+    {
+      usleep(BURST_INTERVAL);
+    }
+  }
+  results.wait(REQUESTS);
+
+  pool->deactivate_object();
+  pool->wait_object();
+
+  task_runner->deactivate_object();
+  task_runner->wait_object();
+
+  fast_p99 = Results::percentile(results.fast(), 99);
+  slow_p99 = Results::percentile(results.slow(), 99);
+
+  std::cout << name << ": fast p50 " <<
+    Results::percentile(results.fast(), 50) << ", fast p99 " <<
+    fast_p99 << ", slow p99 " << slow_p99 << ", errors " <<
+    results.fast_errors() << '/' << results.slow_errors() << std::endl;
+
+  if (results.fast_errors())
+  {
+    fail("fast requests failed");
+  }
+}
+
+int
+main()
+{
+  try
+  {
+    SlowServer server;
+
+    Generics::Time simple_fast, simple_slow;
+    run("Simple", new SimplePolicy(0), server.port(),
+      simple_fast, simple_slow);
+
+    Generics::Time least_fast, least_slow;
+    run("LeastRequests", new LeastRequestsPolicy(0), server.port(),
+      least_fast, least_slow);
+
+    Generics::Time tail_fast, tail_slow;
+    run("TailTimeout",
+      new TailTimeoutPolicy(Generics::Time(2), Generics::Time(0, 20000),
+        90, 4),
+      server.port(), tail_fast, tail_slow);
+
+    if (!(least_fast < simple_fast))
+    {
+      fail("least requests decider doesn't lower the tail latency");
+    }
+
+    if (!(tail_slow < Generics::Time(0, SLOW_DELAY)))
+    {
+      fail("slow requests aren't timed out");
+    }
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "FAIL: " << ex.what() << std::endl;
+    failed = true;
+  }
+
+  return failed;
+}
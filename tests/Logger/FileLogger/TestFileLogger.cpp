@@ -48,6 +48,8 @@ struct Config
   int size_span;
   bool check_test;
   size_t preallocated;
+  size_t async_buffer;
+  bool drop;
 
   Config() throw ()
     : count(2000000000),
@@ -59,7 +61,9 @@ struct Config
         time_span(7),
       size_span(10000000),
       check_test(false),
-      preallocated(0)
+      preallocated(0),
+      async_buffer(0),
+      drop(false)
   {
   }
 };
@@ -106,6 +110,27 @@ struct Stat
 
 Stat test_stat;
 
+/**
+ * File logger with the handler accessible for the statistics
+ */
+class HandlerLogger :
+  public Simple::Logger,
+  public ReferenceCounting::AtomicImpl
+{
+public:
+  HandlerLogger(Handler* handler, Simple::Config&& config)
+    throw (eh::Exception)
+    : Simple::Logger(handler, std::move(config))
+  {
+  }
+
+protected:
+  virtual
+  ~HandlerLogger() throw ()
+  {
+  }
+};
+
 struct Print
 {
 void
@@ -129,6 +154,8 @@ usage()
     "  -T sec       Time for span policy. Default " << config.time_span << "." << std::endl <<
     "  -S bytes     Size for span policy. Default " << config.size_span << "." << std::endl <<
     "  -p bytes     Preallocated buffer size. Default " << config.preallocated << "." << std::endl <<
+    "  -a bytes     Asynchronous writing buffer size. Default " << config.async_buffer << "." << std::endl <<
+    "  -d           Drop records on asynchronous buffer overflow." << std::endl <<
     "  -t           Perform check test." << std::endl <<
     "  -h           Show this help." << std::endl;
 }
@@ -160,7 +187,7 @@ main(int argc, char* argv[])
 
   while (1)
   {
-    int opt = ::getopt(argc, argv, "c:m:f:s:hT:S:tp:");
+    int opt = ::getopt(argc, argv, "c:m:f:s:hT:S:tp:a:d");
     if (opt == -1)
     {
       break;
@@ -252,6 +279,22 @@ main(int argc, char* argv[])
         }
         break;
 
+      case 'a':
+        if (optarg)
+        {
+          config.async_buffer = atoi(optarg);
+        }
+        else
+        {
+          std::cerr << "Argument undefined for -a option" << std::endl;
+          return 1;
+        }
+        break;
+
+      case 'd':
+        config.drop = true;
+        break;
+
       case 't':
         config.check_test = true;
         break;
@@ -294,6 +337,7 @@ main(int argc, char* argv[])
     }
 
     QLogger_var logger;
+    ReferenceCounting::QualPtr<File::Helper::Handler> file_handler;
 
     if (strcmp(config.file.c_str(), "cerr") == 0)
     {
@@ -304,7 +348,19 @@ main(int argc, char* argv[])
     {
       File::Config file_config(config.file.c_str(), plist, Logger::DEBUG);
       file_config.preallocated_size = config.preallocated;
-      logger = new File::Logger(std::move(file_config));
+      if (config.async_buffer)
+      {
+        file_config.async_buffer_size = config.async_buffer;
+        file_config.overflow_policy = config.drop ?
+          File::Helper::OP_DROP : File::Helper::OP_BLOCK;
+        file_handler = new File::Helper::Handler(std::move(file_config));
+        logger = new HandlerLogger(file_handler,
+          Simple::Config(Logger::DEBUG));
+      }
+      else
+      {
+        logger = new File::Logger(std::move(file_config));
+      }
     }
 
     int i = 0;
@@ -353,7 +409,29 @@ main(int argc, char* argv[])
 
     print_stat();
 
+    if (file_handler)
+    {
+      file_handler->flush();
+      const File::Helper::AsyncStats STATS = file_handler->async_stats();
+      std::cout << "Asynchronous writing:" << std::endl <<
+        "  written : " << STATS.written << std::endl <<
+        "  dropped : " << STATS.dropped << std::endl <<
+        "  blocked : " << STATS.blocked << std::endl <<
+        "  failed  : " << STATS.failed << std::endl << std::endl;
+
+      if (config.check_test &&
+        (STATS.written + STATS.dropped != static_cast<unsigned>(i) ||
+          (!config.drop && STATS.dropped) ||
+          STATS.blocked > static_cast<unsigned>(i) || STATS.failed))
+      {
+        std::cerr << "Error: inconsistent asynchronous writing statistics"
+          << std::endl;
+        return 1;
+      }
+    }
+
     logger.reset();
+    file_handler.reset();
 
     if (config.count && config.check_test)
     {
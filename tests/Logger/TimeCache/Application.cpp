@@ -0,0 +1,220 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <iostream>
+
+#include <Logger/TimeCache.hpp>
+
+
+namespace
+{
+  // POSIX time zones, no zoneinfo files are required
+  const char* const ZONES[] =
+  {
+    "UTC0",
+    "MSK-3",
+    "IST-5:30",
+    "EST5EDT,M3.2.0,M11.1.0",
+  };
+
+  // Fri Dec 30 2011, the ranges cross the year end
+  const time_t YEAR_END = 1325203200;
+  // Sat Mar 10 2012, the ranges cross the EST5EDT daylight saving start
+  const time_t DST_START = 1331337600;
+
+  const time_t RANGE = 3 * 24 * 60 * 60;
+  // Multiple of the zone offsets, so every step is a rollover of
+  // at least a minute in each zone and some of them are day rollovers
+  const time_t STEP = 30 * 60;
+
+  // Offsets around each step: the end of the previous second and
+  // a few microseconds of the next two ones
+  const long OFFSETS[][2] =
+  {
+    { -1, 0 },
+    { -1, 999999 },
+    { 0, 0 },
+    { 0, 1 },
+    { 0, 500000 },
+    { 0, 999999 },
+    { 1, 7 },
+  };
+
+  const unsigned BENCHMARK_RECORDS = 10000000;
+  // Typical interval between the records of a busy log
+  const long BENCHMARK_STEP_USEC = 10;
+
+  bool failed = false;
+
+  /**
+   * Formatting used by Simple::Formatter before TimeCache
+   */
+  size_t
+  reference_format(char* buf, size_t size, const Generics::Time& time,
+    Generics::Time::TimeZone time_zone)
+    throw (eh::Exception)
+  {
+    const Generics::ExtendedTime TIME(time.get_time(time_zone));
+    size_t length = strftime(buf, size, "%a %d %b %Y", &TIME);
+    length += snprintf(buf + length, size - length, " %02d:%02d:%02d:%06d",
+      TIME.tm_hour, TIME.tm_min, TIME.tm_sec, TIME.tm_usec);
+    return length;
+  }
+
+  bool
+  same_time(const Generics::ExtendedTime& left,
+    const Generics::ExtendedTime& right) throw ()
+  {
+    return left.tm_year == right.tm_year && left.tm_mon == right.tm_mon &&
+      left.tm_mday == right.tm_mday && left.tm_wday == right.tm_wday &&
+      left.tm_yday == right.tm_yday && left.tm_hour == right.tm_hour &&
+      left.tm_min == right.tm_min && left.tm_sec == right.tm_sec &&
+      left.tm_usec == right.tm_usec && left.tm_isdst == right.tm_isdst &&
+      left.timezone == right.timezone;
+  }
+
+  void
+  check(const Generics::Time& time, Generics::Time::TimeZone time_zone,
+    const char* zone) throw (eh::Exception)
+  {
+    char expected[64];
+    const size_t LENGTH =
+      reference_format(expected, sizeof(expected), time, time_zone);
+    const String::SubString RESULT(Logging::TimeCache::format(time,
+      time_zone));
+    if (RESULT != String::SubString(expected, LENGTH))
+    {
+      std::cerr << "FAIL: " << zone << ' ' <<
+        (time_zone == Generics::Time::TZ_GMT ? "GMT" : "local") << ' ' <<
+        time.tv_sec << '.' << time.tv_usec << ": '" << RESULT <<
+        "' instead of '" << expected << "'" << std::endl;
+      failed = true;
+    }
+
+    if (!same_time(Logging::TimeCache::get_time(time, time_zone),
+      time.get_time(time_zone)))
+    {
+      std::cerr << "FAIL: " << zone << ' ' << time.tv_sec << '.' <<
+        time.tv_usec << ": broken down time differs" << std::endl;
+      failed = true;
+    }
+  }
+
+  void
+  check_range(time_t start, const char* zone) throw (eh::Exception)
+  {
+    for (time_t sec = start; sec < start + RANGE; sec += STEP)
+    {
+      for (size_t i = 0; i < sizeof(OFFSETS) / sizeof(*OFFSETS); i++)
+      {
+        const Generics::Time TIME(sec + OFFSETS[i][0], OFFSETS[i][1]);
+        check(TIME, Generics::Time::TZ_LOCAL, zone);
+        check(TIME, Generics::Time::TZ_GMT, zone);
+        // Repeated calls in the same second use the cached second
+        check(TIME, Generics::Time::TZ_GMT, zone);
+        check(TIME, Generics::Time::TZ_LOCAL, zone);
+      }
+    }
+  }
+
+  void
+  test_format() throw (eh::Exception)
+  {
+    for (size_t i = 0; i < sizeof(ZONES) / sizeof(*ZONES); i++)
+    {
+      // Local time conversion picks up the zone after tzset().
+      // Each range ends with a GMT call, so no cached local time of
+      // the previous zone is reused.
+      setenv("TZ", ZONES[i], 1);
+      tzset();
+      check_range(YEAR_END, ZONES[i]);
+      check_range(DST_START, ZONES[i]);
+    }
+  }
+
+  /**
+   * Compares formatting of the log records of a busy log
+   */
+  void
+  benchmark() throw (eh::Exception)
+  {
+    const Generics::Time START(DST_START);
+    const Generics::Time STEP_TIME(0, BENCHMARK_STEP_USEC);
+    char buf[64];
+    size_t sum = 0;
+
+    Generics::Timer reference_timer;
+    reference_timer.start();
+    Generics::Time time(START);
+    for (unsigned i = 0; i < BENCHMARK_RECORDS; i++, time += STEP_TIME)
+    {
+      sum += reference_format(buf, sizeof(buf), time,
+        Generics::Time::TZ_LOCAL);
+    }
+    reference_timer.stop();
+
+    Generics::Timer cache_timer;
+    cache_timer.start();
+    time = START;
+    for (unsigned i = 0; i < BENCHMARK_RECORDS; i++, time += STEP_TIME)
+    {
+      sum -= Logging::TimeCache::format(time,
+        Generics::Time::TZ_LOCAL).size();
+    }
+    cache_timer.stop();
+
+    if (sum)
+    {
+      std::cerr << "FAIL: benchmark lengths differ" << std::endl;
+      failed = true;
+    }
+
+    const Generics::Time REFERENCE(reference_timer.elapsed_time());
+    const Generics::Time CACHE(cache_timer.elapsed_time());
+    std::cout << BENCHMARK_RECORDS << " records, " <<
+      BENCHMARK_STEP_USEC << " usec apart: strftime " << REFERENCE <<
+      ", TimeCache " << CACHE << ", " <<
+      REFERENCE.as_double() / CACHE.as_double() << " times faster" <<
+      std::endl;
+  }
+}
+
+int
+main()
+{
+  try
+  {
+    test_format();
+    benchmark();
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "FAIL: " << ex.what() << std::endl;
+    failed = true;
+  }
+
+  return failed;
+}
@@ -24,8 +24,131 @@
 #include <string.h>
 #include <iostream>
 
+#include <Generics/Rand.hpp>
+#include <Generics/Time.hpp>
+
 #include <PlainStorage/BlockFileAdapter.hpp>
 
+namespace
+{
+  const unsigned long BLOCK_SIZE = 4096;
+  const unsigned long BENCH_BLOCKS = 16 * 1024;
+  const unsigned long BENCH_READS = 200000;
+  const unsigned long SEGMENT_SIZE = 16 * 1024 * 1024;
+}
+
+/**
+ * Blocks written through the segment mapping mode must be visible
+ * through the per block mapping and vice versa
+ */
+bool
+check_segment_mode() throw (eh::Exception)
+{
+  const unsigned long SECOND_SEGMENT_BLOCK =
+    SEGMENT_SIZE / BLOCK_SIZE + 1;
+
+  {
+    PlainStorage::WriteBlockFileAdapter adapter(
+      "segment.out", BLOCK_SIZE,
+      PlainStorage::WriteBlockFileAdapter::OT_OPEN_OR_CREATE,
+      SEGMENT_SIZE);
+
+    for (unsigned long i = 0; i < 2; i++)
+    {
+      const unsigned long INDEX = i ? SECOND_SEGMENT_BLOCK : 0;
+      PlainStorage::WriteBlockFileAdapter::WriteBlockStruct_var block =
+        adapter.get_block(INDEX);
+      block->size(100);
+      memset(block->content(), 'B' + i, 100);
+    }
+
+    // Write and read views of the same block share the mapping
+    PlainStorage::WriteBlockFileAdapter::ReadBlockStruct_var read_block =
+      adapter.get_read_block(SECOND_SEGMENT_BLOCK);
+    if (*static_cast<const char*>(read_block->read_content()) != 'C')
+    {
+      std::cerr << "segment mode: unexpected content" << std::endl;
+      return false;
+    }
+  }
+
+  PlainStorage::ReadBlockFileAdapter adapter("segment.out", BLOCK_SIZE);
+  PlainStorage::ReadBlockFileAdapter::ReadBlockStruct_var first =
+    adapter.get_block(0);
+  PlainStorage::ReadBlockFileAdapter::ReadBlockStruct_var second =
+    adapter.get_block(SECOND_SEGMENT_BLOCK);
+  if (first->size() != 100 || second->size() != 100 ||
+    *static_cast<const char*>(first->read_content()) != 'B' ||
+    *static_cast<const char*>(second->read_content()) != 'C')
+  {
+    std::cerr << "segment mode: content is not persisted" << std::endl;
+    return false;
+  }
+
+  unlink("segment.out");
+  return true;
+}
+
+/**
+ * Compares appending of the blocks and random reads of them
+ * for the per block mapping and the segment mapping
+ */
+void
+benchmark(const char* name, unsigned long segment_size)
+  throw (eh::Exception)
+{
+  unlink("bench.out");
+
+  Generics::Timer append_timer;
+  append_timer.start();
+  {
+    PlainStorage::WriteBlockFileAdapter adapter(
+      "bench.out", BLOCK_SIZE,
+      PlainStorage::WriteBlockFileAdapter::OT_OPEN_OR_CREATE,
+      segment_size);
+    for (unsigned long i = 0; i < BENCH_BLOCKS; i++)
+    {
+      PlainStorage::WriteBlockFileAdapter::WriteBlockStruct_var block =
+        adapter.get_block(i);
+      block->size(sizeof(i));
+      memcpy(block->content(), &i, sizeof(i));
+    }
+  }
+  append_timer.stop();
+
+  PlainStorage::ReadBlockFileAdapter adapter(
+    "bench.out", BLOCK_SIZE, segment_size);
+  unsigned long sum = 0;
+
+  Generics::Timer read_timer;
+  read_timer.start();
+  for (unsigned long i = 0; i < BENCH_READS; i++)
+  {
+    PlainStorage::ReadBlockFileAdapter::ReadBlockStruct_var block =
+      adapter.get_block(Generics::safe_rand(BENCH_BLOCKS));
+    unsigned long value;
+    memcpy(&value, block->read_content(), sizeof(value));
+    sum += value;
+  }
+  read_timer.stop();
+
+  const double APPEND_TIME = append_timer.elapsed_time().as_double();
+  const double READ_TIME = read_timer.elapsed_time().as_double();
+
+  std::cout << name << ": append " << append_timer.elapsed_time() <<
+    " (" << static_cast<unsigned long>(BENCH_BLOCKS / APPEND_TIME) <<
+    " blocks/s), random read " << read_timer.elapsed_time() <<
+    " (" << static_cast<unsigned long>(BENCH_READS / READ_TIME) <<
+    " blocks/s)" << std::endl;
+
+  if (sum == 0)
+  {
+    std::cerr << name << ": unexpected content" << std::endl;
+  }
+
+  unlink("bench.out");
+}
+
 int
 main()
 {
@@ -120,6 +243,15 @@ main()
     {
       /* reading */
     }
+
+    if (!check_segment_mode())
+    {
+      return 1;
+    }
+
+    benchmark("per block mapping", 0);
+    benchmark("segment mapping",
+      PlainStorage::ReadBlockFileAdapter::DEFAULT_SEGMENT_SIZE);
   }
   catch(const eh::Exception& ex)
   {
@@ -23,10 +23,17 @@
 //
 
 #include <iostream>
+#include <iomanip>
 #include <String/AsciiStringManip.hpp>
+#include <String/StringManip.hpp>
 #include <String/UTF8IsProperty.hpp>
 #include <Generics/Rand.hpp>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TEST_RDTSC
+#endif
+
 void
 check_flatten() throw (eh::Exception);
 
@@ -56,6 +63,15 @@ check_random_flatten() throw (eh::Exception);
 void
 check_compare_caseless() throw (eh::Exception);
 
+void
+check_kernels() throw (eh::Exception);
+
+void
+check_categories() throw (eh::Exception);
+
+void
+benchmark_kernels() throw (eh::Exception);
+
 //
 // Test body below
 //
@@ -69,6 +85,9 @@ main()
     check_flatten();
     check_random_flatten();
     check_compare_caseless();
+    check_kernels();
+    check_categories();
+    benchmark_kernels();
     std::cout << "SUCCESS" << std::endl;
   }
   catch (eh::Exception& e)
@@ -194,3 +213,275 @@ check_compare_caseless() throw (eh::Exception)
     std::cerr << FUN << "fail 3" << std::endl;
   }
 }
+
+namespace
+{
+  const Kernel KERNELS[] = { K_SCALAR, K_SSE2, K_AVX2 };
+  const char* const KERNEL_NAMES[] = { "scalar", "sse2", "avx2" };
+
+  const Category::CharTable HIGH_TABLE("\x01-\x08\x7F-\xFF");
+  const CharCategory URL_DELIMITERS("/?#&=");
+
+  /**
+   * Random string of letters, spaces, delimiters and high bytes
+   */
+  std::string
+  random_string(size_t size) throw (eh::Exception)
+  {
+    const char CHARS[] = "aZ09 \t/?#&=\x80\xFF\x01.";
+    std::string str(size, 'x');
+    for (size_t i = 0; i < size; i++)
+    {
+      if (!Generics::safe_rand(4))
+      {
+        str[i] = CHARS[Generics::safe_rand(sizeof(CHARS) - 1)];
+      }
+    }
+    return str;
+  }
+
+  const char*
+  scalar_find(const Category::CharTable& table, const char* begin,
+    const char* end, bool owned) throw ()
+  {
+    for (; begin != end && table(*begin) != owned; ++begin)
+    {
+    }
+    return begin;
+  }
+
+  const char*
+  scalar_rfind(const Category::CharTable& table, const char* begin,
+    const char* end, bool owned) throw ()
+  {
+    for (const char* pos = end; pos != begin;)
+    {
+      if (table(*--pos) == owned)
+      {
+        return pos;
+      }
+    }
+    return end;
+  }
+}
+
+void
+check_kernels() throw (eh::Exception)
+{
+  const char FUN[] = "check_kernels(): ";
+  const Category::CharTable* const TABLES[] =
+    { &SPACE, &ALPHA_NUM, &URL_DELIMITERS, &HIGH_TABLE };
+
+  for (size_t k = 0; k < sizeof(KERNELS) / sizeof(*KERNELS); k++)
+  {
+    if (!supported(KERNELS[k]))
+    {
+      std::cout << FUN << KERNEL_NAMES[k] << " is not supported" <<
+        std::endl;
+      continue;
+    }
+    const Kernels::Functions& FUNCTIONS = Kernels::functions(KERNELS[k]);
+
+    for (size_t size = 0; size < 150; size++)
+    {
+      for (size_t offset = 0; offset < 3; offset++)
+      {
+        const std::string STR = random_string(size + offset);
+        const char* const BEGIN = STR.data() + offset;
+        const char* const END = STR.data() + STR.size();
+
+        for (size_t t = 0; t < sizeof(TABLES) / sizeof(*TABLES); t++)
+        {
+          for (int owned = 0; owned < 2; owned++)
+          {
+            if (FUNCTIONS.find_table(BEGIN, END, *TABLES[t], owned) !=
+              scalar_find(*TABLES[t], BEGIN, END, owned) ||
+              FUNCTIONS.rfind_table(BEGIN, END, *TABLES[t], owned) !=
+              scalar_rfind(*TABLES[t], BEGIN, END, owned))
+            {
+              std::cerr << FUN << KERNEL_NAMES[k] << " table " << t <<
+                " owned " << owned << " size " << size << " failed" <<
+                std::endl;
+            }
+          }
+        }
+
+        const Category::CharTable CHARS("/?#");
+        for (int owned = 0; owned < 2; owned++)
+        {
+          if (FUNCTIONS.find_chars(BEGIN, END, '/', '?', '#', owned) !=
+            scalar_find(CHARS, BEGIN, END, owned) ||
+            FUNCTIONS.rfind_chars(BEGIN, END, '/', '?', '#', owned) !=
+            scalar_rfind(CHARS, BEGIN, END, owned))
+          {
+            std::cerr << FUN << KERNEL_NAMES[k] << " chars owned " <<
+              owned << " size " << size << " failed" << std::endl;
+          }
+        }
+
+        for (size_t needle_size = 1; needle_size < 6; needle_size++)
+        {
+          const std::string NEEDLE =
+            STR.substr(Generics::safe_rand(STR.size() + 1), needle_size);
+          if (NEEDLE.empty())
+          {
+            continue;
+          }
+          const std::string TEXT(BEGIN, END);
+          const size_t FIRST = TEXT.find(NEEDLE);
+          const size_t LAST = TEXT.rfind(NEEDLE);
+          if (FUNCTIONS.find_block(BEGIN, END - BEGIN, NEEDLE.data(),
+              NEEDLE.size()) !=
+            (FIRST != std::string::npos ? BEGIN + FIRST : 0) ||
+            FUNCTIONS.rfind_block(BEGIN, END - BEGIN, NEEDLE.data(),
+              NEEDLE.size()) !=
+            (LAST != std::string::npos ? BEGIN + LAST : 0))
+          {
+            std::cerr << FUN << KERNEL_NAMES[k] << " block size " <<
+              size << " needle " << NEEDLE.size() << " failed" <<
+              std::endl;
+          }
+        }
+
+        std::string lower(STR), upper(STR);
+        FUNCTIONS.to_lower(&lower[0] + offset, &lower[0] + lower.size());
+        FUNCTIONS.to_upper(&upper[0] + offset, &upper[0] + upper.size());
+        for (size_t i = offset; i < STR.size(); i++)
+        {
+          if (lower[i] != (STR[i] >= 'A' && STR[i] <= 'Z' ?
+              STR[i] + 0x20 : STR[i]) ||
+            upper[i] != (STR[i] >= 'a' && STR[i] <= 'z' ?
+              STR[i] - 0x20 : STR[i]))
+          {
+            std::cerr << FUN << KERNEL_NAMES[k] << " case size " <<
+              size << " failed" << std::endl;
+            break;
+          }
+        }
+      }
+    }
+  }
+}
+
+void
+check_categories() throw (eh::Exception)
+{
+  const char FUN[] = "check_categories(): ";
+
+  const std::string URL =
+    "http://www.example.com/path/to/the/resource.html?query=value#anchor";
+  const Char3Category<'/', '?', '#'> DELIMITERS;
+  if (DELIMITERS.find_owned(URL.data() + 7, URL.data() + URL.size()) !=
+    URL.data() + 22 ||
+    DELIMITERS.rfind_owned(URL.data() + URL.size(), URL.data()) !=
+    URL.data() + URL.find('#') ||
+    Char1Category<'#'>().find_nonowned(URL.data(),
+      URL.data() + URL.size()) != URL.data())
+  {
+    std::cerr << FUN << "char categories failed" << std::endl;
+  }
+
+  const std::string PADDED = std::string(40, ' ') + "value \t value" +
+    std::string(33, '\t');
+  String::SubString trimmed(PADDED);
+  String::StringManip::trim(trimmed);
+  if (trimmed != "value \t value")
+  {
+    std::cerr << FUN << "trim failed: '" << trimmed << "'" << std::endl;
+  }
+
+  std::string dest;
+  flatten(dest, PADDED);
+  if (dest != " value value ")
+  {
+    std::cerr << FUN << "flatten failed: '" << dest << "'" << std::endl;
+  }
+
+  std::string text = "Mixed Case Text Longer Than One Block \xC0\xE0";
+  to_upper(text);
+  if (text != "MIXED CASE TEXT LONGER THAN ONE BLOCK \xC0\xE0")
+  {
+    std::cerr << FUN << "to_upper failed" << std::endl;
+  }
+  to_lower(text);
+  if (text != "mixed case text longer than one block \xC0\xE0")
+  {
+    std::cerr << FUN << "to_lower failed" << std::endl;
+  }
+}
+
+void
+benchmark_kernels() throw (eh::Exception)
+{
+#ifdef TEST_RDTSC
+  const size_t SIZES[] = { 16, 64, 256, 4096 };
+  const size_t TOTAL = 16 * 1024 * 1024;
+
+  std::cout << "Bytes per cycle:" << std::endl <<
+    "kernel  size  find_table rfind_table find_chars to_lower" <<
+    "  find_block" <<
+    std::endl;
+
+  for (size_t k = 0; k < sizeof(KERNELS) / sizeof(*KERNELS); k++)
+  {
+    if (!supported(KERNELS[k]))
+    {
+      continue;
+    }
+    const Kernels::Functions& FUNCTIONS = Kernels::functions(KERNELS[k]);
+
+    for (size_t s = 0; s < sizeof(SIZES) / sizeof(*SIZES); s++)
+    {
+      // Nothing is found, the whole string is scanned
+      std::string str(SIZES[s], 'a');
+      const char* const BEGIN = str.data();
+      const char* const END = BEGIN + str.size();
+      const size_t ITERATIONS = TOTAL / SIZES[s];
+      size_t found = 0;
+      double results[5];
+      const char NEEDLE[] = "abcdef";
+
+      for (int op = 0; op < 5; op++)
+      {
+        const unsigned long long START = __rdtsc();
+        for (size_t i = 0; i < ITERATIONS; i++)
+        {
+          switch (op)
+          {
+          case 0:
+            found += FUNCTIONS.find_table(BEGIN, END, SPACE, true) - BEGIN;
+            break;
+          case 1:
+            found += FUNCTIONS.rfind_table(BEGIN, END, SPACE, true) - BEGIN;
+            break;
+          case 2:
+            found += FUNCTIONS.find_chars(BEGIN, END, '/', '?', '#', true) -
+              BEGIN;
+            break;
+          case 3:
+            FUNCTIONS.to_lower(&str[0], &str[0] + str.size());
+            break;
+          default:
+            found += FUNCTIONS.find_block(BEGIN, str.size(), NEEDLE,
+              sizeof(NEEDLE) - 1) ? 0 : SIZES[s];
+            break;
+          }
+        }
+        results[op] = static_cast<double>(TOTAL) / (__rdtsc() - START);
+      }
+
+      std::cout << std::setw(6) << KERNEL_NAMES[k] << std::setw(6) <<
+        SIZES[s] << std::fixed << std::setprecision(2);
+      for (int op = 0; op < 5; op++)
+      {
+        std::cout << std::setw(12) << results[op];
+      }
+      std::cout << std::endl;
+      if (found != 4 * ITERATIONS * SIZES[s])
+      {
+        std::cerr << "benchmark_kernels(): unexpected result" << std::endl;
+      }
+    }
+  }
+#endif
+}
@@ -0,0 +1,274 @@
+/* 
+ * This file is part of the UnixCommons distribution (https://github.com/yoori/unixcommons).
+ * UnixCommons contains help classes and functions for Unix Server application writing
+ *
+ * Copyright (c) 2012 Yuri Kuznecov <yuri.kuznecov@gmail.com>.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Generics/Time.hpp>
+
+#include <String/AsciiStringManip.hpp>
+#include <String/KeywordMatcher.hpp>
+
+
+namespace
+{
+  bool failed = false;
+
+  void
+  fail(const char* what) throw ()
+  {
+    std::cerr << "FAIL: " << what << std::endl;
+    failed = true;
+  }
+
+  std::string
+  random_string(size_t size, const char* chars, size_t count)
+    throw (eh::Exception)
+  {
+    std::string str(size, ' ');
+    for (size_t i = 0; i < size; i++)
+    {
+      str[i] = chars[rand() % count];
+    }
+    return str;
+  }
+
+  /**
+   * Matches found with SubString::find() in the order of
+   * KeywordMatcher::find_all()
+   */
+  void
+  naive_find_all(const std::vector<std::string>& keywords,
+    const std::string& text, bool caseless,
+    String::KeywordMatcher::Matches& matches) throw (eh::Exception)
+  {
+    std::string lower_text(text);
+    if (caseless)
+    {
+      String::AsciiStringManip::to_lower(lower_text);
+    }
+    const String::SubString TEXT(lower_text);
+
+    for (size_t end = 1; end <= text.size(); end++)
+    {
+      // Longer keywords ending at the same place go first
+      for (size_t length = end; length; length--)
+      {
+        for (size_t i = 0; i < keywords.size(); i++)
+        {
+          std::string keyword(keywords[i]);
+          if (caseless)
+          {
+            String::AsciiStringManip::to_lower(keyword);
+          }
+          if (keyword.size() == length &&
+            TEXT.substr(end - length, length) == keyword)
+          {
+            const String::KeywordMatcher::Match MATCH =
+              { i, end - length };
+            matches.push_back(MATCH);
+          }
+        }
+      }
+    }
+  }
+
+  bool
+  equal_match(const String::KeywordMatcher::Match& left,
+    const String::KeywordMatcher::Match& right) throw ()
+  {
+    return left.keyword == right.keyword &&
+      left.position == right.position;
+  }
+
+  struct StopAfter
+  {
+    explicit
+    StopAfter(size_t limit) throw ()
+      : limit(limit), count(0)
+    {
+    }
+
+    bool
+    operator ()(size_t, size_t) throw ()
+    {
+      return ++count < limit;
+    }
+
+    size_t limit;
+    size_t count;
+  };
+}
+
+void
+test_simple() throw (eh::Exception)
+{
+  const char* const KEYWORDS[] = { "he", "she", "his", "hers", "she" };
+  const String::KeywordMatcher MATCHER(KEYWORDS,
+    KEYWORDS + sizeof(KEYWORDS) / sizeof(*KEYWORDS));
+
+  String::KeywordMatcher::Matches matches;
+  MATCHER.find_all(String::SubString("ushers"), matches);
+  // she(1) and its duplicate(4) end at 3, he(0) too, hers(3) ends at 5
+  const String::KeywordMatcher::Match EXPECTED[] =
+    { { 1, 1 }, { 4, 1 }, { 0, 2 }, { 3, 2 } };
+  if (matches.size() != sizeof(EXPECTED) / sizeof(*EXPECTED) ||
+    !std::equal(matches.begin(), matches.end(), EXPECTED, equal_match))
+  {
+    fail("simple: find_all");
+  }
+
+  size_t keyword;
+  if (MATCHER.find(String::SubString("this is"), &keyword) != 1 ||
+    keyword != 2 ||
+    MATCHER.find(String::SubString("nothing")) != String::SubString::NPOS ||
+    !MATCHER.contains(String::SubString("ahe")) ||
+    MATCHER.contains(String::SubString("h e")) ||
+    MATCHER.contains(String::SubString()))
+  {
+    fail("simple: find");
+  }
+
+  StopAfter stop(2);
+  if (MATCHER.match(String::SubString("ushers"), stop) || stop.count != 2)
+  {
+    fail("simple: stopped match");
+  }
+
+  try
+  {
+    const char* const EMPTY[] = { "a", "" };
+    String::KeywordMatcher matcher(EMPTY, EMPTY + 2);
+    fail("simple: empty keyword accepted");
+  }
+  catch (const String::KeywordMatcher::Exception&)
+  {
+  }
+}
+
+void
+test_random() throw (eh::Exception)
+{
+  const char CHARS[] = "abcAB.";
+  for (int i = 0; i < 300; i++)
+  {
+    const bool CASELESS = i % 2;
+    std::vector<std::string> keywords;
+    for (int j = rand() % 20 + 1; j; j--)
+    {
+      keywords.push_back(random_string(rand() % 4 + 1, CHARS, 6));
+    }
+    const std::string TEXT = random_string(rand() % 100, CHARS, 6);
+
+    const String::KeywordMatcher MATCHER(keywords.begin(), keywords.end(),
+      CASELESS);
+    String::KeywordMatcher::Matches matches, expected;
+    MATCHER.find_all(TEXT, matches);
+    naive_find_all(keywords, TEXT, CASELESS, expected);
+    if (matches.size() != expected.size() ||
+      !std::equal(matches.begin(), matches.end(), expected.begin(),
+        equal_match))
+    {
+      fail("random: find_all");
+      return;
+    }
+  }
+}
+
+void
+benchmark() throw (eh::Exception)
+{
+  const size_t KEYWORDS = 2000;
+  const size_t URLS = 1000;
+  const char CHARS[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+  std::vector<std::string> keywords;
+  for (size_t i = 0; i < KEYWORDS; i++)
+  {
+    keywords.push_back(random_string(rand() % 6 + 5, CHARS, 36));
+  }
+  std::vector<std::string> urls;
+  for (size_t i = 0; i < URLS; i++)
+  {
+    urls.push_back("http://www." + random_string(12, CHARS, 36) +
+      ".com/" + random_string(rand() % 80 + 20, CHARS, 36) + "?q=" +
+      keywords[rand() % KEYWORDS]);
+  }
+
+  Generics::Timer timer;
+  timer.start();
+  size_t found = 0;
+  for (size_t i = 0; i < URLS; i++)
+  {
+    const String::SubString URL(urls[i]);
+    for (size_t j = 0; j < KEYWORDS; j++)
+    {
+      found += URL.find(String::SubString(keywords[j])) !=
+        String::SubString::NPOS;
+    }
+  }
+  timer.stop();
+  std::cout << KEYWORDS << " keywords in " << URLS << " urls: find() " <<
+    timer.elapsed_time();
+
+  timer.start();
+  const String::KeywordMatcher MATCHER(keywords.begin(), keywords.end());
+  timer.stop();
+  std::cout << ", matcher construction " << timer.elapsed_time();
+
+  timer.start();
+  size_t matched = 0;
+  String::KeywordMatcher::Matches matches;
+  for (size_t i = 0; i < URLS; i++)
+  {
+    matches.clear();
+    MATCHER.find_all(urls[i], matches);
+    matched += matches.size();
+  }
+  timer.stop();
+  std::cout << ", find_all() " << timer.elapsed_time() << std::endl;
+
+  if (matched < found)
+  {
+    fail("benchmark: matches lost");
+  }
+}
+
+int
+main()
+{
+  try
+  {
+    test_simple();
+    test_random();
+    benchmark();
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "FAIL: " << ex.what() << std::endl;
+    failed = true;
+  }
+
+  return failed;
+}
@@ -140,6 +140,67 @@ main()
       }
     }
 
+    {
+      const String::SubString REGEXP("A(.*)Z(q)?");
+      const String::SubString SUBJECT("q9f834fAf434Zf43f4");
+      RegEx r(REGEXP, 0, 0, true);
+      RegEx::Result result;
+      if (!r.match(SUBJECT) || !r.search(result, SUBJECT) ||
+        result.size() != 3 || result[1] != "f434")
+      {
+        std::cerr << "Invalid JIT search result" << std::endl;
+      }
+      RegEx copy(r);
+      if (copy.jit() != r.jit() || !copy.match(SUBJECT))
+      {
+        std::cerr << "Invalid JIT copy" << std::endl;
+      }
+
+      RegEx::MatchData& data = RegEx::thread_match_data();
+      if (&data != &RegEx::thread_match_data())
+      {
+        std::cerr << "Thread match data is not reused" << std::endl;
+      }
+      for (int i = 0; i < 2; i++)
+      {
+        if (!r.search(data, SUBJECT) || data.size() != 2 ||
+          data[0] != "Af434Z" || data[1] != "f434" || data[2] != "" ||
+          data[3] != "")
+        {
+          std::cerr << "Invalid match data" << std::endl;
+        }
+      }
+      if (r.search(data, String::SubString("abc")) || data.size() ||
+        data[0] != "")
+      {
+        std::cerr << "Match data illegally filled" << std::endl;
+      }
+    }
+
+    {
+      const char* REGEXPS[] = { "^a", "b$", "c" };
+      std::vector<RegEx> regexps;
+      for (size_t i = 0; i < sizeof(REGEXPS) / sizeof(*REGEXPS); i++)
+      {
+        regexps.push_back(RegEx(String::SubString(REGEXPS[i]), 0, 0, true));
+      }
+      const String::SubString SUBJECTS[] =
+      {
+        String::SubString("xxb"),
+        String::SubString("abc"),
+        String::SubString("xyz")
+      };
+      const size_t EXPECTED[] = { 1, 0, regexps.size() };
+      for (size_t i = 0; i < sizeof(SUBJECTS) / sizeof(*SUBJECTS); i++)
+      {
+        if (RegEx::match_any(regexps.begin(), regexps.end(), SUBJECTS[i]) !=
+          regexps.begin() + EXPECTED[i])
+        {
+          std::cerr << "Invalid match_any result" << std::endl;
+        }
+      }
+    }
+
     return 0;
   }
   catch (const eh::Exception& ex)
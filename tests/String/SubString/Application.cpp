@@ -19,6 +19,7 @@
 
 
 
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -530,6 +531,41 @@ check_find() throw (eh::Exception)
    RoughSubString("p"));
 }
 
+void
+check_find_random() throw (eh::Exception)
+{
+  // Small alphabet gives many partial matches
+  const char CHARS[] = "abca";
+  for (unsigned i = 0; i < 3000; i++)
+  {
+    std::string text(rand() % 200, 'a');
+    for (size_t j = 0; j < text.size(); j++)
+    {
+      text[j] = CHARS[rand() % 3];
+    }
+    std::string needle(rand() % 12 + 1, 'a');
+    for (size_t j = 0; j < needle.size(); j++)
+    {
+      needle[j] = CHARS[rand() % 3];
+    }
+    const size_t POS = rand() % (text.size() + 2);
+
+    const String::SubString TEXT(text);
+    const String::SubString NEEDLE(needle);
+    if (TEXT.find(NEEDLE, POS) != text.find(needle, POS) ||
+      TEXT.find(NEEDLE) != text.find(needle) ||
+      TEXT.rfind(NEEDLE, POS) != text.rfind(needle, POS) ||
+      TEXT.rfind(NEEDLE) != text.rfind(needle) ||
+      TEXT.rfind(needle[0], POS) != text.rfind(needle[0], POS) ||
+      TEXT.find(needle[0], POS) != text.find(needle[0], POS))
+    {
+      std::cerr << FNS << "fail for '" << text << "' and '" << needle <<
+        "' from " << POS << std::endl;
+      return;
+    }
+  }
+}
+
 void
 check_compile_constrain() throw ()
 {
@@ -594,6 +630,7 @@ main(int /*argc*/, char** /*argv*/)
     check_out();
     check_equal();
     check_find();
+    check_find_random();
     check_compile_constrain();
     check_plus();
     std::cout << "SUCCESS" << std::endl;
@@ -28,8 +28,10 @@
 #include <sstream>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include <Generics/FileCache.hpp>
+#include <Generics/Time.hpp>
 
 #include <String/TextTemplate.hpp>
 
@@ -88,13 +90,14 @@ CallBack::get_argument(const char* key) const
   }
 }
 
-class TestTextTemplateUpdateStrategy : public TextTemplate::UpdateStrategy
+template <typename UpdateStrategy>
+class TestUpdateStrategy : public UpdateStrategy
 {
 public:
-  TestTextTemplateUpdateStrategy(const char* fname) throw (eh::Exception);
+  TestUpdateStrategy(const char* fname) throw (eh::Exception);
 
   virtual
-  ~TestTextTemplateUpdateStrategy() throw ();
+  ~TestUpdateStrategy() throw ();
 
   virtual String::SubString
   start_lexeme() const throw (eh::Exception);
@@ -102,6 +105,69 @@ public:
   end_lexeme() const throw (eh::Exception);
 };
 
+typedef TestUpdateStrategy<TextTemplate::UpdateStrategy>
+  TestTextTemplateUpdateStrategy;
+typedef TestUpdateStrategy<TextTemplate::CompiledUpdateStrategy>
+  TestCompiledUpdateStrategy;
+
+/**
+ * Compares instantiation of the compiled template with the slots bound
+ * once against the items walk with the hash table lookups
+ */
+void
+benchmark(const TextTemplate::IStream& text_template,
+  const TextTemplate::Compiled& compiled,
+  const TextTemplate::Args& callback) throw (eh::Exception)
+{
+  const unsigned long ITERATIONS = 20000;
+
+  TextTemplate::Compiled::Values values(compiled.slots());
+  std::vector<std::string> strings(compiled.slots());
+  for (size_t i = 0; i < compiled.slots(); i++)
+  {
+    callback.get_argument(compiled.key(i), strings[i]);
+    values[i] = strings[i];
+  }
+
+  Generics::Timer timer;
+  timer.start();
+  size_t basic_size = 0;
+  for (unsigned long i = 0; i < ITERATIONS; i++)
+  {
+    basic_size += text_template.instantiate(callback).size();
+  }
+  timer.stop();
+  const Generics::Time BASIC = timer.elapsed_time();
+
+  timer.start();
+  size_t callback_size = 0;
+  for (unsigned long i = 0; i < ITERATIONS; i++)
+  {
+    callback_size += compiled.instantiate(callback).size();
+  }
+  timer.stop();
+  const Generics::Time CALLBACK = timer.elapsed_time();
+
+  timer.start();
+  size_t values_size = 0;
+  std::string out;
+  for (unsigned long i = 0; i < ITERATIONS; i++)
+  {
+    compiled.instantiate(values, out);
+    values_size += out.size();
+  }
+  timer.stop();
+
+  std::cout << "Instantiations: " << ITERATIONS << ", " <<
+    compiled.slots() << " slots\n  items: " << BASIC <<
+    "\n  compiled, args callback: " << CALLBACK <<
+    "\n  compiled, bound values: " << timer.elapsed_time() << std::endl;
+  if (callback_size != basic_size || values_size != basic_size)
+  {
+    std::cerr << "Compiled template result size differs" << std::endl;
+  }
+}
+
 
 int
 main(int argc, char* argv[])
@@ -128,10 +194,13 @@ main(int argc, char* argv[])
 
   typedef Generics::FileCacheManager<TestTextTemplateUpdateStrategy>
     TextTemplateCacheManager;
+  typedef Generics::FileCacheManager<TestCompiledUpdateStrategy>
+    CompiledCacheManager;
 
   try
   {
     TextTemplateCacheManager manager;
+    CompiledCacheManager compiled_manager;
 
 #if 0
     CallBack callback("http://upsa.ocslab.com/bugzilla/",
@@ -172,6 +241,8 @@ main(int argc, char* argv[])
     {
       TextTemplateCacheManager::BufferHolder_var text_template =
         manager.get(file_name);
+      CompiledCacheManager::BufferHolder_var compiled =
+        compiled_manager.get(file_name);
 
       std::cout << "Instantiating template (" << i << "):\n";
       {
@@ -184,6 +255,13 @@ main(int argc, char* argv[])
           std::cout << " " << *itor;
         }
         std::cout << std::endl;
+
+        TextTemplate::Keys compiled_keys;
+        (*compiled)->keys(callback, compiled_keys);
+        if (compiled_keys != keys)
+        {
+          std::cerr << "Unexpected keys of compiled template" << std::endl;
+        }
       }
       std::string out((*text_template)->instantiate(callback));
       std::cout << out << std::endl << std::endl;
@@ -193,6 +271,15 @@ main(int argc, char* argv[])
         std::cerr << "Unexpected result of template instantiation" <<
           std::endl;
       }
+      if ((*compiled)->instantiate(callback) != out)
+      {
+        std::cerr << "Unexpected result of compiled template "
+          "instantiation" << std::endl;
+      }
+      if (!i)
+      {
+        benchmark(**text_template, **compiled, callback);
+      }
 
       sleep(1);
     }
@@ -213,27 +300,33 @@ main(int argc, char* argv[])
 }
 
 //
-// TestTextTemplateUpdateStrategy class
+// TestUpdateStrategy class
 //
 
-TestTextTemplateUpdateStrategy::TestTextTemplateUpdateStrategy(
+template <typename UpdateStrategy>
+TestUpdateStrategy<UpdateStrategy>::TestUpdateStrategy(
   const char* fname) throw (eh::Exception)
-  : TextTemplate::UpdateStrategy(fname)
+  : UpdateStrategy(fname)
 {
 }
 
+template <typename UpdateStrategy>
 String::SubString
-TestTextTemplateUpdateStrategy::start_lexeme() const throw (eh::Exception)
+TestUpdateStrategy<UpdateStrategy>::start_lexeme() const
+  throw (eh::Exception)
 {
   return String::TextTemplate::Basic::DEFAULT_LEXEME;
 }
 
+template <typename UpdateStrategy>
 String::SubString
-TestTextTemplateUpdateStrategy::end_lexeme() const throw (eh::Exception)
+TestUpdateStrategy<UpdateStrategy>::end_lexeme() const
+  throw (eh::Exception)
 {
   return String::TextTemplate::Basic::DEFAULT_LEXEME;
 }
 
-TestTextTemplateUpdateStrategy::~TestTextTemplateUpdateStrategy() throw ()
+template <typename UpdateStrategy>
+TestUpdateStrategy<UpdateStrategy>::~TestUpdateStrategy() throw ()
 {
 }
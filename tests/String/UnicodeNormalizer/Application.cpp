@@ -961,9 +961,259 @@ main()
   return 0;
 }
 #else
+// @file UnicodeNormalizer/Application.cpp
+
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include <Generics/Time.hpp>
+#include <String/StringManip.hpp>
+#include <String/UnicodeNormalizer.hpp>
+
+namespace
+{
+  DECLARE_EXCEPTION(TestException, eh::DescriptiveException);
+
+  const std::size_t REPETITIONS = 20;
+  const std::size_t CORPUS_SIZE = 1024 * 1024;
+
+  const char* const SAMPLES[] =
+  {
+    "example.com",
+    "ExAmple.COM",
+    "\xD0\xBF\xD1\x80\xD0\xB8\xD0\xBC\xD0\xB5\xD1\x80.\xD1\x80\xD1\x84",
+    "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xBC\xD0\xB5\xD1\x80",
+    "a\xCC\x81",
+    "ba\xCC\x81" "b",
+    "a\xCC\xA3\xCC\x81",
+    "a\xCC\x81\xCC\xA3",
+    "\xEF\xAC\x81" "x",
+    "x\xC2\xAD" "y",
+    "\xED\x95\x9C\xEA\xB5\xAD\xEC\x96\xB4",
+    "\xE1\x84\x92\xE1\x85\xA1\xE1\x86\xAB",
+    "\xE4\xB8\xAD\xE6\x96\x87",
+    "\xCC\x81" "abc",
+    "ab\xFF",
+    "ab\xD0",
+  };
+
+  /**
+   * Reference: the text is converted to wide and normalized as a whole
+   */
+  bool
+  wide_normalize(const String::SubString& input, std::string& output,
+    bool idna2008) throw (eh::Exception)
+  {
+    Generics::ArrayWChar wide;
+    try
+    {
+      wide = String::StringManip::utf8_to_wchar(input);
+    }
+    catch (const String::StringManip::InvalidFormatException&)
+    {
+      return false;
+    }
+    std::wstring normalized;
+    if (!String::lower_and_normalize(
+      String::WSubString(wide.get()), normalized, idna2008))
+    {
+      return false;
+    }
+    output.clear();
+    String::StringManip::wchar_to_utf8(String::WSubString(normalized),
+      output);
+    return true;
+  }
+
+  /**
+   * @param input UTF-8 text
+   * @param in_place if normalized input must not be copied
+   */
+  bool
+  check(const String::SubString& input, bool in_place)
+    throw (eh::Exception)
+  {
+    bool result = true;
+    for (int idna2008 = 0; idna2008 < 2; idna2008++)
+    {
+      std::string expected;
+      const bool EXPECTED = wide_normalize(input, expected, idna2008);
+
+      String::SubString output;
+      std::string buffer;
+      if (String::lower_and_normalize(input, output, buffer, idna2008) !=
+        EXPECTED || (EXPECTED && output != expected))
+      {
+        std::cerr << "Normalization of '" << input << "' (" <<
+          (idna2008 ? "IDNA2008" : "IDNA2003") << ") mismatch: '" <<
+          output << "' instead of '" << expected << "'" << std::endl;
+        result = false;
+      }
+      else if (in_place && EXPECTED && output == input &&
+        output.data() != input.data())
+      {
+        std::cerr << "Normalized '" << input << "' is copied" << std::endl;
+        result = false;
+      }
+    }
+    return result;
+  }
+
+  bool
+  check_samples() throw (eh::Exception)
+  {
+    bool result = true;
+    for (std::size_t i = 0; i < sizeof(SAMPLES) / sizeof(*SAMPLES); i++)
+    {
+      result &= check(String::SubString(SAMPLES[i]), true);
+    }
+    return result;
+  }
+
+  /**
+   * Source column of NormalizationTest.txt is checked against
+   * the normalization of the wide text
+   */
+  bool
+  check_conformance() throw (eh::Exception)
+  {
+    const char* ev = getenv("TEST_TOP_SRC_DIR");
+    std::string path = ev ? ev : "../../../..";
+    path += "/tests/String/UnicodeNormalizer/Data/NormalizationTest.txt";
+    std::ifstream ifs(path.c_str());
+    if (!ifs)
+    {
+      std::cerr << "File " << path << " open error" << std::endl;
+      return false;
+    }
+
+    bool result = true;
+    std::size_t lines = 0;
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+      if (line.empty() || line[0] == '#' || line[0] == '@')
+      {
+        continue;
+      }
+      std::istringstream istr(line.substr(0, line.find(';')));
+      std::string utf8;
+      unsigned long code;
+      while (istr >> std::hex >> code)
+      {
+        String::StringManip::wchar_to_utf8(static_cast<wchar_t>(code),
+          utf8);
+      }
+      result &= check(String::SubString(utf8), false);
+      lines++;
+    }
+    std::cout << "Checked " << lines << " conformance lines" << std::endl;
+    return result;
+  }
+
+  double
+  megabytes_per_second(std::size_t size, const Generics::Timer& timer)
+    throw ()
+  {
+    const long long MICROSECONDS = timer.elapsed_time().microseconds();
+    return MICROSECONDS ?
+      static_cast<double>(size) * REPETITIONS / MICROSECONDS : 0.;
+  }
+
+  /**
+   * Already normalized host names in several scripts with a few
+   * upper case ones
+   */
+  void
+  benchmark() throw (eh::Exception)
+  {
+    const char* const WORDS[] =
+    {
+      "www.example.com ",
+      "\xD0\xBF\xD1\x80\xD0\xB8\xD0\xBC\xD0\xB5\xD1\x80.\xD1\x80\xD1\x84 ",
+      "\xE4\xB8\xAD\xE6\x96\x87.\xE4\xB8\xAD\xE5\x9B\xBD ",
+      "\xCE\xB5\xCE\xBB\xCE\xBB\xCE\xAC\xCE\xB4\xCE\xB1.gr ",
+      "Example.COM ",
+    };
+    const std::size_t WORDS_SIZE = sizeof(WORDS) / sizeof(*WORDS);
+
+    std::string corpus;
+    std::string normalized;
+    for (std::size_t i = 0; corpus.size() < CORPUS_SIZE; i++)
+    {
+      // Every tenth word is not normalized
+      corpus += WORDS[i % 10 == 9 ? WORDS_SIZE - 1 : i % (WORDS_SIZE - 1)];
+      normalized += WORDS[i % (WORDS_SIZE - 1)];
+    }
+
+    std::string expected;
+    std::string buffer;
+    String::SubString output;
+
+    Generics::Timer timer;
+    timer.start();
+    for (std::size_t i = 0; i < REPETITIONS; i++)
+    {
+      wide_normalize(corpus, expected, false);
+    }
+    timer.stop();
+    std::cout << "wide conversion: " <<
+      megabytes_per_second(corpus.size(), timer) << " MB/s" << std::endl;
+
+    timer.start();
+    for (std::size_t i = 0; i < REPETITIONS; i++)
+    {
+      String::lower_and_normalize(String::SubString(corpus), output,
+        buffer, false);
+    }
+    timer.stop();
+    std::cout << "UTF-8 quick check: " <<
+      megabytes_per_second(corpus.size(), timer) << " MB/s" << std::endl;
+
+    if (output != expected)
+    {
+      throw TestException("Benchmark results differ");
+    }
+
+    timer.start();
+    for (std::size_t i = 0; i < REPETITIONS; i++)
+    {
+      String::lower_and_normalize(String::SubString(normalized), output,
+        buffer, false);
+    }
+    timer.stop();
+    std::cout << "UTF-8 quick check of normalized text: " <<
+      megabytes_per_second(normalized.size(), timer) << " MB/s" <<
+      std::endl;
+
+    if (output.data() != normalized.data())
+    {
+      throw TestException("Normalized text is copied");
+    }
+  }
+}
+
 int
 main()
 {
-  return 0;
+  try
+  {
+    bool result = check_samples();
+    result &= check_conformance();
+    benchmark();
+    return !result;
+  }
+  catch (const eh::Exception& ex)
+  {
+    std::cerr << "Exception raised: " << ex.what() << std::endl;
+  }
+  catch (...)
+  {
+    std::cerr << "Unknown exception raised" << std::endl;
+  }
+  return 1;
 }
 #endif
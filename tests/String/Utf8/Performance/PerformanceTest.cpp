@@ -23,6 +23,7 @@
 //   Defines the entry point for the test console application.
 //
 
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 
@@ -489,6 +490,164 @@ performance_arrays_test() throw (eh::Exception)
   sstr = ut8_multilang;  test_octets_counting();
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Mixed-script corpora: ASCII text with multibyte words inserted
+
+namespace
+{
+  struct MixedCorpus
+  {
+    const char NAME[32];
+    const char* TEXT;
+    const char* WORD;
+    std::size_t PERIOD;
+  };
+
+  // WORD is inserted after every PERIOD words of TEXT
+  const MixedCorpus MIXED_CORPORA[] =
+  {
+    {"ASCII", TEXT_CORPUS[0], "", 0},
+    {"ASCII, rare Cyrillic", TEXT_CORPUS[0], "Стартовая", 20},
+    {"ASCII, frequent Cyrillic", TEXT_CORPUS[0], "Стартовая", 3},
+    {"ASCII, rare CJK", TEXT_CORPUS[0], "전세계의호텔", 20},
+    {"Cyrillic", TEXT_CORPUS[1], "", 0},
+  };
+
+  const std::size_t MIXED_CORPUS_SIZE = 16 * 1024;
+
+  std::string
+  make_mixed_corpus(const MixedCorpus& corpus) throw (eh::Exception)
+  {
+    std::string result;
+    std::size_t words = 0;
+    while (result.size() < MIXED_CORPUS_SIZE)
+    {
+      for (const char* word = corpus.TEXT; *word;)
+      {
+        const char* end = strchr(word, ' ');
+        if (!end)
+        {
+          end = word + strlen(word);
+        }
+        result.append(word, end).push_back(' ');
+        if (corpus.PERIOD && ++words % corpus.PERIOD == 0)
+        {
+          result.append(corpus.WORD).push_back(' ');
+        }
+        word = *end ? end + 1 : end;
+      }
+    }
+    return result;
+  }
+
+  double
+  megabytes_per_second(std::size_t size, const Generics::Timer& timer)
+    throw ()
+  {
+    const long long MICROSECONDS = timer.elapsed_time().microseconds();
+    return MICROSECONDS ?
+      static_cast<double>(size) * RepetitionCount / MICROSECONDS : 0.;
+  }
+
+  /**
+   * Symbol by symbol conversion never takes the ASCII block path,
+   * its result is the reference one
+   */
+  template <typename Action>
+  void
+  mixed_case_change(const char* name, const std::string& corpus)
+    throw (eh::Exception)
+  {
+    test_context.set_operation(name);
+
+    std::string expected;
+    std::string symbol;
+    for (const char* p = corpus.data(), * const END = p + corpus.size();
+      p != END;)
+    {
+      const std::size_t OCTETS = UTF8Handler::get_octet_count(*p);
+      case_change<Action>(SubString(p, OCTETS), symbol);
+      expected += symbol;
+      p += OCTETS;
+    }
+
+    std::string result;
+    Generics::Timer timer;
+    timer.start();
+    for (std::size_t i = 0; i < RepetitionCount; ++i)
+    {
+      case_change<Action>(corpus, result);
+    }
+    timer.stop();
+    test_context.test_equal(result == expected, true);
+
+    std::cout << '\t' << name << '=' <<
+      megabytes_per_second(corpus.size(), timer) << " MB/s" << std::endl;
+  }
+
+  void
+  mixed_validation(const std::string& corpus) throw (eh::Exception)
+  {
+    test_context.set_operation("is_correct_utf8_string");
+
+    Generics::Timer timer;
+    timer.start();
+    for (std::size_t i = 0; i < RepetitionCount; ++i)
+    {
+      test_context.test_equal(
+        UTF8Handler::is_correct_utf8_string(corpus.c_str()),
+        static_cast<const char*>(0));
+    }
+    timer.stop();
+    std::cout << "\tvalidation (zero terminated)=" <<
+      megabytes_per_second(corpus.size(), timer) << " MB/s" << std::endl;
+
+    timer.start();
+    for (std::size_t i = 0; i < RepetitionCount; ++i)
+    {
+      test_context.test_equal(
+        UTF8Handler::is_correct_utf8_string(corpus.data(), corpus.size()),
+        static_cast<const char*>(0));
+    }
+    timer.stop();
+    std::cout << "\tvalidation (sized)=" <<
+      megabytes_per_second(corpus.size(), timer) << " MB/s" << std::endl;
+
+    // Truncated and ill-formed sequences are found at the same places
+    const char* const BAD_TAILS[] =
+      { "\xD0", "\xE0\xA4", "\x80", "\xC1\xBF" };
+    for (std::size_t i = 0; i < sizeof(BAD_TAILS) / sizeof(BAD_TAILS[0]);
+      ++i)
+    {
+      const std::string BAD = corpus + BAD_TAILS[i] + "tail";
+      const char* const INVALID = BAD.data() + corpus.size();
+      test_context.test_equal(
+        UTF8Handler::is_correct_utf8_string(BAD.c_str()) == INVALID, true);
+      test_context.test_equal(UTF8Handler::is_correct_utf8_string(
+        BAD.data(), corpus.size() + strlen(BAD_TAILS[i])) == INVALID, true);
+    }
+  }
+}
+
+void
+mixed_script_performance_test() throw (eh::Exception)
+{
+  std::cout << "Mixed-script corpora parameters:" << std::endl;
+  std::cout << std::fixed << std::setprecision(2);
+  for (std::size_t i = 0;
+    i < sizeof(MIXED_CORPORA) / sizeof(MIXED_CORPORA[0]); ++i)
+  {
+    std::cout << "Corpus: " << MIXED_CORPORA[i].NAME << std::endl;
+    const std::string CORPUS = make_mixed_corpus(MIXED_CORPORA[i]);
+    test_context.set_operand(MIXED_CORPORA[i].NAME);
+    mixed_case_change<Lower>("Lower", CORPUS);
+    mixed_case_change<Uniform>("Uniform", CORPUS);
+    mixed_case_change<Upper>("Upper", CORPUS);
+    mixed_case_change<Simplify>("Simplify", CORPUS);
+    mixed_validation(CORPUS);
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Performance comparison
 // Task solved with OLD API and with NEW API
@@ -511,6 +670,7 @@ main(int argc, char *argv[] )
     is_property_performance_test();
     single_performance_test();
     performance_arrays_test();
+    mixed_script_performance_test();
     std::cout << "SUCCESS" << std::endl;
   }
   catch (const eh::Exception& e)